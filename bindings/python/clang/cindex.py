@@ -1468,6 +1468,43 @@ class Cursor(Structure):
             for descendant in child.walk_preorder():
                 yield descendant
 
+    def get_descendant_records(self, include_usrs=False):
+        """Return CursorRecord instances describing all of the descendants of
+        this cursor, in depth-first preorder.
+
+        Unlike walk_preorder(), this performs the whole traversal with a
+        single call into libclang, which is much faster for large ASTs. The
+        parent of each record is the index of the record of its parent
+        cursor, or -1 for the children of this cursor.
+        """
+        options = 1 # CXCursorRecord_IncludeSpellings
+        if include_usrs:
+            options |= 2 # CXCursorRecord_IncludeUSRs
+
+        num_records = 1024
+        strings_size = 16384
+        while True:
+            records = (CursorRecord * num_records)()
+            strings = create_string_buffer(strings_size)
+            strings_needed = c_uint()
+            records_needed = conf.lib.clang_visitChildrenBulk(self, options,
+                records, num_records, strings, strings_size,
+                byref(strings_needed))
+            if (records_needed <= num_records and
+                strings_needed.value <= strings_size):
+                break
+
+            # The buffers were too small; retry with the sizes we were given.
+            num_records = max(num_records, records_needed)
+            strings_size = max(strings_size, strings_needed.value)
+
+        string_table = strings.raw[:strings_needed.value]
+        result = records[:records_needed]
+        for record in result:
+            record._strings = string_table
+            record._tu = self._tu
+        return result
+
     def get_tokens(self):
         """Obtain Token instances formulating that compose this Cursor.
 
@@ -1521,6 +1558,50 @@ class Cursor(Structure):
         res._tu = args[0]._tu
         return res
 
+class CursorRecord(Structure):
+    """
+    A compact description of a cursor, as produced by
+    Cursor.get_descendant_records().
+    """
+    _fields_ = [("_kind_id", c_int),
+                ("parent", c_int),
+                ("_file", c_object_p),
+                ("start_line", c_uint),
+                ("start_column", c_uint),
+                ("start_offset", c_uint),
+                ("end_line", c_uint),
+                ("end_column", c_uint),
+                ("end_offset", c_uint),
+                ("_spelling", c_uint),
+                ("_usr", c_uint)]
+
+    def _get_string(self, offset):
+        return self._strings[offset:self._strings.index('\0', offset)]
+
+    @property
+    def kind(self):
+        """Return the kind of the cursor."""
+        return CursorKind.from_id(self._kind_id)
+
+    @property
+    def file(self):
+        """Return the file containing the start of the cursor, if any."""
+        if not self._file:
+            return None
+        f = File(self._file)
+        f._tu = self._tu
+        return f
+
+    @property
+    def spelling(self):
+        """Return the spelling of the cursor."""
+        return self._get_string(self._spelling)
+
+    @property
+    def usr(self):
+        """Return the USR of the cursor, if it was requested."""
+        return self._get_string(self._usr)
+
 class StorageClass(object):
     """
     Describes the storage class of a declaration
@@ -3337,6 +3418,11 @@ functionList = [
    [Cursor, callbacks['cursor_visit'], py_object],
    c_uint),
 
+  ("clang_visitChildrenBulk",
+   [Cursor, c_uint, POINTER(CursorRecord), c_uint, c_char_p, c_uint,
+    POINTER(c_uint)],
+   c_uint),
+
   ("clang_Cursor_getNumArguments",
    [Cursor],
    c_int),
@@ -3551,6 +3637,7 @@ __all__ = [
     'CompileCommand',
     'CursorKind',
     'Cursor',
+    'CursorRecord',
     'Diagnostic',
     'File',
     'FixIt',
@@ -68,6 +68,26 @@ def test_get_children():
     assert tu_nodes[2].displayname == 'f0(int, int)'
     assert tu_nodes[2].is_definition() == True
 
+def test_get_descendant_records():
+    tu = get_tu(kInput)
+
+    records = tu.cursor.get_descendant_records(include_usrs=True)
+    cursors = list(tu.cursor.walk_preorder())[1:]
+    assert len(records) == len(cursors)
+    for record, cursor in zip(records, cursors):
+        assert record.kind == cursor.kind
+        assert record.spelling == cursor.spelling
+        assert record.start_line == cursor.extent.start.line
+        assert record.end_column == cursor.extent.end.column
+
+    assert records[0].kind == CursorKind.STRUCT_DECL
+    assert records[0].parent == -1
+    assert records[0].usr == 'c:@S@s0'
+    assert records[0].file.name == 't.c'
+    assert records[1].kind == CursorKind.FIELD_DECL
+    assert records[1].parent == 0
+    assert records[1].spelling == 'a'
+
 def test_references():
     """Ensure that references to TranslationUnit are kept."""
     tu = get_tu('int x;')
@@ -22,6 +22,7 @@
 #include "clang-c/CXErrorCode.h"
 #include "clang-c/CXString.h"
 #include "clang-c/BuildSystem.h"
+#include "clang-c/CXCompilationDatabase.h"
 
 /**
  * \brief The version constants for the libclang API.
@@ -32,7 +33,7 @@
  * compatible, thus CINDEX_VERSION_MAJOR is expected to remain stable.
  */
 #define CINDEX_VERSION_MAJOR 0
-#define CINDEX_VERSION_MINOR 29
+#define CINDEX_VERSION_MINOR 37
 
 #define CINDEX_VERSION_ENCODE(major, minor) ( \
       ((major) * 10000)                       \
@@ -82,6 +83,17 @@ typedef void *CXIndex;
 
 /**
  * \brief A single translation unit, which resides in an index.
+ *
+ * A translation unit may be used from several threads at once. Calls that
+ * use the same translation unit, or cursors, types and source locations from
+ * it, take turns, and a reparse waits for the calls in progress to finish.
+ * Cursors, types and source locations obtained before a reparse must not be
+ * used after it, and a translation unit must not be disposed of while other
+ * threads still use it.
+ *
+ * Visitors and other callbacks run while the translation unit is in use, so
+ * they may call back into libclang on the same thread, but must not wait for
+ * other threads that use the same translation unit.
  */
 typedef struct CXTranslationUnitImpl *CXTranslationUnit;
 
@@ -274,6 +286,28 @@ CINDEX_LINKAGE void clang_CXIndex_setGlobalOptions(CXIndex, unsigned options);
  */
 CINDEX_LINKAGE unsigned clang_CXIndex_getGlobalOptions(CXIndex);
 
+/**
+ * \brief Configures the cache through which the translation units of an
+ * index share their precompiled preambles.
+ *
+ * Translation units parsed with \c CXTranslationUnit_PrecompiledPreamble
+ * reuse the precompiled preamble of any other translation unit in the same
+ * index whose main file starts with the same preamble and that was parsed
+ * with compatible options. By default the cache only lives as long as the
+ * index does.
+ *
+ * Only affects translation units parsed after the call.
+ *
+ * \param Directory If non-NULL, a directory in which precompiled preambles
+ * are kept, so that they can be reused by later processes.
+ *
+ * \param MaxSize The maximum total size, in bytes, of the precompiled
+ * preambles that the cache keeps, or zero for no limit. The least recently
+ * used preambles are evicted first.
+ */
+CINDEX_LINKAGE void clang_CXIndex_setPreambleCacheOptions(
+    CXIndex, const char *Directory, unsigned long long MaxSize);
+
 /**
  * \defgroup CINDEX_FILES File manipulation routines
  *
@@ -1391,7 +1425,29 @@ enum CXReparse_Flags {
   /**
    * \brief Used to indicate that no special reparsing options are needed.
    */
-  CXReparse_None = 0x0
+  CXReparse_None = 0x0,
+
+  /**
+   * \brief Used to indicate that an out-of-date precompiled preamble should be
+   * rebuilt on a background thread rather than during the reparse.
+   *
+   * The out-of-date preamble cannot be used in the meantime, so reparses that
+   * happen before the new preamble is ready parse the whole main file. The
+   * first reparse after it is ready picks it up.
+   */
+  CXReparse_BuildPreambleInBackground = 0x1,
+
+  /**
+   * \brief Used to indicate that the unchanged top-level declarations at the
+   * start of the main file should be precompiled along with the preamble.
+   *
+   * Once two consecutive reparses change the same top-level declaration, the
+   * precompiled preamble is extended to end just before that declaration, so
+   * that later reparses only parse it and the declarations that follow it.
+   * This only has an effect on translation units that use a precompiled
+   * preamble (see \c CXTranslationUnit_PrecompiledPreamble).
+   */
+  CXReparse_ReuseUnchangedDeclarations = 0x2
 };
  
 /**
@@ -1450,6 +1506,31 @@ CINDEX_LINKAGE int clang_reparseTranslationUnit(CXTranslationUnit TU,
                                           struct CXUnsavedFile *unsaved_files,
                                                 unsigned options);
 
+/**
+ * \brief Release most of the memory used by a translation unit that is not
+ * being queried.
+ *
+ * The AST of the translation unit is saved to a temporary AST file, and the
+ * AST, the preprocessor and the contents of the source files are released.
+ * The next call that queries the translation unit loads the AST from that
+ * file again; declarations are then deserialized lazily, as they are used.
+ * If the AST file can no longer be used, e.g., because one of the files it
+ * depends on has changed, the translation unit is reparsed instead. A
+ * translation unit that uses a precompiled preamble, a PCH or modules is not
+ * saved; it is reparsed when it is next queried, reusing its preamble.
+ *
+ * As with clang_reparseTranslationUnit(), all cursors, source locations and
+ * diagnostics previously obtained from the translation unit are invalidated.
+ *
+ * Only translation units parsed from source can hibernate.
+ *
+ * \param TU The translation unit to hibernate.
+ *
+ * \returns 0 if the translation unit is hibernating, otherwise one of the
+ * error codes described by the \c CXErrorCode enum.
+ */
+CINDEX_LINKAGE int clang_hibernateTranslationUnit(CXTranslationUnit TU);
+
 /**
   * \brief Categorizes how memory is being used by a translation unit.
   */
@@ -1472,8 +1553,14 @@ enum CXTUResourceUsageKind {
   CXTUResourceUsage_MEMORY_IN_BYTES_END =
     CXTUResourceUsage_Preprocessor_HeaderSearch,
 
+  /**
+   * \brief The size, in bytes, of the AST file that a hibernating translation
+   * unit was saved to. This is disk space rather than memory.
+   */
+  CXTUResourceUsage_HibernatedAST = 15,
+
   CXTUResourceUsage_First = CXTUResourceUsage_AST,
-  CXTUResourceUsage_Last = CXTUResourceUsage_Preprocessor_HeaderSearch
+  CXTUResourceUsage_Last = CXTUResourceUsage_HibernatedAST
 };
 
 /**
@@ -3514,6 +3601,122 @@ unsigned clang_visitChildrenWithBlock(CXCursor parent,
 #  endif
 #endif
 
+/**
+ * \brief A compact description of a cursor, as produced by
+ * clang_visitChildrenBulk().
+ */
+typedef struct {
+  /**
+   * \brief The kind of the cursor.
+   */
+  enum CXCursorKind kind;
+
+  /**
+   * \brief The index of the record of the parent of the cursor, or -1 if
+   * the parent is the cursor whose descendants were visited.
+   */
+  int parent;
+
+  /**
+   * \brief The file containing the start of the extent of the cursor, or
+   * NULL if the cursor has no location.
+   */
+  CXFile file;
+
+  /**
+   * \brief The expansion location of the start of the extent of the cursor.
+   */
+  unsigned start_line;
+  unsigned start_column;
+  unsigned start_offset;
+
+  /**
+   * \brief The expansion location of the end of the extent of the cursor.
+   */
+  unsigned end_line;
+  unsigned end_column;
+  unsigned end_offset;
+
+  /**
+   * \brief The offset of the spelling of the cursor in the string table, or
+   * 0 if the spelling was not requested or is empty.
+   */
+  unsigned spelling;
+
+  /**
+   * \brief The offset of the USR of the cursor in the string table, or 0 if
+   * the USR was not requested or the cursor has none.
+   */
+  unsigned usr;
+} CXCursorRecord;
+
+/**
+ * \brief Flags that control the records produced by
+ * clang_visitChildrenBulk().
+ */
+enum CXCursorRecord_Flags {
+  /**
+   * \brief Only describe the kind, parent and extent of each cursor.
+   */
+  CXCursorRecord_None = 0x0,
+
+  /**
+   * \brief Record the spelling of each cursor.
+   */
+  CXCursorRecord_IncludeSpellings = 0x1,
+
+  /**
+   * \brief Record the USR of each cursor. Computing USRs is comparatively
+   * expensive.
+   */
+  CXCursorRecord_IncludeUSRs = 0x2
+};
+
+/**
+ * \brief Visit all of the descendants of a cursor at once, describing each
+ * of them with a \c CXCursorRecord.
+ *
+ * This performs the same recursive traversal as clang_visitChildren() with a
+ * visitor that always returns \c CXChildVisit_Recurse, but stores the
+ * records of the visited cursors, in depth-first preorder, in a
+ * caller-provided array instead of invoking a callback for each cursor. This
+ * makes it suitable for clients, such as language bindings, for which each
+ * callback is expensive.
+ *
+ * The strings referenced by the records are stored in \p strings as
+ * nul-terminated strings. Each distinct string is stored once, and offset 0
+ * always holds an empty string.
+ *
+ * The records and strings are only written if both \p records and
+ * \p strings are large enough. Otherwise, the call can be repeated with
+ * buffers of the sizes that were reported.
+ *
+ * \param parent the cursor whose descendants will be visited.
+ *
+ * \param options a bitmask of \c CXCursorRecord_Flags.
+ *
+ * \param records the array that receives the records.
+ *
+ * \param num_records the number of records that fit in \p records.
+ *
+ * \param strings the buffer that receives the string table.
+ *
+ * \param strings_size the size of \p strings, in bytes.
+ *
+ * \param strings_size_needed if non-NULL, receives the size of the string
+ * table, in bytes.
+ *
+ * \returns the number of descendants of \p parent, i.e., the number of
+ * records needed.
+ */
+CINDEX_LINKAGE unsigned clang_visitChildrenBulk(CXCursor parent,
+                                                unsigned options,
+                                                CXCursorRecord *records,
+                                                unsigned num_records,
+                                                char *strings,
+                                                unsigned strings_size,
+                                                unsigned *strings_size_needed);
+
 /**
  * @}
  */
@@ -4818,6 +5021,38 @@ CXCodeCompleteResults *clang_codeCompleteAt(CXTranslationUnit TU,
                                             unsigned num_unsaved_files,
                                             unsigned options);
 
+/**
+ * \brief Perform code completion at a given location in a translation unit,
+ * keeping only the results that match what the user has typed so far.
+ *
+ * This is equivalent to #clang_codeCompleteAt followed by filtering and
+ * ranking the results, except that the results that are dropped never have
+ * completion strings built for them. When there are many candidates, e.g.,
+ * all the globals declared in the headers, this is much cheaper.
+ *
+ * \param prefix The part of the name being completed that has already been
+ * typed. Only the results whose typed text starts with it, ignoring case, are
+ * reported. NULL or an empty string reports all results.
+ *
+ * \param max_results If non-zero, at most this many results are reported:
+ * those with the best (lowest) priority, preferring the ones that match the
+ * case of \p prefix. The reported results are then ordered best first.
+ *
+ * The other parameters and the result are the same as for
+ * #clang_codeCompleteAt.
+ */
+CINDEX_LINKAGE
+CXCodeCompleteResults *
+clang_codeCompleteAtWithPrefix(CXTranslationUnit TU,
+                               const char *complete_filename,
+                               unsigned complete_line,
+                               unsigned complete_column,
+                               struct CXUnsavedFile *unsaved_files,
+                               unsigned num_unsaved_files,
+                               unsigned options,
+                               const char *prefix,
+                               unsigned max_results);
+
 /**
  * \brief Sort the code-completion results in case-insensitive alphabetical 
  * order.
@@ -5619,6 +5854,41 @@ CINDEX_LINKAGE int clang_indexSourceFile(CXIndexAction,
                                          CXTranslationUnit *out_TU,
                                          unsigned TU_options);
 
+/**
+ * \brief Index the source files of all the compile commands in a compilation
+ * database, on several threads.
+ *
+ * Each compile command is indexed as if by #clang_indexSourceFile, with the
+ * relative paths in it resolved against the command's directory.
+ *
+ * A header is only indexed by the first translation unit that reaches it
+ * among those that are parsed with the same language, target and
+ * preprocessor options. The others do not report the declarations, the
+ * references or the inclusion directives in it again. This assumes that such
+ * a header means the same thing in every translation unit that includes it.
+ *
+ * The callbacks are invoked on the indexing threads as the results are found.
+ * Callbacks for different translation units may run concurrently, so they
+ * must be thread-safe. The callbacks for one translation unit are all invoked
+ * on the same thread, starting with \c enteredMainFile.
+ *
+ * \param db The compilation database whose compile commands are indexed.
+ *
+ * \param num_threads The number of threads to index on, or 0 to use one
+ * thread per hardware thread.
+ *
+ * \returns 0 if every compile command was indexed, otherwise the
+ * \c CXErrorCode of the first one that failed. The other parameters are the
+ * same as #clang_indexSourceFile.
+ */
+CINDEX_LINKAGE int clang_indexCompilationDatabase(CXIndexAction,
+                                             CXClientData client_data,
+                                             IndexerCallbacks *index_callbacks,
+                                             unsigned index_callbacks_size,
+                                             unsigned index_options,
+                                             CXCompilationDatabase db,
+                                             unsigned num_threads);
+
 /**
  * \brief Index the given translation unit via callbacks implemented through
  * #IndexerCallbacks.
@@ -5663,6 +5933,130 @@ CINDEX_LINKAGE void clang_indexLoc_getFileLocation(CXIdxLoc loc,
 CINDEX_LINKAGE
 CXSourceLocation clang_indexLoc_getCXSourceLocation(CXIdxLoc loc);
 
+/**
+ * \brief A persistent index of the symbols of many translation units, which
+ * maps USRs to the places where the symbols are declared, defined and
+ * referenced.
+ *
+ * The index lives in a single file. It is updated one translation unit at a
+ * time, and the occurrences are recorded per source file: indexing a
+ * translation unit again only replaces the occurrences in the files that
+ * changed since they were last indexed.
+ */
+typedef void *CXSymbolIndex;
+
+/**
+ * \brief The ways in which a symbol can occur in a symbol index.
+ */
+enum CXSymbolRole {
+  CXSymbolRole_Declaration = 0x1,
+  CXSymbolRole_Definition = 0x2,
+  CXSymbolRole_Reference = 0x4
+};
+
+/**
+ * \brief A place where a symbol occurs.
+ */
+typedef struct {
+  /**
+   * \brief The absolute path of the file in which the symbol occurs.
+   */
+  const char *file;
+  unsigned line;
+  unsigned column;
+  unsigned offset;
+  enum CXSymbolRole role;
+} CXSymbolOccurrence;
+
+/**
+ * \brief Open the symbol index stored in the file \p index_path.
+ *
+ * The file does not need to exist yet; it is created by
+ * #clang_SymbolIndex_save.
+ *
+ * \returns The symbol index, or NULL if \p index_path exists but is not a
+ * symbol index.
+ */
+CINDEX_LINKAGE CXSymbolIndex clang_SymbolIndex_create(const char *index_path);
+
+/**
+ * \brief Release the symbol index, discarding any updates that have not been
+ * saved.
+ */
+CINDEX_LINKAGE void clang_SymbolIndex_dispose(CXSymbolIndex index);
+
+/**
+ * \brief Parse a source file and record the symbol occurrences in it and in
+ * the files it includes.
+ *
+ * Files whose occurrences are already recorded and that have not changed
+ * since, as well as files already indexed through this \c CXSymbolIndex, are
+ * not recorded again.
+ *
+ * The updates become visible to #clang_SymbolIndex_findOccurrences once they
+ * are saved.
+ *
+ * \param CIdx The index object used to parse the source file.
+ *
+ * The remaining parameters are the same as #clang_parseTranslationUnit.
+ *
+ * \returns 0 on success, otherwise the \c CXErrorCode of the failure.
+ */
+CINDEX_LINKAGE int
+clang_SymbolIndex_indexSourceFile(CXSymbolIndex index, CXIndex CIdx,
+                                  const char *source_filename,
+                                  const char *const *command_line_args,
+                                  int num_command_line_args,
+                                  struct CXUnsavedFile *unsaved_files,
+                                  unsigned num_unsaved_files,
+                                  unsigned TU_options);
+
+/**
+ * \brief Forget every symbol occurrence recorded for the given file, e.g.,
+ * because it was deleted.
+ */
+CINDEX_LINKAGE void clang_SymbolIndex_removeFile(CXSymbolIndex index,
+                                                 const char *filename);
+
+/**
+ * \brief Write the symbol index back to its file.
+ *
+ * The files that were not indexed or removed through this \c CXSymbolIndex
+ * are taken from the file as it is when saving, so that updates saved in the
+ * meantime through other \c CXSymbolIndex objects, possibly in other
+ * processes, are kept. If another process is writing the file, this waits
+ * for it to finish.
+ *
+ * \returns 0 on success, non-zero if the index could not be written.
+ */
+CINDEX_LINKAGE int clang_SymbolIndex_save(CXSymbolIndex index);
+
+/**
+ * \brief Visitor invoked for each occurrence found by
+ * #clang_SymbolIndex_findOccurrences.
+ *
+ * The occurrence is only valid for the duration of the call.
+ */
+typedef void (*CXSymbolOccurrenceVisitor)(CXClientData client_data,
+                                          const CXSymbolOccurrence *occurrence);
+
+/**
+ * \brief Find the occurrences of the symbol with the given USR.
+ *
+ * The lookup is served directly from the memory-mapped index file, so its
+ * cost does not depend on the number of translation units in the index.
+ *
+ * \param roles A bitmask of \c CXSymbolRole values selecting the occurrences
+ * to report.
+ *
+ * \returns The number of occurrences reported.
+ */
+CINDEX_LINKAGE unsigned
+clang_SymbolIndex_findOccurrences(CXSymbolIndex index, const char *usr,
+                                  unsigned roles,
+                                  CXSymbolOccurrenceVisitor visitor,
+                                  CXClientData client_data);
+
 /**
  * @}
  */
@@ -51,6 +51,8 @@ namespace clang {
   class ASTRecordLayout;
   class BlockExpr;
   class CharUnits;
+  class ConstexprCallCache;
+  class ConstexprInterpreter;
   class DiagnosticsEngine;
   class Expr;
   class ASTMutationListener;
@@ -1759,6 +1761,13 @@ public:
 
   VTableContextBase *getVTableContext();
 
+  /// \brief Retrieve the cache of constexpr function call results, or null
+  /// if memoizing constexpr calls is disabled.
+  ConstexprCallCache *getConstexprCallCache();
+
+  /// \brief Retrieve the bytecode interpreter for constexpr function calls.
+  ConstexprInterpreter &getConstexprInterpreter();
+
   MangleContext *createMangleContext();
   
   void DeepCollectObjCIvars(const ObjCInterfaceDecl *OI, bool leafClass,
@@ -2331,6 +2340,10 @@ private:
 
   std::unique_ptr<VTableContextBase> VTContext;
 
+  std::unique_ptr<ConstexprCallCache> ConstexprCalls;
+
+  std::unique_ptr<ConstexprInterpreter> ConstexprInterp;
+
 public:
   enum PragmaSectionFlag : unsigned {
     PSF_None = 0,
@@ -38,6 +38,7 @@ namespace clang {
   class ASTImporter {
   public:
     typedef llvm::DenseSet<std::pair<Decl *, Decl *> > NonEquivalentDeclSet;
+    typedef llvm::DenseSet<std::pair<Decl *, Decl *> > EquivalentDeclSet;
     
   private:
     /// \brief The contexts we're importing to and from.
@@ -75,6 +76,15 @@ namespace clang {
     /// \brief Declaration (from, to) pairs that are known not to be equivalent
     /// (which we have already complained about).
     NonEquivalentDeclSet NonEquivalentDecls;
+
+    /// \brief Declaration (from, to) pairs that have been proven structurally
+    /// equivalent, so that later imports referring to them need not repeat
+    /// the check.
+    EquivalentDeclSet EquivalentDecls;
+
+    /// \brief The number of structural equivalence checks answered from
+    /// \c EquivalentDecls.
+    unsigned NumEquivalenceCacheHits;
     
   public:
     /// \brief Create a new AST importer.
@@ -259,6 +269,16 @@ namespace clang {
     /// \brief Return the set of declarations that we know are not equivalent.
     NonEquivalentDeclSet &getNonEquivalentDecls() { return NonEquivalentDecls; }
 
+    /// \brief Return the set of declarations that we know are equivalent.
+    EquivalentDeclSet &getEquivalentDecls() { return EquivalentDecls; }
+
+    /// \brief Note that \p N structural equivalence checks were answered from
+    /// the set of known-equivalent declarations.
+    void noteEquivalenceCacheHits(unsigned N) { NumEquivalenceCacheHits += N; }
+
+    /// \brief Print statistics about the nodes imported so far.
+    void PrintStats() const;
+
     /// \brief Called for ObjCInterfaceDecl, ObjCProtocolDecl, and TagDecl.
     /// Mark the Decl as complete, filling it in as much as possible.
     ///
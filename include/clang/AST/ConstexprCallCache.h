@@ -0,0 +1,76 @@
+//===--- ConstexprCallCache.h - Memoized constexpr calls --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the ConstexprCallCache class, which remembers the results
+//  of constexpr function calls for the constant expression evaluator.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_AST_CONSTEXPRCALLCACHE_H
+#define LLVM_CLANG_AST_CONSTEXPRCALLCACHE_H
+
+#include "clang/AST/APValue.h"
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+
+namespace clang {
+
+class FunctionDecl;
+
+/// \brief Maps constexpr function calls to their results, so that evaluating
+/// the same call again is a lookup.
+///
+/// Only calls whose result depends on nothing but the callee and the values
+/// of its arguments are memoized; the evaluator decides which ones those are.
+/// The arguments and results must be self-contained values (see
+/// \c isMemoizable), which cannot refer to any object. The cache stops
+/// growing once it uses a given amount of memory.
+class ConstexprCallCache {
+  /// \brief The memoized results, keyed by an encoding of the callee and
+  /// the argument values.
+  llvm::StringMap<APValue> Results;
+
+  /// \brief The maximum memory the cache may use, in bytes.
+  uint64_t MemoryLimit;
+
+  /// \brief An estimate of the memory the cache uses, in bytes.
+  uint64_t MemoryUsed;
+
+  unsigned NumHits;
+  unsigned NumMisses;
+
+  /// \brief The number of results that were not memoized because the cache
+  /// was full.
+  unsigned NumDropped;
+
+  ConstexprCallCache(const ConstexprCallCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const ConstexprCallCache &) LLVM_DELETED_FUNCTION;
+
+public:
+  explicit ConstexprCallCache(uint64_t MemoryLimit);
+
+  /// \brief Determine whether \p V is a value that can be used as an argument
+  /// or result of a memoized call: one that does not refer to any object.
+  static bool isMemoizable(const APValue &V);
+
+  /// \brief Retrieve the memoized result of calling \p Callee with \p Args,
+  /// or null if the call has not been memoized.
+  const APValue *lookup(const FunctionDecl *Callee, ArrayRef<APValue> Args);
+
+  /// \brief Memoize the result of calling \p Callee with \p Args.
+  void insert(const FunctionDecl *Callee, ArrayRef<APValue> Args,
+              const APValue &Result);
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
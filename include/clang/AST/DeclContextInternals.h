@@ -21,7 +21,10 @@
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/PointerUnion.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
 #include <algorithm>
+#include <utility>
+#include <vector>
 
 namespace clang {
 
@@ -238,13 +241,110 @@ public:
   }
 };
 
-class StoredDeclsMap
-  : public llvm::SmallDenseMap<DeclarationName, StoredDeclsList, 4> {
+/// \brief The lookup table of a DeclContext, mapping each declaration name
+/// to the declarations with that name.
+///
+/// The entries are stored in a flat array, in the order in which their names
+/// were added. Adding a name appends to the array, so the other entries only
+/// move when the array grows, and iteration order does not depend on where
+/// the names were allocated. Tables with few names are searched linearly.
+/// Larger tables also keep an open-addressing index into the array, which
+/// uses linear probing. Growing the index only rehashes entry numbers and
+/// never moves the entries themselves.
+///
+/// Names are never removed from the table. A name whose declarations have all
+/// been removed keeps an empty entry.
+class StoredDeclsMap {
+public:
+  typedef std::pair<DeclarationName, StoredDeclsList> value_type;
+  typedef value_type *iterator;
+  typedef const value_type *const_iterator;
+
+private:
+  /// \brief The largest number of names searched without an index.
+  enum { LinearSearchLimit = 8 };
+
+  /// \brief The entries, in the order in which their names were added.
+  SmallVector<value_type, 4> Entries;
+
+  /// \brief The hash index: each slot is either zero, if it is empty, or one
+  /// more than the position of an entry in \c Entries. Its size is zero or a
+  /// power of two.
+  std::vector<unsigned> Index;
+
+  static unsigned getHash(DeclarationName Name) {
+    return llvm::DenseMapInfo<DeclarationName>::getHashValue(Name);
+  }
+
+  /// \brief Add the entry at position \p I of \c Entries to the index.
+  void addToIndex(unsigned I) {
+    unsigned Mask = Index.size() - 1;
+    unsigned Slot = getHash(Entries[I].first) & Mask;
+    while (Index[Slot])
+      Slot = (Slot + 1) & Mask;
+    Index[Slot] = I + 1;
+  }
+
+  /// \brief Rebuild the index, with room for twice the current entries.
+  void rebuildIndex() {
+    Index.assign(llvm::NextPowerOf2(Entries.size() * 2), 0);
+    for (unsigned I = 0, N = Entries.size(); I != N; ++I)
+      addToIndex(I);
+  }
 
 public:
+  StoredDeclsMap() {}
+
+  iterator begin() { return Entries.begin(); }
+  iterator end() { return Entries.end(); }
+  const_iterator begin() const { return Entries.begin(); }
+  const_iterator end() const { return Entries.end(); }
+
+  unsigned size() const { return Entries.size(); }
+  bool empty() const { return Entries.empty(); }
+
+  iterator find(DeclarationName Name) {
+    if (Index.empty()) {
+      for (iterator I = begin(), E = end(); I != E; ++I)
+        if (I->first == Name)
+          return I;
+      return end();
+    }
+
+    unsigned Mask = Index.size() - 1;
+    for (unsigned Slot = getHash(Name) & Mask; Index[Slot];
+         Slot = (Slot + 1) & Mask) {
+      value_type &Entry = Entries[Index[Slot] - 1];
+      if (Entry.first == Name)
+        return &Entry;
+    }
+    return end();
+  }
+
+  std::pair<iterator, bool> insert(value_type &&KV) {
+    iterator I = find(KV.first);
+    if (I != end())
+      return std::make_pair(I, false);
+
+    Entries.push_back(std::move(KV));
+    unsigned N = Entries.size();
+    if (!Index.empty() && N * 4 <= Index.size() * 3)
+      addToIndex(N - 1);
+    else if (N > LinearSearchLimit)
+      rebuildIndex();
+    return std::make_pair(&Entries.back(), true);
+  }
+
+  StoredDeclsList &operator[](DeclarationName Name) {
+    return insert(value_type(Name, StoredDeclsList())).first->second;
+  }
+
   static void DestroyAll(StoredDeclsMap *Map, bool Dependent);
 
 private:
+  StoredDeclsMap(const StoredDeclsMap &) LLVM_DELETED_FUNCTION;
+  void operator=(const StoredDeclsMap &) LLVM_DELETED_FUNCTION;
+
   friend class ASTContext; // walks the chain deleting these
   friend class DeclContext;
   llvm::PointerIntPair<StoredDeclsMap*, 1> Previous;
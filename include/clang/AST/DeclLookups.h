@@ -32,7 +32,7 @@ public:
   typedef std::forward_iterator_tag iterator_category;
   typedef std::ptrdiff_t            difference_type;
 
-  all_lookups_iterator() {}
+  all_lookups_iterator() : It(), End() {}
   all_lookups_iterator(StoredDeclsMap::iterator It,
                        StoredDeclsMap::iterator End)
       : It(It), End(End) {}
@@ -55,11 +55,13 @@ class DiagnosticsEngine;
 class FileEntry;
 class FileManager;
 class HeaderSearch;
+class PrecompiledPreambleCache;
 class Preprocessor;
 class SourceManager;
 class TargetInfo;
 class ASTFrontendAction;
 class ASTDeserializationListener;
+struct SharedPreamble;
 
 /// \brief Utility class for loading a ASTContext from an AST file.
 ///
@@ -288,8 +290,17 @@ private:
   unsigned NumWarningsInPreamble;
 
   /// \brief A list of the serialization ID numbers for each of the top-level
-  /// declarations parsed within the precompiled preamble.
+  /// declarations parsed within the precompiled preamble, or of all of the
+  /// top-level declarations when the AST was loaded by wake().
   std::vector<serialization::DeclID> TopLevelDeclsInPreamble;
+
+  /// \brief The cache through which precompiled preambles are shared with
+  /// other ASTUnits, if any.
+  std::shared_ptr<PrecompiledPreambleCache> PreambleCache;
+
+  /// \brief The shared preamble that \c PreambleFile belongs to, if it came
+  /// from or was added to \c PreambleCache.
+  std::shared_ptr<SharedPreamble> CurrentSharedPreamble;
   
   /// \brief Whether we should be caching code-completion results.
   bool ShouldCacheCodeCompletionResults : 1;
@@ -301,6 +312,28 @@ private:
   /// \brief True if non-system source files should be treated as volatile
   /// (likely to change while trying to use them).
   bool UserFilesAreVolatile : 1;
+
+  /// \brief Whether an out-of-date precompiled preamble is rebuilt on a
+  /// background thread, rather than while reparsing.
+  bool BuildPreambleInBackground : 1;
+
+  /// \brief A precompiled preamble being built on a background thread.
+  struct BackgroundPreambleBuild;
+  std::unique_ptr<BackgroundPreambleBuild> PendingPreambleBuild;
+
+  /// \brief Whether reparsing precompiles the unchanged top-level
+  /// declarations that precede an edit along with the preamble.
+  bool IncrementalReparse : 1;
+
+  /// \brief Where the preamble would have to end for the last edit to the
+  /// main file to fall just after it, or zero if the edit could not be
+  /// placed.
+  unsigned IncrementalEditOffset;
+
+  /// \brief If nonzero, the size of the preamble to precompile in place of
+  /// the one made of the main file's leading directives.
+  unsigned RequestedPreambleSize;
+  bool RequestedPreambleEndsAtStartOfLine : 1;
  
   /// \brief The language options used when we load an AST file.
   LangOptions ASTFileLangOpts;
@@ -354,16 +387,42 @@ public:
     unsigned Type;
   };
   
+  /// \brief The cached code-completion results for the declarations and
+  /// macros of a single file.
+  ///
+  /// The results of a header only need to be computed once for all the
+  /// translation units that see the same declarations in it, and across
+  /// rebuilds of the preamble.
+  struct CachedCompletionGroup {
+    /// \brief The key identifying the file, its contents and the way it was
+    /// parsed, or empty if the group is not shared.
+    std::string Key;
+
+    /// \brief The allocator that owns the completion strings.
+    IntrusiveRefCntPtr<GlobalCodeCompletionAllocator> Allocator;
+
+    /// \brief The cached results.
+    ///
+    /// The \c Type of each result is relative to this group: it is an index
+    /// into \c Types plus one, or zero if the type is not known.
+    std::vector<CachedCodeCompletionResult> Results;
+
+    /// \brief The formatted names of the types of the results.
+    std::vector<std::string> Types;
+  };
+
   /// \brief Retrieve the mapping from formatted type names to unique type
   /// identifiers.
   llvm::StringMap<unsigned> &getCachedCompletionTypes() { 
     return CachedCompletionTypes; 
   }
   
-  /// \brief Retrieve the allocator used to cache global code completions.
-  IntrusiveRefCntPtr<GlobalCodeCompletionAllocator>
-  getCachedCompletionAllocator() {
-    return CachedCompletionAllocator;
+  /// \brief Retrieve the groups that own the cached global code completions.
+  ///
+  /// Holding on to them keeps the cached completion strings alive.
+  ArrayRef<std::shared_ptr<const CachedCompletionGroup> >
+  getCachedCompletionGroups() const {
+    return CachedCompletionGroups;
   }
 
   CodeCompletionTUInfo &getCodeCompletionTUInfo() {
@@ -374,13 +433,15 @@ public:
   }
 
 private:
-  /// \brief Allocator used to store cached code completions.
-  IntrusiveRefCntPtr<GlobalCodeCompletionAllocator>
-    CachedCompletionAllocator;
+  /// \brief The groups that own the cached code completions, one per file
+  /// that contributes global declarations or macros.
+  std::vector<std::shared_ptr<const CachedCompletionGroup> >
+    CachedCompletionGroups;
 
   std::unique_ptr<CodeCompletionTUInfo> CCTUInfo;
 
-  /// \brief The set of cached code-completion results.
+  /// \brief The set of cached code-completion results, gathered from all of
+  /// the groups.
   std::vector<CachedCodeCompletionResult> CachedCompletionResults;
   
   /// \brief A mapping from the formatted type name to a unique number for that
@@ -409,9 +470,34 @@ private:
   /// inconsistent state, and is not safe to free.
   unsigned UnsafeToFree : 1;
 
+  /// \brief Whether the AST has been released by hibernate().
+  bool Hibernating : 1;
+
+  /// \brief Whether the AST was loaded from the hibernation file by wake()
+  /// rather than parsed. The unit still behaves as one parsed from source.
+  bool WokeFromHibernationFile : 1;
+
+  /// \brief The AST file the translation unit was saved to when it last
+  /// hibernated, or empty if it will be parsed again on waking.
+  std::string HibernationFile;
+
+  /// \brief The serialization ID numbers of the top-level declarations in
+  /// the hibernation file.
+  std::vector<serialization::DeclID> HibernatedTopLevelDecls;
+
+  /// \brief The diagnostics of a hibernating translation unit that refer to
+  /// the released source manager.
+  SmallVector<StandaloneDiagnostic, 4> HibernatedDiagnostics;
+
   /// \brief Cache any "global" code-completion results, so that we can avoid
   /// recomputing them with each completion.
   void CacheCodeCompletionResults();
+
+  /// \brief Build the cached results for the global code-completion results
+  /// \p Results[I] for each I in \p Indices.
+  std::shared_ptr<CachedCompletionGroup>
+  buildCachedCompletionGroup(MutableArrayRef<CodeCompletionResult> Results,
+                             ArrayRef<unsigned> Indices);
   
   /// \brief Clear out and deallocate 
   void ClearCachedCompletionResults();
@@ -422,6 +508,7 @@ private:
   explicit ASTUnit(bool MainFileIsAST);
 
   void CleanTemporaryFiles();
+  void removeTemporaryFile(StringRef TempFile);
   bool Parse(std::unique_ptr<llvm::MemoryBuffer> OverrideMainBuffer);
 
   struct ComputedPreamble {
@@ -444,6 +531,15 @@ private:
   std::unique_ptr<llvm::MemoryBuffer> getMainBufferWithPrecompiledPreamble(
       const CompilerInvocation &PreambleInvocationIn, bool AllowRebuild = true,
       unsigned MaxLines = 0);
+  void adoptSharedPreamble(std::shared_ptr<SharedPreamble> Shared,
+                           const CompilerInvocation &PreambleInvocation);
+  void startBackgroundPreambleBuild(const CompilerInvocation &PreambleInvocation,
+                                    StringRef Key,
+                                    const ComputedPreamble &NewPreamble);
+  bool findEditedTopLevelDecl(StringRef NewContents, unsigned &Offset);
+  void extendPreambleOverUnchangedDecls(ComputedPreamble &NewPreamble,
+                                        const LangOptions &LangOpts,
+                                        bool AllowRebuild, unsigned MaxLines);
   void RealizeTopLevelDeclsFromPreamble();
 
   /// \brief Transfers ownership of the objects (like SourceManager) from
@@ -540,6 +636,43 @@ public:
   bool getOwnsRemappedFileBuffers() const { return OwnsRemappedFileBuffers; }
   void setOwnsRemappedFileBuffers(bool val) { OwnsRemappedFileBuffers = val; }
 
+  /// \brief Share precompiled preambles with other ASTUnits through
+  /// \p Cache, which may be null.
+  void setPreambleCache(std::shared_ptr<PrecompiledPreambleCache> Cache) {
+    PreambleCache = std::move(Cache);
+  }
+  PrecompiledPreambleCache *getPreambleCache() const {
+    return PreambleCache.get();
+  }
+
+  /// \brief Rebuild an out-of-date precompiled preamble on a background
+  /// thread.
+  ///
+  /// While the new preamble is being built, reparsing and code completion
+  /// proceed without a precompiled preamble. The first reparse after the
+  /// build completes picks the new preamble up. Background builds go through
+  /// the preamble cache, so one is created if this ASTUnit does not have one.
+  void setBuildPreambleInBackground(bool Value);
+  bool getBuildPreambleInBackground() const {
+    return BuildPreambleInBackground;
+  }
+
+  /// \brief Whether a precompiled preamble is being built in the background.
+  bool isBuildingPreambleInBackground() const;
+
+  /// \brief Wait for any precompiled preamble being built in the background.
+  void waitForBackgroundPreambleBuild();
+
+  /// \brief Precompile the unchanged top-level declarations of the main file
+  /// into the preamble when reparsing.
+  ///
+  /// Once two consecutive reparses change the same top-level declaration, the
+  /// preamble is extended to end just before it, so that later reparses only
+  /// parse that declaration and the ones after it. The extended preamble is
+  /// used for as long as the bytes it covers do not change.
+  void setIncrementalReparse(bool Value) { IncrementalReparse = Value; }
+  bool getIncrementalReparse() const { return IncrementalReparse; }
+
   StringRef getMainFileName() const;
 
   /// \brief If this ASTUnit came from an AST file, returns the filename for it.
@@ -727,6 +860,14 @@ public:
       bool UserFilesAreVolatile = false);
 
 private:
+  /// \brief Helper function for \c LoadFromASTFile() and \c wake(), which
+  /// loads the AST file \p Filename into this unit.
+  ///
+  /// \returns true if an error occurred, false otherwise.
+  bool loadASTFile(const std::string &Filename,
+                   ArrayRef<RemappedFile> RemappedFiles,
+                   bool AllowPCHWithCompilerErrors);
+
   /// \brief Helper function for \c LoadFromCompilerInvocation() and
   /// \c LoadFromCommandLine(), which loads an AST from a compiler invocation.
   ///
@@ -809,6 +950,9 @@ public:
   /// (e.g. because the PCH could not be loaded), this accepts the ASTUnit
   /// mainly to allow the caller to see the diagnostics.
   ///
+  /// \param PreambleCache - If non-null, the cache through which this ASTUnit
+  /// shares its precompiled preamble with others.
+  ///
   // FIXME: Move OnlyLocalDecls, UseBumpAllocator to setters on the ASTUnit, we
   // shouldn't need to specify them at construction time.
   static ASTUnit *LoadFromCommandLine(
@@ -822,7 +966,8 @@ public:
       bool IncludeBriefCommentsInCodeCompletion = false,
       bool AllowPCHWithCompilerErrors = false, bool SkipFunctionBodies = false,
       bool UserFilesAreVolatile = false, bool ForSerialization = false,
-      std::unique_ptr<ASTUnit> *ErrAST = nullptr);
+      std::unique_ptr<ASTUnit> *ErrAST = nullptr,
+      std::shared_ptr<PrecompiledPreambleCache> PreambleCache = nullptr);
 
   /// \brief Reparse the source files using the same command-line options that
   /// were originally used to produce this translation unit.
@@ -872,6 +1017,38 @@ public:
   /// \returns True if an error occurred, false otherwise.
   bool serialize(raw_ostream &OS);
 
+  /// \brief Save the AST of this translation unit to a temporary AST file and
+  /// release the AST, the preprocessor and the source manager, to reduce the
+  /// memory used by a translation unit that is not being queried.
+  ///
+  /// An AST that depends on other AST files, such as a precompiled preamble,
+  /// is not saved; it is parsed again on waking, reusing the preamble.
+  ///
+  /// Only translation units parsed from source can hibernate. As with
+  /// reparsing, all pointers into the AST are invalidated.
+  ///
+  /// \returns true if an error occurred, false otherwise.
+  bool hibernate();
+
+  /// \brief Whether the translation unit is hibernating, i.e., its AST must
+  /// be loaded again with wake() before being used.
+  bool isHibernating() const { return Hibernating; }
+
+  /// \brief Load the AST of a hibernating translation unit from the AST file
+  /// it was saved to, and remove that file. The declarations are
+  /// deserialized lazily, as they are used.
+  ///
+  /// If there is no AST file, or it cannot be loaded, e.g., because one of
+  /// the files it was built from has changed, the translation unit is
+  /// reparsed instead.
+  ///
+  /// \returns true if an error occurred, false otherwise.
+  bool wake();
+
+  /// \brief The size of the AST file a hibernating translation unit was saved
+  /// to, in bytes.
+  uint64_t getHibernationFileSize() const;
+
   ModuleLoadResult loadModule(SourceLocation ImportLoc, ModuleIdPath Path,
                               Module::NameVisibilityKind Visibility,
                               bool IsInclusionDirective) override {
@@ -47,6 +47,7 @@ class Preprocessor;
 class Sema;
 class SourceManager;
 class TargetInfo;
+class TemplateInstantiationProfiler;
 
 /// CompilerInstance - Helper class for managing a single instance of the Clang
 /// compiler.
@@ -103,6 +104,9 @@ class CompilerInstance : public ModuleLoader {
   /// \brief The frontend timer
   std::unique_ptr<llvm::Timer> FrontendTimer;
 
+  /// \brief The profiler of the template instantiations performed by Sema.
+  std::unique_ptr<TemplateInstantiationProfiler> InstantiationProfiler;
+
   /// \brief The ASTReader, if one exists.
   IntrusiveRefCntPtr<ASTReader> ModuleManager;
 
@@ -507,6 +511,20 @@ public:
     return *FrontendTimer;
   }
 
+  /// }
+  /// @name Template instantiation profiler
+  /// {
+
+  bool hasTemplateInstantiationProfiler() const {
+    return (bool)InstantiationProfiler;
+  }
+
+  TemplateInstantiationProfiler &getTemplateInstantiationProfiler() const {
+    assert(InstantiationProfiler &&
+           "Compiler instance has no template instantiation profiler!");
+    return *InstantiationProfiler;
+  }
+
   /// }
   /// @name Output Files
   /// {
@@ -614,6 +632,14 @@ public:
   /// Create the frontend timer and replace any existing one with it.
   void createFrontendTimer();
 
+  /// Create the template instantiation profiler, which records the time
+  /// spent in template instantiations once Sema is created.
+  void createTemplateInstantiationProfiler();
+
+  /// Report the template instantiation profile, as requested by the
+  /// frontend options.
+  void reportTemplateInstantiationProfile();
+
   /// Create the default output file (from the invocation's options) and add it
   /// to the list of tracked output files.
   ///
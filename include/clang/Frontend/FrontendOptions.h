@@ -250,6 +250,10 @@ public:
   /// \brief File name of the file that will provide record layouts
   /// (in the format produced by -fdump-record-layouts).
   std::string OverrideRecordLayoutsFile;
+
+  /// \brief If given, the file to which a Chrome trace of the template
+  /// instantiations and constant evaluations is written.
+  std::string TemplateProfileFile;
   
 public:
   FrontendOptions() :
@@ -0,0 +1,205 @@
+//===--- PrecompiledPreambleCache.h - Shared preamble cache -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the PrecompiledPreambleCache class, which lets several
+// ASTUnits share the precompiled preambles they build, optionally persisting
+// them on disk so that they survive across processes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_FRONTEND_PRECOMPILEDPREAMBLECACHE_H
+#define LLVM_CLANG_FRONTEND_PRECOMPILEDPREAMBLECACHE_H
+
+#include "clang/Frontend/ASTUnit.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Mutex.h"
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clang {
+
+class CompilerInvocation;
+
+/// \brief A precompiled preamble that can be used by any ASTUnit whose main
+/// file starts with the same preamble and that is parsed with compatible
+/// options.
+///
+/// Everything an ASTUnit needs to adopt the preamble without building it
+/// lives here, alongside the path of the precompiled header itself.
+struct SharedPreamble {
+  /// \brief The key under which the preamble is cached.
+  std::string Key;
+
+  /// \brief The precompiled header file.
+  std::string PCHFile;
+
+  /// \brief The main file that the preamble was built from.
+  std::string MainFileName;
+
+  /// \brief The bytes of the preamble.
+  std::vector<char> Bytes;
+
+  /// \brief Whether the preamble ends at the start of a new line.
+  bool PreambleEndsAtStartOfLine;
+
+  /// \brief The files the preamble depends on, used to determine whether it
+  /// is out of date.
+  llvm::StringMap<ASTUnit::PreambleFileHash> FilesInPreamble;
+
+  /// \brief The top-level declarations in the preamble.
+  std::vector<serialization::DeclID> TopLevelDecls;
+
+  /// \brief The diagnostics produced while building the preamble.
+  SmallVector<ASTUnit::StandaloneDiagnostic, 4> Diagnostics;
+
+  /// \brief The number of warnings produced while building the preamble.
+  unsigned NumWarnings;
+
+  /// \brief The hash of the top-level declaration and macro names in the
+  /// preamble, used to invalidate the global code-completion cache.
+  unsigned TopLevelHashValue;
+
+  /// \brief The size of the precompiled header file.
+  uint64_t Size;
+
+  /// \brief Whether to remove the precompiled header when the last user of
+  /// this preamble goes away.
+  bool RemoveOnDestroy;
+
+  SharedPreamble()
+    : PreambleEndsAtStartOfLine(false), NumWarnings(0), TopLevelHashValue(0),
+      Size(0), RemoveOnDestroy(true) { }
+  ~SharedPreamble();
+};
+
+/// \brief A cache of precompiled preambles, shared by the ASTUnits that are
+/// given it.
+///
+/// Preambles are keyed by a hash of their bytes and of the parts of the
+/// compiler invocation that can affect them. A preamble found in the cache
+/// must still be checked against the files it depends on before it is used.
+///
+/// When the cache has a directory, the precompiled headers it creates are
+/// moved there along with a small description of each preamble, so that
+/// later processes can reuse them. Preambles whose construction produced
+/// diagnostics are only cached in memory.
+///
+/// Once the precompiled headers in the cache exceed the size limit, the
+/// least recently used ones are evicted. A preamble that is still in use by
+/// an ASTUnit stays on disk until that ASTUnit releases it.
+class PrecompiledPreambleCache {
+  struct CacheEntry {
+    /// \brief The preamble, or null if it is on disk but not loaded yet.
+    std::shared_ptr<SharedPreamble> Preamble;
+
+    /// \brief The size of the precompiled header.
+    uint64_t Size;
+
+    /// \brief The position of this entry in the LRU list.
+    std::list<std::string>::iterator LRUPosition;
+  };
+
+  llvm::sys::Mutex Mutex;
+
+  /// \brief The directory in which preambles are persisted, if any.
+  std::string Directory;
+
+  /// \brief The maximum total size of the cached preambles, or zero if
+  /// unbounded.
+  uint64_t MaxSize;
+
+  /// \brief The total size of the cached preambles.
+  uint64_t TotalSize;
+
+  llvm::StringMap<CacheEntry> Entries;
+
+  /// \brief The keys of the entries, most recently used first.
+  std::list<std::string> LRU;
+
+  unsigned NumHits;
+  unsigned NumMisses;
+
+  /// \brief The global code-completion results computed for the files in
+  /// the preambles, keyed by ASTUnit::CachedCompletionGroup::Key.
+  ///
+  /// A group stays available for as long as some ASTUnit uses it.
+  typedef llvm::StringMap<std::weak_ptr<const ASTUnit::CachedCompletionGroup> >
+    CompletionGroupMap;
+  CompletionGroupMap CompletionGroups;
+
+  /// \brief The number of completion groups above which expired ones are
+  /// removed from \c CompletionGroups.
+  unsigned CompletionGroupSweepLimit;
+
+  void scanDirectory();
+  void addEntry(StringRef Key, std::shared_ptr<SharedPreamble> Preamble,
+                uint64_t Size);
+  void removeEntry(llvm::StringMap<CacheEntry>::iterator Pos);
+  void evict();
+
+  std::shared_ptr<SharedPreamble> readFromDisk(StringRef Key);
+  bool writeToDisk(StringRef Key, SharedPreamble &Preamble);
+
+  PrecompiledPreambleCache(const PrecompiledPreambleCache &)
+      LLVM_DELETED_FUNCTION;
+  void operator=(const PrecompiledPreambleCache &) LLVM_DELETED_FUNCTION;
+
+public:
+  /// \param Directory If non-empty, the directory in which preambles are
+  /// persisted across processes. It is created if necessary.
+  ///
+  /// \param MaxSize The maximum total size in bytes of the cached precompiled
+  /// headers, or zero to never evict anything.
+  explicit PrecompiledPreambleCache(StringRef Directory = StringRef(),
+                                    uint64_t MaxSize = 0);
+  ~PrecompiledPreambleCache();
+
+  /// \brief Compute the key under which the preamble \p Bytes, parsed with
+  /// \p Invocation, is cached.
+  static std::string getKey(const CompilerInvocation &Invocation,
+                            StringRef Bytes, bool PreambleEndsAtStartOfLine);
+
+  /// \brief Find the preamble cached under \p Key, or null if there is none.
+  std::shared_ptr<SharedPreamble> lookup(StringRef Key);
+
+  /// \brief Add a newly-built preamble to the cache, taking ownership of its
+  /// precompiled header.
+  ///
+  /// \returns The cached preamble, whose precompiled header may have moved,
+  /// or null if the preamble could not be cached.
+  std::shared_ptr<SharedPreamble>
+  insert(StringRef Key, std::unique_ptr<SharedPreamble> Preamble);
+
+  /// \brief Remove \p Preamble from the cache because it is out of date.
+  void invalidate(const SharedPreamble &Preamble);
+
+  /// \brief Find the code-completion results cached under \p Key by any
+  /// ASTUnit using this cache, or null if there are none.
+  std::shared_ptr<const ASTUnit::CachedCompletionGroup>
+  lookupCompletionGroup(StringRef Key);
+
+  /// \brief Make the given code-completion results available to the other
+  /// ASTUnits using this cache.
+  void
+  insertCompletionGroup(std::shared_ptr<const ASTUnit::CachedCompletionGroup>
+                            Group);
+
+  StringRef getDirectory() const { return Directory; }
+  uint64_t getTotalSize() const { return TotalSize; }
+  unsigned getNumHits() const { return NumHits; }
+  unsigned getNumMisses() const { return NumMisses; }
+};
+
+} // end namespace clang
+
+#endif
@@ -12,7 +12,10 @@
 
 #include "clang/Basic/LLVM.h"
 #include "clang/Frontend/SerializedDiagnostics.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
+#include <string>
+#include <system_error>
 
 namespace llvm {
 class raw_ostream;
@@ -37,6 +40,42 @@ std::unique_ptr<DiagnosticConsumer> create(StringRef OutputFile,
                                            DiagnosticOptions *Diags,
                                            bool MergeChildRecords = false);
 
+/// \brief Statistics gathered by \c mergeDiagnosticFiles.
+struct MergeStatistics {
+  /// \brief The number of input files read.
+  unsigned NumFiles;
+  /// \brief The number of input files skipped because they could not be read.
+  unsigned NumSkippedFiles;
+  /// \brief The number of top-level diagnostics read from the input files.
+  unsigned NumDiagnostics;
+  /// \brief The number of top-level diagnostics dropped as duplicates.
+  unsigned NumDuplicates;
+
+  MergeStatistics()
+      : NumFiles(0), NumSkippedFiles(0), NumDiagnostics(0), NumDuplicates(0) {}
+};
+
+/// \brief Merge the serialized diagnostics files \p InputFiles into the single
+/// serialized diagnostics file \p OutputFile.
+///
+/// The input files are read on up to \p NumThreads threads (zero means one
+/// per hardware thread) and written out in order as they are read, so only a
+/// few of them are held in memory at a time. A diagnostic, along with its
+/// notes, is dropped if one with the same file, offset, severity, flag and
+/// message was already written, as happens when many translation units
+/// include a header that produces a warning.
+///
+/// An input file which cannot be read, or is truncated, is skipped with a
+/// warning.
+///
+/// \returns the error for the first input file if none of them could be
+/// read, in which case \p OutputFile is not written.
+std::error_code mergeDiagnosticFiles(ArrayRef<std::string> InputFiles,
+                                     StringRef OutputFile,
+                                     DiagnosticOptions *Diags,
+                                     unsigned NumThreads = 0,
+                                     MergeStatistics *Stats = nullptr);
+
 } // end serialized_diags namespace
 } // end clang namespace
 
@@ -0,0 +1,226 @@
+//===--- SymbolIndex.h - Persistent cross-TU symbol index -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the SymbolIndex class, an on-disk index from USRs to the
+// places where the corresponding symbols are declared, defined and
+// referenced, and the SymbolIndexBuilder class used to create and update it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_INDEX_SYMBOLINDEX_H
+#define LLVM_CLANG_INDEX_SYMBOLINDEX_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include <ctime>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class BitstreamCursor;
+class BitstreamWriter;
+class MemoryBuffer;
+}
+
+namespace clang {
+namespace index {
+
+/// \brief The ways in which a symbol can occur in the source code.
+enum SymbolRole {
+  SymbolRole_Declaration = 0x1,
+  SymbolRole_Definition = 0x2,
+  SymbolRole_Reference = 0x4,
+  SymbolRole_All = SymbolRole_Declaration | SymbolRole_Definition |
+                   SymbolRole_Reference
+};
+
+/// \brief A place where a symbol occurs.
+struct SymbolOccurrence {
+  /// \brief The file in which the symbol occurs.
+  StringRef File;
+
+  /// \brief The line and column at which the symbol occurs, both 1-based.
+  unsigned Line, Column;
+
+  /// \brief The offset of the occurrence from the start of the file.
+  unsigned Offset;
+
+  /// \brief How the symbol occurs here.
+  SymbolRole Role;
+};
+
+/// \brief A source file whose symbol occurrences are recorded in the index.
+struct SymbolIndexFile {
+  /// \brief The name of the file.
+  std::string Name;
+
+  /// \brief The size of the file when it was indexed.
+  uint64_t Size;
+
+  /// \brief The modification time of the file when it was indexed.
+  time_t ModTime;
+};
+
+/// \brief An index of the symbols of many translation units, keyed by USR.
+///
+/// The index file is mapped into memory and consulted in place: looking up a
+/// USR costs one hash table probe, regardless of the number of translation
+/// units that went into the index. The index is created and updated with a
+/// SymbolIndexBuilder.
+class SymbolIndex {
+  /// \brief The buffer that backs this index.
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+
+  /// \brief The files recorded in the index, indexed by file ID.
+  std::vector<SymbolIndexFile> Files;
+
+  /// \brief Maps file names to file IDs.
+  llvm::StringMap<unsigned> FileIDs;
+
+  /// \brief The on-disk hash table from USRs to symbol occurrences.
+  void *SymbolTable;
+
+  /// \brief The number of lookups performed through this index.
+  unsigned NumLookups;
+
+  /// \brief The number of lookups that found the symbol.
+  unsigned NumLookupHits;
+
+  SymbolIndex(std::unique_ptr<llvm::MemoryBuffer> Buffer,
+              llvm::BitstreamCursor Cursor);
+
+  SymbolIndex(const SymbolIndex &) LLVM_DELETED_FUNCTION;
+  void operator=(const SymbolIndex &) LLVM_DELETED_FUNCTION;
+
+  friend class SymbolIndexBuilder;
+
+public:
+  ~SymbolIndex();
+
+  /// \brief An error code returned when trying to read or write an index.
+  enum ErrorCode {
+    /// \brief No error occurred.
+    EC_None,
+    /// \brief No index file was found.
+    EC_NotFound,
+    /// \brief Some other process is currently writing the index file.
+    EC_Building,
+    /// \brief There was an unspecified I/O error reading or writing the
+    /// index, or the index file is not a symbol index.
+    EC_IOError
+  };
+
+  /// \brief Read the symbol index in the file \p Path.
+  ///
+  /// \returns A pair containing the index itself and an error code, if any.
+  static std::pair<SymbolIndex *, ErrorCode> readIndex(StringRef Path);
+
+  /// \brief Find the occurrences of the symbol with the given USR whose role
+  /// is one of \p Roles.
+  ///
+  /// \returns true if the symbol is in the index, false otherwise.
+  bool lookup(StringRef USR, unsigned Roles,
+              SmallVectorImpl<SymbolOccurrence> &Occurrences);
+
+  /// \brief Retrieve the files whose symbol occurrences are recorded.
+  ArrayRef<SymbolIndexFile> getFiles() const { return Files; }
+
+  /// \brief Determine whether the recorded occurrences for \p File were
+  /// computed from a file with the given size and modification time.
+  bool isFileUpToDate(StringRef File, uint64_t Size, time_t ModTime) const;
+
+  /// \brief Print statistics to standard error.
+  void printStats();
+};
+
+/// \brief Builds a symbol index, either from scratch or by updating an
+/// existing one a file at a time.
+///
+/// Occurrences are recorded per file: when a file is indexed again, all of
+/// its previous occurrences are replaced, and the occurrences in other files
+/// are left untouched.
+class SymbolIndexBuilder {
+  struct Occurrence {
+    unsigned USR;
+    unsigned Line, Column, Offset;
+    SymbolRole Role;
+  };
+
+  struct FileRecord {
+    uint64_t Size;
+    time_t ModTime;
+
+    /// \brief Whether the file has been indexed through this builder, as
+    /// opposed to loaded from an existing index.
+    bool Updated;
+
+    std::vector<Occurrence> Occurrences;
+  };
+
+  /// \brief Maps USRs to the IDs used for them in the occurrences.
+  llvm::StringMap<unsigned> USRIDs;
+
+  /// \brief The USRs, indexed by ID.
+  std::vector<StringRef> USRs;
+
+  /// \brief The files whose occurrences are recorded.
+  llvm::StringMap<FileRecord> Files;
+
+  /// \brief The files removed through this builder, which must not be
+  /// picked up again from an existing index.
+  llvm::StringSet<> RemovedFiles;
+
+  unsigned getUSRID(StringRef USR);
+  SymbolIndex::ErrorCode updateIndexFile(StringRef Path);
+
+  void emitBlockInfoBlock(llvm::BitstreamWriter &Stream);
+  void writeIndex(llvm::BitstreamWriter &Stream);
+
+public:
+  SymbolIndexBuilder() { }
+
+  /// \brief Start from the occurrences recorded in \p Index.
+  void load(SymbolIndex &Index);
+
+  /// \brief Prepare to record the occurrences in \p File.
+  ///
+  /// \returns true if the occurrences in the file should be recorded, in
+  /// which case the ones previously recorded for it have been dropped. Returns
+  /// false if the recorded occurrences were computed from the same version
+  /// of the file, or if the file has already been indexed through this
+  /// builder.
+  bool startFile(StringRef File, uint64_t Size, time_t ModTime);
+
+  /// \brief Record an occurrence of the symbol \p USR in \p File, which must
+  /// have been started with startFile().
+  void addOccurrence(StringRef File, StringRef USR, SymbolRole Role,
+                     unsigned Line, unsigned Column, unsigned Offset);
+
+  /// \brief Forget everything recorded about \p File.
+  void removeFile(StringRef File);
+
+  /// \brief Write the index to the file \p Path, replacing any index that is
+  /// already there.
+  ///
+  /// The files that were neither indexed nor removed through this builder
+  /// are taken from the index in \p Path as it is when the index is written,
+  /// so that the updates of other builders of the same index are kept.
+  SymbolIndex::ErrorCode writeIndex(StringRef Path);
+};
+
+} // end namespace index
+} // end namespace clang
+
+#endif
@@ -92,6 +92,11 @@ public:
   /// \brief The directory used for a user build.
   std::string ModuleUserBuildPath;
 
+  /// \brief The directory holding source buffers shared between module and
+  /// PCH files, keyed by the hash of their contents. If empty, buffers are
+  /// embedded directly in each AST file.
+  std::string ModuleBufferStorePath;
+
   /// \brief Whether we should disable the use of the hash string within the
   /// module cache.
   ///
@@ -164,6 +169,15 @@ public:
   /// \brief Whether to validate system input files when a module is loaded.
   unsigned ModulesValidateSystemHeaders : 1;
 
+  /// \brief If true, record modules whose input files were all validated in a
+  /// file shared by the build session (see \c BuildSessionTimestamp), and skip
+  /// validating them entirely when they are loaded again in that session.
+  unsigned ModulesValidationCache : 1;
+
+  /// \brief Whether large source buffers embedded in module and PCH files
+  /// should be written compressed (when zlib is available).
+  unsigned ModulesCompressBlobs : 1;
+
 public:
   HeaderSearchOptions(StringRef _Sysroot = "/")
     : Sysroot(_Sysroot), DisableModuleHash(0), ModuleMaps(0),
@@ -175,7 +189,8 @@ public:
       UseStandardSystemIncludes(true), UseStandardCXXIncludes(true),
       UseLibcxx(false), Verbose(false),
       ModulesValidateOncePerBuildSession(false),
-      ModulesValidateSystemHeaders(false) {}
+      ModulesValidateSystemHeaders(false), ModulesValidationCache(false),
+      ModulesCompressBlobs(false) {}
 
   /// AddPath - Add the \p Path path to the specified \p Group list.
   void AddPath(StringRef Path, frontend::IncludeDirGroup Group,
@@ -22,12 +22,15 @@
 #include "clang/Sema/DeclSpec.h"
 #include "clang/Sema/LoopHint.h"
 #include "clang/Sema/Sema.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SaveAndRestore.h"
+#include <deque>
 #include <memory>
 #include <stack>
+#include <vector>
 
 namespace clang {
   class PragmaHandler;
@@ -233,6 +236,46 @@ class Parser : public CodeCompletionHandler {
 
   bool SkipFunctionBodies;
 
+  /// \brief A C function definition whose body has been stored for parsing
+  /// after the declarations that follow it, in
+  /// -fexperimental-deferred-function-bodies mode.
+  struct DeferredFunctionBody {
+    Decl *D;
+    CachedTokens Toks;
+  };
+
+  /// \brief The function bodies waiting to be parsed, in the order in which
+  /// they appeared.
+  std::deque<DeferredFunctionBody> DeferredFunctionBodies;
+
+  /// \brief The identifiers which appear in DeferredFunctionBodies. A later
+  /// declaration which mentions one of them could change the meaning of a
+  /// body, so the bodies are parsed before it.
+  llvm::SmallPtrSet<IdentifierInfo *, 32> DeferredFunctionBodyIdentifiers;
+
+  /// \brief Whether all of DeferredFunctionBodies have to be parsed before
+  /// the next top-level declaration.
+  bool FlushDeferredFunctionBodies;
+
+  /// \brief The bodies of static functions defined in headers, in
+  /// -flazy-static-function-bodies mode. These are only parsed at the end of
+  /// the translation unit, if the function has been used.
+  std::vector<DeferredFunctionBody> LazyFunctionBodies;
+
+  /// \brief The next entry of LazyFunctionBodies to consider, and whether any
+  /// body has been parsed since the start of the current pass over them.
+  unsigned NextLazyFunctionBody;
+  bool ParsedLazyFunctionBodyInPass;
+
+  /// \brief Whether the lazily parsed functions named by alias attributes
+  /// have been marked as used.
+  bool MarkedLazyFunctionAliasTargets;
+
+  unsigned NumDeferredFunctionBodies;
+  double DeferredFunctionBodyTime;
+  double LongestDeferredFunctionBodyTime;
+  unsigned NumLazyFunctionBodiesParsed;
+
 public:
   Parser(Preprocessor &PP, Sema &Actions, bool SkipFunctionBodies);
   ~Parser();
@@ -274,6 +317,8 @@ public:
     return ParseTopLevelDecl(Result);
   }
 
+  void PrintStats() const;
+
   /// ConsumeToken - Consume the current 'peek token' and lex the next one.
   /// This does not work with special tokens: string literals, code completion
   /// and balanced tokens must be handled using the specific consume methods.
@@ -1219,6 +1264,13 @@ private:
   Decl *ParseFunctionDefinition(ParsingDeclarator &D,
                  const ParsedTemplateInfo &TemplateInfo = ParsedTemplateInfo(),
                  LateParsedAttrList *LateParsedAttrs = nullptr);
+  bool canDeferFunctionBody(const Declarator &D,
+                            LateParsedAttrList *LateParsedAttrs);
+  bool isLazyFunctionBody(const Declarator &D);
+  void ParseDeferredFunctionBody(Decl *D, CachedTokens &Toks);
+  bool canParseBeforeDeferredFunctionBodies();
+  Decl *ParseNextUsedLazyFunctionBody();
+  void MarkLazyFunctionAliasTargetsUsed();
   void ParseKNRParamDeclarations(Declarator &D);
   // EndLoc, if non-NULL, is filled with the location of the last token of
   // the simple-asm.
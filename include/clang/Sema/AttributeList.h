@@ -512,6 +512,13 @@ private:
   ///   (size - sizeof(AttributeList)) / sizeof(void*)
   SmallVector<AttributeList*, InlineFreeListsCapacity> FreeLists;
 
+  /// Free lists of scratch storage blocks.  The index is the base-2
+  /// logarithm of the size of the blocks in the list.
+  SmallVector<void*, 16> ScratchFreeLists;
+
+  unsigned NumScratchAllocations;
+  unsigned NumScratchBlocks;
+
   // The following are the private interface used by AttributePool.
   friend class AttributePool;
 
@@ -528,6 +535,23 @@ private:
 public:
   AttributeFactory();
   ~AttributeFactory();
+
+  /// \brief Allocate \p Size bytes of scratch storage for the parsed form of
+  /// a declaration, such as the parameters of a function declarator which do
+  /// not fit within the declarator itself.
+  ///
+  /// The storage comes from the same arena as attributes, and storage which
+  /// is released with deallocateScratch is reused by later declarations.
+  void *allocateScratch(size_t Size);
+
+  /// \brief Release storage obtained from allocateScratch.
+  void deallocateScratch(void *Ptr);
+
+  /// \brief The number of calls to allocateScratch.
+  unsigned getNumScratchAllocations() const { return NumScratchAllocations; }
+
+  /// \brief The number of those calls which could not reuse a released block.
+  unsigned getNumScratchBlocks() const { return NumScratchBlocks; }
 };
 
 class AttributePool {
@@ -821,6 +821,14 @@ protected:
   /// binary.
   bool OutputIsBinary;
 
+  /// \brief If non-empty, only the results whose typed text starts with this
+  /// prefix, ignoring case, are reported to the consumer.
+  std::string ResultPrefix;
+
+  /// \brief If non-zero, the maximum number of results reported to the
+  /// consumer.
+  unsigned MaxResults;
+
 public:
   class OverloadCandidate {
   public:
@@ -890,7 +898,8 @@ public:
 
   CodeCompleteConsumer(const CodeCompleteOptions &CodeCompleteOpts,
                        bool OutputIsBinary)
-    : CodeCompleteOpts(CodeCompleteOpts), OutputIsBinary(OutputIsBinary)
+    : CodeCompleteOpts(CodeCompleteOpts), OutputIsBinary(OutputIsBinary),
+      MaxResults(0)
   { }
 
   /// \brief Whether the code-completion consumer wants to see macros.
@@ -917,6 +926,42 @@ public:
   /// \brief Determine whether the output of this consumer is binary.
   bool isOutputBinary() const { return OutputIsBinary; }
 
+  /// \brief Only report the results whose typed text starts with \p Prefix,
+  /// ignoring case, and, if \p MaxResults is non-zero, only the
+  /// \p MaxResults best-ranked ones among them.
+  ///
+  /// The results are filtered before they are handed to
+  /// ProcessCodeCompleteResults(), so that the consumer does not build
+  /// completion strings for results that the client would throw away.
+  void setResultFilter(StringRef Prefix, unsigned MaxResults) {
+    ResultPrefix = Prefix;
+    this->MaxResults = MaxResults;
+  }
+
+  /// \brief The prefix that results must start with, if any.
+  StringRef getResultPrefix() const { return ResultPrefix; }
+
+  /// \brief The maximum number of results to report, or zero if unlimited.
+  unsigned getMaxResults() const { return MaxResults; }
+
+  /// \brief Determine whether a result with the given typed text starts with
+  /// the result prefix.
+  bool matchesResultPrefix(StringRef TypedText) const {
+    return TypedText.size() >= ResultPrefix.size() &&
+           TypedText.substr(0, ResultPrefix.size()).equals_lower(ResultPrefix);
+  }
+
+  /// \brief Apply the result filter to the given results.
+  ///
+  /// The results that pass the filter are moved to the front of \p Results.
+  /// If the number of results is limited, they are also ranked, best first:
+  /// by priority, then preferring an exact-case match of the prefix, then by
+  /// name.
+  ///
+  /// \returns The number of results that pass the filter.
+  unsigned filterResults(CodeCompletionResult *Results,
+                         unsigned NumResults) const;
+
   /// \brief Deregisters and destroys this code-completion consumer.
   virtual ~CodeCompleteConsumer();
 
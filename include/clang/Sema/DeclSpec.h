@@ -444,8 +444,11 @@ public:
       ObjCQualifiers(nullptr) {
   }
   ~DeclSpec() {
-    delete [] ProtocolQualifiers;
-    delete [] ProtocolLocs;
+    if (ProtocolQualifiers) {
+      AttributeFactory &Factory = getAttributePool().getFactory();
+      Factory.deallocateScratch(const_cast<Decl **>(ProtocolQualifiers));
+      Factory.deallocateScratch(ProtocolLocs);
+    }
   }
   // storage-class-specifier
   SCS getStorageClassSpec() const { return (SCS)StorageClassSpec; }
@@ -1184,7 +1187,8 @@ struct DeclaratorChunk {
     /// ExceptionSpecType - An ExceptionSpecificationType value.
     unsigned ExceptionSpecType : 4;
 
-    /// DeleteParams - If this is true, we need to delete[] Params.
+    /// DeleteParams - If this is true, Params was allocated from the
+    /// AttributeFactory of the declarator, and must be released to it.
     unsigned DeleteParams : 1;
 
     /// HasTrailingReturnType - If this is true, a trailing return type was
@@ -1235,15 +1239,16 @@ struct DeclaratorChunk {
     /// \brief The location of the keyword introducing the spec, if any.
     unsigned ExceptionSpecLoc;
 
-    /// Params - This is a pointer to a new[]'d array of ParamInfo objects that
+    /// Params - This is a pointer to an array of ParamInfo objects that
     /// describe the parameters specified by this function declarator.  null if
     /// there are no parameters specified.
     ParamInfo *Params;
 
     union {
-      /// \brief Pointer to a new[]'d array of TypeAndRange objects that
-      /// contain the types in the function's dynamic exception specification
-      /// and their locations, if there is one.
+      /// \brief Pointer to an array of TypeAndRange objects, allocated from
+      /// the AttributeFactory of the declarator, that contain the types in the
+      /// function's dynamic exception specification and their locations, if
+      /// there is one.
       TypeAndRange *Exceptions;
 
       /// \brief Pointer to the expression in the noexcept-specifier of this
@@ -1261,24 +1266,21 @@ struct DeclaratorChunk {
 
     /// \brief Reset the parameter list to having zero parameters.
     ///
-    /// This is used in various places for error recovery.
+    /// This is used in various places for error recovery. The storage for the
+    /// parameters is released along with the declarator.
     void freeParams() {
       for (unsigned I = 0; I < NumParams; ++I) {
         delete Params[I].DefaultArgTokens;
         Params[I].DefaultArgTokens = nullptr;
       }
-      if (DeleteParams) {
-        delete[] Params;
-        DeleteParams = false;
-      }
       NumParams = 0;
     }
 
-    void destroy() {
+    void destroy(AttributeFactory &Factory) {
       if (DeleteParams)
-        delete[] Params;
-      if (getExceptionSpecType() == EST_Dynamic)
-        delete[] Exceptions;
+        Factory.deallocateScratch(Params);
+      if (getExceptionSpecType() == EST_Dynamic && Exceptions)
+        Factory.deallocateScratch(Exceptions);
       else if (getExceptionSpecType() == EST_Unparsed)
         delete ExceptionSpecTokens;
     }
@@ -1389,9 +1391,9 @@ struct DeclaratorChunk {
     MemberPointerTypeInfo Mem;
   };
 
-  void destroy() {
+  void destroy(AttributeFactory &Factory) {
     switch (Kind) {
-    case DeclaratorChunk::Function:      return Fun.destroy();
+    case DeclaratorChunk::Function:      return Fun.destroy(Factory);
     case DeclaratorChunk::Pointer:       return Ptr.destroy();
     case DeclaratorChunk::BlockPointer:  return Cls.destroy();
     case DeclaratorChunk::Reference:     return Ref.destroy();
@@ -1706,7 +1708,7 @@ public:
     Range = DS.getSourceRange();
     
     for (unsigned i = 0, e = DeclTypeInfo.size(); i != e; ++i)
-      DeclTypeInfo[i].destroy();
+      DeclTypeInfo[i].destroy(getAttributePool().getFactory());
     DeclTypeInfo.clear();
     Attrs.clear();
     AsmLabel = nullptr;
@@ -1933,7 +1935,7 @@ public:
 
   void DropFirstTypeObject() {
     assert(!DeclTypeInfo.empty() && "No type chunks to drop.");
-    DeclTypeInfo.front().destroy();
+    DeclTypeInfo.front().destroy(getAttributePool().getFactory());
     DeclTypeInfo.erase(DeclTypeInfo.begin());
   }
 
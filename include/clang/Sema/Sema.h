@@ -47,6 +47,7 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include <deque>
 #include <memory>
@@ -160,6 +161,7 @@ namespace clang {
   class TemplateArgumentList;
   class TemplateArgumentLoc;
   class TemplateDecl;
+  class TemplateInstantiationProfiler;
   class TemplateParameterList;
   class TemplatePartialOrderingContext;
   class TemplateTemplateParmDecl;
@@ -169,6 +171,7 @@ namespace clang {
   class TypedefNameDecl;
   class TypeLoc;
   class TypoCorrectionConsumer;
+  class TypoCorrectionIndex;
   class UnqualifiedId;
   class UnresolvedLookupExpr;
   class UnresolvedMemberExpr;
@@ -948,6 +951,30 @@ public:
     bool OldFPContractState : 1;
   };
 
+  /// \brief Determine whether the pragmas which affect the code in a function
+  /// body, such as \#pragma pack and \#pragma STDC FP_CONTRACT, are in their
+  /// default state.
+  bool isFunctionBodyPragmaStateDefault() const;
+
+  /// Puts the pragmas which affect the code in a function body in their
+  /// default state, and restores them on exit. This is used to parse a body
+  /// away from the point where it was written, when that point had the
+  /// default pragma state.
+  class DefaultFunctionBodyPragmaStateRAII {
+  public:
+    DefaultFunctionBodyPragmaStateRAII(Sema &S);
+    ~DefaultFunctionBodyPragmaStateRAII();
+  private:
+    Sema &S;
+    void *OldPackContext;
+    void *OldVisContext;
+    StringLiteral *OldDataSeg;
+    StringLiteral *OldBSSSeg;
+    StringLiteral *OldConstSeg;
+    bool OldMSStructPragmaOn : 1;
+    bool OldFPContractState : 1;
+  };
+
   void addImplicitTypedef(StringRef Name, QualType T);
 
 public:
@@ -2345,6 +2372,11 @@ public:
                                 TemplateArgumentListInfo *ExplicitTemplateArgs,
                                             OverloadCandidateSet& CandidateSet,
                                             bool PartialOverloading = false);
+  void AddArgumentDependentLookupCandidates(ADLResult &Fns,
+                                            ArrayRef<Expr *> Args,
+                                TemplateArgumentListInfo *ExplicitTemplateArgs,
+                                            OverloadCandidateSet& CandidateSet,
+                                            bool PartialOverloading = false);
 
   // Emit as a 'note' the specific overload candidate
   void NoteOverloadCandidate(FunctionDecl *Fn, QualType DestType = QualType());
@@ -2397,7 +2429,27 @@ public:
   void AddOverloadedCallCandidates(UnresolvedLookupExpr *ULE,
                                    ArrayRef<Expr *> Args,
                                    OverloadCandidateSet &CandidateSet,
-                                   bool PartialOverloading = false);
+                                   bool PartialOverloading = false,
+                                   ADLResult *ADLFns = nullptr);
+
+  /// \brief The result of overload resolution for a non-dependent call or
+  /// binary operator, which is reused for later calls of the same functions
+  /// with arguments of the same types and value kinds.
+  struct CachedOverloadResolution {
+    FunctionDecl *Function;
+    DeclAccessPair FoundDecl;
+    bool HadMultipleCandidates;
+  };
+
+  /// \brief The cached results of overload resolution, keyed by the kind of
+  /// call, the functions found by name lookup (including argument-dependent
+  /// lookup) and the arguments. Because the functions found are part of the
+  /// key, declaring a new overload makes any earlier results for that name
+  /// unreachable.
+  llvm::StringMap<CachedOverloadResolution> OverloadResolutionCache;
+
+  unsigned NumOverloadCacheHits;
+  unsigned NumOverloadCacheMisses;
 
   // An enum used to represent the different possible results of building a
   // range-based for loop.
@@ -2434,7 +2486,8 @@ public:
   bool buildOverloadedCallSet(Scope *S, Expr *Fn, UnresolvedLookupExpr *ULE,
                               MultiExprArg Args, SourceLocation RParenLoc,
                               OverloadCandidateSet *CandidateSet,
-                              ExprResult *Result);
+                              ExprResult *Result,
+                              ADLResult *ADLFns = nullptr);
 
   ExprResult CreateOverloadedUnaryOp(SourceLocation OpLoc,
                                      unsigned Opc,
@@ -2446,6 +2499,13 @@ public:
                                    const UnresolvedSetImpl &Fns,
                                    Expr *LHS, Expr *RHS);
 
+  ExprResult BuildResolvedOverloadedBinOp(SourceLocation OpLoc,
+                                          OverloadedOperatorKind Op,
+                                          FunctionDecl *FnDecl,
+                                          DeclAccessPair FoundDecl,
+                                          bool HadMultipleCandidates,
+                                          Expr *LHS, Expr *RHS);
+
   ExprResult CreateOverloadedArraySubscriptExpr(SourceLocation LLoc,
                                                 SourceLocation RLoc,
                                                 Expr *Base,Expr *Idx);
@@ -6435,6 +6495,10 @@ public:
   /// therefore, should not be counted as part of the instantiation depth.
   unsigned NonInstantiationEntries;
 
+  /// \brief The profiler that records the time spent in template
+  /// instantiations and constant evaluations, if they are being profiled.
+  TemplateInstantiationProfiler *InstantiationProfiler;
+
   /// \brief The last template from which a template instantiation
   /// error or warning was produced.
   ///
@@ -6590,6 +6654,7 @@ public:
     Sema &SemaRef;
     bool Invalid;
     bool SavedInNonInstantiationSFINAEContext;
+    bool Profiled;
     bool CheckInstantiationDepth(SourceLocation PointOfInstantiation,
                                  SourceRange InstantiationRange);
 
@@ -6610,6 +6675,30 @@ public:
 
   void PrintInstantiationStack();
 
+  /// \brief Start recording the time spent in template instantiations and
+  /// constant evaluations with \p Profiler, which must outlive this Sema
+  /// object.
+  void setTemplateInstantiationProfiler(
+      TemplateInstantiationProfiler *Profiler) {
+    InstantiationProfiler = Profiler;
+  }
+
+  /// \brief RAII object used to profile a constant evaluation performed
+  /// while checking the program, when template instantiations are being
+  /// profiled.
+  class ProfileConstantEvaluationRAII {
+    Sema &SemaRef;
+    bool Profiled;
+
+  public:
+    /// \param E The expression being evaluated.
+    ///
+    /// \param Var The variable \p E initializes, if any.
+    ProfileConstantEvaluationRAII(Sema &SemaRef, const Expr *E,
+                                  const VarDecl *Var = nullptr);
+    ~ProfileConstantEvaluationRAII();
+  };
+
   /// \brief Determines whether we are currently in a context where
   /// template argument substitution failures are not considered
   /// errors.
@@ -6693,6 +6782,30 @@ public:
   /// \brief The number of typos corrected by CorrectTypo.
   unsigned TyposCorrected;
 
+  /// \brief The index of identifier names searched by typo correction, which
+  /// is built on the first attempt to correct a typo.
+  std::unique_ptr<TypoCorrectionIndex> TypoIndex;
+
+  /// \brief The number of identifiers in the identifier table when the typo
+  /// correction index was last brought up to date.
+  unsigned TypoIndexedIdentifiers;
+
+  /// \brief The generation of the external AST source when its identifiers
+  /// were last added to the typo correction index.
+  uint32_t TypoIndexedGeneration;
+
+  /// \brief Whether the identifiers of the external AST source have been
+  /// added to the typo correction index.
+  bool TypoIndexedExternalIdentifiers;
+
+  /// \brief Retrieve the index of identifier names used for typo correction,
+  /// after adding any identifiers which were created or loaded since it was
+  /// last used.
+  ///
+  /// \returns null if adding the identifiers exhausted the budget set by
+  /// -fspell-checking-candidate-limit.
+  TypoCorrectionIndex *getTypoCorrectionIndex();
+
   typedef llvm::SmallSet<SourceLocation, 2> SrcLocSet;
   typedef llvm::DenseMap<IdentifierInfo *, SrcLocSet> IdentifierSourceLocations;
 
@@ -6718,6 +6831,18 @@ public:
   /// but have not yet been performed.
   std::deque<PendingImplicitInstantiation> PendingInstantiations;
 
+  /// \brief The implicit template instantiations that a precompiled header
+  /// leaves to the translation units that include it, because their
+  /// templates are not defined yet.
+  ///
+  /// Only used with -fpch-instantiate-templates.
+  SmallVector<PendingImplicitInstantiation, 4> DeferredPrefixInstantiations;
+
+  /// \brief The number of implicit instantiations performed while building
+  /// a precompiled header, which the translation units that include it do
+  /// not need to perform again.
+  unsigned NumPrefixInstantiations;
+
   class SavePendingInstantiationsAndVTableUsesRAII {
   public:
     SavePendingInstantiationsAndVTableUsesRAII(Sema &S): S(S) {
@@ -0,0 +1,138 @@
+//===--- TemplateInstantiationProfiler.h - Instantiation profiling -*- C++ -*-//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the TemplateInstantiationProfiler class, which records
+//  the time and memory Sema spends in each template instantiation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_SEMA_TEMPLATEINSTANTIATIONPROFILER_H
+#define LLVM_CLANG_SEMA_TEMPLATEINSTANTIATIONPROFILER_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+
+/// \brief Records the wall time and AST memory spent in each template
+/// instantiation, default argument instantiation and constant evaluation
+/// performed by Sema.
+///
+/// Events nest: an event started while another one is active is counted as
+/// part of the enclosing event. The events are aggregated by the template
+/// they were instantiated from, and can be written out as a Chrome
+/// trace-event file (viewable in chrome://tracing) or as a summary of the
+/// templates that took the most time.
+class TemplateInstantiationProfiler {
+public:
+  /// \brief The kinds of work that are profiled.
+  enum EventKind {
+    EK_ClassInstantiation,
+    EK_FunctionInstantiation,
+    EK_VariableInstantiation,
+    EK_DefaultArgument,
+    EK_ExceptionSpec,
+    EK_Substitution,
+    EK_ConstantEvaluation
+  };
+
+private:
+  /// \brief A finished event.
+  struct Event {
+    EventKind Kind;
+    std::string Name;
+
+    /// \brief The index of the aggregated template in \c Templates.
+    unsigned Template;
+
+    /// \brief When the event started, in seconds since profiling started.
+    double Start;
+
+    /// \brief The wall time taken by the event, including nested events, or
+    /// -1 if the event has not finished.
+    double Duration;
+
+    /// \brief The AST memory allocated during the event.
+    uint64_t Memory;
+  };
+
+  /// \brief The statistics of a template, over all of its events.
+  struct TemplateStats {
+    std::string Name;
+    unsigned Count;
+
+    /// \brief The wall time taken by the events of this template, including
+    /// nested events but counting recursive instantiations only once.
+    double Time;
+
+    /// \brief The wall time taken by the events of this template, excluding
+    /// nested events.
+    double SelfTime;
+
+    uint64_t Memory;
+
+    /// \brief The number of events of this template that are active.
+    unsigned ActiveCount;
+  };
+
+  /// \brief An event that has been started but not finished.
+  struct ActiveEvent {
+    unsigned Event;
+    double Start;
+    uint64_t StartMemory;
+    double NestedTime;
+  };
+
+  /// \brief The wall time at which profiling started.
+  double StartTime;
+
+  std::vector<Event> Events;
+  SmallVector<ActiveEvent, 16> ActiveEvents;
+  std::vector<TemplateStats> Templates;
+  llvm::StringMap<unsigned> TemplateIDs;
+
+  TemplateInstantiationProfiler(
+      const TemplateInstantiationProfiler &) LLVM_DELETED_FUNCTION;
+  void operator=(const TemplateInstantiationProfiler &) LLVM_DELETED_FUNCTION;
+
+public:
+  TemplateInstantiationProfiler();
+
+  /// \brief Note that Sema started an event.
+  ///
+  /// \param Name The name of the entity being instantiated or evaluated,
+  /// including its template arguments.
+  ///
+  /// \param Template The name of the template the events are aggregated
+  /// under.
+  ///
+  /// \param ASTMemory The AST memory allocated so far.
+  void startEvent(EventKind Kind, StringRef Name, StringRef Template,
+                  uint64_t ASTMemory);
+
+  /// \brief Note that the most recently started event finished.
+  void finishEvent(uint64_t ASTMemory);
+
+  /// \brief Whether any event has been started and not finished.
+  bool hasActiveEvents() const { return !ActiveEvents.empty(); }
+
+  /// \brief Write the finished events in the Chrome trace-event format.
+  void writeTrace(raw_ostream &OS) const;
+
+  /// \brief Print the \p Limit templates that took the most time.
+  void printSummary(raw_ostream &OS, unsigned Limit) const;
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,90 @@
+//===--- TypoCorrectionIndex.h - Index of names for typo correction -*- C++ -*-//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the TypoCorrectionIndex class, which finds the names
+//  within a given edit distance of a typo.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_SEMA_TYPOCORRECTIONINDEX_H
+#define LLVM_CLANG_SEMA_TYPOCORRECTIONINDEX_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <utility>
+#include <vector>
+
+namespace clang {
+
+/// \brief An index of identifier names, used by typo correction to find the
+/// names which are close to a typo without computing the edit distance
+/// between the typo and every identifier in the translation unit.
+///
+/// The names are kept in a BK-tree: each child of a node is labelled with the
+/// edit distance between its name and the name of the node. Because edit
+/// distance is a metric, a search for names within distance \c K of a typo
+/// only has to descend into the children whose label is within \c K of the
+/// distance between the typo and the node.
+///
+/// Names are only ever added to the index, so that it can be kept up to date
+/// as identifiers are created and AST files are loaded.
+class TypoCorrectionIndex {
+  struct Node {
+    Node(StringRef Name) : Name(Name) { }
+
+    StringRef Name;
+
+    /// \brief The children of this node, with the edit distance between their
+    /// names and the name of this node.
+    SmallVector<std::pair<unsigned, unsigned>, 4> Children;
+  };
+
+  /// \brief Maps the names in the index to their nodes. This also owns the
+  /// storage for the names of the nodes.
+  llvm::StringMap<unsigned> NodeIDs;
+
+  /// \brief The nodes of the tree; the first node is the root.
+  std::vector<Node> Nodes;
+
+  unsigned NumQueries;
+  unsigned NumComparisons;
+  unsigned NumInsertComparisons;
+
+  TypoCorrectionIndex(const TypoCorrectionIndex &) LLVM_DELETED_FUNCTION;
+  void operator=(const TypoCorrectionIndex &) LLVM_DELETED_FUNCTION;
+
+public:
+  TypoCorrectionIndex()
+    : NumQueries(0), NumComparisons(0), NumInsertComparisons(0) { }
+
+  /// \brief Add \p Name to the index, if it is not already present.
+  void insert(StringRef Name);
+
+  /// \brief Find the names whose edit distance from \p Typo is at most
+  /// \p MaxDistance, and append them to \p Results.
+  void search(StringRef Typo, unsigned MaxDistance,
+              SmallVectorImpl<StringRef> &Results);
+
+  /// \brief The number of names in the index.
+  unsigned size() const { return Nodes.size(); }
+
+  /// \brief The number of edit distances computed so far, both to add names
+  /// to the index and to search it.
+  unsigned getNumComparisons() const {
+    return NumComparisons + NumInsertComparisons;
+  }
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
@@ -572,7 +572,16 @@ namespace clang {
       SM_SLOC_BUFFER_BLOB = 3,
       /// \brief Describes a source location entry (SLocEntry) for a
       /// macro expansion.
-      SM_SLOC_EXPANSION_ENTRY = 4
+      SM_SLOC_EXPANSION_ENTRY = 4,
+      /// \brief Describes a zlib-compressed blob that contains the data for
+      /// a buffer entry. Used in place of SM_SLOC_BUFFER_BLOB.
+      /// [SM_SLOC_BUFFER_BLOB_COMPRESSED, UncompressedSize]
+      SM_SLOC_BUFFER_BLOB_COMPRESSED = 5,
+      /// \brief Refers to the data for a buffer entry that lives in a
+      /// content-addressed file in the shared buffer store rather than in
+      /// the AST file. Used in place of SM_SLOC_BUFFER_BLOB.
+      /// [SM_SLOC_BUFFER_BLOB_REF, Size] + path blob
+      SM_SLOC_BUFFER_BLOB_REF = 6
     };
 
     /// \brief Record types used within a preprocessor block.
@@ -70,6 +70,7 @@ class CXXBaseSpecifier;
 class CXXConstructorDecl;
 class CXXCtorInitializer;
 class GlobalModuleIndex;
+class ModuleValidationCache;
 class GotoStmt;
 class MacroDefinition;
 class MacroDirective;
@@ -381,6 +382,12 @@ private:
   /// \brief The global module index, if loaded.
   std::unique_ptr<GlobalModuleIndex> GlobalIndex;
 
+  /// \brief The build session's module validation cache, if in use.
+  std::unique_ptr<ModuleValidationCache> ValidationCache;
+
+  /// \brief Whether we have tried to set up the validation cache.
+  bool TriedValidationCache;
+
   /// \brief A map of global bit offsets to the module that stores entities
   /// at those bit offsets.
   ContinuousRangeMap<uint64_t, ModuleFile*, 4> GlobalBitOffsetsMap;
@@ -864,6 +871,18 @@ private:
   /// the PCH file.
   unsigned NumSLocEntriesRead;
 
+  /// \brief The number of compressed source buffers that have been
+  /// decompressed.
+  unsigned NumSLocBlobsDecompressed;
+
+  /// \brief The number of source buffers that have been loaded from the
+  /// shared buffer store.
+  unsigned NumSLocBlobsLoadedFromStore;
+
+  /// \brief The number of module files whose input files were not validated
+  /// because the build session's validation cache already covered them.
+  unsigned NumModulesValidationSkipped;
+
   /// \brief The number of source location entries in the chain.
   unsigned TotalNumSLocEntries;
 
@@ -1467,6 +1486,10 @@ public:
   /// \brief Determine whether we tried to load the global index, but failed,
   /// e.g., because it is out-of-date or does not exist.
   bool isGlobalIndexUnavailable() const;
+
+  /// \brief Retrieve the build session's module validation cache, or null if
+  /// -fmodules-validation-cache is not in effect.
+  ModuleValidationCache *getValidationCache();
   
   /// \brief Initializes the ASTContext
   void InitializeContext();
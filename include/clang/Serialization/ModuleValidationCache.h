@@ -0,0 +1,90 @@
+//===--- ModuleValidationCache.h - Per-session validation cache -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the ModuleValidationCache class, which records the module
+// files whose input files have already been validated during the current
+// build session, so that other compiler invocations in the same session can
+// skip validating them again.
+//
+//===----------------------------------------------------------------------===//
+#ifndef LLVM_CLANG_SERIALIZATION_MODULEVALIDATIONCACHE_H
+#define LLVM_CLANG_SERIALIZATION_MODULEVALIDATIONCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Serialization/Module.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+
+/// \brief A per-build-session record of module files whose input files have
+/// been validated.
+///
+/// The cache is a single append-only file in the module cache, named after
+/// the build session timestamp. Each entry identifies a module file by its
+/// signature, size and modification time. The file is mapped into memory the
+/// first time it is queried; entries appended afterwards by concurrent
+/// compiler invocations are only seen by later ones, which is harmless since
+/// the worst case is a redundant validation.
+class ModuleValidationCache {
+public:
+  /// \brief Identifies one version of a module file.
+  struct Entry {
+    uint64_t Signature;
+    uint64_t Size;
+    uint64_t ModTime;
+
+    bool operator<(const Entry &RHS) const {
+      if (Signature != RHS.Signature)
+        return Signature < RHS.Signature;
+      if (Size != RHS.Size)
+        return Size < RHS.Size;
+      return ModTime < RHS.ModTime;
+    }
+    bool operator==(const Entry &RHS) const {
+      return Signature == RHS.Signature && Size == RHS.Size &&
+             ModTime == RHS.ModTime;
+    }
+  };
+
+private:
+  /// \brief The path of the cache file.
+  std::string Path;
+
+  /// \brief Whether we have tried to read the cache file yet.
+  bool Loaded;
+
+  /// \brief The entries read from the cache file, sorted.
+  std::vector<Entry> Entries;
+
+  void load();
+
+public:
+  explicit ModuleValidationCache(StringRef Path);
+
+  /// \brief Compute the path of the validation cache for the build session
+  /// starting at \p BuildSessionTimestamp within \p ModuleCachePath.
+  static std::string getCachePath(StringRef ModuleCachePath,
+                                  uint64_t BuildSessionTimestamp);
+
+  /// \brief Determine whether the given module file has been validated in
+  /// this build session.
+  bool isValidated(serialization::ASTFileSignature Signature, off_t Size,
+                   time_t ModTime);
+
+  /// \brief Record that the given module file has been validated in this
+  /// build session.
+  void markValidated(serialization::ASTFileSignature Signature, off_t Size,
+                     time_t ModTime);
+};
+
+} // end namespace clang
+
+#endif
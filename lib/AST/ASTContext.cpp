@@ -13,11 +13,13 @@
 
 #include "clang/AST/ASTContext.h"
 #include "CXXABI.h"
+#include "ConstexprInterpreter.h"
 #include "clang/AST/ASTMutationListener.h"
 #include "clang/AST/Attr.h"
 #include "clang/AST/CharUnits.h"
 #include "clang/AST/Comment.h"
 #include "clang/AST/CommentCommandTraits.h"
+#include "clang/AST/ConstexprCallCache.h"
 #include "clang/AST/DeclCXX.h"
 #include "clang/AST/DeclObjC.h"
 #include "clang/AST/DeclTemplate.h"
@@ -862,6 +864,11 @@ void ASTContext::PrintStats() const {
     ExternalSource->PrintStats();
   }
 
+  if (ConstexprCalls)
+    ConstexprCalls->PrintStats();
+  if (ConstexprInterp)
+    ConstexprInterp->PrintStats();
+
   BumpAlloc.PrintStats();
 }
 
@@ -8064,6 +8071,19 @@ VTableContextBase *ASTContext::getVTableContext() {
   return VTContext.get();
 }
 
+ConstexprCallCache *ASTContext::getConstexprCallCache() {
+  if (!ConstexprCalls && LangOpts.ConstexprCacheLimit)
+    ConstexprCalls.reset(new ConstexprCallCache(
+        uint64_t(LangOpts.ConstexprCacheLimit) * 1024 * 1024));
+  return ConstexprCalls.get();
+}
+
+ConstexprInterpreter &ASTContext::getConstexprInterpreter() {
+  if (!ConstexprInterp)
+    ConstexprInterp.reset(new ConstexprInterpreter(*this));
+  return *ConstexprInterp;
+}
+
 MangleContext *ASTContext::createMangleContext() {
   switch (Target->getCXXABI().getKind()) {
   case TargetCXXABI::GenericAArch64:
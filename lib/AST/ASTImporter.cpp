@@ -22,6 +22,7 @@
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/SourceManager.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
 #include <deque>
 
 namespace clang {
@@ -206,6 +207,13 @@ namespace {
     /// \brief Declaration (from, to) pairs that are known not to be equivalent
     /// (which we have already complained about).
     llvm::DenseSet<std::pair<Decl *, Decl *> > &NonEquivalentDecls;
+
+    /// \brief Declaration (from, to) pairs that are known to be equivalent,
+    /// if the client keeps track of them.
+    llvm::DenseSet<std::pair<Decl *, Decl *> > *EquivalentDecls;
+
+    /// \brief The number of declaration pairs found in \c EquivalentDecls.
+    unsigned NumKnownEquivalent;
     
     /// \brief Whether we're being strict about the spelling of types when 
     /// unifying two types.
@@ -220,8 +228,11 @@ namespace {
     StructuralEquivalenceContext(ASTContext &C1, ASTContext &C2,
                llvm::DenseSet<std::pair<Decl *, Decl *> > &NonEquivalentDecls,
                                  bool StrictTypeSpelling = false,
-                                 bool Complain = true)
+                                 bool Complain = true,
+               llvm::DenseSet<std::pair<Decl *, Decl *> > *EquivalentDecls
+                                   = nullptr)
       : C1(C1), C2(C2), NonEquivalentDecls(NonEquivalentDecls),
+        EquivalentDecls(EquivalentDecls), NumKnownEquivalent(0),
         StrictTypeSpelling(StrictTypeSpelling), Complain(Complain),
         LastDiagFromC2(false) {}
 
@@ -237,6 +248,9 @@ namespace {
     ///
     /// \returns true if an error occurred, false otherwise.
     bool Finish();
+
+    /// \brief After a successful check, remember the equivalences it proved.
+    void RecordEquivalences();
     
   public:
     DiagnosticBuilder Diag1(SourceLocation Loc, unsigned DiagID) {
@@ -1277,6 +1291,14 @@ static bool IsStructurallyEquivalent(StructuralEquivalenceContext &Context,
   if (Context.NonEquivalentDecls.count(std::make_pair(D1->getCanonicalDecl(),
                                                       D2->getCanonicalDecl())))
     return false;
+
+  // Check whether an earlier check already proved them equivalent.
+  if (Context.EquivalentDecls &&
+      Context.EquivalentDecls->count(std::make_pair(D1->getCanonicalDecl(),
+                                                    D2->getCanonicalDecl()))) {
+    ++Context.NumKnownEquivalent;
+    return true;
+  }
   
   // Determine whether we've already produced a tentative equivalence for D1.
   Decl *&EquivToD1 = Context.TentativeEquivalences[D1->getCanonicalDecl()];
@@ -1294,7 +1316,11 @@ bool StructuralEquivalenceContext::IsStructurallyEquivalent(Decl *D1,
   if (!::IsStructurallyEquivalent(*this, D1, D2))
     return false;
   
-  return !Finish();
+  if (Finish())
+    return false;
+
+  RecordEquivalences();
+  return true;
 }
 
 bool StructuralEquivalenceContext::IsStructurallyEquivalent(QualType T1, 
@@ -1302,7 +1328,36 @@ bool StructuralEquivalenceContext::IsStructurallyEquivalent(QualType T1,
   if (!::IsStructurallyEquivalent(*this, T1, T2))
     return false;
   
-  return !Finish();
+  if (Finish())
+    return false;
+
+  RecordEquivalences();
+  return true;
+}
+
+/// \brief Determine whether \p D is a tag declaration without a definition,
+/// which structural equivalence optimistically treats as matching anything.
+static bool isIncompleteTag(Decl *D) {
+  TagDecl *Tag = dyn_cast<TagDecl>(D);
+  return Tag && !Tag->getDefinition();
+}
+
+void StructuralEquivalenceContext::RecordEquivalences() {
+  if (!EquivalentDecls)
+    return;
+
+  // An incomplete tag may later be completed differently, so a result that
+  // relied on one is only valid for now.
+  for (llvm::DenseMap<Decl *, Decl *>::iterator
+         I = TentativeEquivalences.begin(), E = TentativeEquivalences.end();
+       I != E; ++I)
+    if (isIncompleteTag(I->first) || isIncompleteTag(I->second))
+      return;
+
+  for (llvm::DenseMap<Decl *, Decl *>::iterator
+         I = TentativeEquivalences.begin(), E = TentativeEquivalences.end();
+       I != E; ++I)
+    EquivalentDecls->insert(*I);
 }
 
 bool StructuralEquivalenceContext::Finish() {
@@ -2159,6 +2214,16 @@ bool ASTNodeImporter::ImportTemplateArguments(const TemplateArgument *FromArgs,
   return false;
 }
 
+/// \brief Run a structural equivalence check, crediting the importer with
+/// any answers that came from its set of known equivalences.
+static bool checkStructuralMatch(ASTImporter &Importer,
+                                 StructuralEquivalenceContext &Ctx,
+                                 Decl *From, Decl *To) {
+  bool Result = Ctx.IsStructurallyEquivalent(From, To);
+  Importer.noteEquivalenceCacheHits(Ctx.NumKnownEquivalent);
+  return Result;
+}
+
 bool ASTNodeImporter::IsStructuralMatch(RecordDecl *FromRecord, 
                                         RecordDecl *ToRecord, bool Complain) {
   // Eliminate a potential failure point where we attempt to re-import
@@ -2173,23 +2238,27 @@ bool ASTNodeImporter::IsStructuralMatch(RecordDecl *FromRecord,
   StructuralEquivalenceContext Ctx(Importer.getFromContext(),
                                    ToRecord->getASTContext(),
                                    Importer.getNonEquivalentDecls(),
-                                   false, Complain);
-  return Ctx.IsStructurallyEquivalent(FromRecord, ToRecord);
+                                   false, Complain,
+                                   &Importer.getEquivalentDecls());
+  return checkStructuralMatch(Importer, Ctx, FromRecord, ToRecord);
 }
 
 bool ASTNodeImporter::IsStructuralMatch(VarDecl *FromVar, VarDecl *ToVar,
                                         bool Complain) {
   StructuralEquivalenceContext Ctx(
       Importer.getFromContext(), Importer.getToContext(),
-      Importer.getNonEquivalentDecls(), false, Complain);
-  return Ctx.IsStructurallyEquivalent(FromVar, ToVar);
+      Importer.getNonEquivalentDecls(), false, Complain,
+      &Importer.getEquivalentDecls());
+  return checkStructuralMatch(Importer, Ctx, FromVar, ToVar);
 }
 
 bool ASTNodeImporter::IsStructuralMatch(EnumDecl *FromEnum, EnumDecl *ToEnum) {
   StructuralEquivalenceContext Ctx(Importer.getFromContext(),
                                    Importer.getToContext(),
-                                   Importer.getNonEquivalentDecls());
-  return Ctx.IsStructurallyEquivalent(FromEnum, ToEnum);
+                                   Importer.getNonEquivalentDecls(),
+                                   false, true,
+                                   &Importer.getEquivalentDecls());
+  return checkStructuralMatch(Importer, Ctx, FromEnum, ToEnum);
 }
 
 bool ASTNodeImporter::IsStructuralMatch(EnumConstantDecl *FromEC,
@@ -2207,16 +2276,20 @@ bool ASTNodeImporter::IsStructuralMatch(ClassTemplateDecl *From,
                                         ClassTemplateDecl *To) {
   StructuralEquivalenceContext Ctx(Importer.getFromContext(),
                                    Importer.getToContext(),
-                                   Importer.getNonEquivalentDecls());
-  return Ctx.IsStructurallyEquivalent(From, To);  
+                                   Importer.getNonEquivalentDecls(),
+                                   false, true,
+                                   &Importer.getEquivalentDecls());
+  return checkStructuralMatch(Importer, Ctx, From, To);  
 }
 
 bool ASTNodeImporter::IsStructuralMatch(VarTemplateDecl *From,
                                         VarTemplateDecl *To) {
   StructuralEquivalenceContext Ctx(Importer.getFromContext(),
                                    Importer.getToContext(),
-                                   Importer.getNonEquivalentDecls());
-  return Ctx.IsStructurallyEquivalent(From, To);
+                                   Importer.getNonEquivalentDecls(),
+                                   false, true,
+                                   &Importer.getEquivalentDecls());
+  return checkStructuralMatch(Importer, Ctx, From, To);
 }
 
 Decl *ASTNodeImporter::VisitDecl(Decl *D) {
@@ -4590,7 +4663,8 @@ ASTImporter::ASTImporter(ASTContext &ToContext, FileManager &ToFileManager,
                          bool MinimalImport)
   : ToContext(ToContext), FromContext(FromContext),
     ToFileManager(ToFileManager), FromFileManager(FromFileManager),
-    Minimal(MinimalImport), LastDiagFromFrom(false)
+    Minimal(MinimalImport), LastDiagFromFrom(false),
+    NumEquivalenceCacheHits(0)
 {
   ImportedDecls[FromContext.getTranslationUnitDecl()]
     = ToContext.getTranslationUnitDecl();
@@ -5153,6 +5227,21 @@ bool ASTImporter::IsStructurallyEquivalent(QualType From, QualType To,
     return true;
       
   StructuralEquivalenceContext Ctx(FromContext, ToContext, NonEquivalentDecls,
-                                   false, Complain);
-  return Ctx.IsStructurallyEquivalent(From, To);
+                                   false, Complain, &EquivalentDecls);
+  bool Result = Ctx.IsStructurallyEquivalent(From, To);
+  NumEquivalenceCacheHits += Ctx.NumKnownEquivalent;
+  return Result;
+}
+
+void ASTImporter::PrintStats() const {
+  llvm::errs() << "*** AST Importer Statistics:\n";
+  llvm::errs() << "  " << ImportedDecls.size() << " declarations imported\n";
+  llvm::errs() << "  " << ImportedTypes.size() << " types imported\n";
+  llvm::errs() << "  " << ImportedStmts.size() << " statements imported\n";
+  llvm::errs() << "  " << EquivalentDecls.size()
+               << " declaration pairs known to be equivalent\n";
+  llvm::errs() << "  " << NonEquivalentDecls.size()
+               << " declaration pairs known not to be equivalent\n";
+  llvm::errs() << "  " << NumEquivalenceCacheHits
+               << " equivalence checks answered from the cache\n";
 }
@@ -0,0 +1,236 @@
+//===--- ConstexprCallCache.cpp - Memoized constexpr calls ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the ConstexprCallCache class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/AST/ConstexprCallCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+ConstexprCallCache::ConstexprCallCache(uint64_t MemoryLimit)
+  : MemoryLimit(MemoryLimit), MemoryUsed(0), NumHits(0), NumMisses(0),
+    NumDropped(0) { }
+
+bool ConstexprCallCache::isMemoizable(const APValue &V) {
+  switch (V.getKind()) {
+  case APValue::Uninitialized:
+  case APValue::Int:
+  case APValue::Float:
+  case APValue::ComplexInt:
+  case APValue::ComplexFloat:
+    return true;
+
+  case APValue::LValue:
+  case APValue::MemberPointer:
+  case APValue::AddrLabelDiff:
+    return false;
+
+  case APValue::Vector:
+    for (unsigned I = 0, N = V.getVectorLength(); I != N; ++I)
+      if (!isMemoizable(V.getVectorElt(I)))
+        return false;
+    return true;
+
+  case APValue::Array:
+    for (unsigned I = 0, N = V.getArrayInitializedElts(); I != N; ++I)
+      if (!isMemoizable(V.getArrayInitializedElt(I)))
+        return false;
+    return !V.hasArrayFiller() || isMemoizable(V.getArrayFiller());
+
+  case APValue::Struct:
+    for (unsigned I = 0, N = V.getStructNumBases(); I != N; ++I)
+      if (!isMemoizable(V.getStructBase(I)))
+        return false;
+    for (unsigned I = 0, N = V.getStructNumFields(); I != N; ++I)
+      if (!isMemoizable(V.getStructField(I)))
+        return false;
+    return true;
+
+  case APValue::Union:
+    return isMemoizable(V.getUnionValue());
+  }
+  llvm_unreachable("Unknown APValue kind!");
+}
+
+static void addBytes(SmallVectorImpl<char> &Key, const void *Data,
+                     size_t Size) {
+  const char *Bytes = static_cast<const char *>(Data);
+  Key.append(Bytes, Bytes + Size);
+}
+
+static void addUnsigned(SmallVectorImpl<char> &Key, unsigned Value) {
+  addBytes(Key, &Value, sizeof(Value));
+}
+
+static void addPointer(SmallVectorImpl<char> &Key, const void *Ptr) {
+  addBytes(Key, &Ptr, sizeof(Ptr));
+}
+
+static void addAPInt(SmallVectorImpl<char> &Key, const llvm::APInt &Value) {
+  addUnsigned(Key, Value.getBitWidth());
+  addBytes(Key, Value.getRawData(), Value.getNumWords() * sizeof(uint64_t));
+}
+
+static void addAPFloat(SmallVectorImpl<char> &Key,
+                       const llvm::APFloat &Value) {
+  addPointer(Key, &Value.getSemantics());
+  addAPInt(Key, Value.bitcastToAPInt());
+}
+
+/// \brief Append an unambiguous encoding of the memoizable value \p V to
+/// \p Key.
+static void addValue(SmallVectorImpl<char> &Key, const APValue &V) {
+  Key.push_back(static_cast<char>(V.getKind()));
+  switch (V.getKind()) {
+  case APValue::Uninitialized:
+    return;
+
+  case APValue::Int:
+    Key.push_back(V.getInt().isUnsigned());
+    addAPInt(Key, V.getInt());
+    return;
+
+  case APValue::Float:
+    addAPFloat(Key, V.getFloat());
+    return;
+
+  case APValue::ComplexInt:
+    Key.push_back(V.getComplexIntReal().isUnsigned());
+    addAPInt(Key, V.getComplexIntReal());
+    addAPInt(Key, V.getComplexIntImag());
+    return;
+
+  case APValue::ComplexFloat:
+    addAPFloat(Key, V.getComplexFloatReal());
+    addAPFloat(Key, V.getComplexFloatImag());
+    return;
+
+  case APValue::Vector:
+    addUnsigned(Key, V.getVectorLength());
+    for (unsigned I = 0, N = V.getVectorLength(); I != N; ++I)
+      addValue(Key, V.getVectorElt(I));
+    return;
+
+  case APValue::Array:
+    addUnsigned(Key, V.getArraySize());
+    addUnsigned(Key, V.getArrayInitializedElts());
+    for (unsigned I = 0, N = V.getArrayInitializedElts(); I != N; ++I)
+      addValue(Key, V.getArrayInitializedElt(I));
+    if (V.hasArrayFiller())
+      addValue(Key, V.getArrayFiller());
+    return;
+
+  case APValue::Struct:
+    addUnsigned(Key, V.getStructNumBases());
+    addUnsigned(Key, V.getStructNumFields());
+    for (unsigned I = 0, N = V.getStructNumBases(); I != N; ++I)
+      addValue(Key, V.getStructBase(I));
+    for (unsigned I = 0, N = V.getStructNumFields(); I != N; ++I)
+      addValue(Key, V.getStructField(I));
+    return;
+
+  case APValue::Union:
+    addPointer(Key, V.getUnionField());
+    addValue(Key, V.getUnionValue());
+    return;
+
+  case APValue::LValue:
+  case APValue::MemberPointer:
+  case APValue::AddrLabelDiff:
+    break;
+  }
+  llvm_unreachable("value cannot be memoized");
+}
+
+/// \brief Estimate the memory used by the memoizable value \p V.
+static uint64_t getValueSize(const APValue &V) {
+  uint64_t Size = sizeof(APValue);
+  switch (V.getKind()) {
+  case APValue::Int:
+    if (V.getInt().getNumWords() > 1)
+      Size += V.getInt().getNumWords() * sizeof(uint64_t);
+    break;
+
+  case APValue::Vector:
+    for (unsigned I = 0, N = V.getVectorLength(); I != N; ++I)
+      Size += getValueSize(V.getVectorElt(I));
+    break;
+
+  case APValue::Array:
+    for (unsigned I = 0, N = V.getArrayInitializedElts(); I != N; ++I)
+      Size += getValueSize(V.getArrayInitializedElt(I));
+    if (V.hasArrayFiller())
+      Size += getValueSize(V.getArrayFiller());
+    break;
+
+  case APValue::Struct:
+    for (unsigned I = 0, N = V.getStructNumBases(); I != N; ++I)
+      Size += getValueSize(V.getStructBase(I));
+    for (unsigned I = 0, N = V.getStructNumFields(); I != N; ++I)
+      Size += getValueSize(V.getStructField(I));
+    break;
+
+  case APValue::Union:
+    Size += getValueSize(V.getUnionValue());
+    break;
+
+  default:
+    break;
+  }
+  return Size;
+}
+
+static void computeKey(const FunctionDecl *Callee, ArrayRef<APValue> Args,
+                       SmallVectorImpl<char> &Key) {
+  addPointer(Key, Callee);
+  addUnsigned(Key, Args.size());
+  for (unsigned I = 0, N = Args.size(); I != N; ++I)
+    addValue(Key, Args[I]);
+}
+
+const APValue *ConstexprCallCache::lookup(const FunctionDecl *Callee,
+                                          ArrayRef<APValue> Args) {
+  SmallString<64> Key;
+  computeKey(Callee, Args, Key);
+  llvm::StringMap<APValue>::iterator Known = Results.find(Key);
+  if (Known == Results.end()) {
+    ++NumMisses;
+    return nullptr;
+  }
+  ++NumHits;
+  return &Known->second;
+}
+
+void ConstexprCallCache::insert(const FunctionDecl *Callee,
+                                ArrayRef<APValue> Args,
+                                const APValue &Result) {
+  SmallString<64> Key;
+  computeKey(Callee, Args, Key);
+  uint64_t Size = Key.size() + getValueSize(Result);
+  if (MemoryUsed + Size > MemoryLimit) {
+    ++NumDropped;
+    return;
+  }
+
+  if (Results.insert(std::make_pair(Key, Result)).second)
+    MemoryUsed += Size;
+}
+
+void ConstexprCallCache::PrintStats() const {
+  llvm::errs() << "\n*** Constexpr Call Cache Stats:\n";
+  llvm::errs() << "  " << Results.size() << " memoized calls, using "
+               << MemoryUsed << " bytes (limit " << MemoryLimit << ").\n";
+  llvm::errs() << "  " << NumHits << " hits, " << NumMisses << " misses, "
+               << NumDropped << " results dropped because the cache was "
+                  "full.\n";
+}
@@ -0,0 +1,1004 @@
+//===--- ConstexprInterpreter.cpp - Bytecode constexpr evaluation ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ConstexprInterpreter class.
+//
+// A function is compiled to a sequence of instructions for a stack machine.
+// Its parameters and local variables occupy the first slots of its stack
+// frame, and expressions are evaluated on the stack above them. Every value is
+// an integer of at most 64 bits, held in a uint64_t in canonical form: values
+// of signed types are sign-extended and values of unsigned types are
+// zero-extended, so that most operations can work on the native integers.
+//
+// The instructions mirror what the tree-walking evaluator does for the same
+// constructs, including counting one evaluation step for each statement, but
+// every check that would produce a diagnostic there simply fails here.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ConstexprInterpreter.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/Stmt.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+namespace {
+enum Opcode : uint8_t {
+  OP_Const,        ///< Push the operand.
+  OP_GetLocal,     ///< Push the value of local variable number 'operand'.
+  OP_SetLocal,     ///< Pop a value into local variable number 'operand'.
+  OP_Pop,          ///< Discard the top of the stack.
+  OP_Step,         ///< Count an evaluation step.
+  OP_Jump,         ///< Jump to instruction number 'operand'.
+  OP_JumpIfFalse,  ///< Pop a value, and jump if it is zero.
+  OP_JumpIfTrue,   ///< Pop a value, and jump if it is nonzero.
+  OP_Call,         ///< Call function number 'operand' with the arguments on
+                   ///< the top of the stack, and push its result.
+  OP_Return,       ///< Return the top of the stack.
+  OP_Fail,         ///< Fail the evaluation.
+
+  // Binary operations pop the right operand, then the left operand, and push
+  // the result.
+  OP_Add, OP_Sub, OP_Mul, OP_Div, OP_Rem,
+  OP_Shl, OP_Shr,  ///< The operand is nonzero if the shift amount is signed.
+  OP_And, OP_Or, OP_Xor,
+  OP_LT, OP_GT, OP_LE, OP_GE, OP_EQ, OP_NE,
+
+  // Unary operations replace the top of the stack.
+  OP_Neg, OP_Not, OP_LNot,
+  OP_Cast,         ///< Convert to the instruction's type.
+  OP_ToBool
+};
+
+struct Instruction {
+  Opcode Op;
+
+  /// The width of the type the instruction operates on, in bits. For
+  /// comparisons, this is the type of the operands.
+  uint8_t Width;
+  bool Signed;
+
+  uint64_t Operand;
+};
+}
+
+struct ConstexprInterpreter::Function {
+  const FunctionDecl *Decl;
+  std::vector<Instruction> Code;
+  unsigned NumParams;
+
+  /// The number of slots in the frame, including the parameters.
+  unsigned NumLocals;
+
+  /// Whether the function is still being compiled. Such a function can
+  /// already be called by (mutually) recursive functions.
+  bool Compiling;
+
+  /// Whether the function was compiled successfully.
+  bool Valid;
+
+  explicit Function(const FunctionDecl *Decl)
+    : Decl(Decl), NumParams(0), NumLocals(0), Compiling(true), Valid(false) {}
+};
+
+/// Convert \p V to the canonical representation of an integer of the given
+/// width and signedness.
+static uint64_t normalize(uint64_t V, unsigned Width, bool Signed) {
+  if (Width >= 64)
+    return V;
+  uint64_t Mask = (uint64_t(1) << Width) - 1;
+  V &= Mask;
+  if (Signed && (V >> (Width - 1)))
+    V |= ~Mask;
+  return V;
+}
+
+/// Determine whether the signed value \p V fits in \p Width bits.
+static bool fitsSigned(uint64_t V, unsigned Width) {
+  return normalize(V, Width, true) == V;
+}
+
+/// Evaluate a binary operation, returning false if it does not produce a
+/// constant.
+static bool evaluateBinary(const Instruction &I, uint64_t A, uint64_t B,
+                           uint64_t &R) {
+  unsigned Width = I.Width;
+  int64_t SA = static_cast<int64_t>(A), SB = static_cast<int64_t>(B);
+  switch (I.Op) {
+  case OP_Add:
+    R = A + B;
+    if (!I.Signed)
+      break;
+    // The operands are sign-extended, so their sum cannot overflow 64 bits
+    // unless they are 64 bits wide.
+    if (Width == 64 ? static_cast<int64_t>((A ^ R) & (B ^ R)) < 0
+                    : !fitsSigned(R, Width))
+      return false;
+    return true;
+
+  case OP_Sub:
+    R = A - B;
+    if (!I.Signed)
+      break;
+    if (Width == 64 ? static_cast<int64_t>((A ^ B) & (A ^ R)) < 0
+                    : !fitsSigned(R, Width))
+      return false;
+    return true;
+
+  case OP_Mul:
+    if (!I.Signed) {
+      R = A * B;
+      break;
+    }
+    if (Width <= 32) {
+      R = static_cast<uint64_t>(SA * SB);
+    } else {
+      bool Overflow;
+      R = llvm::APInt(64, A).smul_ov(llvm::APInt(64, B), Overflow)
+              .getZExtValue();
+      if (Overflow)
+        return false;
+    }
+    return fitsSigned(R, Width);
+
+  case OP_Div:
+  case OP_Rem:
+    if (B == 0)
+      return false;
+    if (!I.Signed) {
+      R = I.Op == OP_Div ? A / B : A % B;
+      break;
+    }
+    // INT_MIN / -1 and INT_MIN % -1 overflow.
+    if (SB == -1 && A == normalize(uint64_t(1) << (Width - 1), Width, true))
+      return false;
+    R = static_cast<uint64_t>(I.Op == OP_Div ? SA / SB : SA % SB);
+    return true;
+
+  case OP_Shl:
+  case OP_Shr: {
+    // The shift amount must be non-negative and less than the width.
+    if (I.Operand && SB < 0)
+      return false;
+    if (B >= Width)
+      return false;
+    unsigned Amount = static_cast<unsigned>(B);
+    if (I.Op == OP_Shr) {
+      R = I.Signed && SA < 0 ? ~(~A >> Amount) : A >> Amount;
+      return true;
+    }
+    // A signed left shift must have a non-negative operand, and must not
+    // overflow the corresponding unsigned type.
+    if (I.Signed &&
+        (SA < 0 || (A && 64 - llvm::countLeadingZeros(A) + Amount > Width)))
+      return false;
+    R = A << Amount;
+    break;
+  }
+
+  case OP_And: R = A & B; return true;
+  case OP_Or:  R = A | B; return true;
+  case OP_Xor: R = A ^ B; return true;
+
+  case OP_LT: R = I.Signed ? SA < SB : A < B; return true;
+  case OP_GT: R = I.Signed ? SA > SB : A > B; return true;
+  case OP_LE: R = I.Signed ? SA <= SB : A <= B; return true;
+  case OP_GE: R = I.Signed ? SA >= SB : A >= B; return true;
+  case OP_EQ: R = A == B; return true;
+  case OP_NE: R = A != B; return true;
+
+  default:
+    llvm_unreachable("not a binary operation");
+  }
+  R = normalize(R, Width, I.Signed);
+  return true;
+}
+
+namespace clang {
+/// \brief Compiles a constexpr function definition to bytecode.
+class FunctionCompiler {
+  ConstexprInterpreter &Interp;
+  ASTContext &Ctx;
+  ConstexprInterpreter::Function &Fn;
+
+  /// The frame slots of the parameters and local variables.
+  llvm::DenseMap<const VarDecl *, unsigned> Locals;
+
+  /// The jumps out of the loops being compiled, to be patched once the
+  /// targets are known.
+  struct LoopJumps {
+    SmallVector<unsigned, 4> Breaks;
+    SmallVector<unsigned, 4> Continues;
+  };
+  SmallVector<LoopJumps, 4> Loops;
+
+  bool isSupportedType(QualType T) {
+    return T->isIntegralOrEnumerationType() && !T.isVolatileQualified() &&
+           Ctx.getIntWidth(T) <= 64;
+  }
+
+  unsigned emit(Opcode Op, unsigned Width, bool Signed, uint64_t Operand) {
+    Instruction I = { Op, static_cast<uint8_t>(Width), Signed, Operand };
+    Fn.Code.push_back(I);
+    return Fn.Code.size() - 1;
+  }
+
+  unsigned emit(Opcode Op, uint64_t Operand = 0) {
+    return emit(Op, 0, false, Operand);
+  }
+
+  unsigned emit(Opcode Op, QualType T, uint64_t Operand = 0) {
+    return emit(Op, Ctx.getIntWidth(T),
+                !T->isUnsignedIntegerOrEnumerationType(), Operand);
+  }
+
+  /// Emit a constant of type \p T.
+  void emitConst(QualType T, const llvm::APSInt &Value) {
+    uint64_t V = Value.isSigned() ? static_cast<uint64_t>(Value.getSExtValue())
+                                  : Value.getZExtValue();
+    emit(OP_Const, normalize(V, Ctx.getIntWidth(T),
+                             !T->isUnsignedIntegerOrEnumerationType()));
+  }
+
+  /// Point the jump instruction \p Jump at the next instruction.
+  void patchJump(unsigned Jump) { Fn.Code[Jump].Operand = Fn.Code.size(); }
+
+  unsigned addLocal(const VarDecl *VD) {
+    unsigned Slot = Fn.NumLocals++;
+    Locals[VD] = Slot;
+    return Slot;
+  }
+
+  bool getLocal(const Expr *E, unsigned &Slot);
+  bool compileGlobalRead(const VarDecl *VD, QualType T);
+  bool compileStmt(const Stmt *S);
+  bool compileDiscarded(const Expr *E);
+  bool compileExpr(const Expr *E);
+  bool compileCast(const CastExpr *E);
+  bool compileUnary(const UnaryOperator *E);
+  bool compileBinary(const BinaryOperator *E);
+  bool compileCall(const CallExpr *E);
+
+public:
+  FunctionCompiler(ConstexprInterpreter &Interp,
+                   ConstexprInterpreter::Function &Fn)
+    : Interp(Interp), Ctx(Interp.Ctx), Fn(Fn) {}
+
+  bool compile();
+};
+}
+
+bool FunctionCompiler::compile() {
+  const FunctionDecl *FD = Fn.Decl;
+  if (FD->isInvalidDecl() || !FD->isConstexpr() || FD->isVariadic() ||
+      !isSupportedType(FD->getReturnType()))
+    return false;
+  if (const CXXMethodDecl *MD = dyn_cast<CXXMethodDecl>(FD))
+    if (MD->isInstance())
+      return false;
+
+  for (unsigned I = 0, N = FD->getNumParams(); I != N; ++I) {
+    const ParmVarDecl *PVD = FD->getParamDecl(I);
+    if (!isSupportedType(PVD->getType()))
+      return false;
+    addLocal(PVD);
+  }
+  Fn.NumParams = FD->getNumParams();
+
+  const Stmt *Body = FD->getBody();
+  if (!Body) {
+    Interp.SawIncompleteDecl = true;
+    return false;
+  }
+  if (!compileStmt(Body))
+    return false;
+
+  // Flowing off the end of the function does not produce a value.
+  emit(OP_Fail);
+  return true;
+}
+
+bool FunctionCompiler::getLocal(const Expr *E, unsigned &Slot) {
+  const DeclRefExpr *DRE = dyn_cast<DeclRefExpr>(E->IgnoreParens());
+  if (!DRE)
+    return false;
+  llvm::DenseMap<const VarDecl *, unsigned>::iterator Known =
+      Locals.find(dyn_cast<VarDecl>(DRE->getDecl()));
+  if (Known == Locals.end() || !isSupportedType(DRE->getType()))
+    return false;
+  Slot = Known->second;
+  return true;
+}
+
+/// Compile a read of the global constant \p VD, which is folded to its value.
+bool FunctionCompiler::compileGlobalRead(const VarDecl *VD, QualType T) {
+  if (!VD->isConstexpr() && !T.isConstQualified())
+    return false;
+
+  const VarDecl *Definition = nullptr;
+  const Expr *Init = VD->getAnyInitializer(Definition);
+  if (!Init) {
+    // The variable may be initialized later.
+    Interp.SawIncompleteDecl = true;
+    return false;
+  }
+  if (Init->isValueDependent() || Definition->isWeak())
+    return false;
+
+  SmallVector<PartialDiagnosticAt, 8> Notes;
+  const APValue *Value = Definition->evaluateValue(Notes);
+  if (!Value || !Notes.empty() || !Definition->checkInitIsICE() ||
+      !Value->isInt())
+    return false;
+
+  emitConst(T, Value->getInt());
+  return true;
+}
+
+bool FunctionCompiler::compileStmt(const Stmt *S) {
+  emit(OP_Step);
+
+  switch (S->getStmtClass()) {
+  default:
+    if (const Expr *E = dyn_cast<Expr>(S))
+      return compileDiscarded(E);
+    return false;
+
+  case Stmt::NullStmtClass:
+    return true;
+
+  case Stmt::DeclStmtClass:
+    for (const auto *D : cast<DeclStmt>(S)->decls()) {
+      const VarDecl *VD = dyn_cast<VarDecl>(D);
+      if (!VD)
+        continue;
+      const Expr *Init = VD->getInit();
+      if (!VD->hasLocalStorage() || !isSupportedType(VD->getType()) ||
+          !Init || Init->isValueDependent() || !compileExpr(Init))
+        return false;
+      // The variable is only in scope after its initializer.
+      emit(OP_SetLocal, addLocal(VD));
+    }
+    return true;
+
+  case Stmt::ReturnStmtClass: {
+    const Expr *RetExpr = cast<ReturnStmt>(S)->getRetValue();
+    if (!RetExpr || !compileExpr(RetExpr))
+      return false;
+    emit(OP_Return);
+    return true;
+  }
+
+  case Stmt::CompoundStmtClass:
+    for (const auto *BI : cast<CompoundStmt>(S)->body())
+      if (!compileStmt(BI))
+        return false;
+    return true;
+
+  case Stmt::IfStmtClass: {
+    const IfStmt *IS = cast<IfStmt>(S);
+    if (IS->getConditionVariable() || !compileExpr(IS->getCond()))
+      return false;
+    unsigned SkipThen = emit(OP_JumpIfFalse);
+    if (!compileStmt(IS->getThen()))
+      return false;
+    if (const Stmt *Else = IS->getElse()) {
+      unsigned SkipElse = emit(OP_Jump);
+      patchJump(SkipThen);
+      if (!compileStmt(Else))
+        return false;
+      patchJump(SkipElse);
+    } else {
+      patchJump(SkipThen);
+    }
+    return true;
+  }
+
+  case Stmt::WhileStmtClass: {
+    const WhileStmt *WS = cast<WhileStmt>(S);
+    if (WS->getConditionVariable())
+      return false;
+    uint64_t Top = Fn.Code.size();
+    if (!compileExpr(WS->getCond()))
+      return false;
+    unsigned Exit = emit(OP_JumpIfFalse);
+    Loops.push_back(LoopJumps());
+    if (!compileStmt(WS->getBody()))
+      return false;
+    for (unsigned Continue : Loops.back().Continues)
+      Fn.Code[Continue].Operand = Top;
+    emit(OP_Jump, Top);
+    patchJump(Exit);
+    for (unsigned Break : Loops.back().Breaks)
+      patchJump(Break);
+    Loops.pop_back();
+    return true;
+  }
+
+  case Stmt::DoStmtClass: {
+    const DoStmt *DS = cast<DoStmt>(S);
+    uint64_t Top = Fn.Code.size();
+    Loops.push_back(LoopJumps());
+    if (!compileStmt(DS->getBody()))
+      return false;
+    for (unsigned Continue : Loops.back().Continues)
+      patchJump(Continue);
+    if (!compileExpr(DS->getCond()))
+      return false;
+    emit(OP_JumpIfTrue, Top);
+    for (unsigned Break : Loops.back().Breaks)
+      patchJump(Break);
+    Loops.pop_back();
+    return true;
+  }
+
+  case Stmt::ForStmtClass: {
+    const ForStmt *FS = cast<ForStmt>(S);
+    if (FS->getConditionVariable())
+      return false;
+    if (FS->getInit() && !compileStmt(FS->getInit()))
+      return false;
+    uint64_t Top = Fn.Code.size();
+    unsigned Exit = ~0U;
+    if (const Expr *Cond = FS->getCond()) {
+      if (!compileExpr(Cond))
+        return false;
+      Exit = emit(OP_JumpIfFalse);
+    }
+    Loops.push_back(LoopJumps());
+    if (!compileStmt(FS->getBody()))
+      return false;
+    for (unsigned Continue : Loops.back().Continues)
+      patchJump(Continue);
+    if (FS->getInc() && !compileDiscarded(FS->getInc()))
+      return false;
+    emit(OP_Jump, Top);
+    if (Exit != ~0U)
+      patchJump(Exit);
+    for (unsigned Break : Loops.back().Breaks)
+      patchJump(Break);
+    Loops.pop_back();
+    return true;
+  }
+
+  case Stmt::BreakStmtClass:
+    // 'switch' is not supported, so this breaks out of a loop.
+    if (Loops.empty())
+      return false;
+    Loops.back().Breaks.push_back(emit(OP_Jump));
+    return true;
+
+  case Stmt::ContinueStmtClass:
+    if (Loops.empty())
+      return false;
+    Loops.back().Continues.push_back(emit(OP_Jump));
+    return true;
+  }
+}
+
+bool FunctionCompiler::compileDiscarded(const Expr *E) {
+  if (!compileExpr(E))
+    return false;
+  emit(OP_Pop);
+  return true;
+}
+
+/// Compile \p E, pushing its value. If \p E is a glvalue, this reads the object
+/// it refers to.
+bool FunctionCompiler::compileExpr(const Expr *E) {
+  if (E->isValueDependent() || !isSupportedType(E->getType()))
+    return false;
+
+  switch (E->getStmtClass()) {
+  default:
+    return false;
+
+  case Stmt::IntegerLiteralClass:
+    emitConst(E->getType(),
+              llvm::APSInt(cast<IntegerLiteral>(E)->getValue(), true));
+    return true;
+
+  case Stmt::CharacterLiteralClass:
+    emitConst(E->getType(),
+              llvm::APSInt::getUnsigned(cast<CharacterLiteral>(E)->getValue()));
+    return true;
+
+  case Stmt::CXXBoolLiteralExprClass:
+    emit(OP_Const, cast<CXXBoolLiteralExpr>(E)->getValue());
+    return true;
+
+  case Stmt::UnaryExprOrTypeTraitExprClass: {
+    llvm::APSInt Value;
+    if (!E->EvaluateAsInt(Value, Ctx))
+      return false;
+    emitConst(E->getType(), Value);
+    return true;
+  }
+
+  case Stmt::ParenExprClass:
+    return compileExpr(cast<ParenExpr>(E)->getSubExpr());
+  case Stmt::ExprWithCleanupsClass:
+    return compileExpr(cast<ExprWithCleanups>(E)->getSubExpr());
+  case Stmt::SubstNonTypeTemplateParmExprClass:
+    return compileExpr(
+        cast<SubstNonTypeTemplateParmExpr>(E)->getReplacement());
+  case Stmt::CXXDefaultArgExprClass:
+    return compileExpr(cast<CXXDefaultArgExpr>(E)->getExpr());
+
+  case Stmt::DeclRefExprClass: {
+    const ValueDecl *D = cast<DeclRefExpr>(E)->getDecl();
+    if (const EnumConstantDecl *ECD = dyn_cast<EnumConstantDecl>(D)) {
+      emitConst(E->getType(), ECD->getInitVal());
+      return true;
+    }
+    const VarDecl *VD = dyn_cast<VarDecl>(D);
+    if (!VD)
+      return false;
+    unsigned Slot;
+    if (getLocal(E, Slot)) {
+      emit(OP_GetLocal, Slot);
+      return true;
+    }
+    if (VD->hasLocalStorage())
+      return false;
+    return compileGlobalRead(VD, E->getType());
+  }
+
+  case Stmt::ImplicitCastExprClass:
+  case Stmt::CStyleCastExprClass:
+  case Stmt::CXXFunctionalCastExprClass:
+  case Stmt::CXXStaticCastExprClass:
+    return compileCast(cast<CastExpr>(E));
+
+  case Stmt::UnaryOperatorClass:
+    return compileUnary(cast<UnaryOperator>(E));
+
+  case Stmt::BinaryOperatorClass:
+  case Stmt::CompoundAssignOperatorClass:
+    return compileBinary(cast<BinaryOperator>(E));
+
+  case Stmt::ConditionalOperatorClass: {
+    const ConditionalOperator *CO = cast<ConditionalOperator>(E);
+    if (!compileExpr(CO->getCond()))
+      return false;
+    unsigned SkipTrue = emit(OP_JumpIfFalse);
+    if (!compileExpr(CO->getTrueExpr()))
+      return false;
+    unsigned SkipFalse = emit(OP_Jump);
+    patchJump(SkipTrue);
+    if (!compileExpr(CO->getFalseExpr()))
+      return false;
+    patchJump(SkipFalse);
+    return true;
+  }
+
+  case Stmt::CallExprClass:
+    return compileCall(cast<CallExpr>(E));
+  }
+}
+
+bool FunctionCompiler::compileCast(const CastExpr *E) {
+  const Expr *SubExpr = E->getSubExpr();
+  switch (E->getCastKind()) {
+  case CK_LValueToRValue:
+  case CK_NoOp:
+    return compileExpr(SubExpr);
+
+  case CK_IntegralCast:
+    if (!compileExpr(SubExpr))
+      return false;
+    emit(OP_Cast, E->getType());
+    return true;
+
+  case CK_IntegralToBoolean:
+    if (!compileExpr(SubExpr))
+      return false;
+    emit(OP_ToBool);
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+bool FunctionCompiler::compileUnary(const UnaryOperator *E) {
+  const Expr *SubExpr = E->getSubExpr();
+  QualType T = E->getType();
+  switch (E->getOpcode()) {
+  case UO_Plus:
+    return compileExpr(SubExpr);
+
+  case UO_Minus:
+  case UO_Not:
+  case UO_LNot:
+    if (!compileExpr(SubExpr))
+      return false;
+    emit(E->getOpcode() == UO_Minus ? OP_Neg :
+         E->getOpcode() == UO_Not ? OP_Not : OP_LNot, T);
+    return true;
+
+  case UO_PreInc:
+  case UO_PreDec:
+  case UO_PostInc:
+  case UO_PostDec: {
+    unsigned Slot;
+    QualType VarType = SubExpr->getType();
+    if (VarType->isBooleanType() || !getLocal(SubExpr, Slot))
+      return false;
+    bool IsPost = E->isPostfix();
+    emit(OP_GetLocal, Slot);
+    if (IsPost)
+      emit(OP_GetLocal, Slot);
+    emit(OP_Const, 1);
+    // Like the evaluator, only treat overflow as an error for types that are
+    // not promoted; smaller types wrap around when converted back.
+    Opcode Op = E->isIncrementOp() ? OP_Add : OP_Sub;
+    if (VarType->isSignedIntegerOrEnumerationType() &&
+        Ctx.getIntWidth(VarType) >= Ctx.getIntWidth(Ctx.IntTy)) {
+      emit(Op, VarType);
+    } else {
+      emit(Op, Ctx.getIntWidth(VarType), /*Signed=*/false, 0);
+      emit(OP_Cast, VarType);
+    }
+    emit(OP_SetLocal, Slot);
+    if (!IsPost)
+      emit(OP_GetLocal, Slot);
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
+
+bool FunctionCompiler::compileBinary(const BinaryOperator *E) {
+  const Expr *LHS = E->getLHS(), *RHS = E->getRHS();
+  BinaryOperatorKind Opc = E->getOpcode();
+
+  switch (Opc) {
+  case BO_Comma:
+    return compileDiscarded(LHS) && compileExpr(RHS);
+
+  case BO_LAnd:
+  case BO_LOr: {
+    if (!compileExpr(LHS))
+      return false;
+    unsigned ShortCircuit = emit(Opc == BO_LAnd ? OP_JumpIfFalse
+                                                : OP_JumpIfTrue);
+    if (!compileExpr(RHS))
+      return false;
+    unsigned Done = emit(OP_Jump);
+    patchJump(ShortCircuit);
+    emit(OP_Const, Opc == BO_LOr);
+    patchJump(Done);
+    return true;
+  }
+
+  case BO_Assign: {
+    unsigned Slot;
+    if (!getLocal(LHS, Slot) || !compileExpr(RHS))
+      return false;
+    emit(OP_SetLocal, Slot);
+    emit(OP_GetLocal, Slot);
+    return true;
+  }
+
+  default:
+    break;
+  }
+
+  static const Opcode Opcodes[] = {
+    OP_Mul, OP_Div, OP_Rem, OP_Add, OP_Sub, OP_Shl, OP_Shr,
+    OP_LT, OP_GT, OP_LE, OP_GE, OP_EQ, OP_NE,
+    OP_And, OP_Xor, OP_Or
+  };
+
+  if (E->isCompoundAssignmentOp()) {
+    const CompoundAssignOperator *CAO = cast<CompoundAssignOperator>(E);
+    BinaryOperatorKind Op = BinaryOperator::getOpForCompoundAssignment(Opc);
+    unsigned Slot;
+    if (!getLocal(LHS, Slot) ||
+        !isSupportedType(CAO->getComputationLHSType()) ||
+        !isSupportedType(CAO->getComputationResultType()))
+      return false;
+    // As in the evaluator, the variable is read after the RHS has been
+    // evaluated, which can assign to it; the RHS waits in a scratch slot.
+    // The value of the variable is converted to the computation type, and
+    // the result back to the type of the variable.
+    if (!compileExpr(RHS))
+      return false;
+    unsigned Scratch = Fn.NumLocals++;
+    emit(OP_SetLocal, Scratch);
+    emit(OP_GetLocal, Slot);
+    emit(OP_Cast, CAO->getComputationLHSType());
+    emit(OP_GetLocal, Scratch);
+    emit(Opcodes[Op - BO_Mul], CAO->getComputationResultType(),
+         RHS->getType()->isSignedIntegerOrEnumerationType());
+    emit(OP_Cast, LHS->getType());
+    emit(OP_SetLocal, Slot);
+    emit(OP_GetLocal, Slot);
+    return true;
+  }
+
+  if (Opc < BO_Mul || Opc > BO_Or)
+    return false;
+  if (!compileExpr(LHS) || !compileExpr(RHS))
+    return false;
+  // Comparisons operate on the type of their operands; other operators on
+  // the type of their result, which for shifts is the type of the LHS.
+  QualType OpType = E->isComparisonOp() ? LHS->getType() : E->getType();
+  emit(Opcodes[Opc - BO_Mul], OpType,
+       RHS->getType()->isSignedIntegerOrEnumerationType());
+  return true;
+}
+
+bool FunctionCompiler::compileCall(const CallExpr *E) {
+  const FunctionDecl *Callee = E->getDirectCallee();
+  if (!Callee || Callee->getBuiltinID())
+    return false;
+
+  const FunctionDecl *Definition = nullptr;
+  Callee->getBody(Definition);
+  if (!Definition) {
+    // The function may be defined later.
+    Interp.SawIncompleteDecl = true;
+    return false;
+  }
+  if (E->getNumArgs() != Definition->getNumParams())
+    return false;
+
+  for (unsigned I = 0, N = E->getNumArgs(); I != N; ++I)
+    if (!compileExpr(E->getArg(I)))
+      return false;
+
+  unsigned ID;
+  if (!Interp.getFunction(Definition, ID))
+    return false;
+  emit(OP_Call, ID);
+  return true;
+}
+
+ConstexprInterpreter::ConstexprInterpreter(ASTContext &Ctx)
+  : Ctx(Ctx), SawIncompleteDecl(false), NumCalls(0), NumFailedCalls(0),
+    NumUnsupportedCalls(0) { }
+
+ConstexprInterpreter::~ConstexprInterpreter() { }
+
+bool ConstexprInterpreter::getFunction(const FunctionDecl *FD, unsigned &ID) {
+  llvm::DenseMap<const FunctionDecl *, unsigned>::iterator Known =
+      FunctionIDs.find(FD);
+  if (Known != FunctionIDs.end()) {
+    ID = Known->second;
+    const Function &Fn = *Functions[ID];
+    return Fn.Valid || Fn.Compiling;
+  }
+
+  ID = Functions.size();
+  Function *Fn = new Function(FD);
+  Functions.push_back(std::unique_ptr<Function>(Fn));
+  FunctionIDs[FD] = ID;
+
+  bool OldSawIncompleteDecl = SawIncompleteDecl;
+  SawIncompleteDecl = false;
+  Fn->Valid = FunctionCompiler(*this, *Fn).compile();
+  Fn->Compiling = false;
+  if (!Fn->Valid) {
+    Fn->Code.clear();
+    // If this failed because something was not defined yet, try again next
+    // time.
+    if (SawIncompleteDecl)
+      FunctionIDs.erase(FD);
+  }
+  SawIncompleteDecl |= OldSawIncompleteDecl;
+  return Fn->Valid;
+}
+
+ConstexprInterpreter::CallResult
+ConstexprInterpreter::run(unsigned ID, ArrayRef<uint64_t> Args,
+                          unsigned CallDepth, unsigned &StepsLeft,
+                          uint64_t &Result) {
+  struct Frame {
+    const Function *Fn;
+    unsigned PC;
+    unsigned Base;
+  };
+  SmallVector<Frame, 16> Callers;
+  SmallVector<uint64_t, 64> Stack(Args.begin(), Args.end());
+
+  const Function *Fn = Functions[ID].get();
+  unsigned PC = 0, Base = 0;
+  unsigned Steps = StepsLeft;
+  unsigned MaxDepth = Ctx.getLangOpts().ConstexprCallDepth;
+  Stack.resize(Fn->NumLocals);
+
+  while (true) {
+    const Instruction &I = Fn->Code[PC++];
+    switch (I.Op) {
+    case OP_Const:
+      Stack.push_back(I.Operand);
+      break;
+
+    case OP_GetLocal:
+      Stack.push_back(Stack[Base + I.Operand]);
+      break;
+
+    case OP_SetLocal:
+      Stack[Base + I.Operand] = Stack.pop_back_val();
+      break;
+
+    case OP_Pop:
+      Stack.pop_back();
+      break;
+
+    case OP_Step:
+      if (!Steps)
+        return CR_Failed;
+      --Steps;
+      break;
+
+    case OP_Jump:
+      PC = I.Operand;
+      break;
+
+    case OP_JumpIfFalse:
+      if (!Stack.pop_back_val())
+        PC = I.Operand;
+      break;
+
+    case OP_JumpIfTrue:
+      if (Stack.pop_back_val())
+        PC = I.Operand;
+      break;
+
+    case OP_Call: {
+      const Function *Callee = Functions[I.Operand].get();
+      if (!Callee->Valid)
+        return CR_Unsupported;
+      // The caller frames, and this one, are on the evaluator's call stack
+      // too.
+      if (CallDepth + Callers.size() + 1 > MaxDepth)
+        return CR_Failed;
+      Frame Caller = { Fn, PC, Base };
+      Callers.push_back(Caller);
+      Fn = Callee;
+      PC = 0;
+      Base = Stack.size() - Fn->NumParams;
+      Stack.resize(Base + Fn->NumLocals);
+      break;
+    }
+
+    case OP_Return: {
+      uint64_t Value = Stack.back();
+      if (Callers.empty()) {
+        Result = Value;
+        StepsLeft = Steps;
+        return CR_Success;
+      }
+      Stack.resize(Base);
+      Stack.push_back(Value);
+      Frame Caller = Callers.pop_back_val();
+      Fn = Caller.Fn;
+      PC = Caller.PC;
+      Base = Caller.Base;
+      break;
+    }
+
+    case OP_Fail:
+      return CR_Failed;
+
+    case OP_Add: case OP_Sub: case OP_Mul: case OP_Div: case OP_Rem:
+    case OP_Shl: case OP_Shr: case OP_And: case OP_Or: case OP_Xor:
+    case OP_LT: case OP_GT: case OP_LE: case OP_GE: case OP_EQ: case OP_NE: {
+      uint64_t RHS = Stack.pop_back_val();
+      if (!evaluateBinary(I, Stack.back(), RHS, Stack.back()))
+        return CR_Failed;
+      break;
+    }
+
+    case OP_Neg: {
+      uint64_t &V = Stack.back();
+      if (I.Signed &&
+          V == normalize(uint64_t(1) << (I.Width - 1), I.Width, true))
+        return CR_Failed;
+      V = normalize(0 - V, I.Width, I.Signed);
+      break;
+    }
+
+    case OP_Not:
+      Stack.back() = normalize(~Stack.back(), I.Width, I.Signed);
+      break;
+
+    case OP_LNot:
+      Stack.back() = !Stack.back();
+      break;
+
+    case OP_Cast:
+      Stack.back() = normalize(Stack.back(), I.Width, I.Signed);
+      break;
+
+    case OP_ToBool:
+      Stack.back() = Stack.back() != 0;
+      break;
+    }
+  }
+}
+
+ConstexprInterpreter::CallResult
+ConstexprInterpreter::call(const FunctionDecl *Callee, ArrayRef<APValue> Args,
+                           unsigned CallDepth, unsigned &StepsLeft,
+                           APValue &Result) {
+  // The callee may still be being compiled, if compiling it evaluates a
+  // constant which calls it.
+  unsigned ID;
+  if (!getFunction(Callee, ID) || !Functions[ID]->Valid ||
+      Args.size() != Callee->getNumParams()) {
+    ++NumUnsupportedCalls;
+    return CR_Unsupported;
+  }
+
+  SmallVector<uint64_t, 8> ArgValues;
+  for (unsigned I = 0, N = Args.size(); I != N; ++I) {
+    if (!Args[I].isInt()) {
+      ++NumUnsupportedCalls;
+      return CR_Unsupported;
+    }
+    const llvm::APSInt &Arg = Args[I].getInt();
+    QualType ParamType = Callee->getParamDecl(I)->getType();
+    ArgValues.push_back(
+        normalize(Arg.isSigned() ? static_cast<uint64_t>(Arg.getSExtValue())
+                                 : Arg.getZExtValue(),
+                  Ctx.getIntWidth(ParamType),
+                  !ParamType->isUnsignedIntegerOrEnumerationType()));
+  }
+
+  uint64_t Value;
+  CallResult R = run(ID, ArgValues, CallDepth, StepsLeft, Value);
+  switch (R) {
+  case CR_Success: {
+    QualType ReturnType = Callee->getReturnType();
+    llvm::APInt Int(Ctx.getIntWidth(ReturnType), Value);
+    Result = APValue(llvm::APSInt(
+        Int, ReturnType->isUnsignedIntegerOrEnumerationType()));
+    ++NumCalls;
+    break;
+  }
+  case CR_Failed:
+    ++NumFailedCalls;
+    break;
+  case CR_Unsupported:
+    ++NumUnsupportedCalls;
+    break;
+  }
+  return R;
+}
+
+void ConstexprInterpreter::PrintStats() const {
+  unsigned NumValid = 0, NumInstructions = 0;
+  for (unsigned I = 0, N = Functions.size(); I != N; ++I) {
+    if (Functions[I]->Valid) {
+      ++NumValid;
+      NumInstructions += Functions[I]->Code.size();
+    }
+  }
+
+  llvm::errs() << "\n*** Constexpr Interpreter Stats:\n";
+  llvm::errs() << "  " << NumValid << " functions compiled to "
+               << NumInstructions << " instructions, "
+               << Functions.size() - NumValid
+               << " functions could not be compiled.\n";
+  llvm::errs() << "  " << NumCalls << " calls interpreted, " << NumFailedCalls
+               << " failed calls and " << NumUnsupportedCalls
+               << " unsupported calls left to the evaluator.\n";
+}
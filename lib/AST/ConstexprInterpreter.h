@@ -0,0 +1,106 @@
+//===--- ConstexprInterpreter.h - Bytecode constexpr evaluation -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the ConstexprInterpreter class, which compiles constexpr
+// functions to bytecode and runs them on a stack machine.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LIB_AST_CONSTEXPRINTERPRETER_H
+#define LLVM_CLANG_LIB_AST_CONSTEXPRINTERPRETER_H
+
+#include "clang/AST/APValue.h"
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include <memory>
+#include <vector>
+
+namespace clang {
+
+class ASTContext;
+class FunctionDecl;
+
+/// \brief Evaluates calls to constexpr functions by compiling them to
+/// bytecode, once per ASTContext, and running the bytecode on a stack
+/// machine whose values are native 64-bit integers.
+///
+/// Only functions whose parameters, locals and result are integers (of at most
+/// 64 bits), and whose bodies use a core subset of statements and
+/// expressions, can be compiled. The interpreter never diagnoses anything: any
+/// call it cannot compile, and any evaluation which would not produce a
+/// constant (overflow, division by zero, exceeding a limit, ...) is left to
+/// the tree-walking evaluator in ExprConstant.cpp, which reevaluates the call
+/// and produces the diagnostics. The interpreter is therefore only ever used
+/// for calls which it can evaluate successfully.
+class ConstexprInterpreter {
+public:
+  enum CallResult {
+    /// The call was evaluated.
+    CR_Success,
+    /// The callee could not be compiled.
+    CR_Unsupported,
+    /// The call does not produce a constant, or hit a limit.
+    CR_Failed
+  };
+
+  struct Function;
+
+private:
+  ASTContext &Ctx;
+
+  /// \brief The compiled functions, indexed by the operand of a call
+  /// instruction.
+  std::vector<std::unique_ptr<Function>> Functions;
+
+  /// \brief Maps function definitions to their index in \c Functions.
+  llvm::DenseMap<const FunctionDecl *, unsigned> FunctionIDs;
+
+  /// \brief Whether compiling the current function failed because some
+  /// function or variable it uses is not defined yet. Such failures are not
+  /// remembered, so that the function is compiled again on its next call.
+  bool SawIncompleteDecl;
+
+  unsigned NumCalls;
+  unsigned NumFailedCalls;
+  unsigned NumUnsupportedCalls;
+
+  /// \brief Retrieve the index of the compiled function \p FD, compiling it
+  /// if necessary. Returns false if \p FD cannot be compiled.
+  bool getFunction(const FunctionDecl *FD, unsigned &ID);
+
+  CallResult run(unsigned ID, ArrayRef<uint64_t> Args, unsigned CallDepth,
+                 unsigned &StepsLeft, uint64_t &Result);
+
+  ConstexprInterpreter(const ConstexprInterpreter &) LLVM_DELETED_FUNCTION;
+  void operator=(const ConstexprInterpreter &) LLVM_DELETED_FUNCTION;
+
+  friend class FunctionCompiler;
+
+public:
+  explicit ConstexprInterpreter(ASTContext &Ctx);
+  ~ConstexprInterpreter();
+
+  /// \brief Evaluate a call to the constexpr function definition \p Callee.
+  ///
+  /// \param CallDepth The depth of the constexpr call stack at the point of
+  /// the call, which is checked against the call depth limit for any calls
+  /// that \p Callee makes.
+  ///
+  /// \param StepsLeft The number of evaluation steps the call may perform.
+  /// If the call succeeds, the steps it performed are subtracted.
+  CallResult call(const FunctionDecl *Callee, ArrayRef<APValue> Args,
+                  unsigned CallDepth, unsigned &StepsLeft, APValue &Result);
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
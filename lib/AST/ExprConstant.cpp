@@ -33,10 +33,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "ConstexprInterpreter.h"
 #include "clang/AST/APValue.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/ASTDiagnostic.h"
 #include "clang/AST/CharUnits.h"
+#include "clang/AST/ConstexprCallCache.h"
 #include "clang/AST/Expr.h"
 #include "clang/AST/RecordLayout.h"
 #include "clang/AST/StmtVisitor.h"
@@ -454,6 +456,19 @@ namespace {
     /// notes attached to it will also be stored, otherwise they will not be.
     bool HasActiveDiagnostic;
 
+    /// NumUnmemoizableEvents - The number of times evaluation has done
+    /// something whose outcome depends on more than the function being called
+    /// and its arguments: diagnosed a problem, had a side-effect, looked at the
+    /// declaration being initialized, or depended on the evaluation mode. A
+    /// call during which this changes cannot be memoized.
+    unsigned NumUnmemoizableEvents;
+
+    /// InterpreterFailed - Whether a call evaluated by the bytecode
+    /// interpreter has failed. We then evaluate that call again to diagnose
+    /// the failure, and don't use the interpreter for the calls it makes,
+    /// which would most likely fail in the same way.
+    bool InterpreterFailed;
+
     enum EvaluationMode {
       /// Evaluate as a constant expression. Stop if we find that the expression
       /// is not a constant expression.
@@ -507,6 +522,19 @@ namespace {
     // in such constructs, not just overflow.
     bool checkingForOverflow() { return EvalMode == EM_EvaluateForOverflow; }
 
+    /// Note that evaluation has done something that depends on more than the
+    /// current call and its arguments.
+    void noteUnmemoizable() { ++NumUnmemoizableEvents; }
+
+    /// Can the results of constexpr function calls be looked up in, and added
+    /// to, the ASTContext's call cache? Potential constant expressions are
+    /// checked without knowing the values of parameters, and overflow checking
+    /// wants to visit every subexpression, so neither can use it.
+    bool canMemoizeCalls() const {
+      return !checkingPotentialConstantExpression() &&
+             EvalMode != EM_EvaluateForOverflow;
+    }
+
     EvalInfo(const ASTContext &C, Expr::EvalStatus &S, EvaluationMode Mode)
       : Ctx(const_cast<ASTContext &>(C)), EvalStatus(S), CurrentCall(nullptr),
         CallStackDepth(0), NextCallIndex(1),
@@ -514,7 +542,7 @@ namespace {
         BottomFrame(*this, SourceLocation(), nullptr, nullptr, nullptr),
         EvaluatingDecl((const ValueDecl *)nullptr),
         EvaluatingDeclValue(nullptr), HasActiveDiagnostic(false),
-        EvalMode(Mode) {}
+        NumUnmemoizableEvents(0), InterpreterFailed(false), EvalMode(Mode) {}
 
     void setEvaluatingDecl(APValue::LValueBase Base, APValue &Value) {
       EvaluatingDecl = Base;
@@ -575,6 +603,7 @@ namespace {
     OptionalDiagnostic Diag(SourceLocation Loc, diag::kind DiagId
                               = diag::note_invalid_subexpr_in_const_expr,
                             unsigned ExtraNotes = 0) {
+      noteUnmemoizable();
       if (EvalStatus.Diag) {
         // If we have a prior diagnostic, it will be noting that the expression
         // isn't a constant expression. This diagnostic is more important,
@@ -624,6 +653,7 @@ namespace {
                             unsigned ExtraNotes = 0) {
       if (EvalStatus.Diag)
         return Diag(E->getExprLoc(), DiagId, ExtraNotes);
+      noteUnmemoizable();
       HasActiveDiagnostic = false;
       return OptionalDiagnostic();
     }
@@ -640,6 +670,7 @@ namespace {
       // Don't override a previous diagnostic. Don't bother collecting
       // diagnostics if we're evaluating for overflow.
       if (!EvalStatus.Diag || !EvalStatus.Diag->empty()) {
+        noteUnmemoizable();
         HasActiveDiagnostic = false;
         return OptionalDiagnostic();
       }
@@ -682,6 +713,7 @@ namespace {
     /// Note that we have had a side-effect, and determine whether we should
     /// keep evaluating.
     bool noteSideEffect() {
+      noteUnmemoizable();
       EvalStatus.HasSideEffects = true;
       return keepEvaluatingAfterSideEffect();
     }
@@ -1330,8 +1362,10 @@ static bool CheckLiteralType(EvalInfo &Info, const Expr *E,
   // constexpr constructors for o and its subobjects even if those objects
   // are of non-literal class types.
   if (Info.getLangOpts().CPlusPlus14 && This &&
-      Info.EvaluatingDecl == This->getLValueBase())
+      Info.EvaluatingDecl == This->getLValueBase()) {
+    Info.noteUnmemoizable();
     return true;
+  }
 
   // Prvalue constant expressions must be of literal types.
   if (Info.getLangOpts().CPlusPlus11)
@@ -1978,6 +2012,7 @@ static bool evaluateVarDeclInit(EvalInfo &Info, const Expr *E,
   // If we're currently evaluating the initializer of this declaration, use that
   // in-flight value.
   if (Info.EvaluatingDecl.dyn_cast<const ValueDecl*>() == VD) {
+    Info.noteUnmemoizable();
     Result = Info.EvaluatingDeclValue;
     return true;
   }
@@ -2575,6 +2610,7 @@ CompleteObject findCompleteObject(EvalInfo &Info, const Expr *E, AccessKinds AK,
         // OK, we can read and modify an object if we're in the process of
         // evaluating its initializer, because its lifetime began in this
         // evaluation.
+        Info.noteUnmemoizable();
       } else if (AK != AK_Read) {
         // All the remaining cases only permit reading.
         Info.Diag(E, diag::note_constexpr_modify_global);
@@ -2640,6 +2676,8 @@ CompleteObject findCompleteObject(EvalInfo &Info, const Expr *E, AccessKinds AK,
         // Therefore we use the C++1y rules in C++11 too.
         const ValueDecl *VD = Info.EvaluatingDecl.dyn_cast<const ValueDecl*>();
         const ValueDecl *ED = MTE->getExtendingDecl();
+        if (VD)
+          Info.noteUnmemoizable();
         if (!(BaseType.isConstQualified() &&
               BaseType->isIntegralOrEnumerationType()) &&
             !(VD && VD->getCanonicalDecl() == ED->getCanonicalDecl())) {
@@ -2677,6 +2715,7 @@ CompleteObject findCompleteObject(EvalInfo &Info, const Expr *E, AccessKinds AK,
   // and this doesn't do quite the right thing for const subobjects of the
   // object under construction.
   if (LVal.getLValueBase() == Info.EvaluatingDecl) {
+    Info.noteUnmemoizable();
     BaseType = Info.Ctx.getCanonicalType(BaseType);
     BaseType.removeLocalConst();
   }
@@ -3717,6 +3756,45 @@ static bool HandleFunctionCall(SourceLocation CallLoc,
   if (!Info.CheckCallLimit(CallLoc))
     return false;
 
+  // A call to a function that is not a member function, with arguments that
+  // do not refer to any object, can only depend on those arguments. Look it up
+  // in the call cache, and memoize its result if it gets one without noting
+  // anything that depends on the surrounding evaluation.
+  ConstexprCallCache *Memo = nullptr;
+  if (!This && Info.canMemoizeCalls()) {
+    Memo = Info.Ctx.getConstexprCallCache();
+    for (unsigned I = 0, N = ArgValues.size(); Memo && I != N; ++I)
+      if (!ConstexprCallCache::isMemoizable(ArgValues[I]))
+        Memo = nullptr;
+  }
+  if (Memo) {
+    if (const APValue *Known = Memo->lookup(Callee, ArgValues)) {
+      Result = *Known;
+      return true;
+    }
+  }
+  unsigned OldUnmemoizableEvents = Info.NumUnmemoizableEvents;
+
+  // Try the bytecode interpreter. It only succeeds for calls which the code
+  // below would evaluate without producing any diagnostic; otherwise, fall
+  // back to that to evaluate the call and diagnose the problem.
+  if (!This && Info.getLangOpts().ConstexprInterpreter &&
+      !Info.InterpreterFailed && !Info.checkingPotentialConstantExpression() &&
+      !Info.checkingForOverflow()) {
+    switch (Info.Ctx.getConstexprInterpreter().call(
+        Callee, ArgValues, Info.CallStackDepth, Info.StepsLeft, Result)) {
+    case ConstexprInterpreter::CR_Success:
+      if (Memo)
+        Memo->insert(Callee, ArgValues, Result);
+      return true;
+    case ConstexprInterpreter::CR_Failed:
+      Info.InterpreterFailed = true;
+      break;
+    case ConstexprInterpreter::CR_Unsupported:
+      break;
+    }
+  }
+
   CallStackFrame Frame(Info, CallLoc, Callee, This, ArgValues.data());
 
   // For a trivial copy or move assignment, perform an APValue copy. This is
@@ -3749,6 +3827,10 @@ static bool HandleFunctionCall(SourceLocation CallLoc,
       return true;
     Info.Diag(Callee->getLocEnd(), diag::note_constexpr_no_return);
   }
+  if (ESR == ESR_Returned && Memo &&
+      Info.NumUnmemoizableEvents == OldUnmemoizableEvents &&
+      ConstexprCallCache::isMemoizable(Result))
+    Memo->insert(Callee, ArgValues, Result);
   return ESR == ESR_Returned;
 }
 
@@ -6243,6 +6325,7 @@ bool IntExprEvaluator::VisitCallExpr(const CallExpr *E) {
 
     // Expression had no side effects, but we couldn't statically determine the
     // size of the referenced object.
+    Info.noteUnmemoizable();
     switch (Info.EvalMode) {
     case EvalInfo::EM_ConstantExpression:
     case EvalInfo::EM_PotentialConstantExpression:
@@ -3520,6 +3520,13 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     CmdArgs.push_back(A->getValue());
   }
 
+  if (Arg *A = Args.getLastArg(options::OPT_fconstexpr_cache_limit_EQ)) {
+    CmdArgs.push_back("-fconstexpr-cache-limit");
+    CmdArgs.push_back(A->getValue());
+  }
+
+  Args.AddLastArg(CmdArgs, options::OPT_fexperimental_constexpr_interpreter);
+
   if (Arg *A = Args.getLastArg(options::OPT_fbracket_depth_EQ)) {
     CmdArgs.push_back("-fbracket-depth");
     CmdArgs.push_back(A->getValue());
@@ -3574,6 +3581,12 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     CmdArgs.push_back(A->getValue());
   }
 
+  if (Arg *A =
+          Args.getLastArg(options::OPT_fspell_checking_candidate_limit_EQ)) {
+    CmdArgs.push_back("-fspell-checking-candidate-limit");
+    CmdArgs.push_back(A->getValue());
+  }
+
   // Pass -fmessage-length=.
   CmdArgs.push_back("-fmessage-length");
   if (Arg *A = Args.getLastArg(options::OPT_fmessage_length_EQ)) {
@@ -3648,6 +3661,7 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   Args.AddLastArg(CmdArgs, options::OPT_fdiagnostics_print_source_range_info);
   Args.AddLastArg(CmdArgs, options::OPT_fdiagnostics_parseable_fixits);
   Args.AddLastArg(CmdArgs, options::OPT_ftime_report);
+  Args.AddLastArg(CmdArgs, options::OPT_ftemplate_profile_EQ);
   Args.AddLastArg(CmdArgs, options::OPT_ftrapv);
 
   if (Arg *A = Args.getLastArg(options::OPT_ftrapv_handler_EQ)) {
@@ -3922,6 +3936,17 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
 
   Args.AddLastArg(CmdArgs, options::OPT_fmodules_validate_system_headers);
 
+  if (Args.getLastArg(options::OPT_fmodules_validation_cache)) {
+    if (!Args.getLastArg(options::OPT_fbuild_session_timestamp,
+                         options::OPT_fbuild_session_file))
+      D.Diag(diag::err_drv_modules_validation_cache_requires_timestamp);
+
+    Args.AddLastArg(CmdArgs, options::OPT_fmodules_validation_cache);
+  }
+
+  Args.AddLastArg(CmdArgs, options::OPT_fmodules_compress_blobs);
+  Args.AddLastArg(CmdArgs, options::OPT_fmodules_buffer_store_path);
+
   // -faccess-control is default.
   if (Args.hasFlag(options::OPT_fno_access_control,
                    options::OPT_faccess_control,
@@ -4025,6 +4050,11 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
                    options::OPT_fno_delayed_template_parsing, IsWindowsMSVC))
     CmdArgs.push_back("-fdelayed-template-parsing");
 
+  Args.AddLastArg(CmdArgs, options::OPT_fexperimental_deferred_function_bodies);
+  Args.AddLastArg(CmdArgs, options::OPT_flazy_static_function_bodies);
+
+  Args.AddLastArg(CmdArgs, options::OPT_fpch_instantiate_templates);
+
   // -fgnu-keywords default varies depending on language; only pass if
   // specified.
   if (Arg *A = Args.getLastArg(options::OPT_fgnu_keywords,
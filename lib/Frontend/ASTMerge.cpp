@@ -13,6 +13,9 @@
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendActions.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace clang;
 
@@ -39,7 +42,13 @@ void ASTMergeAction::ExecuteAction() {
                                        &CI.getASTContext());
   IntrusiveRefCntPtr<DiagnosticIDs>
       DiagIDs(CI.getDiagnostics().getDiagnosticIDs());
+  bool ShowStats = CI.getFrontendOpts().ShowStats;
   for (unsigned I = 0, N = ASTFiles.size(); I != N; ++I) {
+    llvm::TimeRecord StartTime;
+    if (ShowStats)
+      StartTime = llvm::TimeRecord::getCurrentTime(/*Start=*/true);
+    size_t StartMemory = CI.getASTContext().getASTAllocatedMemory();
+
     IntrusiveRefCntPtr<DiagnosticsEngine>
         Diags(new DiagnosticsEngine(DiagIDs, &CI.getDiagnosticOpts(),
                                     new ForwardingDiagnosticConsumer(
@@ -50,6 +59,10 @@ void ASTMergeAction::ExecuteAction() {
     if (!Unit)
       continue;
 
+    llvm::TimeRecord LoadedTime;
+    if (ShowStats)
+      LoadedTime = llvm::TimeRecord::getCurrentTime(/*Start=*/false);
+
     ASTImporter Importer(CI.getASTContext(), 
                          CI.getFileManager(),
                          Unit->getASTContext(), 
@@ -66,6 +79,23 @@ void ASTMergeAction::ExecuteAction() {
       
       Importer.Import(D);
     }
+
+    if (ShowStats) {
+      llvm::TimeRecord EndTime = llvm::TimeRecord::getCurrentTime(false);
+      llvm::TimeRecord ImportTime = EndTime;
+      ImportTime -= LoadedTime;
+      LoadedTime -= StartTime;
+      llvm::errs() << "\nSTATISTICS FOR MERGING '" << ASTFiles[I] << "':\n";
+      llvm::errs() << "  load time: "
+                   << llvm::format("%.4f", LoadedTime.getWallTime()) << "s\n";
+      llvm::errs() << "  import time: "
+                   << llvm::format("%.4f", ImportTime.getWallTime()) << "s\n";
+      llvm::errs() << "  AST memory added: "
+                   << (CI.getASTContext().getASTAllocatedMemory() -
+                       StartMemory)
+                   << " bytes\n";
+      Importer.PrintStats();
+    }
   }
 
   AdaptedAction->ExecuteAction();
@@ -26,6 +26,7 @@
 #include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Frontend/FrontendOptions.h"
 #include "clang/Frontend/MultiplexConsumer.h"
+#include "clang/Frontend/PrecompiledPreambleCache.h"
 #include "clang/Frontend/Utils.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/Preprocessor.h"
@@ -34,8 +35,10 @@
 #include "clang/Serialization/ASTReader.h"
 #include "clang/Serialization/ASTWriter.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -44,9 +47,13 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#if LLVM_ENABLE_THREADS
+#include <thread>
+#endif
 using namespace clang;
 
 using llvm::TimeRecord;
@@ -83,6 +90,10 @@ namespace {
     /// \brief The file in which the precompiled preamble is stored.
     std::string PreambleFile;
 
+    /// \brief Whether the preamble file belongs to a shared preamble, and
+    /// must therefore be left alone.
+    bool PreambleFileIsShared;
+
     /// \brief Temporary files that should be removed when the ASTUnit is
     /// destroyed.
     SmallVector<std::string, 4> TemporaryFiles;
@@ -95,6 +106,8 @@ namespace {
 
     /// \brief Erase temporary files and the preamble file.
     void Cleanup();
+
+    OnDiskData() : PreambleFileIsShared(false) { }
   };
 }
 
@@ -155,8 +168,11 @@ static void removeOnDiskEntry(const ASTUnit *AU) {
   }
 }
 
-static void setPreambleFile(const ASTUnit *AU, StringRef preambleFile) {
-  getOnDiskData(AU).PreambleFile = preambleFile;
+static void setPreambleFile(const ASTUnit *AU, StringRef preambleFile,
+                            bool isShared = false) {
+  OnDiskData &D = getOnDiskData(AU);
+  D.PreambleFile = preambleFile;
+  D.PreambleFileIsShared = isShared;
 }
 
 static const std::string &getPreambleFile(const ASTUnit *AU) {
@@ -171,8 +187,10 @@ void OnDiskData::CleanTemporaryFiles() {
 
 void OnDiskData::CleanPreambleFile() {
   if (!PreambleFile.empty()) {
-    llvm::sys::fs::remove(PreambleFile);
+    if (!PreambleFileIsShared)
+      llvm::sys::fs::remove(PreambleFile);
     PreambleFile.clear();
+    PreambleFileIsShared = false;
   }
 }
 
@@ -189,6 +207,51 @@ struct ASTUnit::ASTWriterData {
   ASTWriterData() : Stream(Buffer), Writer(Stream) { }
 };
 
+/// \brief A precompiled preamble being built by a separate ASTUnit, which
+/// adds it to the preamble cache when done.
+struct ASTUnit::BackgroundPreambleBuild {
+  /// \brief The preamble cache key of the preamble being built.
+  std::string Key;
+
+  /// \brief The ASTUnit that builds the preamble. It has its own copies of
+  /// the invocation and the remapped buffers, and is destroyed as soon as the
+  /// build is over.
+  std::unique_ptr<ASTUnit> Builder;
+
+  std::atomic<bool> Finished;
+  bool Succeeded;
+
+#if LLVM_ENABLE_THREADS
+  std::thread Thread;
+#endif
+
+  BackgroundPreambleBuild() : Finished(false), Succeeded(false) { }
+  ~BackgroundPreambleBuild() { wait(); }
+
+  void run() {
+    llvm::CrashRecoveryContext CRC;
+    bool Crashed = !CRC.RunSafely([&]() {
+      Succeeded = Builder->getMainBufferWithPrecompiledPreamble(
+                      *Builder->Invocation) != nullptr &&
+                  Builder->CurrentSharedPreamble;
+    });
+    if (Crashed) {
+      // Leak the builder rather than destroying it in an unknown state.
+      Builder.release();
+      Succeeded = false;
+    }
+    Builder.reset();
+    Finished = true;
+  }
+
+  void wait() {
+#if LLVM_ENABLE_THREADS
+    if (Thread.joinable())
+      Thread.join();
+#endif
+  }
+};
+
 void ASTUnit::clearFileLevelDecls() {
   llvm::DeleteContainerSeconds(FileDecls);
 }
@@ -201,6 +264,15 @@ void ASTUnit::addTemporaryFile(StringRef TempFile) {
   getOnDiskData(this).TemporaryFiles.push_back(TempFile);
 }
 
+void ASTUnit::removeTemporaryFile(StringRef TempFile) {
+  // A file that is still open can't be removed on some platforms; leave it
+  // to be removed with the other temporary files.
+  if (llvm::sys::fs::remove(TempFile))
+    return;
+  SmallVectorImpl<std::string> &Files = getOnDiskData(this).TemporaryFiles;
+  Files.erase(std::remove(Files.begin(), Files.end(), TempFile), Files.end());
+}
+
 /// \brief After failing to build a precompiled preamble (due to
 /// errors in the source that occurs in the preamble), the number of
 /// reparses during which we'll skip even trying to precompile the
@@ -223,17 +295,21 @@ ASTUnit::ASTUnit(bool _MainFileIsAST)
     NumWarningsInPreamble(0),
     ShouldCacheCodeCompletionResults(false),
     IncludeBriefCommentsInCodeCompletion(false), UserFilesAreVolatile(false),
+    BuildPreambleInBackground(false), IncrementalReparse(false),
+    IncrementalEditOffset(0), RequestedPreambleSize(0),
+    RequestedPreambleEndsAtStartOfLine(false),
     CompletionCacheTopLevelHashValue(0),
     PreambleTopLevelHashValue(0),
     CurrentTopLevelHashValue(0),
-    UnsafeToFree(false) { 
+    UnsafeToFree(false), Hibernating(false), WokeFromHibernationFile(false) {
   if (getenv("LIBCLANG_OBJTRACKING"))
     fprintf(stderr, "+++ %u translation units\n", ++ActiveASTUnitObjects);
 }
 
 ASTUnit::~ASTUnit() {
   // If we loaded from an AST file, balance out the BeginSourceFile call.
-  if (MainFileIsAST && getDiagnostics().getClient()) {
+  if ((MainFileIsAST || WokeFromHibernationFile) &&
+      getDiagnostics().getClient()) {
     getDiagnostics().getClient()->EndSourceFile();
   }
 
@@ -334,6 +410,38 @@ static unsigned getDeclShowContexts(const NamedDecl *ND,
   return Contexts;
 }
 
+/// \brief Retrieve the file whose global declarations or macros produced the
+/// code-completion result \p R, or null if the result comes from the main
+/// file or has no location.
+static const FileEntry *getCompletionResultFile(const CodeCompletionResult &R,
+                                                SourceManager &SM,
+                                                Preprocessor &PP) {
+  SourceLocation Loc;
+  switch (R.Kind) {
+  case CodeCompletionResult::RK_Declaration:
+    Loc = R.Declaration->getLocation();
+    break;
+
+  case CodeCompletionResult::RK_Macro:
+    if (const MacroInfo *MI
+          = PP.getMacroInfo(const_cast<IdentifierInfo *>(R.Macro)))
+      Loc = MI->getDefinitionLoc();
+    break;
+
+  case CodeCompletionResult::RK_Keyword:
+  case CodeCompletionResult::RK_Pattern:
+    break;
+  }
+
+  if (Loc.isInvalid())
+    return nullptr;
+
+  FileID FID = SM.getFileID(SM.getExpansionLoc(Loc));
+  if (FID == SM.getMainFileID())
+    return nullptr;
+  return SM.getFileEntryForID(FID);
+}
+
 void ASTUnit::CacheCodeCompletionResults() {
   if (!TheSema)
     return;
@@ -341,27 +449,152 @@ void ASTUnit::CacheCodeCompletionResults() {
   SimpleTimer Timer(WantTiming);
   Timer.setOutput("Cache global code completions for " + getMainFileName());
 
+  // Keep the groups we have so far, so that the ones whose files did not
+  // change can be reused.
+  std::vector<std::shared_ptr<const CachedCompletionGroup> > PreviousGroups;
+  PreviousGroups.swap(CachedCompletionGroups);
+
   // Clear out the previous results.
   ClearCachedCompletionResults();
   
-  // Gather the set of global code completions.
+  // Gather the set of global code completions. Only the declarations and
+  // macros are needed to partition them by file; the completion strings are
+  // built for each group separately.
   typedef CodeCompletionResult Result;
   SmallVector<Result, 8> Results;
-  CachedCompletionAllocator = new GlobalCodeCompletionAllocator;
-  CodeCompletionTUInfo CCTUInfo(CachedCompletionAllocator);
-  TheSema->GatherGlobalCodeCompletions(*CachedCompletionAllocator,
-                                       CCTUInfo, Results);
+  IntrusiveRefCntPtr<GlobalCodeCompletionAllocator> GatherAllocator
+    = new GlobalCodeCompletionAllocator;
+  CodeCompletionTUInfo GatherTUInfo(GatherAllocator);
+  TheSema->GatherGlobalCodeCompletions(*GatherAllocator, GatherTUInfo,
+                                       Results);
+
+  // Partition the results by the file that provides them, preserving the
+  // order in which the files were first seen.
+  llvm::MapVector<const FileEntry *, SmallVector<unsigned, 16> > ResultsByFile;
+  for (unsigned I = 0, N = Results.size(); I != N; ++I) {
+    if (Results[I].Kind != Result::RK_Declaration &&
+        Results[I].Kind != Result::RK_Macro)
+      continue;
+    ResultsByFile[getCompletionResultFile(Results[I], *SourceMgr, *PP)]
+      .push_back(I);
+  }
+
+  // The part of the key that depends on the way this translation unit is
+  // parsed rather than on a particular file.
+  std::string ConfigurationKey = Invocation->getModuleHash();
+  ConfigurationKey += IncludeBriefCommentsInCodeCompletion ? ":B" : ":b";
+
+  for (llvm::MapVector<const FileEntry *, SmallVector<unsigned, 16> >::iterator
+         F = ResultsByFile.begin(), FEnd = ResultsByFile.end();
+       F != FEnd; ++F) {
+    const FileEntry *File = F->first;
+    if (!File) {
+      // The results from the main file change with every edit; don't share
+      // them.
+      CachedCompletionGroups.push_back(
+          buildCachedCompletionGroup(Results, F->second));
+      continue;
+    }
+
+    // A header produces the same results whenever it has the same contents,
+    // is parsed the same way and the same declarations of it are visible.
+    unsigned Signature = 0;
+    for (unsigned I = 0, N = F->second.size(); I != N; ++I) {
+      const Result &R = Results[F->second[I]];
+      if (R.Kind == Result::RK_Macro)
+        Signature = llvm::HashString(R.Macro->getName(), Signature);
+      else
+        Signature = llvm::HashString(R.Declaration->getNameAsString(),
+                                     Signature);
+      Signature = Signature * 31 + R.CursorKind;
+      Signature = Signature * 31 + R.Priority;
+      Signature = Signature * 31 + R.Availability;
+    }
+
+    // Identify the contents of the header the way the files of a preamble
+    // are identified: by size and modification time if it comes from disk,
+    // and by a hash of its buffer otherwise. Unsaved and remapped files have
+    // no modification time of their own, so an edit that keeps their size
+    // must not look like the same file.
+    PreambleFileHash Contents;
+    if (File->getModificationTime() && !SourceMgr->isFileOverridden(File))
+      Contents = PreambleFileHash::createForFile(File->getSize(),
+                                                 File->getModificationTime());
+    else
+      Contents = PreambleFileHash::createForMemoryBuffer(
+          SourceMgr->getMemoryBufferForFile(File));
+    SmallString<32> ContentsHash;
+    llvm::MD5::stringifyResult(Contents.MD5, ContentsHash);
+
+    llvm::sys::fs::UniqueID ID = File->getUniqueID();
+    std::string Key;
+    llvm::raw_string_ostream KeyOS(Key);
+    KeyOS << ID.getDevice() << ':' << ID.getFile() << ':' << Contents.Size
+          << ':' << Contents.ModTime << ':' << ContentsHash << ':'
+          << Signature << ':' << ConfigurationKey;
+    KeyOS.flush();
+
+    std::shared_ptr<const CachedCompletionGroup> Group;
+    for (unsigned I = 0, N = PreviousGroups.size(); I != N; ++I) {
+      if (PreviousGroups[I]->Key == Key) {
+        Group = PreviousGroups[I];
+        break;
+      }
+    }
+    if (!Group && PreambleCache)
+      Group = PreambleCache->lookupCompletionGroup(Key);
+    if (!Group) {
+      std::shared_ptr<CachedCompletionGroup> NewGroup
+        = buildCachedCompletionGroup(Results, F->second);
+      NewGroup->Key = Key;
+      Group = NewGroup;
+      if (PreambleCache)
+        PreambleCache->insertCompletionGroup(Group);
+    }
+    CachedCompletionGroups.push_back(Group);
+  }
+
+  // Gather the results of all of the groups, mapping the type identifiers
+  // of each group to the ones of this translation unit.
+  for (unsigned G = 0, NG = CachedCompletionGroups.size(); G != NG; ++G) {
+    const CachedCompletionGroup &Group = *CachedCompletionGroups[G];
+    for (unsigned I = 0, N = Group.Results.size(); I != N; ++I) {
+      CachedCodeCompletionResult CachedResult = Group.Results[I];
+      if (CachedResult.Type) {
+        unsigned &TypeValue
+          = CachedCompletionTypes[Group.Types[CachedResult.Type - 1]];
+        if (TypeValue == 0)
+          TypeValue = CachedCompletionTypes.size();
+        CachedResult.Type = TypeValue;
+      }
+      CachedCompletionResults.push_back(CachedResult);
+    }
+  }
   
+  // Save the current top-level hash value.
+  CompletionCacheTopLevelHashValue = CurrentTopLevelHashValue;
+}
+
+std::shared_ptr<ASTUnit::CachedCompletionGroup>
+ASTUnit::buildCachedCompletionGroup(
+    MutableArrayRef<CodeCompletionResult> Results, ArrayRef<unsigned> Indices) {
+  typedef CodeCompletionResult Result;
+  std::shared_ptr<CachedCompletionGroup> Group
+    = std::make_shared<CachedCompletionGroup>();
+  Group->Allocator = new GlobalCodeCompletionAllocator;
+  CodeCompletionTUInfo CCTUInfo(Group->Allocator);
+
   // Translate global code completions into cached completions.
   llvm::DenseMap<CanQualType, unsigned> CompletionTypes;
   
-  for (unsigned I = 0, N = Results.size(); I != N; ++I) {
+  for (unsigned Idx = 0, N = Indices.size(); Idx != N; ++Idx) {
+    unsigned I = Indices[Idx];
     switch (Results[I].Kind) {
     case Result::RK_Declaration: {
       bool IsNestedNameSpecifier = false;
       CachedCodeCompletionResult CachedResult;
       CachedResult.Completion = Results[I].CreateCodeCompletionString(*TheSema,
-                                                    *CachedCompletionAllocator,
+                                                    *Group->Allocator,
                                                     CCTUInfo,
                                           IncludeBriefCommentsInCodeCompletion);
       CachedResult.ShowInContexts = getDeclShowContexts(Results[I].Declaration,
@@ -388,14 +621,13 @@ void ASTUnit::CacheCodeCompletionResults() {
         unsigned &TypeValue = CompletionTypes[CanUsageType];
         if (TypeValue == 0) {
           TypeValue = CompletionTypes.size();
-          CachedCompletionTypes[QualType(CanUsageType).getAsString()]
-            = TypeValue;
+          Group->Types.push_back(QualType(CanUsageType).getAsString());
         }
         
         CachedResult.Type = TypeValue;
       }
       
-      CachedCompletionResults.push_back(CachedResult);
+      Group->Results.push_back(CachedResult);
       
       /// Handle nested-name-specifiers in C++.
       if (TheSema->Context.getLangOpts().CPlusPlus && 
@@ -427,14 +659,14 @@ void ASTUnit::CacheCodeCompletionResults() {
           Results[I].StartsNestedNameSpecifier = true;
           CachedResult.Completion 
             = Results[I].CreateCodeCompletionString(*TheSema,
-                                                    *CachedCompletionAllocator,
+                                                    *Group->Allocator,
                                                     CCTUInfo,
                                         IncludeBriefCommentsInCodeCompletion);
           CachedResult.ShowInContexts = RemainingContexts;
           CachedResult.Priority = CCP_NestedNameSpecifier;
           CachedResult.TypeClass = STC_Void;
           CachedResult.Type = 0;
-          CachedCompletionResults.push_back(CachedResult);
+          Group->Results.push_back(CachedResult);
         }
       }
       break;
@@ -450,7 +682,7 @@ void ASTUnit::CacheCodeCompletionResults() {
       CachedCodeCompletionResult CachedResult;
       CachedResult.Completion 
         = Results[I].CreateCodeCompletionString(*TheSema,
-                                                *CachedCompletionAllocator,
+                                                *Group->Allocator,
                                                 CCTUInfo,
                                           IncludeBriefCommentsInCodeCompletion);
       CachedResult.ShowInContexts
@@ -472,20 +704,20 @@ void ASTUnit::CacheCodeCompletionResults() {
       CachedResult.Availability = Results[I].Availability;
       CachedResult.TypeClass = STC_Void;
       CachedResult.Type = 0;
-      CachedCompletionResults.push_back(CachedResult);
+      Group->Results.push_back(CachedResult);
       break;
     }
     }
   }
   
-  // Save the current top-level hash value.
-  CompletionCacheTopLevelHashValue = CurrentTopLevelHashValue;
+
+  return Group;
 }
 
 void ASTUnit::ClearCachedCompletionResults() {
   CachedCompletionResults.clear();
   CachedCompletionTypes.clear();
-  CachedCompletionAllocator = nullptr;
+  CachedCompletionGroups.clear();
 }
 
 namespace {
@@ -676,16 +908,22 @@ std::unique_ptr<ASTUnit> ASTUnit::LoadFromASTFile(
   IntrusiveRefCntPtr<vfs::FileSystem> VFS = vfs::getRealFileSystem();
   AST->FileMgr = new FileManager(FileSystemOpts, VFS);
   AST->UserFilesAreVolatile = UserFilesAreVolatile;
-  AST->SourceMgr = new SourceManager(AST->getDiagnostics(),
-                                     AST->getFileManager(),
-                                     UserFilesAreVolatile);
-  AST->HSOpts = new HeaderSearchOptions();
+  if (AST->loadASTFile(Filename, RemappedFiles, AllowPCHWithCompilerErrors))
+    return nullptr;
+
+  return AST;
+}
 
-  AST->HeaderInfo.reset(new HeaderSearch(AST->HSOpts,
-                                         AST->getSourceManager(),
-                                         AST->getDiagnostics(),
-                                         AST->ASTFileLangOpts,
-                                         /*Target=*/nullptr));
+bool ASTUnit::loadASTFile(const std::string &Filename,
+                          ArrayRef<RemappedFile> RemappedFiles,
+                          bool AllowPCHWithCompilerErrors) {
+  SourceMgr = new SourceManager(getDiagnostics(), getFileManager(),
+                                UserFilesAreVolatile);
+  HSOpts = new HeaderSearchOptions();
+
+  HeaderInfo.reset(new HeaderSearch(HSOpts, getSourceManager(),
+                                    getDiagnostics(), ASTFileLangOpts,
+                                    /*Target=*/nullptr));
 
   PreprocessorOptions *PPOpts = new PreprocessorOptions();
 
@@ -694,34 +932,30 @@ std::unique_ptr<ASTUnit> ASTUnit::LoadFromASTFile(
 
   // Gather Info for preprocessor construction later on.
 
-  HeaderSearch &HeaderInfo = *AST->HeaderInfo;
   unsigned Counter;
 
-  AST->PP =
-      new Preprocessor(PPOpts, AST->getDiagnostics(), AST->ASTFileLangOpts,
-                       AST->getSourceManager(), HeaderInfo, *AST,
-                       /*IILookup=*/nullptr,
-                       /*OwnsHeaderSearch=*/false);
-  Preprocessor &PP = *AST->PP;
+  PP = new Preprocessor(PPOpts, getDiagnostics(), ASTFileLangOpts,
+                        getSourceManager(), *HeaderInfo, *this,
+                        /*IILookup=*/nullptr,
+                        /*OwnsHeaderSearch=*/false);
 
-  AST->Ctx = new ASTContext(AST->ASTFileLangOpts, AST->getSourceManager(),
-                            PP.getIdentifierTable(), PP.getSelectorTable(),
-                            PP.getBuiltinInfo());
-  ASTContext &Context = *AST->Ctx;
+  Ctx = new ASTContext(ASTFileLangOpts, getSourceManager(),
+                       PP->getIdentifierTable(), PP->getSelectorTable(),
+                       PP->getBuiltinInfo());
+  ASTContext &Context = *Ctx;
 
   bool disableValid = false;
   if (::getenv("LIBCLANG_DISABLE_PCH_VALIDATION"))
     disableValid = true;
-  AST->Reader = new ASTReader(PP, Context,
-                             /*isysroot=*/"",
-                             /*DisableValidation=*/disableValid,
-                             AllowPCHWithCompilerErrors);
+  Reader = new ASTReader(*PP, Context,
+                         /*isysroot=*/"",
+                         /*DisableValidation=*/disableValid,
+                         AllowPCHWithCompilerErrors);
 
-  AST->Reader->setListener(llvm::make_unique<ASTInfoCollector>(
-      *AST->PP, Context, AST->ASTFileLangOpts, AST->TargetOpts, AST->Target,
-      Counter));
+  Reader->setListener(llvm::make_unique<ASTInfoCollector>(
+      *PP, Context, ASTFileLangOpts, TargetOpts, Target, Counter));
 
-  switch (AST->Reader->ReadAST(Filename, serialization::MK_MainFile,
+  switch (Reader->ReadAST(Filename, serialization::MK_MainFile,
                           SourceLocation(), ASTReader::ARR_None)) {
   case ASTReader::Success:
     break;
@@ -732,31 +966,32 @@ std::unique_ptr<ASTUnit> ASTUnit::LoadFromASTFile(
   case ASTReader::VersionMismatch:
   case ASTReader::ConfigurationMismatch:
   case ASTReader::HadErrors:
-    AST->getDiagnostics().Report(diag::err_fe_unable_to_load_pch);
-    return nullptr;
+    getDiagnostics().Report(diag::err_fe_unable_to_load_pch);
+    return true;
   }
 
-  AST->OriginalSourceFile = AST->Reader->getOriginalSourceFile();
+  OriginalSourceFile = Reader->getOriginalSourceFile();
 
-  PP.setCounterValue(Counter);
+  PP->setCounterValue(Counter);
 
   // Attach the AST reader to the AST context as an external AST
   // source, so that declarations will be deserialized from the
   // AST file as needed.
-  Context.setExternalSource(AST->Reader);
+  Context.setExternalSource(Reader);
 
   // Create an AST consumer, even though it isn't used.
-  AST->Consumer.reset(new ASTConsumer);
+  Consumer.reset(new ASTConsumer);
   
   // Create a semantic analysis object and tell the AST reader about it.
-  AST->TheSema.reset(new Sema(PP, Context, *AST->Consumer));
-  AST->TheSema->Initialize();
-  AST->Reader->InitializeSema(*AST->TheSema);
+  TheSema.reset(new Sema(*PP, Context, *Consumer));
+  TheSema->Initialize();
+  Reader->InitializeSema(*TheSema);
 
   // Tell the diagnostic client that we have started a source file.
-  AST->getDiagnostics().getClient()->BeginSourceFile(Context.getLangOpts(),&PP);
+  getDiagnostics().getClient()->BeginSourceFile(Context.getLangOpts(),
+                                                PP.get());
 
-  return AST;
+  return false;
 }
 
 namespace {
@@ -1028,6 +1263,15 @@ bool ASTUnit::Parse(std::unique_ptr<llvm::MemoryBuffer> OverrideMainBuffer) {
   if (!Invocation)
     return true;
 
+  // Parsing replaces the AST that was loaded when waking from hibernation.
+  if (WokeFromHibernationFile) {
+    if (getDiagnostics().getClient())
+      getDiagnostics().getClient()->EndSourceFile();
+    WokeFromHibernationFile = false;
+  }
+  Hibernating = false;
+  HibernatedDiagnostics.clear();
+
   // Create the compiler instance to use for building the AST.
   std::unique_ptr<CompilerInstance> Clang(new CompilerInstance());
 
@@ -1263,6 +1507,63 @@ bool operator==(const ASTUnit::PreambleFileHash &LHS,
 }
 } // namespace clang
 
+/// \brief Determine whether any of the files a precompiled preamble was built
+/// from have changed, taking into account the files that are currently
+/// remapped.
+static bool
+havePreambleFilesChanged(FileManager &FileMgr,
+                         const PreprocessorOptions &PreprocessorOpts,
+                         const llvm::StringMap<ASTUnit::PreambleFileHash>
+                             &FilesInPreamble) {
+  typedef ASTUnit::PreambleFileHash PreambleFileHash;
+
+  // First, make a record of those files that have been overridden via
+  // remapping or unsaved_files.
+  llvm::StringMap<PreambleFileHash> OverriddenFiles;
+  for (const auto &R : PreprocessorOpts.RemappedFiles) {
+    vfs::Status Status;
+    if (FileMgr.getNoncachedStatValue(R.second, Status)) {
+      // If we can't stat the file we're remapping to, assume that something
+      // horrible happened.
+      return true;
+    }
+
+    OverriddenFiles[R.first] = PreambleFileHash::createForFile(
+        Status.getSize(), Status.getLastModificationTime().toEpochTime());
+  }
+
+  for (const auto &RB : PreprocessorOpts.RemappedFileBuffers)
+    OverriddenFiles[RB.first] =
+        PreambleFileHash::createForMemoryBuffer(RB.second);
+
+  // Check whether anything has changed.
+  for (llvm::StringMap<PreambleFileHash>::const_iterator
+         F = FilesInPreamble.begin(), FEnd = FilesInPreamble.end();
+       F != FEnd; ++F) {
+    llvm::StringMap<PreambleFileHash>::iterator Overridden
+      = OverriddenFiles.find(F->first());
+    if (Overridden != OverriddenFiles.end()) {
+      // This file was remapped; check whether the newly-mapped file 
+      // matches up with the previous mapping.
+      if (Overridden->second != F->second)
+        return true;
+      continue;
+    }
+    
+    // The file was not remapped; check whether it has changed on disk.
+    vfs::Status Status;
+    if (FileMgr.getNoncachedStatValue(F->first(), Status)) {
+      // If we can't stat the file, assume that something horrible happened.
+      return true;
+    } else if (Status.getSize() != uint64_t(F->second.Size) ||
+               Status.getLastModificationTime().toEpochTime() !=
+                   uint64_t(F->second.ModTime))
+      return true;
+  }
+
+  return false;
+}
+
 static std::pair<unsigned, unsigned>
 makeStandaloneRange(CharSourceRange Range, const SourceManager &SM,
                     const LangOptions &LangOpts) {
@@ -1344,12 +1645,22 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     = PreambleInvocation->getPreprocessorOpts();
 
   ComputedPreamble NewPreamble = ComputePreamble(*PreambleInvocation, MaxLines);
+  if (NewPreamble.Buffer && RequestedPreambleSize > NewPreamble.Size &&
+      RequestedPreambleSize <= NewPreamble.Buffer->getBufferSize()) {
+    NewPreamble.Size = RequestedPreambleSize;
+    NewPreamble.PreambleEndsAtStartOfLine = RequestedPreambleEndsAtStartOfLine;
+  } else if (IncrementalReparse) {
+    extendPreambleOverUnchangedDecls(NewPreamble,
+                                     *PreambleInvocation->getLangOpts(),
+                                     AllowRebuild, MaxLines);
+  }
 
   if (!NewPreamble.Size) {
     // We couldn't find a preamble in the main source. Clear out the current
     // preamble, if we have one. It's obviously no good any more.
     Preamble.clear();
     erasePreambleFile(this);
+    CurrentSharedPreamble.reset();
 
     // The next time we actually see a preamble, precompile it.
     PreambleRebuildCounter = 1;
@@ -1361,6 +1672,7 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     // preamble now that we did before, and that there's enough space in
     // the main-file buffer within the precompiled preamble to fit the
     // new main file.
+    bool AnyFileChanged = false;
     if (Preamble.size() == NewPreamble.Size &&
         PreambleEndsAtStartOfLine == NewPreamble.PreambleEndsAtStartOfLine &&
         memcmp(Preamble.getBufferStart(), NewPreamble.Buffer->getBufferStart(),
@@ -1369,60 +1681,8 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
       // preamble.
 
       // Check that none of the files used by the preamble have changed.
-      bool AnyFileChanged = false;
-          
-      // First, make a record of those files that have been overridden via
-      // remapping or unsaved_files.
-      llvm::StringMap<PreambleFileHash> OverriddenFiles;
-      for (const auto &R : PreprocessorOpts.RemappedFiles) {
-        if (AnyFileChanged)
-          break;
-
-        vfs::Status Status;
-        if (FileMgr->getNoncachedStatValue(R.second, Status)) {
-          // If we can't stat the file we're remapping to, assume that something
-          // horrible happened.
-          AnyFileChanged = true;
-          break;
-        }
-
-        OverriddenFiles[R.first] = PreambleFileHash::createForFile(
-            Status.getSize(), Status.getLastModificationTime().toEpochTime());
-      }
-
-      for (const auto &RB : PreprocessorOpts.RemappedFileBuffers) {
-        if (AnyFileChanged)
-          break;
-        OverriddenFiles[RB.first] =
-            PreambleFileHash::createForMemoryBuffer(RB.second);
-      }
-       
-      // Check whether anything has changed.
-      for (llvm::StringMap<PreambleFileHash>::iterator 
-             F = FilesInPreamble.begin(), FEnd = FilesInPreamble.end();
-           !AnyFileChanged && F != FEnd; 
-           ++F) {
-        llvm::StringMap<PreambleFileHash>::iterator Overridden
-          = OverriddenFiles.find(F->first());
-        if (Overridden != OverriddenFiles.end()) {
-          // This file was remapped; check whether the newly-mapped file 
-          // matches up with the previous mapping.
-          if (Overridden->second != F->second)
-            AnyFileChanged = true;
-          continue;
-        }
-        
-        // The file was not remapped; check whether it has changed on disk.
-        vfs::Status Status;
-        if (FileMgr->getNoncachedStatValue(F->first(), Status)) {
-          // If we can't stat the file, assume that something horrible happened.
-          AnyFileChanged = true;
-        } else if (Status.getSize() != uint64_t(F->second.Size) ||
-                   Status.getLastModificationTime().toEpochTime() !=
-                       uint64_t(F->second.ModTime))
-          AnyFileChanged = true;
-      }
-          
+      AnyFileChanged = havePreambleFilesChanged(*FileMgr, PreprocessorOpts,
+                                                FilesInPreamble);
       if (!AnyFileChanged) {
         // Okay! We can re-use the precompiled preamble.
 
@@ -1443,10 +1703,14 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     if (!AllowRebuild)
       return nullptr;
 
-    // We can't reuse the previously-computed preamble. Build a new one.
+    // We can't reuse the previously-computed preamble. Build a new one. If
+    // it was shared, make sure nobody else picks up the stale copy either.
+    if (AnyFileChanged && CurrentSharedPreamble)
+      PreambleCache->invalidate(*CurrentSharedPreamble);
     Preamble.clear();
     PreambleDiagnostics.clear();
     erasePreambleFile(this);
+    CurrentSharedPreamble.reset();
     PreambleRebuildCounter = 1;
   } else if (!AllowRebuild) {
     // We aren't allowed to rebuild the precompiled preamble; just
@@ -1454,6 +1718,44 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     return nullptr;
   }
 
+  // Another ASTUnit, or an earlier process, may already have built this
+  // preamble.
+  std::string PreambleCacheKey;
+  if (PreambleCache) {
+    StringRef PreambleBytes =
+        NewPreamble.Buffer->getBuffer().slice(0, NewPreamble.Size);
+    PreambleCacheKey = PrecompiledPreambleCache::getKey(
+        *PreambleInvocation, PreambleBytes,
+        NewPreamble.PreambleEndsAtStartOfLine);
+    if (std::shared_ptr<SharedPreamble> Shared =
+            PreambleCache->lookup(PreambleCacheKey)) {
+      if (StringRef(Shared->Bytes.data(), Shared->Bytes.size()) ==
+              PreambleBytes &&
+          !havePreambleFilesChanged(*FileMgr, PreprocessorOpts,
+                                    Shared->FilesInPreamble)) {
+        adoptSharedPreamble(std::move(Shared), *PreambleInvocation);
+        return llvm::MemoryBuffer::getMemBufferCopy(
+            NewPreamble.Buffer->getBuffer(), FrontendOpts.Inputs[0].getFile());
+      }
+      PreambleCache->invalidate(*Shared);
+    }
+  }
+
+  if (PendingPreambleBuild) {
+    // Carry on without a precompiled preamble until the one being built in
+    // the background is ready.
+    if (!PendingPreambleBuild->Finished)
+      return nullptr;
+
+    // Had it been usable, the cache lookup above would have found it. Back
+    // off as usual if it failed to build.
+    PendingPreambleBuild->wait();
+    if (!PendingPreambleBuild->Succeeded &&
+        PendingPreambleBuild->Key == PreambleCacheKey)
+      PreambleRebuildCounter = DefaultPreambleRebuildInterval;
+    PendingPreambleBuild.reset();
+  }
+
   // If the preamble rebuild counter > 1, it's because we previously
   // failed to build a preamble and we're not yet ready to try
   // again. Decrement the counter and return a failure.
@@ -1462,6 +1764,12 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     return nullptr;
   }
 
+  if (BuildPreambleInBackground && PreambleCache) {
+    startBackgroundPreambleBuild(PreambleInvocationIn, PreambleCacheKey,
+                                 NewPreamble);
+    return nullptr;
+  }
+
   // Create a temporary file for the precompiled preamble. In rare 
   // circumstances, this can fail.
   std::string PreamblePCHPath = GetPreamblePCHPath();
@@ -1626,10 +1934,360 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     PreambleTopLevelHashValue = CurrentTopLevelHashValue;
   }
 
+  // Offer the preamble to the other ASTUnits sharing our cache.
+  if (PreambleCache) {
+    std::unique_ptr<SharedPreamble> Shared(new SharedPreamble());
+    Shared->PCHFile = FrontendOpts.OutputFile;
+    Shared->MainFileName = MainFilename;
+    Shared->Bytes.assign(Preamble.getBufferStart(),
+                         Preamble.getBufferStart() + Preamble.size());
+    Shared->PreambleEndsAtStartOfLine = PreambleEndsAtStartOfLine;
+    Shared->FilesInPreamble = FilesInPreamble;
+    Shared->TopLevelDecls = TopLevelDeclsInPreamble;
+    Shared->Diagnostics = PreambleDiagnostics;
+    Shared->NumWarnings = NumWarningsInPreamble;
+    Shared->TopLevelHashValue = CurrentTopLevelHashValue;
+
+    // If another ASTUnit got there first, we get its preamble back.
+    if (std::shared_ptr<SharedPreamble> Cached =
+            PreambleCache->insert(PreambleCacheKey, std::move(Shared)))
+      adoptSharedPreamble(std::move(Cached), *PreambleInvocation);
+  }
+
   return llvm::MemoryBuffer::getMemBufferCopy(NewPreamble.Buffer->getBuffer(),
                                               MainFilename);
 }
 
+/// \brief Build the precompiled preamble for \p PreambleInvocation on a
+/// background thread, adding it to the preamble cache under \p Key.
+void ASTUnit::startBackgroundPreambleBuild(
+    const CompilerInvocation &PreambleInvocation, StringRef Key,
+    const ComputedPreamble &NewPreamble) {
+  IntrusiveRefCntPtr<CompilerInvocation>
+    CI(new CompilerInvocation(PreambleInvocation));
+
+  // The next reparse replaces our remapped buffers, so the builder needs its
+  // own copies.
+  for (auto &RB : CI->getPreprocessorOpts().RemappedFileBuffers)
+    RB.second = llvm::MemoryBuffer::getMemBufferCopy(
+                    RB.second->getBuffer(), RB.second->getBufferIdentifier())
+                    .release();
+
+  IntrusiveRefCntPtr<DiagnosticsEngine> Diags(new DiagnosticsEngine(
+      new DiagnosticIDs(), &CI->getDiagnosticOpts()));
+  std::unique_ptr<ASTUnit> Builder(ASTUnit::create(
+      CI.get(), Diags, /*CaptureDiagnostics=*/true, UserFilesAreVolatile));
+  if (!Builder) {
+    for (const auto &RB : CI->getPreprocessorOpts().RemappedFileBuffers)
+      delete RB.second;
+    return;
+  }
+  Builder->PreambleCache = PreambleCache;
+  Builder->WantTiming = WantTiming;
+  Builder->RequestedPreambleSize = NewPreamble.Size;
+  Builder->RequestedPreambleEndsAtStartOfLine =
+      NewPreamble.PreambleEndsAtStartOfLine;
+
+  PendingPreambleBuild.reset(new BackgroundPreambleBuild());
+  PendingPreambleBuild->Key = Key;
+  PendingPreambleBuild->Builder = std::move(Builder);
+
+  BackgroundPreambleBuild *Build = PendingPreambleBuild.get();
+#if LLVM_ENABLE_THREADS
+  Build->Thread = std::thread([Build] { Build->run(); });
+#else
+  Build->run();
+#endif
+}
+
+void ASTUnit::setBuildPreambleInBackground(bool Value) {
+  BuildPreambleInBackground = Value;
+  if (Value && !PreambleCache)
+    PreambleCache = std::make_shared<PrecompiledPreambleCache>();
+}
+
+bool ASTUnit::isBuildingPreambleInBackground() const {
+  return PendingPreambleBuild && !PendingPreambleBuild->Finished;
+}
+
+void ASTUnit::waitForBackgroundPreambleBuild() {
+  if (PendingPreambleBuild)
+    PendingPreambleBuild->wait();
+}
+
+/// \brief Determine whether the first \p Size bytes of \p Contents can be
+/// precompiled on their own: they end between two tokens, and outside of any
+/// bracket or conditional directive.
+///
+/// Only one branch of a conditional is compiled, so each branch has to leave
+/// the bracket depth the way it found it; otherwise the brackets cannot be
+/// matched without knowing which branch is taken.
+static bool isSelfContainedPrefix(StringRef Contents, unsigned Size,
+                                  const LangOptions &LangOpts) {
+  // Create a lexer starting at the beginning of the file. Note that we use a
+  // "fake" file source location at offset 1 so that the lexer will track our
+  // position within the file.
+  const unsigned StartOffset = 1;
+  SourceLocation FileLoc = SourceLocation::getFromRawEncoding(StartOffset);
+  Lexer TheLexer(FileLoc, LangOpts, Contents.begin(), Contents.begin(),
+                 Contents.end());
+  TheLexer.SetCommentRetentionState(true);
+
+  unsigned BracketDepth = 0;
+  // The bracket depth at each enclosing #if.
+  SmallVector<unsigned, 4> ConditionalBracketDepths;
+  bool InDirective = false;
+  bool AtDirectiveName = false;
+  Token Tok;
+  while (true) {
+    TheLexer.LexFromRawLexer(Tok);
+    if (Tok.is(tok::eof))
+      break;
+
+    unsigned Offset = Tok.getLocation().getRawEncoding() - StartOffset;
+    if (Offset >= Size)
+      break;
+    if (Offset + Tok.getLength() > Size)
+      return false;
+
+    if (Tok.isAtStartOfLine()) {
+      InDirective = AtDirectiveName = Tok.is(tok::hash);
+      if (InDirective)
+        continue;
+    }
+
+    if (InDirective) {
+      if (AtDirectiveName && Tok.is(tok::raw_identifier)) {
+        StringRef Name = Tok.getRawIdentifier();
+        if (Name == "if" || Name == "ifdef" || Name == "ifndef") {
+          ConditionalBracketDepths.push_back(BracketDepth);
+        } else if (Name == "elif" || Name == "else" || Name == "endif") {
+          if (ConditionalBracketDepths.empty() ||
+              ConditionalBracketDepths.back() != BracketDepth)
+            return false;
+          if (Name == "endif")
+            ConditionalBracketDepths.pop_back();
+        }
+      }
+      AtDirectiveName = false;
+      continue;
+    }
+
+    switch (Tok.getKind()) {
+    case tok::l_brace:
+    case tok::l_paren:
+    case tok::l_square:
+      ++BracketDepth;
+      break;
+
+    case tok::r_brace:
+    case tok::r_paren:
+    case tok::r_square:
+      if (!BracketDepth)
+        return false;
+      --BracketDepth;
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  return BracketDepth == 0 && ConditionalBracketDepths.empty();
+}
+
+/// \brief Find where the preamble would have to end for the first change
+/// between the main file of the last parse and \p NewContents to fall into
+/// the first top-level declaration after it.
+///
+/// \param Offset Set to that position, or to zero if the change is not
+/// preceded by a series of complete, error-free top-level declarations.
+///
+/// \returns false if the main file did not change or was not parsed yet.
+bool ASTUnit::findEditedTopLevelDecl(StringRef NewContents, unsigned &Offset) {
+  Offset = 0;
+  if (!Ctx || !SourceMgr)
+    return false;
+
+  FileID MainFID = SourceMgr->getMainFileID();
+  if (MainFID.isInvalid())
+    return false;
+
+  bool Invalid = false;
+  StringRef OldContents = SourceMgr->getBufferData(MainFID, &Invalid);
+  if (Invalid)
+    return false;
+
+  unsigned Edit = 0;
+  unsigned CommonSize = std::min(OldContents.size(), NewContents.size());
+  while (Edit != CommonSize && OldContents[Edit] == NewContents[Edit])
+    ++Edit;
+  if (Edit == OldContents.size() && Edit == NewContents.size())
+    return false;
+
+  // Collect the ranges of the top-level declarations in the main file,
+  // including those that were precompiled into the preamble.
+  SmallVector<std::pair<unsigned, unsigned>, 64> DeclRanges;
+  for (top_level_iterator D = top_level_begin(), DEnd = top_level_end();
+       D != DEnd; ++D) {
+    SourceRange Range = (*D)->getSourceRange();
+    if (Range.isInvalid())
+      continue;
+
+    SourceLocation Begin =
+        mapLocationFromPreamble(SourceMgr->getExpansionLoc(Range.getBegin()));
+    SourceLocation End = mapLocationFromPreamble(
+        SourceMgr->getExpansionRange(Range.getEnd()).second);
+    unsigned BeginOffset, EndOffset;
+    if (SourceMgr->isInFileID(Begin, MainFID, &BeginOffset) &&
+        SourceMgr->isInFileID(End, MainFID, &EndOffset))
+      DeclRanges.push_back(std::make_pair(BeginOffset, EndOffset));
+  }
+
+  // Find the last declaration that starts before the change. All of the
+  // declarations before it must end before it does.
+  unsigned Start = 0;
+  for (const auto &Range : DeclRanges)
+    if (Range.first <= Edit && Range.first > Start)
+      Start = Range.first;
+
+  bool HavePrevious = false;
+  unsigned PreviousEnd = 0;
+  for (const auto &Range : DeclRanges) {
+    if (Range.first >= Start)
+      continue;
+    if (Range.second >= Start)
+      return true;
+    HavePrevious = true;
+    PreviousEnd = std::max(PreviousEnd, Range.second);
+  }
+  if (!HavePrevious)
+    return true;
+
+  // Prefer to end the preamble with the line on which the previous
+  // declarations end, so that any comment attached to the changed
+  // declaration is parsed along with it.
+  Offset = Start;
+  StringRef::size_type EndOfLine = OldContents.find_first_of("\r\n",
+                                                             PreviousEnd);
+  if (EndOfLine != StringRef::npos && EndOfLine < Start) {
+    Offset = EndOfLine + 1;
+    if (OldContents[EndOfLine] == '\r' && Offset < Start &&
+        OldContents[Offset] == '\n')
+      ++Offset;
+  }
+
+  // A preamble that fails to build keeps us from using one at all for a
+  // while, so stay away from declarations with errors.
+  for (const StoredDiagnostic &SD : StoredDiagnostics) {
+    if (SD.getLevel() < DiagnosticsEngine::Error ||
+        SD.getLocation().isInvalid())
+      continue;
+
+    SourceLocation Loc =
+        mapLocationFromPreamble(SourceMgr->getExpansionLoc(SD.getLocation()));
+    unsigned DiagOffset;
+    if (!SourceMgr->isInFileID(Loc, MainFID, &DiagOffset) ||
+        DiagOffset < Offset) {
+      Offset = 0;
+      break;
+    }
+  }
+
+  return true;
+}
+
+/// \brief Extend the preamble computed from the main file's directives over
+/// the unchanged top-level declarations that follow them.
+void ASTUnit::extendPreambleOverUnchangedDecls(ComputedPreamble &NewPreamble,
+                                               const LangOptions &LangOpts,
+                                               bool AllowRebuild,
+                                               unsigned MaxLines) {
+  if (!NewPreamble.Buffer)
+    return;
+
+  StringRef NewContents = NewPreamble.Buffer->getBuffer();
+
+  // Keep using the current extended preamble for as long as the part of the
+  // main file it covers does not change.
+  unsigned Size = 0;
+  bool EndsAtStartOfLine = false;
+  if (Preamble.size() > NewPreamble.Size &&
+      NewContents.startswith(
+          StringRef(Preamble.getBufferStart(), Preamble.size())) &&
+      (!MaxLines ||
+       std::count(NewContents.begin(), NewContents.begin() + Preamble.size(),
+                  '\n') < MaxLines)) {
+    Size = Preamble.size();
+    EndsAtStartOfLine = PreambleEndsAtStartOfLine;
+  }
+
+  // Code completion does not change the main file; only reparses move the
+  // end of the preamble.
+  unsigned EditOffset;
+  if (!AllowRebuild || !findEditedTopLevelDecl(NewContents, EditOffset))
+    return;
+
+  // Moving the end of the preamble means precompiling it again, which only
+  // pays off once edits keep landing in the same declaration.
+  if (EditOffset > NewPreamble.Size && EditOffset != Size &&
+      EditOffset == IncrementalEditOffset &&
+      isSelfContainedPrefix(NewContents, EditOffset, LangOpts)) {
+    Size = EditOffset;
+    EndsAtStartOfLine = NewContents[EditOffset - 1] == '\n' ||
+                        NewContents[EditOffset - 1] == '\r';
+  }
+  IncrementalEditOffset = EditOffset;
+
+  if (Size > NewPreamble.Size) {
+    NewPreamble.Size = Size;
+    NewPreamble.PreambleEndsAtStartOfLine = EndsAtStartOfLine;
+  }
+}
+
+/// \brief Use a precompiled preamble from the preamble cache rather than one
+/// this ASTUnit built itself.
+void ASTUnit::adoptSharedPreamble(std::shared_ptr<SharedPreamble> Shared,
+                                  const CompilerInvocation &PreambleInvocation) {
+  StringRef MainFilename =
+      PreambleInvocation.getFrontendOpts().Inputs[0].getFile();
+  Preamble.assign(FileMgr->getFile(MainFilename), Shared->Bytes.data(),
+                  Shared->Bytes.data() + Shared->Bytes.size());
+  PreambleEndsAtStartOfLine = Shared->PreambleEndsAtStartOfLine;
+  OriginalSourceFile = MainFilename;
+  FilesInPreamble = Shared->FilesInPreamble;
+  TopLevelDecls.clear();
+  TopLevelDeclsInPreamble = Shared->TopLevelDecls;
+  NumWarningsInPreamble = Shared->NumWarnings;
+
+  // The preamble may have been built from another main file; diagnostics in
+  // the preamble itself belong to ours.
+  PreambleDiagnostics.clear();
+  for (const auto &SD : Shared->Diagnostics) {
+    PreambleDiagnostics.push_back(SD);
+    if (SD.Filename == Shared->MainFileName)
+      PreambleDiagnostics.back().Filename = MainFilename;
+  }
+
+  // Set the state of the diagnostic object to mimic its state
+  // after parsing the preamble.
+  checkAndRemoveNonDriverDiags(StoredDiagnostics);
+  getDiagnostics().Reset();
+  ProcessWarningOptions(getDiagnostics(),
+                        PreambleInvocation.getDiagnosticOpts());
+  getDiagnostics().setNumWarnings(NumWarningsInPreamble);
+
+  setPreambleFile(this, Shared->PCHFile, /*isShared=*/true);
+  CurrentSharedPreamble = std::move(Shared);
+  PreambleRebuildCounter = 1;
+
+  CurrentTopLevelHashValue = CurrentSharedPreamble->TopLevelHashValue;
+  if (CurrentTopLevelHashValue != PreambleTopLevelHashValue) {
+    CompletionCacheTopLevelHashValue = 0;
+    PreambleTopLevelHashValue = CurrentTopLevelHashValue;
+  }
+}
+
 void ASTUnit::RealizeTopLevelDeclsFromPreamble() {
   std::vector<Decl *> Resolved;
   Resolved.reserve(TopLevelDeclsInPreamble.size());
@@ -1923,7 +2581,8 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
     bool CacheCodeCompletionResults, bool IncludeBriefCommentsInCodeCompletion,
     bool AllowPCHWithCompilerErrors, bool SkipFunctionBodies,
     bool UserFilesAreVolatile, bool ForSerialization,
-    std::unique_ptr<ASTUnit> *ErrAST) {
+    std::unique_ptr<ASTUnit> *ErrAST,
+    std::shared_ptr<PrecompiledPreambleCache> PreambleCache) {
   assert(Diags.get() && "no DiagnosticsEngine was provided");
 
   SmallVector<StoredDiagnostic, 4> StoredDiagnostics;
@@ -1974,6 +2633,7 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
   AST->IncludeBriefCommentsInCodeCompletion
     = IncludeBriefCommentsInCodeCompletion;
   AST->UserFilesAreVolatile = UserFilesAreVolatile;
+  AST->PreambleCache = std::move(PreambleCache);
   AST->NumStoredDiagnosticsFromDriver = StoredDiagnostics.size();
   AST->StoredDiagnostics.swap(StoredDiagnostics);
   AST->Invocation = CI;
@@ -2067,6 +2727,10 @@ namespace {
       : CodeCompleteConsumer(CodeCompleteOpts, Next.isOutputBinary()),
         AST(AST), Next(Next)
     { 
+      // Filter both the results from Sema and the cached results the way the
+      // next consumer wants them.
+      setResultFilter(Next.getResultPrefix(), Next.getMaxResults());
+
       // Compute the set of contexts in which we will look when we don't have
       // any information about the specific context.
       NormalContexts 
@@ -2216,6 +2880,10 @@ void AugmentedCodeCompleteConsumer::ProcessCodeCompleteResults(Sema &S,
     // interested in, we'll add this result.
     if ((C->ShowInContexts & InContexts) == 0)
       continue;
+
+    // Skip the results that the client is not interested in.
+    if (!matchesResultPrefix(C->Completion->getTypedText()))
+      continue;
     
     // If we haven't added any results previously, do so now.
     if (!AddedResult) {
@@ -2281,8 +2949,10 @@ void AugmentedCodeCompleteConsumer::ProcessCodeCompleteResults(Sema &S,
     return;
   }
   
+  // Rank the combined results, if only the best ones are wanted.
+  unsigned NumAllResults = filterResults(AllResults.data(), AllResults.size());
   Next.ProcessCodeCompleteResults(S, Context, AllResults.data(),
-                                  AllResults.size());
+                                  NumAllResults);
 }
 
 
@@ -2495,6 +3165,156 @@ bool ASTUnit::serialize(raw_ostream &OS) {
   return serializeUnit(Writer, Buffer, getSema(), hasErrors, OS);
 }
 
+bool ASTUnit::hibernate() {
+  if (Hibernating)
+    return false;
+
+  // Only a unit that can be reparsed can recover from an AST file that
+  // can no longer be loaded.
+  if (!Invocation || !TheSema || MainFileIsAST)
+    return true;
+
+  SimpleTimer Timer(WantTiming);
+  Timer.setOutput("Hibernating " + getMainFileName());
+
+  // An AST that refers to the declarations of a precompiled preamble, a PCH,
+  // a module or the hibernation file it was woken from can't be saved on its
+  // own. It is parsed again when waking; only the main file is when there is
+  // a precompiled preamble.
+  HibernationFile.clear();
+  HibernatedTopLevelDecls.clear();
+  if (!Reader || Reader->getModuleManager().size() == 0) {
+    if (HadModuleLoaderFatalFailure)
+      return true;
+
+    SmallString<128> Path;
+    int FD;
+    if (llvm::sys::fs::createTemporaryFile("hibernated", "ast", FD, Path))
+      return true;
+    addTemporaryFile(Path);
+
+    // Use a writer of our own, which knows the IDs that the top-level
+    // declarations get in the AST file.
+    SmallString<128> Buffer;
+    llvm::BitstreamWriter Stream(Buffer);
+    ASTWriter Writer(Stream);
+    llvm::raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    serializeUnit(Writer, Buffer, getSema(),
+                  getDiagnostics().hasErrorOccurred(), Out);
+    Out.close();
+    if (Out.has_error()) {
+      Out.clear_error();
+      return true;
+    }
+    HibernationFile = Path.str();
+
+    for (top_level_iterator TL = top_level_begin(), TLEnd = top_level_end();
+         TL != TLEnd; ++TL) {
+      // Invalid top-level decls may not have been serialized.
+      if (!(*TL)->isInvalidDecl())
+        HibernatedTopLevelDecls.push_back(Writer.getDeclID(*TL));
+    }
+  }
+
+  // The diagnostics from the driver have no location; the others refer to
+  // the source manager that is about to go away.
+  HibernatedDiagnostics.clear();
+  for (unsigned I = NumStoredDiagnosticsFromDriver,
+                N = StoredDiagnostics.size();
+       I != N; ++I)
+    HibernatedDiagnostics.push_back(
+        makeStandaloneDiagnostic(getLangOpts(), StoredDiagnostics[I]));
+  StoredDiagnostics.erase(StoredDiagnostics.begin() +
+                              NumStoredDiagnosticsFromDriver,
+                          StoredDiagnostics.end());
+
+  // Release everything that refers to the AST, in the order in which it
+  // would be destroyed.
+  if (WokeFromHibernationFile) {
+    if (getDiagnostics().getClient())
+      getDiagnostics().getClient()->EndSourceFile();
+    TopLevelDeclsInPreamble.clear();
+    WokeFromHibernationFile = false;
+  }
+  TopLevelDecls.clear();
+  clearFileLevelDecls();
+  CCTUInfo.reset();
+  SavedMainFileBuffer.reset();
+  TheSema.reset();
+  Consumer.reset();
+  WriterData.reset();
+  Reader = nullptr;
+  Ctx = nullptr;
+  PP = nullptr;
+  Target = nullptr;
+  HeaderInfo.reset();
+
+  // Keep an empty source manager around for the clients that look at it
+  // without waking the unit.
+  SourceMgr = new SourceManager(getDiagnostics(), getFileManager(),
+                                UserFilesAreVolatile);
+  Hibernating = true;
+  return false;
+}
+
+bool ASTUnit::wake() {
+  if (!Hibernating)
+    return false;
+
+  SimpleTimer Timer(WantTiming);
+  Timer.setOutput("Waking " + getMainFileName());
+
+  // Look at the files on disk again, in case they changed while hibernating.
+  IntrusiveRefCntPtr<vfs::FileSystem> VFS =
+      createVFSFromCompilerInvocation(*Invocation, getDiagnostics());
+  if (!VFS)
+    return true;
+  FileMgr = new FileManager(FileSystemOpts, VFS);
+
+  unsigned NumDiagnostics = StoredDiagnostics.size();
+  if (HibernationFile.empty() ||
+      loadASTFile(HibernationFile, None, /*AllowPCHWithCompilerErrors=*/true)) {
+    // Parse the unit from source again, with the same unsaved files. The
+    // precompiled preamble, if any, is reused.
+    std::vector<RemappedFile> RemappedFiles;
+    for (const auto &RB : Invocation->getPreprocessorOpts().RemappedFileBuffers)
+      RemappedFiles.push_back(std::make_pair(
+          RB.first, llvm::MemoryBuffer::getMemBufferCopy(
+                        RB.second->getBuffer(),
+                        RB.second->getBufferIdentifier()).release()));
+    return Reparse(RemappedFiles);
+  }
+
+  // Drop any diagnostics produced by loading the AST file, and bring back
+  // the ones that were produced when parsing.
+  StoredDiagnostics.erase(StoredDiagnostics.begin() + NumDiagnostics,
+                          StoredDiagnostics.end());
+  SmallVector<StoredDiagnostic, 4> Diags;
+  TranslateStoredDiagnostics(getFileManager(), getSourceManager(),
+                             HibernatedDiagnostics, Diags);
+  StoredDiagnostics.append(Diags.begin(), Diags.end());
+  HibernatedDiagnostics.clear();
+
+  // The AST file has been read; don't keep one per hibernation around.
+  removeTemporaryFile(HibernationFile);
+  HibernationFile.clear();
+
+  // The unit is still one parsed from source: its local declarations are
+  // the top-level declarations it had, deserialized as they are visited.
+  TopLevelDeclsInPreamble.swap(HibernatedTopLevelDecls);
+  HibernatedTopLevelDecls.clear();
+  WokeFromHibernationFile = true;
+  Hibernating = false;
+  return false;
+}
+
+uint64_t ASTUnit::getHibernationFileSize() const {
+  uint64_t Size = 0;
+  if (!Hibernating || llvm::sys::fs::file_size(HibernationFile, Size))
+    return 0;
+  return Size;
+}
+
 typedef ContinuousRangeMap<unsigned, int, 2> SLocRemap;
 
 void ASTUnit::TranslateStoredDiagnostics(
@@ -2604,6 +3424,17 @@ void ASTUnit::findFileRegionDecls(FileID File, unsigned Offset, unsigned Length,
                                                          Decls);
   }
 
+  // Top-level declarations of the main file that were precompiled along with
+  // the preamble live in the preamble's file.
+  FileID PreambleID = SourceMgr->getPreambleFileID();
+  if (File == SourceMgr->getMainFileID() && PreambleID.isValid() &&
+      Offset < Preamble.size()) {
+    assert(Ctx->getExternalSource() && "No external source!");
+    Ctx->getExternalSource()->FindFileRegionDecls(
+        PreambleID, Offset,
+        std::min(Length, unsigned(Preamble.size()) - Offset), Decls);
+  }
+
   FileDeclsTy::iterator I = FileDecls.find(File);
   if (I == FileDecls.end())
     return;
@@ -2738,7 +3569,7 @@ SourceLocation ASTUnit::getStartOfMainFileID() {
 
 std::pair<PreprocessingRecord::iterator, PreprocessingRecord::iterator>
 ASTUnit::getLocalPreprocessingEntities() const {
-  if (isMainFileAST()) {
+  if (isMainFileAST() || WokeFromHibernationFile) {
     serialization::ModuleFile &
       Mod = Reader->getModuleManager().getPrimaryModule();
     return Reader->getModulePreprocessedEntities(Mod);
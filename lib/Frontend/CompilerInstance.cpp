@@ -31,6 +31,7 @@
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/CodeCompleteConsumer.h"
 #include "clang/Sema/Sema.h"
+#include "clang/Sema/TemplateInstantiationProfiler.h"
 #include "clang/Serialization/ASTReader.h"
 #include "clang/Serialization/GlobalModuleIndex.h"
 #include "llvm/ADT/Statistic.h"
@@ -500,6 +501,29 @@ void CompilerInstance::createFrontendTimer() {
   FrontendTimer.reset(new llvm::Timer("Clang front-end timer"));
 }
 
+void CompilerInstance::createTemplateInstantiationProfiler() {
+  InstantiationProfiler.reset(new TemplateInstantiationProfiler());
+}
+
+void CompilerInstance::reportTemplateInstantiationProfile() {
+  assert(InstantiationProfiler && "No template instantiation profile!");
+  if (getFrontendOpts().ShowTimers)
+    InstantiationProfiler->printSummary(llvm::errs(), /*Limit=*/20);
+
+  const std::string &TraceFile = getFrontendOpts().TemplateProfileFile;
+  if (TraceFile.empty())
+    return;
+
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(TraceFile, EC, llvm::sys::fs::F_Text);
+  if (EC) {
+    getDiagnostics().Report(diag::err_fe_unable_to_open_output)
+      << TraceFile << EC.message();
+    return;
+  }
+  InstantiationProfiler->writeTrace(OS);
+}
+
 CodeCompleteConsumer *
 CompilerInstance::createCodeCompletionConsumer(Preprocessor &PP,
                                                const std::string &Filename,
@@ -518,6 +542,8 @@ void CompilerInstance::createSema(TranslationUnitKind TUKind,
                                   CodeCompleteConsumer *CompletionConsumer) {
   TheSema.reset(new Sema(getPreprocessor(), getASTContext(), getASTConsumer(),
                          TUKind, CompletionConsumer));
+  if (hasTemplateInstantiationProfiler())
+    TheSema->setTemplateInstantiationProfiler(InstantiationProfiler.get());
 }
 
 // Output Files
@@ -798,6 +824,11 @@ bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
   if (getFrontendOpts().ShowTimers)
     createFrontendTimer();
 
+  // Profiling formats the name of every instantiation, so only do it when a
+  // profile was asked for.
+  if (!getFrontendOpts().TemplateProfileFile.empty())
+    createTemplateInstantiationProfiler();
+
   if (getFrontendOpts().ShowStats)
     llvm::EnableStatistics();
 
@@ -837,6 +868,9 @@ bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
     OS << "\n";
   }
 
+  if (hasTemplateInstantiationProfiler())
+    reportTemplateInstantiationProfile();
+
   return !getDiagnostics().getClient()->getNumErrors();
 }
 
@@ -903,6 +937,9 @@ static bool compileModuleImpl(CompilerInstance &ImportingInstance,
   FrontendOpts.OutputFile = ModuleFileName.str();
   FrontendOpts.DisableFree = false;
   FrontendOpts.GenerateGlobalModuleIndex = false;
+  // The importing instance writes the template profile; a module build
+  // would overwrite it with a trace of its own.
+  FrontendOpts.TemplateProfileFile.clear();
   FrontendOpts.Inputs.clear();
   InputKind IK = getSourceInputKindFromOptions(*Invocation->getLangOpts());
 
@@ -1196,9 +1233,11 @@ static void pruneModuleCache(const HeaderSearchOptions &HSOpts) {
     // Walk all of the files within this directory.
     for (llvm::sys::fs::directory_iterator File(Dir->path(), EC), FileEnd;
          File != FileEnd && !EC; File.increment(EC)) {
-      // We only care about module and global module index files.
+      // We only care about module and global module index files, and
+      // build session validation caches.
       StringRef Extension = llvm::sys::path::extension(File->path());
       if (Extension != ".pcm" && Extension != ".timestamp" &&
+          Extension != ".validated" &&
           llvm::sys::path::filename(File->path()) != "modules.idx")
         continue;
 
@@ -0,0 +1,464 @@
+//===--- PrecompiledPreambleCache.cpp - Shared preamble cache -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the PrecompiledPreambleCache class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/PrecompiledPreambleCache.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace clang;
+using namespace llvm::support;
+
+/// \brief The signature at the start of a persisted preamble description.
+static const char PreambleMagic[4] = { 'C', 'P', 'R', 'E' };
+
+/// \brief The version of the persisted preamble description format.
+static const uint32_t PreambleVersion = 1;
+
+SharedPreamble::~SharedPreamble() {
+  if (RemoveOnDestroy && !PCHFile.empty())
+    llvm::sys::fs::remove(PCHFile);
+}
+
+PrecompiledPreambleCache::PrecompiledPreambleCache(StringRef Directory,
+                                                   uint64_t MaxSize)
+  : Directory(Directory), MaxSize(MaxSize), TotalSize(0), NumHits(0),
+    NumMisses(0), CompletionGroupSweepLimit(64) {
+  if (!this->Directory.empty())
+    scanDirectory();
+}
+
+PrecompiledPreambleCache::~PrecompiledPreambleCache() { }
+
+std::string
+PrecompiledPreambleCache::getKey(const CompilerInvocation &Invocation,
+                                 StringRef Bytes,
+                                 bool PreambleEndsAtStartOfLine) {
+  llvm::MD5 Hash;
+  auto AddString = [&](StringRef S) {
+    Hash.update(S);
+    Hash.update(StringRef("", 1));
+  };
+
+  AddString(Bytes);
+  AddString(PreambleEndsAtStartOfLine ? "1" : "0");
+
+  // The language, target and predefined macros.
+  AddString(Invocation.getModuleHash());
+
+  // Quoted includes are looked up next to the main file.
+  SmallString<128> MainDir(Invocation.getFrontendOpts().Inputs[0].getFile());
+  llvm::sys::fs::make_absolute(MainDir);
+  llvm::sys::path::remove_filename(MainDir);
+  AddString(MainDir);
+  AddString(Invocation.getFileSystemOpts().WorkingDir);
+
+  const HeaderSearchOptions &HSOpts = Invocation.getHeaderSearchOpts();
+  for (const auto &Entry : HSOpts.UserEntries) {
+    AddString(Entry.Path);
+    AddString(Entry.IsFramework ? "F" : "D");
+    AddString(llvm::utostr(Entry.Group));
+  }
+
+  const PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+  for (const auto &Include : PPOpts.Includes)
+    AddString(Include);
+  for (const auto &Include : PPOpts.MacroIncludes)
+    AddString(Include);
+  AddString(PPOpts.ImplicitPTHInclude);
+  AddString(PPOpts.ImplicitPCHInclude);
+  if (!PPOpts.ImplicitPCHInclude.empty()) {
+    // The preamble is chained to this PCH, so it depends on its contents.
+    llvm::sys::fs::file_status Status;
+    if (!llvm::sys::fs::status(PPOpts.ImplicitPCHInclude, Status)) {
+      AddString(llvm::utostr(Status.getSize()));
+      AddString(llvm::utostr(
+          Status.getLastModificationTime().toEpochTime()));
+    }
+  }
+
+  // Warning options determine the diagnostics stored with the preamble.
+  const DiagnosticOptions &DiagOpts = Invocation.getDiagnosticOpts();
+  AddString(DiagOpts.IgnoreWarnings ? "w" : "");
+  AddString(DiagOpts.Pedantic ? "pedantic" : "");
+  AddString(DiagOpts.PedanticErrors ? "pedantic-errors" : "");
+  for (const auto &Warning : DiagOpts.Warnings)
+    AddString(Warning);
+  for (const auto &Remark : DiagOpts.Remarks)
+    AddString(Remark);
+
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  llvm::MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+static void getEntryPaths(StringRef Directory, StringRef Key,
+                          SmallVectorImpl<char> &PCHPath,
+                          SmallVectorImpl<char> &DescriptionPath) {
+  PCHPath.assign(Directory.begin(), Directory.end());
+  llvm::sys::path::append(PCHPath, Key + ".pch");
+  DescriptionPath.assign(Directory.begin(), Directory.end());
+  llvm::sys::path::append(DescriptionPath, Key + ".preamble");
+}
+
+void PrecompiledPreambleCache::scanDirectory() {
+  if (llvm::sys::fs::create_directories(Directory))
+    return;
+
+  // Find the preambles persisted by earlier processes, oldest first.
+  std::vector<std::pair<llvm::sys::TimeValue, std::string> > Found;
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator File(Directory, EC), FileEnd;
+       File != FileEnd && !EC; File.increment(EC)) {
+    if (llvm::sys::path::extension(File->path()) != ".preamble")
+      continue;
+
+    llvm::sys::fs::file_status Status;
+    if (File->status(Status))
+      continue;
+    Found.push_back(std::make_pair(Status.getLastModificationTime(),
+                                   llvm::sys::path::stem(File->path()).str()));
+  }
+  std::sort(Found.begin(), Found.end());
+
+  for (const auto &F : Found) {
+    SmallString<128> PCHPath, DescriptionPath;
+    getEntryPaths(Directory, F.second, PCHPath, DescriptionPath);
+    uint64_t Size;
+    if (llvm::sys::fs::file_size(PCHPath, Size)) {
+      // The precompiled header is gone; so is the preamble.
+      llvm::sys::fs::remove(DescriptionPath);
+      continue;
+    }
+    addEntry(F.second, nullptr, Size);
+  }
+
+  evict();
+}
+
+void PrecompiledPreambleCache::addEntry(StringRef Key,
+                                        std::shared_ptr<SharedPreamble> P,
+                                        uint64_t Size) {
+  CacheEntry &Entry = Entries[Key];
+  Entry.Preamble = std::move(P);
+  Entry.Size = Size;
+  LRU.push_front(Key);
+  Entry.LRUPosition = LRU.begin();
+  TotalSize += Size;
+}
+
+void PrecompiledPreambleCache::removeEntry(
+    llvm::StringMap<CacheEntry>::iterator Pos) {
+  CacheEntry &Entry = Pos->second;
+  TotalSize -= Entry.Size;
+  LRU.erase(Entry.LRUPosition);
+
+  SmallString<128> PCHPath, DescriptionPath;
+  if (!Directory.empty()) {
+    // Make sure no other process picks up the preamble.
+    getEntryPaths(Directory, Pos->first(), PCHPath, DescriptionPath);
+    llvm::sys::fs::remove(DescriptionPath);
+  }
+
+  if (Entry.Preamble) {
+    // The precompiled header is removed once the last ASTUnit using it lets
+    // it go.
+    Entry.Preamble->RemoveOnDestroy = true;
+  } else if (!PCHPath.empty()) {
+    llvm::sys::fs::remove(PCHPath);
+  }
+
+  Entries.erase(Pos);
+}
+
+void PrecompiledPreambleCache::evict() {
+  while (MaxSize && TotalSize > MaxSize && !LRU.empty())
+    removeEntry(Entries.find(LRU.back()));
+}
+
+namespace {
+/// \brief Reads the fields of a persisted preamble description.
+class DescriptionReader {
+  const unsigned char *Ptr;
+  const unsigned char *End;
+  bool Failed;
+
+  bool canRead(uint64_t N) {
+    if (Failed || uint64_t(End - Ptr) < N)
+      Failed = true;
+    return !Failed;
+  }
+
+public:
+  DescriptionReader(StringRef Data)
+    : Ptr((const unsigned char *)Data.data()),
+      End((const unsigned char *)Data.data() + Data.size()), Failed(false) { }
+
+  bool hasFailed() const { return Failed; }
+  bool atEnd() const { return Ptr == End; }
+
+  uint32_t readU32() {
+    if (!canRead(4))
+      return 0;
+    return endian::readNext<uint32_t, little, unaligned>(Ptr);
+  }
+
+  uint64_t readU64() {
+    if (!canRead(8))
+      return 0;
+    return endian::readNext<uint64_t, little, unaligned>(Ptr);
+  }
+
+  StringRef readBytes(uint64_t N) {
+    if (!canRead(N))
+      return StringRef();
+    StringRef Result((const char *)Ptr, N);
+    Ptr += N;
+    return Result;
+  }
+
+  StringRef readString() { return readBytes(readU32()); }
+};
+}
+
+std::shared_ptr<SharedPreamble>
+PrecompiledPreambleCache::readFromDisk(StringRef Key) {
+  SmallString<128> PCHPath, DescriptionPath;
+  getEntryPaths(Directory, Key, PCHPath, DescriptionPath);
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(DescriptionPath);
+  if (!Buffer)
+    return nullptr;
+
+  DescriptionReader R((*Buffer)->getBuffer());
+  if (R.readBytes(sizeof(PreambleMagic)) !=
+          StringRef(PreambleMagic, sizeof(PreambleMagic)) ||
+      R.readU32() != PreambleVersion)
+    return nullptr;
+
+  std::shared_ptr<SharedPreamble> P = std::make_shared<SharedPreamble>();
+  P->RemoveOnDestroy = false;
+  P->Key = Key;
+  P->PCHFile = PCHPath.str();
+  P->PreambleEndsAtStartOfLine = R.readU32();
+  P->TopLevelHashValue = R.readU32();
+  P->NumWarnings = R.readU32();
+  P->Size = R.readU64();
+  P->MainFileName = R.readString();
+  StringRef Bytes = R.readString();
+  P->Bytes.assign(Bytes.begin(), Bytes.end());
+
+  for (unsigned I = 0, N = R.readU32(); I != N && !R.hasFailed(); ++I)
+    P->TopLevelDecls.push_back(R.readU32());
+
+  for (unsigned I = 0, N = R.readU32(); I != N && !R.hasFailed(); ++I) {
+    StringRef Name = R.readString();
+    ASTUnit::PreambleFileHash &Hash = P->FilesInPreamble[Name];
+    Hash.Size = R.readU64();
+    Hash.ModTime = R.readU64();
+    StringRef MD5 = R.readBytes(sizeof(Hash.MD5));
+    if (MD5.size() == sizeof(Hash.MD5))
+      memcpy(Hash.MD5, MD5.data(), sizeof(Hash.MD5));
+  }
+
+  if (R.hasFailed() || !R.atEnd())
+    return nullptr;
+  return P;
+}
+
+bool PrecompiledPreambleCache::writeToDisk(StringRef Key,
+                                           SharedPreamble &P) {
+  SmallString<128> PCHPath, DescriptionPath;
+  getEntryPaths(Directory, Key, PCHPath, DescriptionPath);
+
+  if (llvm::sys::fs::rename(P.PCHFile, PCHPath))
+    return false;
+  P.PCHFile = PCHPath.str();
+
+  SmallString<256> Description;
+  {
+    llvm::raw_svector_ostream Out(Description);
+    endian::Writer<little> LE(Out);
+    Out.write(PreambleMagic, sizeof(PreambleMagic));
+    LE.write<uint32_t>(PreambleVersion);
+    LE.write<uint32_t>(P.PreambleEndsAtStartOfLine);
+    LE.write<uint32_t>(P.TopLevelHashValue);
+    LE.write<uint32_t>(P.NumWarnings);
+    LE.write<uint64_t>(P.Size);
+    LE.write<uint32_t>(P.MainFileName.size());
+    Out << P.MainFileName;
+    LE.write<uint32_t>(P.Bytes.size());
+    Out.write(P.Bytes.data(), P.Bytes.size());
+    LE.write<uint32_t>(P.TopLevelDecls.size());
+    for (serialization::DeclID ID : P.TopLevelDecls)
+      LE.write<uint32_t>(ID);
+    LE.write<uint32_t>(P.FilesInPreamble.size());
+    for (const auto &F : P.FilesInPreamble) {
+      LE.write<uint32_t>(F.getKey().size());
+      Out << F.getKey();
+      LE.write<uint64_t>(F.getValue().Size);
+      LE.write<uint64_t>(F.getValue().ModTime);
+      Out.write((const char *)F.getValue().MD5, sizeof(F.getValue().MD5));
+    }
+  }
+
+  // Write the description to a temporary file and rename it into place, so
+  // that other processes never see a partial description.
+  int FD;
+  SmallString<128> TempPath;
+  if (llvm::sys::fs::createUniqueFile(DescriptionPath + "-%%%%%%%%", FD,
+                                      TempPath))
+    return false;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Description.str();
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return false;
+    }
+  }
+  if (llvm::sys::fs::rename(TempPath, DescriptionPath)) {
+    llvm::sys::fs::remove(TempPath);
+    return false;
+  }
+
+  P.RemoveOnDestroy = false;
+  return true;
+}
+
+std::shared_ptr<SharedPreamble>
+PrecompiledPreambleCache::lookup(StringRef Key) {
+  llvm::MutexGuard Guard(Mutex);
+
+  llvm::StringMap<CacheEntry>::iterator Pos = Entries.find(Key);
+  if (Pos == Entries.end()) {
+    ++NumMisses;
+    return nullptr;
+  }
+
+  CacheEntry &Entry = Pos->second;
+  if (!Entry.Preamble) {
+    Entry.Preamble = readFromDisk(Key);
+    if (!Entry.Preamble) {
+      removeEntry(Pos);
+      ++NumMisses;
+      return nullptr;
+    }
+  }
+
+  // Move the entry to the front of the LRU list.
+  LRU.splice(LRU.begin(), LRU, Entry.LRUPosition);
+
+  if (!Directory.empty()) {
+    // Let later processes know that this preamble is still in use.
+    SmallString<128> PCHPath, DescriptionPath;
+    getEntryPaths(Directory, Key, PCHPath, DescriptionPath);
+    int FD;
+    if (!llvm::sys::fs::openFileForWrite(DescriptionPath, FD,
+                                         llvm::sys::fs::F_Append)) {
+      llvm::sys::fs::setLastModificationAndAccessTime(
+          FD, llvm::sys::TimeValue::now());
+      llvm::sys::Process::SafelyCloseFileDescriptor(FD);
+    }
+  }
+
+  ++NumHits;
+  return Entry.Preamble;
+}
+
+std::shared_ptr<SharedPreamble>
+PrecompiledPreambleCache::insert(StringRef Key,
+                                 std::unique_ptr<SharedPreamble> Preamble) {
+  llvm::MutexGuard Guard(Mutex);
+
+  llvm::StringMap<CacheEntry>::iterator Pos = Entries.find(Key);
+  if (Pos != Entries.end()) {
+    // Another ASTUnit built the same preamble concurrently; keep the one we
+    // already have and throw away the new one.
+    CacheEntry &Entry = Pos->second;
+    if (!Entry.Preamble)
+      Entry.Preamble = readFromDisk(Key);
+    if (Entry.Preamble)
+      return Entry.Preamble;
+    removeEntry(Pos);
+  }
+
+  if (llvm::sys::fs::file_size(Preamble->PCHFile, Preamble->Size)) {
+    // Leave the precompiled header to the ASTUnit that built it.
+    Preamble->RemoveOnDestroy = false;
+    return nullptr;
+  }
+  Preamble->Key = Key;
+
+  // Preambles with diagnostics are only kept in memory, since persisting the
+  // diagnostics is not worth the trouble.
+  if (!Directory.empty() && Preamble->Diagnostics.empty())
+    writeToDisk(Key, *Preamble);
+
+  std::shared_ptr<SharedPreamble> Result(Preamble.release());
+  addEntry(Key, Result, Result->Size);
+  evict();
+  return Result;
+}
+
+void PrecompiledPreambleCache::invalidate(const SharedPreamble &Preamble) {
+  llvm::MutexGuard Guard(Mutex);
+
+  llvm::StringMap<CacheEntry>::iterator Pos = Entries.find(Preamble.Key);
+  if (Pos != Entries.end() && Pos->second.Preamble.get() == &Preamble)
+    removeEntry(Pos);
+}
+
+std::shared_ptr<const ASTUnit::CachedCompletionGroup>
+PrecompiledPreambleCache::lookupCompletionGroup(StringRef Key) {
+  llvm::MutexGuard Guard(Mutex);
+
+  CompletionGroupMap::iterator Pos = CompletionGroups.find(Key);
+  if (Pos == CompletionGroups.end())
+    return nullptr;
+  return Pos->second.lock();
+}
+
+void PrecompiledPreambleCache::insertCompletionGroup(
+    std::shared_ptr<const ASTUnit::CachedCompletionGroup> Group) {
+  llvm::MutexGuard Guard(Mutex);
+
+  CompletionGroups[Group->Key] = Group;
+  if (CompletionGroups.size() <= CompletionGroupSweepLimit)
+    return;
+
+  // Forget the groups that no ASTUnit uses any more.
+  for (CompletionGroupMap::iterator I = CompletionGroups.begin(),
+                                    E = CompletionGroups.end();
+       I != E;) {
+    CompletionGroupMap::iterator Current = I++;
+    if (Current->second.expired())
+      CompletionGroups.erase(Current);
+  }
+  CompletionGroupSweepLimit =
+      std::max(64u, 2 * (unsigned)CompletionGroups.size());
+}
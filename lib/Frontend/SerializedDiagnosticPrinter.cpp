@@ -22,7 +22,13 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 using namespace clang;
@@ -140,6 +146,7 @@ private:
 class SDiagsWriter : public DiagnosticConsumer {
   friend class SDiagsRenderer;
   friend class SDiagsMerger;
+  friend class SDiagsAggregator;
 
   struct SharedState;
 
@@ -915,3 +922,366 @@ std::error_code SDiagsMerger::visitDiagFlagRecord(unsigned ID, StringRef Name) {
   DiagFlagLookup[ID] = Writer.getEmitDiagnosticFlag(Name);
   return std::error_code();
 }
+
+//===----------------------------------------------------------------------===//
+// Merging many serialized diagnostics files.
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// \brief A location read from a serialized diagnostics file.
+struct CollectedLoc {
+  unsigned FileID;
+  unsigned Line;
+  unsigned Col;
+  unsigned Offset;
+
+  CollectedLoc(const serialized_diags::Location &Loc)
+      : FileID(Loc.FileID), Line(Loc.Line), Col(Loc.Col), Offset(Loc.Offset) {}
+};
+
+/// \brief A fix-it hint read from a serialized diagnostics file.
+struct CollectedFixIt {
+  CollectedLoc Start;
+  CollectedLoc End;
+  std::string Text;
+
+  CollectedFixIt(const CollectedLoc &Start, const CollectedLoc &End,
+                 StringRef Text)
+      : Start(Start), End(End), Text(Text) {}
+};
+
+/// \brief A diagnostic, with its ranges, fix-its and notes, read from a
+/// serialized diagnostics file.
+struct CollectedDiag {
+  unsigned Severity;
+  CollectedLoc Loc;
+  unsigned Category;
+  unsigned Flag;
+  std::string Message;
+  std::vector<std::pair<CollectedLoc, CollectedLoc> > Ranges;
+  std::vector<CollectedFixIt> FixIts;
+  std::vector<CollectedDiag> Notes;
+
+  CollectedDiag()
+      : Severity(0), Loc(serialized_diags::Location(0, 0, 0, 0)), Category(0),
+        Flag(0) {}
+};
+
+/// \brief The contents of one serialized diagnostics file.
+struct CollectedFile {
+  llvm::DenseMap<unsigned, std::string> Filenames;
+  llvm::DenseMap<unsigned, std::string> Flags;
+  std::vector<CollectedDiag> Diags;
+  std::error_code EC;
+};
+
+/// \brief Reads a serialized diagnostics file into a \c CollectedFile, so that
+/// many files can be read concurrently and written out later.
+class SDiagsCollector : SerializedDiagnosticReader {
+  CollectedFile &Result;
+
+  /// \brief The diagnostics whose blocks we are currently inside.
+  SmallVector<CollectedDiag *, 4> Stack;
+
+public:
+  explicit SDiagsCollector(CollectedFile &Result) : Result(Result) {}
+
+  void collect(StringRef File) { Result.EC = readDiagnostics(File); }
+
+protected:
+  std::error_code visitStartOfDiagnostic() override {
+    std::vector<CollectedDiag> &Siblings =
+        Stack.empty() ? Result.Diags : Stack.back()->Notes;
+    Siblings.push_back(CollectedDiag());
+    Stack.push_back(&Siblings.back());
+    return std::error_code();
+  }
+
+  std::error_code visitEndOfDiagnostic() override {
+    if (Stack.empty())
+      return SDError::MalformedDiagnosticBlock;
+    Stack.pop_back();
+    return std::error_code();
+  }
+
+  std::error_code visitDiagFlagRecord(unsigned ID, StringRef Name) override {
+    Result.Flags[ID] = Name;
+    return std::error_code();
+  }
+
+  std::error_code visitDiagnosticRecord(
+      unsigned Severity, const serialized_diags::Location &Location,
+      unsigned Category, unsigned Flag, StringRef Message) override {
+    if (Stack.empty())
+      return SDError::MalformedDiagnosticRecord;
+    CollectedDiag &D = *Stack.back();
+    D.Severity = Severity;
+    D.Loc = Location;
+    D.Category = Category;
+    D.Flag = Flag;
+    D.Message = Message;
+    return std::error_code();
+  }
+
+  std::error_code visitFilenameRecord(unsigned ID, unsigned Size,
+                                      unsigned Timestamp,
+                                      StringRef Name) override {
+    Result.Filenames[ID] = Name;
+    return std::error_code();
+  }
+
+  std::error_code visitFixitRecord(const serialized_diags::Location &Start,
+                                   const serialized_diags::Location &End,
+                                   StringRef Text) override {
+    if (Stack.empty())
+      return SDError::MalformedDiagnosticRecord;
+    Stack.back()->FixIts.push_back(CollectedFixIt(Start, End, Text));
+    return std::error_code();
+  }
+
+  std::error_code
+  visitSourceRangeRecord(const serialized_diags::Location &Start,
+                         const serialized_diags::Location &End) override {
+    if (Stack.empty())
+      return SDError::MalformedDiagnosticRecord;
+    Stack.back()->Ranges.push_back(
+        std::make_pair(CollectedLoc(Start), CollectedLoc(End)));
+    return std::error_code();
+  }
+};
+
+/// \brief Writes collected diagnostics from many files through a single
+/// \c SDiagsWriter, dropping duplicates.
+class SDiagsAggregator {
+  SDiagsWriter &Writer;
+
+  /// \brief Interned file and flag names. The writer uniques these by
+  /// pointer, so every occurrence of a name must map to the same storage.
+  llvm::StringSet<> Names;
+
+  /// \brief The keys of the top-level diagnostics written so far.
+  llvm::StringSet<> Seen;
+
+  const char *intern(StringRef Name) {
+    return Names.insert(Name).first->getKeyData();
+  }
+
+  StringRef lookupName(const llvm::DenseMap<unsigned, std::string> &Map,
+                       unsigned ID) {
+    llvm::DenseMap<unsigned, std::string>::const_iterator I = Map.find(ID);
+    return I == Map.end() ? StringRef() : StringRef(I->second);
+  }
+
+  void addLocToRecord(const CollectedFile &File, const CollectedLoc &Loc,
+                      RecordDataImpl &Record) {
+    StringRef Filename = lookupName(File.Filenames, Loc.FileID);
+    Record.push_back(Filename.empty() ? 0
+                                      : Writer.getEmitFile(intern(Filename)));
+    Record.push_back(Loc.Line);
+    Record.push_back(Loc.Col);
+    Record.push_back(Loc.Offset);
+  }
+
+  void emitDiag(const CollectedFile &File, const CollectedDiag &D);
+
+public:
+  explicit SDiagsAggregator(SDiagsWriter &Writer) : Writer(Writer) {}
+
+  /// \brief Write the diagnostics of \p File, returning the number of
+  /// top-level diagnostics dropped as duplicates.
+  unsigned addFile(const CollectedFile &File);
+
+  /// \brief Warn that the input file \p Name could not be read.
+  void reportSkippedFile(StringRef Name, std::error_code EC) {
+    Writer.getMetaDiags()->Report(diag::warn_fe_serialized_diag_merge_skipped)
+        << Name << EC.message();
+  }
+};
+
+} // end anonymous namespace
+
+void SDiagsAggregator::emitDiag(const CollectedFile &File,
+                                const CollectedDiag &D) {
+  llvm::BitstreamWriter &Stream = Writer.State->Stream;
+  AbbreviationMap &Abbrevs = Writer.State->Abbrevs;
+
+  Writer.EnterDiagBlock();
+
+  RecordData Record;
+  Record.push_back(RECORD_DIAG);
+  Record.push_back(D.Severity);
+  addLocToRecord(File, D.Loc, Record);
+  Record.push_back(Writer.getEmitCategory(D.Category));
+  StringRef Flag = lookupName(File.Flags, D.Flag);
+  Record.push_back(Flag.empty() ? 0
+                                : Writer.getEmitDiagnosticFlag(intern(Flag)));
+  Record.push_back(D.Message.size());
+  Stream.EmitRecordWithBlob(Abbrevs.get(RECORD_DIAG), Record, D.Message);
+
+  for (unsigned I = 0, N = D.Ranges.size(); I != N; ++I) {
+    Record.clear();
+    Record.push_back(RECORD_SOURCE_RANGE);
+    addLocToRecord(File, D.Ranges[I].first, Record);
+    addLocToRecord(File, D.Ranges[I].second, Record);
+    Stream.EmitRecordWithAbbrev(Abbrevs.get(RECORD_SOURCE_RANGE), Record);
+  }
+
+  for (unsigned I = 0, N = D.FixIts.size(); I != N; ++I) {
+    const CollectedFixIt &FixIt = D.FixIts[I];
+    Record.clear();
+    Record.push_back(RECORD_FIXIT);
+    addLocToRecord(File, FixIt.Start, Record);
+    addLocToRecord(File, FixIt.End, Record);
+    Record.push_back(FixIt.Text.size());
+    Stream.EmitRecordWithBlob(Abbrevs.get(RECORD_FIXIT), Record, FixIt.Text);
+  }
+
+  for (unsigned I = 0, N = D.Notes.size(); I != N; ++I)
+    emitDiag(File, D.Notes[I]);
+
+  Writer.ExitDiagBlock();
+}
+
+unsigned SDiagsAggregator::addFile(const CollectedFile &File) {
+  unsigned NumDuplicates = 0;
+  SmallString<256> Key;
+  for (unsigned I = 0, N = File.Diags.size(); I != N; ++I) {
+    const CollectedDiag &D = File.Diags[I];
+
+    // Diagnostics without a file can't come from a shared header; always
+    // keep them.
+    StringRef Filename = lookupName(File.Filenames, D.Loc.FileID);
+    if (!Filename.empty()) {
+      Key.clear();
+      llvm::raw_svector_ostream OS(Key);
+      OS << Filename << '\0' << D.Loc.Offset << '\0' << D.Severity << '\0'
+         << lookupName(File.Flags, D.Flag) << '\0' << D.Message;
+      if (!Seen.insert(OS.str()).second) {
+        ++NumDuplicates;
+        continue;
+      }
+    }
+
+    emitDiag(File, D);
+  }
+  return NumDuplicates;
+}
+
+namespace clang {
+namespace serialized_diags {
+
+std::error_code mergeDiagnosticFiles(ArrayRef<std::string> InputFiles,
+                                     StringRef OutputFile,
+                                     DiagnosticOptions *Diags,
+                                     unsigned NumThreads,
+                                     MergeStatistics *Stats) {
+  const unsigned NumInputs = InputFiles.size();
+  SDiagsWriter Writer(OutputFile, Diags, /*MergeChildRecords=*/false);
+  SDiagsAggregator Aggregator(Writer);
+  MergeStatistics Result;
+  std::error_code FirstError;
+
+  // Write out one input file, which has been read completely, and release its
+  // contents. An input that could not be read, for example because it is
+  // truncated, is skipped as a whole.
+  auto WriteFile = [&](unsigned I, CollectedFile &File) {
+    if (File.EC) {
+      Aggregator.reportSkippedFile(InputFiles[I], File.EC);
+      if (!FirstError)
+        FirstError = File.EC;
+      ++Result.NumSkippedFiles;
+    } else {
+      ++Result.NumFiles;
+      Result.NumDiagnostics += File.Diags.size();
+      Result.NumDuplicates += Aggregator.addFile(File);
+    }
+    File = CollectedFile();
+  };
+
+#if LLVM_ENABLE_THREADS
+  if (NumThreads == 0)
+    NumThreads = std::max(1u, std::thread::hardware_concurrency());
+#else
+  NumThreads = 1;
+#endif
+  NumThreads = std::min(NumThreads, NumInputs);
+
+  if (NumThreads <= 1) {
+    CollectedFile File;
+    for (unsigned I = 0; I != NumInputs; ++I) {
+      SDiagsCollector(File).collect(InputFiles[I]);
+      WriteFile(I, File);
+    }
+  } else {
+    // Reading the input files is where the time goes, so it is spread over
+    // several threads. The files are written out in order as soon as they
+    // have been read, and only a window of files beyond the last one written
+    // is read ahead, so that the number of inputs held in memory is bounded
+    // by the number of threads rather than by the number of inputs.
+    const unsigned WindowSize = 2 * NumThreads;
+    std::vector<CollectedFile> Window(WindowSize);
+    std::vector<bool> Read(NumInputs);
+    unsigned NextToRead = 0, NextToWrite = 0;
+    std::mutex Lock;
+    std::condition_variable Changed;
+
+    auto ReadFiles = [&] {
+      while (true) {
+        unsigned I;
+        {
+          std::unique_lock<std::mutex> Guard(Lock);
+          Changed.wait(Guard, [&] {
+            return NextToRead == NumInputs ||
+                   NextToRead < NextToWrite + WindowSize;
+          });
+          if (NextToRead == NumInputs)
+            return;
+          I = NextToRead++;
+        }
+
+        // The slot was released when file I - WindowSize was written.
+        SDiagsCollector(Window[I % WindowSize]).collect(InputFiles[I]);
+
+        {
+          std::lock_guard<std::mutex> Guard(Lock);
+          Read[I] = true;
+        }
+        Changed.notify_all();
+      }
+    };
+
+    std::vector<std::thread> Threads;
+    for (unsigned I = 0; I != NumThreads; ++I)
+      Threads.push_back(std::thread(ReadFiles));
+
+    for (unsigned I = 0; I != NumInputs; ++I) {
+      {
+        std::unique_lock<std::mutex> Guard(Lock);
+        Changed.wait(Guard, [&] { return Read[I]; });
+      }
+      WriteFile(I, Window[I % WindowSize]);
+      {
+        std::lock_guard<std::mutex> Guard(Lock);
+        ++NextToWrite;
+      }
+      Changed.notify_all();
+    }
+
+    for (unsigned I = 0; I != NumThreads; ++I)
+      Threads[I].join();
+  }
+
+  if (Stats)
+    *Stats = Result;
+
+  // Don't write an empty file if nothing could be read.
+  if (NumInputs && Result.NumSkippedFiles == NumInputs)
+    return FirstError;
+
+  Writer.finish();
+  return std::error_code();
+}
+
+} // end namespace serialized_diags
+} // end namespace clang
@@ -0,0 +1,665 @@
+//===--- SymbolIndex.cpp - Persistent cross-TU symbol index -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the SymbolIndex and SymbolIndexBuilder classes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Index/SymbolIndex.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Bitcode/BitstreamWriter.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/OnDiskHashTable.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstdio>
+using namespace clang;
+using namespace clang::index;
+
+//----------------------------------------------------------------------------//
+// Shared constants
+//----------------------------------------------------------------------------//
+namespace {
+  enum {
+    /// \brief The block containing the symbol index.
+    SYMBOL_INDEX_BLOCK_ID = llvm::bitc::FIRST_APPLICATION_BLOCKID
+  };
+
+  /// \brief Describes the record types in the index.
+  enum IndexRecordTypes {
+    /// \brief Contains version information, used to determine if we can read
+    /// this symbol index file.
+    INDEX_METADATA,
+    /// \brief Describes a source file, including its name, size and
+    /// modification time.
+    SOURCE_FILE,
+    /// \brief The table mapping USRs to symbol occurrences.
+    SYMBOL_TABLE
+  };
+
+  /// \brief A symbol occurrence as it is stored in the symbol table.
+  struct StoredOccurrence {
+    unsigned FileID;
+    unsigned Line, Column, Offset;
+    SymbolRole Role;
+
+    bool operator<(const StoredOccurrence &Other) const {
+      if (FileID != Other.FileID)
+        return FileID < Other.FileID;
+      if (Offset != Other.Offset)
+        return Offset < Other.Offset;
+      return Role < Other.Role;
+    }
+
+    bool operator==(const StoredOccurrence &Other) const {
+      return FileID == Other.FileID && Offset == Other.Offset &&
+             Role == Other.Role;
+    }
+  };
+
+  /// \brief The number of bytes used to store each occurrence.
+  const unsigned StoredOccurrenceSize = 4 * 4 + 1;
+}
+
+/// \brief The symbol index file version.
+static const unsigned CurrentVersion = 1;
+
+//----------------------------------------------------------------------------//
+// Symbol index reader.
+//----------------------------------------------------------------------------//
+
+namespace {
+
+/// \brief Trait used to read the symbol table from the on-disk hash table.
+class SymbolTableReaderTrait {
+public:
+  typedef StringRef external_key_type;
+  typedef StringRef internal_key_type;
+  typedef SmallVector<StoredOccurrence, 4> data_type;
+  typedef unsigned hash_value_type;
+  typedef unsigned offset_type;
+
+  static bool EqualKey(const internal_key_type& a, const internal_key_type& b) {
+    return a == b;
+  }
+
+  static hash_value_type ComputeHash(const internal_key_type& a) {
+    return llvm::HashString(a);
+  }
+
+  static std::pair<unsigned, unsigned>
+  ReadKeyDataLength(const unsigned char*& d) {
+    using namespace llvm::support;
+    unsigned KeyLen = endian::readNext<uint16_t, little, unaligned>(d);
+    unsigned DataLen = endian::readNext<uint32_t, little, unaligned>(d);
+    return std::make_pair(KeyLen, DataLen);
+  }
+
+  static const internal_key_type&
+  GetInternalKey(const external_key_type& x) { return x; }
+
+  static const external_key_type&
+  GetExternalKey(const internal_key_type& x) { return x; }
+
+  static internal_key_type ReadKey(const unsigned char* d, unsigned n) {
+    return StringRef((const char *)d, n);
+  }
+
+  static data_type ReadData(const internal_key_type& k,
+                            const unsigned char* d,
+                            unsigned DataLen) {
+    using namespace llvm::support;
+
+    data_type Result;
+    while (DataLen >= StoredOccurrenceSize) {
+      StoredOccurrence Occurrence;
+      Occurrence.FileID = endian::readNext<uint32_t, little, unaligned>(d);
+      Occurrence.Line = endian::readNext<uint32_t, little, unaligned>(d);
+      Occurrence.Column = endian::readNext<uint32_t, little, unaligned>(d);
+      Occurrence.Offset = endian::readNext<uint32_t, little, unaligned>(d);
+      Occurrence.Role = (SymbolRole)*d++;
+      Result.push_back(Occurrence);
+      DataLen -= StoredOccurrenceSize;
+    }
+
+    return Result;
+  }
+};
+
+typedef llvm::OnDiskIterableChainedHashTable<SymbolTableReaderTrait>
+    SymbolIndexTable;
+
+}
+
+SymbolIndex::SymbolIndex(std::unique_ptr<llvm::MemoryBuffer> Buffer,
+                         llvm::BitstreamCursor Cursor)
+    : Buffer(std::move(Buffer)), SymbolTable(), NumLookups(),
+      NumLookupHits() {
+  // Read the symbol index.
+  bool InSymbolIndexBlock = false;
+  bool Done = false;
+  while (!Done) {
+    llvm::BitstreamEntry Entry = Cursor.advance();
+
+    switch (Entry.Kind) {
+    case llvm::BitstreamEntry::Error:
+      return;
+
+    case llvm::BitstreamEntry::EndBlock:
+      if (InSymbolIndexBlock) {
+        InSymbolIndexBlock = false;
+        Done = true;
+        continue;
+      }
+      return;
+
+    case llvm::BitstreamEntry::Record:
+      // Entries in the symbol index block are handled below.
+      if (InSymbolIndexBlock)
+        break;
+
+      return;
+
+    case llvm::BitstreamEntry::SubBlock:
+      if (!InSymbolIndexBlock && Entry.ID == SYMBOL_INDEX_BLOCK_ID) {
+        if (Cursor.EnterSubBlock(SYMBOL_INDEX_BLOCK_ID))
+          return;
+
+        InSymbolIndexBlock = true;
+      } else if (Cursor.SkipBlock()) {
+        return;
+      }
+      continue;
+    }
+
+    SmallVector<uint64_t, 64> Record;
+    StringRef Blob;
+    switch ((IndexRecordTypes)Cursor.readRecord(Entry.ID, Record, &Blob)) {
+    case INDEX_METADATA:
+      // Make sure that the version matches.
+      if (Record.size() < 1 || Record[0] != CurrentVersion)
+        return;
+      break;
+
+    case SOURCE_FILE: {
+      unsigned Idx = 0;
+      unsigned ID = Record[Idx++];
+
+      // Make room for this file's information.
+      if (ID >= Files.size())
+        Files.resize(ID + 1);
+
+      // Size/modification time for this file at the time it was indexed.
+      Files[ID].Size = Record[Idx++];
+      Files[ID].ModTime = (time_t)Record[Idx++];
+
+      // File name.
+      unsigned NameLen = Record[Idx++];
+      Files[ID].Name.assign(Record.begin() + Idx,
+                            Record.begin() + Idx + NameLen);
+      Idx += NameLen;
+
+      // Make sure we're at the end of the record.
+      assert(Idx == Record.size() && "More file info?");
+      FileIDs[Files[ID].Name] = ID;
+      break;
+    }
+
+    case SYMBOL_TABLE:
+      // Wire up the symbol table.
+      if (Record[0]) {
+        SymbolTable = SymbolIndexTable::Create(
+            (const unsigned char *)Blob.data() + Record[0],
+            (const unsigned char *)Blob.data() + sizeof(uint32_t),
+            (const unsigned char *)Blob.data(), SymbolTableReaderTrait());
+      }
+      break;
+    }
+  }
+}
+
+SymbolIndex::~SymbolIndex() {
+  delete static_cast<SymbolIndexTable *>(SymbolTable);
+}
+
+std::pair<SymbolIndex *, SymbolIndex::ErrorCode>
+SymbolIndex::readIndex(StringRef Path) {
+  // Map the index file into memory, if it's there.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufferOrErr =
+      llvm::MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr)
+    return std::make_pair(nullptr, EC_NotFound);
+  std::unique_ptr<llvm::MemoryBuffer> Buffer = std::move(BufferOrErr.get());
+
+  /// \brief The bitstream reader from which we'll read the index.
+  llvm::BitstreamReader Reader((const unsigned char *)Buffer->getBufferStart(),
+                               (const unsigned char *)Buffer->getBufferEnd());
+
+  /// \brief The main bitstream cursor for the main block.
+  llvm::BitstreamCursor Cursor(Reader);
+
+  // Sniff for the signature.
+  if (Cursor.Read(8) != 'C' ||
+      Cursor.Read(8) != 'S' ||
+      Cursor.Read(8) != 'Y' ||
+      Cursor.Read(8) != 'M') {
+    return std::make_pair(nullptr, EC_IOError);
+  }
+
+  return std::make_pair(new SymbolIndex(std::move(Buffer), Cursor), EC_None);
+}
+
+bool SymbolIndex::lookup(StringRef USR, unsigned Roles,
+                         SmallVectorImpl<SymbolOccurrence> &Occurrences) {
+  Occurrences.clear();
+
+  // If there's no symbol table, there is nothing we can do.
+  if (!SymbolTable)
+    return false;
+
+  ++NumLookups;
+  SymbolIndexTable &Table = *static_cast<SymbolIndexTable *>(SymbolTable);
+  SymbolIndexTable::iterator Known = Table.find(USR);
+  if (Known == Table.end())
+    return false;
+
+  ++NumLookupHits;
+  SymbolTableReaderTrait::data_type Stored = *Known;
+  for (unsigned I = 0, N = Stored.size(); I != N; ++I) {
+    if (!(Stored[I].Role & Roles) || Stored[I].FileID >= Files.size())
+      continue;
+
+    SymbolOccurrence Occurrence;
+    Occurrence.File = Files[Stored[I].FileID].Name;
+    Occurrence.Line = Stored[I].Line;
+    Occurrence.Column = Stored[I].Column;
+    Occurrence.Offset = Stored[I].Offset;
+    Occurrence.Role = Stored[I].Role;
+    Occurrences.push_back(Occurrence);
+  }
+  return true;
+}
+
+bool SymbolIndex::isFileUpToDate(StringRef File, uint64_t Size,
+                                 time_t ModTime) const {
+  llvm::StringMap<unsigned>::const_iterator Known = FileIDs.find(File);
+  if (Known == FileIDs.end())
+    return false;
+
+  const SymbolIndexFile &Info = Files[Known->second];
+  return Info.Size == Size && Info.ModTime == ModTime;
+}
+
+void SymbolIndex::printStats() {
+  std::fprintf(stderr, "*** Symbol Index Statistics:\n");
+  std::fprintf(stderr, "  %u source files\n", (unsigned)Files.size());
+  if (NumLookups) {
+    fprintf(stderr, "  %u / %u symbol lookups succeeded (%f%%)\n",
+            NumLookupHits, NumLookups,
+            (double)NumLookupHits*100.0/NumLookups);
+  }
+  std::fprintf(stderr, "\n");
+}
+
+//----------------------------------------------------------------------------//
+// Symbol index builder.
+//----------------------------------------------------------------------------//
+
+unsigned SymbolIndexBuilder::getUSRID(StringRef USR) {
+  std::pair<llvm::StringMap<unsigned>::iterator, bool> Known
+    = USRIDs.insert(std::make_pair(USR, (unsigned)USRs.size()));
+  if (Known.second)
+    USRs.push_back(Known.first->first());
+  return Known.first->second;
+}
+
+void SymbolIndexBuilder::load(SymbolIndex &Index) {
+  // Pick up the files recorded in the index, unless they have already been
+  // indexed through this builder.
+  std::vector<FileRecord *> RecordsByID(Index.Files.size());
+  for (unsigned I = 0, N = Index.Files.size(); I != N; ++I) {
+    const SymbolIndexFile &Info = Index.Files[I];
+    if (Info.Name.empty() || Files.count(Info.Name) ||
+        RemovedFiles.count(Info.Name))
+      continue;
+
+    FileRecord &Record = Files[Info.Name];
+    Record.Size = Info.Size;
+    Record.ModTime = Info.ModTime;
+    Record.Updated = false;
+    RecordsByID[I] = &Record;
+  }
+
+  if (!Index.SymbolTable)
+    return;
+
+  // Walk the symbol table, distributing the occurrences to their files.
+  SymbolIndexTable &Table = *static_cast<SymbolIndexTable *>(Index.SymbolTable);
+  SymbolIndexTable::key_iterator Key = Table.key_begin(),
+                                 KeyEnd = Table.key_end();
+  SymbolIndexTable::data_iterator Data = Table.data_begin();
+  for (; Key != KeyEnd; ++Key, ++Data) {
+    unsigned USR = getUSRID(*Key);
+    SymbolTableReaderTrait::data_type Stored = *Data;
+    for (unsigned I = 0, N = Stored.size(); I != N; ++I) {
+      if (Stored[I].FileID >= RecordsByID.size() ||
+          !RecordsByID[Stored[I].FileID])
+        continue;
+
+      Occurrence O = { USR, Stored[I].Line, Stored[I].Column,
+                       Stored[I].Offset, Stored[I].Role };
+      RecordsByID[Stored[I].FileID]->Occurrences.push_back(O);
+    }
+  }
+}
+
+bool SymbolIndexBuilder::startFile(StringRef File, uint64_t Size,
+                                   time_t ModTime) {
+  llvm::StringMap<FileRecord>::iterator Known = Files.find(File);
+  if (Known != Files.end()) {
+    const FileRecord &Record = Known->second;
+    if (Record.Updated ||
+        (Record.Size == Size && Record.ModTime == ModTime))
+      return false;
+  }
+
+  FileRecord &Record = Files[File];
+  Record.Size = Size;
+  Record.ModTime = ModTime;
+  Record.Updated = true;
+  Record.Occurrences.clear();
+  RemovedFiles.erase(File);
+  return true;
+}
+
+void SymbolIndexBuilder::addOccurrence(StringRef File, StringRef USR,
+                                       SymbolRole Role, unsigned Line,
+                                       unsigned Column, unsigned Offset) {
+  llvm::StringMap<FileRecord>::iterator Known = Files.find(File);
+  assert(Known != Files.end() && Known->second.Updated &&
+         "Recording an occurrence in a file that was not started");
+  if (Known == Files.end())
+    return;
+
+  Occurrence O = { getUSRID(USR), Line, Column, Offset, Role };
+  Known->second.Occurrences.push_back(O);
+}
+
+void SymbolIndexBuilder::removeFile(StringRef File) {
+  Files.erase(File);
+  RemovedFiles.insert(File);
+}
+
+static void emitBlockID(unsigned ID, const char *Name,
+                        llvm::BitstreamWriter &Stream,
+                        SmallVectorImpl<uint64_t> &Record) {
+  Record.clear();
+  Record.push_back(ID);
+  Stream.EmitRecord(llvm::bitc::BLOCKINFO_CODE_SETBID, Record);
+
+  // Emit the block name if present.
+  if (!Name || Name[0] == 0) return;
+  Record.clear();
+  while (*Name)
+    Record.push_back(*Name++);
+  Stream.EmitRecord(llvm::bitc::BLOCKINFO_CODE_BLOCKNAME, Record);
+}
+
+static void emitRecordID(unsigned ID, const char *Name,
+                         llvm::BitstreamWriter &Stream,
+                         SmallVectorImpl<uint64_t> &Record) {
+  Record.clear();
+  Record.push_back(ID);
+  while (*Name)
+    Record.push_back(*Name++);
+  Stream.EmitRecord(llvm::bitc::BLOCKINFO_CODE_SETRECORDNAME, Record);
+}
+
+void SymbolIndexBuilder::emitBlockInfoBlock(llvm::BitstreamWriter &Stream) {
+  SmallVector<uint64_t, 64> Record;
+  Stream.EnterSubblock(llvm::bitc::BLOCKINFO_BLOCK_ID, 3);
+
+#define BLOCK(X) emitBlockID(X ## _ID, #X, Stream, Record)
+#define RECORD(X) emitRecordID(X, #X, Stream, Record)
+  BLOCK(SYMBOL_INDEX_BLOCK);
+  RECORD(INDEX_METADATA);
+  RECORD(SOURCE_FILE);
+  RECORD(SYMBOL_TABLE);
+#undef RECORD
+#undef BLOCK
+
+  Stream.ExitBlock();
+}
+
+namespace {
+
+/// \brief Trait used to generate the symbol table as an on-disk hash table.
+class SymbolTableWriterTrait {
+public:
+  typedef StringRef key_type;
+  typedef StringRef key_type_ref;
+  typedef ArrayRef<StoredOccurrence> data_type;
+  typedef ArrayRef<StoredOccurrence> data_type_ref;
+  typedef unsigned hash_value_type;
+  typedef unsigned offset_type;
+
+  static hash_value_type ComputeHash(key_type_ref Key) {
+    return llvm::HashString(Key);
+  }
+
+  std::pair<unsigned,unsigned>
+  EmitKeyDataLength(raw_ostream& Out, key_type_ref Key, data_type_ref Data) {
+    using namespace llvm::support;
+    endian::Writer<little> LE(Out);
+    unsigned KeyLen = Key.size();
+    unsigned DataLen = Data.size() * StoredOccurrenceSize;
+    LE.write<uint16_t>(KeyLen);
+    LE.write<uint32_t>(DataLen);
+    return std::make_pair(KeyLen, DataLen);
+  }
+
+  void EmitKey(raw_ostream& Out, key_type_ref Key, unsigned KeyLen) {
+    Out.write(Key.data(), KeyLen);
+  }
+
+  void EmitData(raw_ostream& Out, key_type_ref Key, data_type_ref Data,
+                unsigned DataLen) {
+    using namespace llvm::support;
+    endian::Writer<little> LE(Out);
+    for (unsigned I = 0, N = Data.size(); I != N; ++I) {
+      LE.write<uint32_t>(Data[I].FileID);
+      LE.write<uint32_t>(Data[I].Line);
+      LE.write<uint32_t>(Data[I].Column);
+      LE.write<uint32_t>(Data[I].Offset);
+      LE.write<uint8_t>(Data[I].Role);
+    }
+  }
+};
+
+}
+
+void SymbolIndexBuilder::writeIndex(llvm::BitstreamWriter &Stream) {
+  using namespace llvm;
+
+  // Emit the file header.
+  Stream.Emit((unsigned)'C', 8);
+  Stream.Emit((unsigned)'S', 8);
+  Stream.Emit((unsigned)'Y', 8);
+  Stream.Emit((unsigned)'M', 8);
+
+  // Write the block-info block, which describes the records in this bitcode
+  // file.
+  emitBlockInfoBlock(Stream);
+
+  Stream.EnterSubblock(SYMBOL_INDEX_BLOCK_ID, 3);
+
+  // Write the metadata.
+  SmallVector<uint64_t, 2> Record;
+  Record.push_back(CurrentVersion);
+  Stream.EmitRecord(INDEX_METADATA, Record);
+
+  // Number the files in name order, so that the same contents always produce
+  // the same index.
+  std::vector<StringRef> FileNames;
+  for (llvm::StringMap<FileRecord>::iterator F = Files.begin(),
+                                             FEnd = Files.end();
+       F != FEnd; ++F)
+    FileNames.push_back(F->first());
+  std::sort(FileNames.begin(), FileNames.end());
+
+  // Write the set of known source files, and gather the occurrences of each
+  // symbol.
+  std::vector<std::vector<StoredOccurrence> > OccurrencesByUSR(USRs.size());
+  for (unsigned ID = 0, N = FileNames.size(); ID != N; ++ID) {
+    const FileRecord &File = Files.find(FileNames[ID])->second;
+    Record.clear();
+    Record.push_back(ID);
+    Record.push_back(File.Size);
+    Record.push_back(File.ModTime);
+    Record.push_back(FileNames[ID].size());
+    Record.append(FileNames[ID].begin(), FileNames[ID].end());
+    Stream.EmitRecord(SOURCE_FILE, Record);
+
+    for (unsigned I = 0, NumOccurrences = File.Occurrences.size();
+         I != NumOccurrences; ++I) {
+      const Occurrence &O = File.Occurrences[I];
+      StoredOccurrence Stored = { ID, O.Line, O.Column, O.Offset, O.Role };
+      OccurrencesByUSR[O.USR].push_back(Stored);
+    }
+  }
+
+  // Write the USR -> occurrences mapping.
+  {
+    llvm::OnDiskChainedHashTableGenerator<SymbolTableWriterTrait> Generator;
+    SymbolTableWriterTrait Trait;
+
+    // Populate the hash table, skipping symbols that no longer occur
+    // anywhere and USRs too long to be stored.
+    for (unsigned I = 0, N = USRs.size(); I != N; ++I) {
+      std::vector<StoredOccurrence> &Occurrences = OccurrencesByUSR[I];
+      if (Occurrences.empty() || USRs[I].size() > 0xFFFF)
+        continue;
+
+      std::sort(Occurrences.begin(), Occurrences.end());
+      Occurrences.erase(std::unique(Occurrences.begin(), Occurrences.end()),
+                        Occurrences.end());
+      Generator.insert(USRs[I], Occurrences, Trait);
+    }
+
+    // Create the on-disk hash table in a buffer.
+    SmallString<4096> SymbolTable;
+    uint32_t BucketOffset;
+    {
+      using namespace llvm::support;
+      llvm::raw_svector_ostream Out(SymbolTable);
+      // Make sure that no bucket is at offset 0
+      endian::Writer<little>(Out).write<uint32_t>(0);
+      BucketOffset = Generator.Emit(Out, Trait);
+    }
+
+    // Create a blob abbreviation
+    BitCodeAbbrev *Abbrev = new BitCodeAbbrev();
+    Abbrev->Add(BitCodeAbbrevOp(SYMBOL_TABLE));
+    Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+    Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+    unsigned SymbolTableAbbrev = Stream.EmitAbbrev(Abbrev);
+
+    // Write the symbol table
+    Record.clear();
+    Record.push_back(SYMBOL_TABLE);
+    Record.push_back(BucketOffset);
+    Stream.EmitRecordWithBlob(SymbolTableAbbrev, Record, SymbolTable.str());
+  }
+
+  Stream.ExitBlock();
+}
+
+SymbolIndex::ErrorCode SymbolIndexBuilder::writeIndex(StringRef Path) {
+  // Coordinate writing the index file with other processes that might try
+  // to do the same.
+  while (true) {
+    llvm::LockFileManager Locked(Path);
+    switch (Locked) {
+    case llvm::LockFileManager::LFS_Error:
+      return SymbolIndex::EC_IOError;
+
+    case llvm::LockFileManager::LFS_Owned:
+      // We're responsible for writing the index ourselves.
+      return updateIndexFile(Path);
+
+    case llvm::LockFileManager::LFS_Shared:
+      // Someone else is writing the index. Wait for them to finish, then
+      // merge our updates into what they wrote.
+      if (Locked.waitForUnlock() == llvm::LockFileManager::Res_Timeout)
+        return SymbolIndex::EC_Building;
+      break;
+    }
+  }
+}
+
+SymbolIndex::ErrorCode SymbolIndexBuilder::updateIndexFile(StringRef Path) {
+  // Other builders may have written the index since this one was loaded from
+  // it. Take the files that weren't indexed or removed through this builder
+  // from the index as it is now.
+  std::pair<SymbolIndex *, SymbolIndex::ErrorCode> Current =
+      SymbolIndex::readIndex(Path);
+  if (Current.second == SymbolIndex::EC_IOError)
+    return SymbolIndex::EC_IOError;
+  std::unique_ptr<SymbolIndex> OnDisk(Current.first);
+  if (OnDisk) {
+    std::vector<std::string> Stale;
+    for (llvm::StringMap<FileRecord>::iterator F = Files.begin(),
+                                               FEnd = Files.end();
+         F != FEnd; ++F)
+      if (!F->second.Updated)
+        Stale.push_back(F->first());
+    for (unsigned I = 0, N = Stale.size(); I != N; ++I)
+      Files.erase(Stale[I]);
+    load(*OnDisk);
+  }
+
+  // The output buffer, into which the symbol index will be written.
+  SmallVector<char, 16> OutputBuffer;
+  {
+    llvm::BitstreamWriter OutputStream(OutputBuffer);
+    writeIndex(OutputStream);
+  }
+
+  // Write the symbol index to a temporary file.
+  llvm::SmallString<128> IndexTmpPath;
+  int TmpFD;
+  if (llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%", TmpFD,
+                                      IndexTmpPath))
+    return SymbolIndex::EC_IOError;
+
+  llvm::raw_fd_ostream Out(TmpFD, true);
+  if (Out.has_error())
+    return SymbolIndex::EC_IOError;
+
+  Out.write(OutputBuffer.data(), OutputBuffer.size());
+  Out.close();
+  if (Out.has_error()) {
+    llvm::sys::fs::remove(IndexTmpPath.str());
+    return SymbolIndex::EC_IOError;
+  }
+
+  // Replace the old index with the new one, so that readers never see a
+  // partially-written index.
+  if (llvm::sys::fs::rename(IndexTmpPath.str(), Path)) {
+    llvm::sys::fs::remove(IndexTmpPath.str());
+    return SymbolIndex::EC_IOError;
+  }
+
+  return SymbolIndex::EC_None;
+}
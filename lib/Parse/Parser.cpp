@@ -15,11 +15,15 @@
 #include "RAIIObjectsForParser.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
+#include "clang/AST/Attr.h"
 #include "clang/AST/DeclTemplate.h"
 #include "clang/Parse/ParseDiagnostic.h"
 #include "clang/Sema/DeclSpec.h"
 #include "clang/Sema/ParsedTemplate.h"
 #include "clang/Sema/Scope.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace clang;
 
@@ -52,7 +56,12 @@ Parser::Parser(Preprocessor &pp, Sema &actions, bool skipFunctionBodies)
   : PP(pp), Actions(actions), Diags(PP.getDiagnostics()),
     GreaterThanIsOperator(true), ColonIsSacred(false), 
     InMessageExpression(false), TemplateParameterDepth(0),
-    ParsingInObjCContainer(false) {
+    ParsingInObjCContainer(false), NextLazyFunctionBody(0),
+    ParsedLazyFunctionBodyInPass(false),
+    MarkedLazyFunctionAliasTargets(false),
+    FlushDeferredFunctionBodies(false), NumDeferredFunctionBodies(0),
+    DeferredFunctionBodyTime(0), LongestDeferredFunctionBodyTime(0),
+    NumLazyFunctionBodiesParsed(0) {
   SkipFunctionBodies = pp.isCodeCompletionEnabled() || skipFunctionBodies;
   Tok.startToken();
   Tok.setKind(tok::eof);
@@ -528,6 +537,45 @@ bool Parser::ParseTopLevelDecl(DeclGroupPtrTy &Result) {
     ConsumeToken();
 
   Result = DeclGroupPtrTy();
+
+  // Deferred function bodies are parsed before the next declaration which
+  // could change their meaning, before the next pragma, so that they see the
+  // pragma state in effect where they were written, and before the end of
+  // the translation unit.
+  if (!DeferredFunctionBodies.empty() && !FlushDeferredFunctionBodies)
+    FlushDeferredFunctionBodies = Tok.is(tok::eof) || Tok.isAnnotation() ||
+                                  !canParseBeforeDeferredFunctionBodies();
+  if (FlushDeferredFunctionBodies) {
+    Decl *D = DeferredFunctionBodies.front().D;
+    CachedTokens Toks;
+    Toks.swap(DeferredFunctionBodies.front().Toks);
+    DeferredFunctionBodies.pop_front();
+    if (DeferredFunctionBodies.empty()) {
+      DeferredFunctionBodyIdentifiers.clear();
+      FlushDeferredFunctionBodies = false;
+    }
+
+    double Start = llvm::TimeRecord::getCurrentTime().getWallTime();
+    ParseDeferredFunctionBody(D, Toks);
+    double Elapsed = llvm::TimeRecord::getCurrentTime().getWallTime() - Start;
+    ++NumDeferredFunctionBodies;
+    DeferredFunctionBodyTime += Elapsed;
+    LongestDeferredFunctionBodyTime =
+        std::max(LongestDeferredFunctionBodyTime, Elapsed);
+
+    Result = Actions.ConvertDeclToDeclGroup(D);
+    return false;
+  }
+
+  // At the end of the translation unit, parse the bodies of the lazily parsed
+  // functions which have been used.
+  if (Tok.is(tok::eof) && !LazyFunctionBodies.empty()) {
+    if (Decl *D = ParseNextUsedLazyFunctionBody()) {
+      Result = Actions.ConvertDeclToDeclGroup(D);
+      return false;
+    }
+  }
+
   switch (Tok.getKind()) {
   case tok::annot_pragma_unused:
     HandlePragmaUnused();
@@ -1028,6 +1076,59 @@ Decl *Parser::ParseFunctionDefinition(ParsingDeclarator &D,
     }
     // FIXME: Should we really fall through here?
   }
+  else if (canDeferFunctionBody(D, LateParsedAttrs)) {
+    bool Lazy = isLazyFunctionBody(D);
+    ParseScope BodyScope(this, Scope::FnScope|Scope::DeclScope);
+    Scope *ParentScope = getCurScope()->getParent();
+
+    D.setFunctionDefinitionKind(FDK_Definition);
+    Decl *FuncDecl = Actions.HandleDeclarator(ParentScope, D,
+                                              MultiTemplateParamsArg());
+    D.complete(FuncDecl);
+    D.getMutableDeclSpec().abort();
+    if (!FuncDecl) {
+      // HandleDeclarator has diagnosed the declarator. Skip the body rather
+      // than handling the declarator a second time.
+      ConsumeBrace();
+      SkipUntil(tok::r_brace);
+      return nullptr;
+    }
+
+    CachedTokens Toks;
+    Toks.push_back(Tok);
+    ConsumeBrace();
+    ConsumeAndStoreUntil(tok::r_brace, Toks, /*StopAtSemi=*/false);
+    BodyScope.Exit();
+
+    // A pragma or module import within the body has to take effect at this
+    // point in the translation unit, so such a body is parsed right away,
+    // after the bodies deferred before it.
+    bool HasAnnotation = false;
+    for (unsigned I = 0, N = Toks.size(); I != N && !HasAnnotation; ++I)
+      HasAnnotation = Toks[I].isAnnotation();
+    if (HasAnnotation && DeferredFunctionBodies.empty()) {
+      ParseDeferredFunctionBody(FuncDecl, Toks);
+      return FuncDecl;
+    }
+
+    // The declaration is passed to the consumer once its body is parsed.
+    if (Lazy && !HasAnnotation) {
+      LazyFunctionBodies.push_back(DeferredFunctionBody());
+      LazyFunctionBodies.back().D = FuncDecl;
+      LazyFunctionBodies.back().Toks.swap(Toks);
+      return nullptr;
+    }
+    if (HasAnnotation)
+      FlushDeferredFunctionBodies = true;
+    else
+      for (unsigned I = 0, N = Toks.size(); I != N; ++I)
+        if (Toks[I].is(tok::identifier))
+          DeferredFunctionBodyIdentifiers.insert(Toks[I].getIdentifierInfo());
+    DeferredFunctionBodies.push_back(DeferredFunctionBody());
+    DeferredFunctionBodies.back().D = FuncDecl;
+    DeferredFunctionBodies.back().Toks.swap(Toks);
+    return nullptr;
+  }
 
   // Enter a scope for the function body.
   ParseScope BodyScope(this, Scope::FnScope|Scope::DeclScope);
@@ -1103,6 +1204,254 @@ Decl *Parser::ParseFunctionDefinition(ParsingDeclarator &D,
   return ParseFunctionStatementBody(Res, BodyScope);
 }
 
+/// \brief Determine whether the body of the C function definition being
+/// parsed, which starts at the current token, can be parsed after the
+/// declarations that follow it.
+bool Parser::canDeferFunctionBody(const Declarator &D,
+                                  LateParsedAttrList *LateParsedAttrs) {
+  const LangOptions &LangOpts = getLangOpts();
+  if (LangOpts.CPlusPlus || LangOpts.ObjC1 || Tok.isNot(tok::l_brace) ||
+      SkipFunctionBodies || (LateParsedAttrs && !LateParsedAttrs->empty()) ||
+      !Actions.CurContext->isTranslationUnit() ||
+      PP.isIncrementalProcessingEnabled())
+    return false;
+
+  return LangOpts.DeferredFunctionBodies || isLazyFunctionBody(D);
+}
+
+/// \brief Determine whether the top-level declaration which starts at the
+/// current token can be parsed before the deferred function bodies, without
+/// changing what they mean.
+///
+/// A deferred body has to be parsed against the declarations which precede
+/// it, so it is parsed before any declaration which could be visible to it:
+/// one which declares an identifier that appears in the body, or defines a
+/// tag, which can complete a type the body uses. The tokens are looked at up
+/// to the end of the declaration, or up to the body of a function definition,
+/// which is deferred in turn unless it has attributes that are parsed with it.
+/// Identifiers in parameter lists and typedef names, which cannot be
+/// redeclared with another meaning, are references rather than declarations.
+bool Parser::canParseBeforeDeferredFunctionBodies() {
+  TentativeParsingAction PA(*this);
+  bool CanParse = true;
+  bool SawAttribute = false, SawEqual = false;
+  // For each open parenthesis, whether it starts a parameter list.
+  SmallVector<bool, 4> Parens;
+  unsigned ParamListDepth = 0, BracketDepth = 0;
+  tok::TokenKind PrevKind = tok::unknown;
+  while (true) {
+    if (Tok.is(tok::eof) || Tok.is(tok::code_completion) ||
+        Tok.isAnnotation() || Tok.is(tok::r_brace)) {
+      CanParse = false;
+      break;
+    }
+    if (Tok.is(tok::identifier) && !ParamListDepth &&
+        DeferredFunctionBodyIdentifiers.count(Tok.getIdentifierInfo()) &&
+        !dyn_cast_or_null<TypedefNameDecl>(Actions.LookupSingleName(
+            getCurScope(), Tok.getIdentifierInfo(), Tok.getLocation(),
+            Sema::LookupOrdinaryName))) {
+      CanParse = false;
+      break;
+    }
+    if (Parens.empty() && !BracketDepth && Tok.is(tok::semi))
+      break;
+    if (Tok.is(tok::l_brace)) {
+      // Only the body of a function definition can follow a ')'. Any other
+      // brace starts a tag definition or an initializer.
+      CanParse = Parens.empty() && !BracketDepth &&
+                 PrevKind == tok::r_paren && !SawEqual && !SawAttribute;
+      break;
+    }
+
+    switch (Tok.getKind()) {
+    case tok::kw___attribute:
+      SawAttribute = true;
+      break;
+    case tok::equal:
+      SawEqual = true;
+      break;
+    case tok::l_paren: {
+      bool IsParamList =
+          PrevKind == tok::identifier || PrevKind == tok::r_paren;
+      Parens.push_back(IsParamList);
+      ParamListDepth += IsParamList;
+      break;
+    }
+    case tok::r_paren:
+      if (!Parens.empty()) {
+        ParamListDepth -= Parens.back();
+        Parens.pop_back();
+      }
+      break;
+    case tok::l_square:
+      ++BracketDepth;
+      break;
+    case tok::r_square:
+      if (BracketDepth)
+        --BracketDepth;
+      break;
+    default:
+      break;
+    }
+    PrevKind = Tok.getKind();
+    ConsumeAnyToken();
+  }
+  PA.Revert();
+  return CanParse;
+}
+
+/// \brief Determine whether the body of the function definition \p D is only
+/// to be parsed if the function is used.
+///
+/// This is the case for static functions defined outside the main file in
+/// -flazy-static-function-bodies mode. An unused static function is never
+/// emitted, and warnings about unused functions are limited to the main file,
+/// so such a body is only needed once the function has been used.
+///
+/// The body is parsed at the end of the translation unit with the pragmas
+/// in their default state, so a body written while a pragma such as
+/// \#pragma pack was in effect is not lazy. The enabled OpenCL extensions
+/// are not part of that state, so OpenCL is excluded.
+///
+/// Name lookup in a lazily parsed body also finds the file-scope
+/// declarations which follow the function, up to the end of the translation
+/// unit. A body which is valid where it is written means the same there,
+/// unless it relies on a name not being declared yet, such as a struct tag
+/// it means to declare locally or a function it calls without a declaration.
+/// A body which is not valid where it is written can be accepted.
+bool Parser::isLazyFunctionBody(const Declarator &D) {
+  return getLangOpts().LazyStaticFunctionBodies && !getLangOpts().OpenCL &&
+         D.getDeclSpec().getStorageClassSpec() == DeclSpec::SCS_static &&
+         Actions.TUKind == TU_Complete &&
+         !PP.getSourceManager().isInMainFile(D.getIdentifierLoc()) &&
+         Actions.isFunctionBodyPragmaStateDefault();
+}
+
+/// \brief Determine whether the lazily parsed function \p D needs its body.
+///
+/// Besides a use of the function, these are the attributes for which
+/// ASTContext::DeclMustBeEmitted requires a definition. They can be on any
+/// redeclaration, including one which follows the definition. The targets of
+/// alias attributes are handled by MarkLazyFunctionAliasTargetsUsed.
+static bool isLazyFunctionBodyNeeded(Decl *D) {
+  for (auto *Redecl : D->redecls())
+    if (Redecl->isUsed() || Redecl->hasAttr<UsedAttr>() ||
+        Redecl->hasAttr<AliasAttr>() || Redecl->hasAttr<ConstructorAttr>() ||
+        Redecl->hasAttr<DestructorAttr>())
+      return true;
+  return false;
+}
+
+/// \brief Mark the lazily parsed functions which are named by an alias
+/// attribute as used. Sema does not resolve the target of an alias, but
+/// CodeGen needs its definition to emit the alias.
+void Parser::MarkLazyFunctionAliasTargetsUsed() {
+  // Alias attributes in C are only meaningful on file-scope declarations,
+  // and those in AST files cannot name a function defined here.
+  llvm::StringSet<> Targets;
+  for (Decl *D : Actions.Context.getTranslationUnitDecl()->noload_decls())
+    if (const AliasAttr *Alias = D->getAttr<AliasAttr>())
+      Targets.insert(Alias->getAliasee());
+  if (Targets.empty())
+    return;
+
+  for (unsigned I = 0, N = LazyFunctionBodies.size(); I != N; ++I) {
+    FunctionDecl *FD = dyn_cast_or_null<FunctionDecl>(LazyFunctionBodies[I].D);
+    if (!FD || !FD->getIdentifier())
+      continue;
+    const AsmLabelAttr *Label = FD->getAttr<AsmLabelAttr>();
+    if (Targets.count(Label ? Label->getLabel() : FD->getName()))
+      FD->markUsed(Actions.Context);
+  }
+}
+
+/// \brief Parse the body of the next lazily parsed function which has been
+/// used, and return that function. Returns null if no remaining body is needed.
+Decl *Parser::ParseNextUsedLazyFunctionBody() {
+  if (!MarkedLazyFunctionAliasTargets) {
+    MarkLazyFunctionAliasTargetsUsed();
+    MarkedLazyFunctionAliasTargets = true;
+  }
+
+  // Parsing a body can use functions earlier in the list, so keep making
+  // passes over the list until one of them parses nothing.
+  while (true) {
+    for (unsigned N = LazyFunctionBodies.size(); NextLazyFunctionBody != N;
+         ++NextLazyFunctionBody) {
+      DeferredFunctionBody &Body = LazyFunctionBodies[NextLazyFunctionBody];
+      if (!Body.D || !isLazyFunctionBodyNeeded(Body.D))
+        continue;
+
+      Decl *D = Body.D;
+      CachedTokens Toks;
+      Toks.swap(Body.Toks);
+      Body.D = nullptr;
+      ++NextLazyFunctionBody;
+      ParsedLazyFunctionBodyInPass = true;
+      ++NumLazyFunctionBodiesParsed;
+
+      // The body was written with the pragmas in their default state, which
+      // need not be the state at the end of the translation unit.
+      Sema::DefaultFunctionBodyPragmaStateRAII PragmaState(Actions);
+      ParseDeferredFunctionBody(D, Toks);
+      return D;
+    }
+
+    if (!ParsedLazyFunctionBodyInPass)
+      return nullptr;
+    NextLazyFunctionBody = 0;
+    ParsedLazyFunctionBodyInPass = false;
+  }
+}
+
+/// \brief Parse the body of the function \p D from the tokens \p Toks, which
+/// were stored by ParseFunctionDefinition.
+void Parser::ParseDeferredFunctionBody(Decl *D, CachedTokens &Toks) {
+  // Save the current token position.
+  SourceLocation OrigLoc = Tok.getLocation();
+
+  // Append the current token at the end of the new token stream so that it
+  // doesn't get lost.
+  Toks.push_back(Tok);
+  PP.EnterTokenStream(Toks.data(), Toks.size(), true, false);
+
+  // Consume the previously pushed token.
+  ConsumeAnyToken(/*ConsumeCodeCompletionTok=*/true);
+  assert(Tok.is(tok::l_brace) && "function body not starting with '{'");
+
+  // Poison SEH identifiers so they are flagged as illegal in function bodies.
+  PoisonSEHIdentifiersRAIIObject PoisonSEHIdentifiers(*this, true);
+  ParseScope BodyScope(this, Scope::FnScope|Scope::DeclScope);
+  Actions.ActOnStartOfFunctionDef(getCurScope(), D);
+  ParseFunctionStatementBody(D, BodyScope);
+
+  // If a parse error left some of the stored tokens unconsumed, skip them.
+  if (Tok.getLocation() != OrigLoc &&
+      PP.getSourceManager().isBeforeInTranslationUnit(Tok.getLocation(),
+                                                      OrigLoc))
+    while (Tok.getLocation() != OrigLoc && Tok.isNot(tok::eof))
+      ConsumeAnyToken();
+}
+
+void Parser::PrintStats() const {
+  llvm::errs() << "\n*** Parser Stats:\n";
+  llvm::errs() << "  " << AttrFactory.getNumScratchAllocations()
+               << " declarator scratch allocations, "
+               << AttrFactory.getNumScratchBlocks()
+               << " of which needed new storage.\n";
+  if (getLangOpts().DeferredFunctionBodies)
+    llvm::errs() << "  " << NumDeferredFunctionBodies
+                 << " deferred function bodies parsed in "
+                 << llvm::format("%.4f", DeferredFunctionBodyTime)
+                 << " seconds, the longest in "
+                 << llvm::format("%.4f", LongestDeferredFunctionBodyTime)
+                 << " seconds.\n";
+  if (getLangOpts().LazyStaticFunctionBodies)
+    llvm::errs() << "  " << NumLazyFunctionBodiesParsed << " of "
+                 << LazyFunctionBodies.size()
+                 << " lazily parsed static function bodies were used.\n";
+}
+
 /// ParseKNRParamDeclarations - Parse 'declaration-list[opt]' which provides
 /// types for a function with a K&R-style identifier list for arguments.
 void Parser::ParseKNRParamDeclarations(Declarator &D) {
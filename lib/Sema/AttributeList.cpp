@@ -20,6 +20,8 @@
 #include "clang/Sema/SemaInternal.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
 using namespace clang;
 
 IdentifierLoc *IdentifierLoc::create(ASTContext &Ctx, SourceLocation Loc,
@@ -39,7 +41,8 @@ size_t AttributeList::allocated_size() const {
   return (sizeof(AttributeList) + NumArgs * sizeof(ArgsUnion));
 }
 
-AttributeFactory::AttributeFactory() {
+AttributeFactory::AttributeFactory()
+    : NumScratchAllocations(0), NumScratchBlocks(0) {
   // Go ahead and configure all the inline capacity.  This is just a memset.
   FreeLists.resize(InlineFreeListsCapacity);
 }
@@ -87,6 +90,45 @@ void AttributeFactory::reclaimPool(AttributeList *cur) {
   } while (cur);
 }
 
+namespace {
+/// The header of a block of scratch storage.  While the block is in use, it
+/// records which free list the block belongs to; once it has been released,
+/// it links the block into that list.
+union ScratchBlock {
+  unsigned SizeLog2;
+  ScratchBlock *NextFree;
+};
+}
+
+void *AttributeFactory::allocateScratch(size_t Size) {
+  ++NumScratchAllocations;
+
+  // Round the size up to a power of two, so that released blocks can be
+  // reused for a range of sizes.
+  unsigned SizeLog2 = llvm::Log2_64_Ceil(std::max(Size, sizeof(void*)));
+  if (SizeLog2 >= ScratchFreeLists.size())
+    ScratchFreeLists.resize(SizeLog2 + 1);
+
+  ScratchBlock *Block = static_cast<ScratchBlock*>(ScratchFreeLists[SizeLog2]);
+  if (Block) {
+    ScratchFreeLists[SizeLog2] = Block->NextFree;
+  } else {
+    ++NumScratchBlocks;
+    Block = static_cast<ScratchBlock*>(
+        Alloc.Allocate(sizeof(ScratchBlock) + (size_t(1) << SizeLog2),
+                       llvm::AlignOf<ScratchBlock>::Alignment));
+  }
+  Block->SizeLog2 = SizeLog2;
+  return Block + 1;
+}
+
+void AttributeFactory::deallocateScratch(void *Ptr) {
+  ScratchBlock *Block = static_cast<ScratchBlock*>(Ptr) - 1;
+  unsigned SizeLog2 = Block->SizeLog2;
+  Block->NextFree = static_cast<ScratchBlock*>(ScratchFreeLists[SizeLog2]);
+  ScratchFreeLists[SizeLog2] = Block;
+}
+
 void AttributePool::takePool(AttributeList *pool) {
   assert(pool);
 
@@ -611,3 +611,40 @@ bool clang::operator<(const CodeCompletionResult &X,
   
   return false;
 }
+
+unsigned CodeCompleteConsumer::filterResults(CodeCompletionResult *Results,
+                                             unsigned NumResults) const {
+  if (ResultPrefix.empty() && (!MaxResults || NumResults <= MaxResults))
+    return NumResults;
+
+  // Move the results that match the prefix to the front.
+  CodeCompletionResult *End = Results + NumResults;
+  if (!ResultPrefix.empty()) {
+    End = std::stable_partition(Results, End,
+                                [&](const CodeCompletionResult &R) {
+      std::string Saved;
+      return matchesResultPrefix(getOrderedName(R, Saved));
+    });
+  }
+  if (!MaxResults)
+    return End - Results;
+
+  // Rank the matching results and keep the best ones.
+  StringRef Prefix = ResultPrefix;
+  auto Better = [=](const CodeCompletionResult &X,
+                    const CodeCompletionResult &Y) {
+    if (X.Priority != Y.Priority)
+      return X.Priority < Y.Priority;
+    std::string XSaved, YSaved;
+    bool XExact = getOrderedName(X, XSaved).startswith(Prefix);
+    bool YExact = getOrderedName(Y, YSaved).startswith(Prefix);
+    if (XExact != YExact)
+      return XExact;
+    return X < Y;
+  };
+  CodeCompletionResult *Kept = End;
+  if (unsigned(End - Results) > MaxResults)
+    Kept = Results + MaxResults;
+  std::partial_sort(Results, Kept, End, Better);
+  return Kept - Results;
+}
@@ -223,19 +223,23 @@ DeclaratorChunk DeclaratorChunk::getFunction(bool hasProto,
   assert(I.Fun.TypeQuals == TypeQuals && "bitfield overflow");
   assert(I.Fun.ExceptionSpecType == ESpecType && "bitfield overflow");
 
-  // new[] a parameter array if needed.
+  AttributeFactory &Factory = TheDeclarator.getAttributePool().getFactory();
+
+  // Allocate a parameter array if needed.
   if (NumParams) {
     // If the 'InlineParams' in Declarator is unused and big enough, put our
     // parameter list there (in an effort to avoid new/delete traffic).  If it
     // is already used (consider a function returning a function pointer) or too
-    // small (function with too many parameters), go to the heap.
+    // small (function with too many parameters), use the scratch storage of
+    // the attribute factory, which recycles these arrays between declarators.
     if (!TheDeclarator.InlineParamsUsed &&
         NumParams <= llvm::array_lengthof(TheDeclarator.InlineParams)) {
       I.Fun.Params = TheDeclarator.InlineParams;
       I.Fun.DeleteParams = false;
       TheDeclarator.InlineParamsUsed = true;
     } else {
-      I.Fun.Params = new DeclaratorChunk::ParamInfo[NumParams];
+      I.Fun.Params = static_cast<DeclaratorChunk::ParamInfo *>(
+          Factory.allocateScratch(sizeof(Params[0]) * NumParams));
       I.Fun.DeleteParams = true;
     }
     memcpy(I.Fun.Params, Params, sizeof(Params[0]) * NumParams);
@@ -245,10 +249,12 @@ DeclaratorChunk DeclaratorChunk::getFunction(bool hasProto,
   switch (ESpecType) {
   default: break; // By default, save nothing.
   case EST_Dynamic:
-    // new[] an exception array if needed
+    // Allocate an exception array if needed.
     if (NumExceptions) {
       I.Fun.NumExceptions = NumExceptions;
-      I.Fun.Exceptions = new DeclaratorChunk::TypeAndRange[NumExceptions];
+      I.Fun.Exceptions = static_cast<DeclaratorChunk::TypeAndRange *>(
+          Factory.allocateScratch(sizeof(DeclaratorChunk::TypeAndRange) *
+                                  NumExceptions));
       for (unsigned i = 0; i != NumExceptions; ++i) {
         I.Fun.Exceptions[i].Ty = Exceptions[i];
         I.Fun.Exceptions[i].Range = ExceptionRanges[i];
@@ -897,10 +903,13 @@ void DeclSpec::setProtocolQualifiers(Decl * const *Protos,
                                      SourceLocation *ProtoLocs,
                                      SourceLocation LAngleLoc) {
   if (NP == 0) return;
-  Decl **ProtoQuals = new Decl*[NP];
+  AttributeFactory &Factory = getAttributePool().getFactory();
+  Decl **ProtoQuals =
+      static_cast<Decl **>(Factory.allocateScratch(sizeof(Decl*) * NP));
   memcpy(ProtoQuals, Protos, sizeof(Decl*)*NP);
   ProtocolQualifiers = ProtoQuals;
-  ProtocolLocs = new SourceLocation[NP];
+  ProtocolLocs = static_cast<SourceLocation *>(
+      Factory.allocateScratch(sizeof(SourceLocation) * NP));
   memcpy(ProtocolLocs, ProtoLocs, sizeof(SourceLocation)*NP);
   NumProtocolQualifiers = NP;
   ProtocolLAngleLoc = LAngleLoc;
@@ -37,6 +37,7 @@
 #include "clang/Sema/ScopeInfo.h"
 #include "clang/Sema/SemaConsumer.h"
 #include "clang/Sema/TemplateDeduction.h"
+#include "clang/Sema/TypoCorrectionIndex.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallSet.h"
@@ -99,14 +100,18 @@ Sema::Sema(Preprocessor &pp, ASTContext &ctxt, ASTConsumer &consumer,
     GlobalNewDeleteDeclared(false),
     TUKind(TUKind),
     NumSFINAEErrors(0),
+    NumOverloadCacheHits(0), NumOverloadCacheMisses(0),
     AccessCheckingSFINAE(false), InNonInstantiationSFINAEContext(false),
-    NonInstantiationEntries(0), ArgumentPackSubstitutionIndex(-1),
+    NonInstantiationEntries(0), InstantiationProfiler(nullptr),
+    ArgumentPackSubstitutionIndex(-1),
     CurrentInstantiationScope(nullptr), DisableTypoCorrection(false),
-    TyposCorrected(0), AnalysisWarnings(*this),
+    TyposCorrected(0), TypoIndexedIdentifiers(0), TypoIndexedGeneration(0),
+    TypoIndexedExternalIdentifiers(false), AnalysisWarnings(*this),
     VarDataSharingAttributesStack(nullptr), CurScope(nullptr),
     Ident_super(nullptr), Ident___float128(nullptr)
 {
   TUScope = nullptr;
+  NumPrefixInstantiations = 0;
 
   LoadedExternalKnownNamespaces = false;
   for (unsigned I = 0; I != NSAPI::NumNSNumberLiteralMethods; ++I)
@@ -303,6 +308,19 @@ void Sema::addExternalSource(ExternalSemaSource *E) {
 void Sema::PrintStats() const {
   llvm::errs() << "\n*** Semantic Analysis Stats:\n";
   llvm::errs() << NumSFINAEErrors << " SFINAE diagnostics trapped.\n";
+  if (LangOpts.CPlusPlus)
+    llvm::errs() << NumOverloadCacheHits << " overload resolutions reused, "
+                 << NumOverloadCacheMisses << " performed for cacheable "
+                    "calls, " << OverloadResolutionCache.size()
+                 << " results cached.\n";
+  if (TUKind == TU_Prefix && LangOpts.PCHInstantiateTemplates)
+    llvm::errs() << NumPrefixInstantiations
+                 << " implicit instantiations performed in the precompiled "
+                    "header, " << PendingInstantiations.size()
+                 << " left to including translation units.\n";
+
+  if (TypoIndex)
+    TypoIndex->PrintStats();
 
   BumpAlloc.PrintStats();
   AnalysisWarnings.PrintStats();
@@ -675,6 +693,21 @@ void Sema::ActOnEndOfTranslationUnit() {
       LateTemplateParserCleanup(OpaqueParser);
 
     CheckDelayedMemberExceptionSpecs();
+  } else if (LangOpts.PCHInstantiateTemplates) {
+    // Perform the implicit instantiations whose templates are defined, so
+    // that they are stored in the precompiled header and reused by the
+    // translation units that include it. The others stay pending.
+    if (ExternalSource) {
+      SmallVector<PendingImplicitInstantiation, 4> Pending;
+      ExternalSource->ReadPendingInstantiations(Pending);
+      PendingInstantiations.insert(PendingInstantiations.begin(),
+                                   Pending.begin(), Pending.end());
+    }
+    PerformPendingInstantiations();
+    PendingInstantiations.insert(PendingInstantiations.end(),
+                                 DeferredPrefixInstantiations.begin(),
+                                 DeferredPrefixInstantiations.end());
+    DeferredPrefixInstantiations.clear();
   }
 
   // All delayed member exception specs should be checked or we end up accepting
@@ -106,6 +106,48 @@ bool PragmaPackStack::pop(IdentifierInfo *Name, bool IsReset) {
 }
 
 
+bool Sema::isFunctionBodyPragmaStateDefault() const {
+  PragmaPackStack *Stack = static_cast<PragmaPackStack*>(PackContext);
+  if (Stack && Stack->getAlignment())
+    return false;
+  return !MSStructPragmaOn &&
+         FPFeatures.fp_contract == getLangOpts().DefaultFPContract &&
+         !VisContext && !DataSegStack.CurrentValue &&
+         !BSSSegStack.CurrentValue && !ConstSegStack.CurrentValue;
+}
+
+Sema::DefaultFunctionBodyPragmaStateRAII::DefaultFunctionBodyPragmaStateRAII(
+    Sema &S)
+    : S(S), OldPackContext(S.PackContext), OldVisContext(S.VisContext),
+      OldDataSeg(S.DataSegStack.CurrentValue),
+      OldBSSSeg(S.BSSSegStack.CurrentValue),
+      OldConstSeg(S.ConstSegStack.CurrentValue),
+      OldMSStructPragmaOn(S.MSStructPragmaOn),
+      OldFPContractState(S.FPFeatures.fp_contract) {
+  // The stacks are only set aside; a body cannot contain pragmas which would
+  // change them.
+  S.PackContext = nullptr;
+  S.VisContext = nullptr;
+  S.DataSegStack.CurrentValue = nullptr;
+  S.BSSSegStack.CurrentValue = nullptr;
+  S.ConstSegStack.CurrentValue = nullptr;
+  S.MSStructPragmaOn = false;
+  S.FPFeatures.fp_contract = S.getLangOpts().DefaultFPContract;
+}
+
+Sema::DefaultFunctionBodyPragmaStateRAII::
+    ~DefaultFunctionBodyPragmaStateRAII() {
+  assert(!S.PackContext && !S.VisContext &&
+         "pragma stack created while parsing a function body");
+  S.PackContext = OldPackContext;
+  S.VisContext = OldVisContext;
+  S.DataSegStack.CurrentValue = OldDataSeg;
+  S.BSSSegStack.CurrentValue = OldBSSSeg;
+  S.ConstSegStack.CurrentValue = OldConstSeg;
+  S.MSStructPragmaOn = OldMSStructPragmaOn;
+  S.FPFeatures.fp_contract = OldFPContractState;
+}
+
 /// FreePackedContext - Deallocate and null out PackContext.
 void Sema::FreePackedContext() {
   delete static_cast<PragmaPackStack*>(PackContext);
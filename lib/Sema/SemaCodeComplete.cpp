@@ -3024,8 +3024,12 @@ static void HandleCodeCompleteResults(Sema *S,
                                       CodeCompletionContext Context,
                                       CodeCompletionResult *Results,
                                       unsigned NumResults) {
-  if (CodeCompleter)
+  if (CodeCompleter) {
+    // Drop the results that the consumer filters out before it builds any
+    // completion strings for them.
+    NumResults = CodeCompleter->filterResults(Results, NumResults);
     CodeCompleter->ProcessCodeCompleteResults(*S, Context, Results, NumResults);
+  }
 }
 
 static enum CodeCompletionContext::Kind mapCodeCompletionContext(Sema &S, 
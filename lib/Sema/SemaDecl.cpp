@@ -9524,7 +9524,12 @@ void Sema::CheckCompleteVariableDeclaration(VarDecl *var) {
 
     if (var->isConstexpr()) {
       SmallVector<PartialDiagnosticAt, 8> Notes;
-      if (!var->evaluateValue(Notes) || !var->isInitICE()) {
+      bool Evaluated;
+      {
+        ProfileConstantEvaluationRAII Profile(*this, Init, var);
+        Evaluated = var->evaluateValue(Notes);
+      }
+      if (!Evaluated || !var->isInitICE()) {
         SourceLocation DiagLoc = var->getLocation();
         // If the note doesn't add any useful information other than a source
         // location, fold it into the primary diagnostic.
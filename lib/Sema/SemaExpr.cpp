@@ -11323,8 +11323,12 @@ Sema::VerifyIntegerConstantExpression(Expr *E, llvm::APSInt *Result,
 
   // Try to evaluate the expression, and produce diagnostics explaining why it's
   // not a constant expression as a side-effect.
-  bool Folded = E->EvaluateAsRValue(EvalResult, Context) &&
-                EvalResult.Val.isInt() && !EvalResult.HasSideEffects;
+  bool Folded;
+  {
+    ProfileConstantEvaluationRAII Profile(*this, E);
+    Folded = E->EvaluateAsRValue(EvalResult, Context) &&
+             EvalResult.Val.isInt() && !EvalResult.HasSideEffects;
+  }
 
   // In C++11, we can rely on diagnostics being produced for any expression
   // which is not a constant expression. If no diagnostics were produced, then
@@ -33,6 +33,7 @@
 #include "clang/Sema/SemaInternal.h"
 #include "clang/Sema/TemplateDeduction.h"
 #include "clang/Sema/TypoCorrection.h"
+#include "clang/Sema/TypoCorrectionIndex.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
@@ -3422,6 +3423,12 @@ void TypoCorrectionConsumer::addKeywordResult(StringRef Keyword) {
   addName(Keyword, nullptr, nullptr, true);
 }
 
+/// \brief Compute the largest edit distance from \p Typo at which a name is
+/// still considered as a correction.
+static unsigned getMaxTypoEditDistance(StringRef Typo) {
+  return (Typo.size() + 2) / 3;
+}
+
 void TypoCorrectionConsumer::addName(StringRef Name, NamedDecl *ND,
                                      NestedNameSpecifier *NNS, bool isKeyword) {
   // Use a simple length-based heuristic to determine the minimum possible
@@ -3433,7 +3440,7 @@ void TypoCorrectionConsumer::addName(StringRef Name, NamedDecl *ND,
 
   // Compute an upper bound on the allowable edit distance, so that the
   // edit-distance algorithm can short-circuit.
-  unsigned UpperBound = (TypoStr.size() + 2) / 3 + 1;
+  unsigned UpperBound = getMaxTypoEditDistance(TypoStr) + 1;
   unsigned ED = TypoStr.edit_distance(Name, true, UpperBound);
   if (ED >= UpperBound) return;
 
@@ -4018,6 +4025,56 @@ static void AddKeywordsToConsumer(Sema &SemaRef,
   }
 }
 
+TypoCorrectionIndex *Sema::getTypoCorrectionIndex() {
+  if (!TypoIndex)
+    TypoIndex.reset(new TypoCorrectionIndex());
+
+  // Adding a name to the index computes edit distances too, so it is charged
+  // against the same budget as the searches. A large translation unit can
+  // otherwise spend far more on building the index than on the corrections.
+  unsigned CandidateLimit =
+      getDiagnostics().getDiagnosticOptions().SpellCheckingCandidateLimit;
+  auto OverBudget = [&] {
+    return CandidateLimit && TypoIndex->getNumComparisons() >= CandidateLimit;
+  };
+
+  // Identifiers are never removed from the identifier table, so it only needs
+  // to be walked again if it has grown.
+  if (Context.Idents.size() != TypoIndexedIdentifiers) {
+    for (const auto &I : Context.Idents) {
+      TypoIndex->insert(I.getKey());
+      if (OverBudget())
+        return nullptr;
+    }
+    TypoIndexedIdentifiers = Context.Idents.size();
+  }
+
+  // Likewise, the external identifiers only change when an AST file is
+  // loaded, which starts a new generation of the external AST source.
+  if (IdentifierInfoLookup *External
+                          = Context.Idents.getExternalIdentifierLookup()) {
+    ExternalASTSource *Source = Context.getExternalSource();
+    uint32_t Generation = Source ? Source->getGeneration() : 0;
+    if (!TypoIndexedExternalIdentifiers ||
+        Generation != TypoIndexedGeneration) {
+      std::unique_ptr<IdentifierIterator> Iter(External->getIdentifiers());
+      do {
+        StringRef Name = Iter->Next();
+        if (Name.empty())
+          break;
+
+        TypoIndex->insert(Name);
+        if (OverBudget())
+          return nullptr;
+      } while (true);
+      TypoIndexedExternalIdentifiers = true;
+      TypoIndexedGeneration = Generation;
+    }
+  }
+
+  return TypoIndex.get();
+}
+
 std::unique_ptr<TypoCorrectionConsumer> Sema::makeTypoCorrectionConsumer(
     const DeclarationNameInfo &TypoName, Sema::LookupNameKind LookupKind,
     Scope *S, CXXScopeSpec *SS,
@@ -4073,6 +4130,14 @@ std::unique_ptr<TypoCorrectionConsumer> Sema::makeTypoCorrectionConsumer(
   unsigned Limit = getDiagnostics().getDiagnosticOptions().SpellCheckingLimit;
   if (Limit && TyposCorrected >= Limit)
     return nullptr;
+
+  // Likewise, stop once indexing and searching the candidate names has
+  // computed as many edit distances as the translation unit is allowed.
+  unsigned CandidateLimit =
+      getDiagnostics().getDiagnosticOptions().SpellCheckingCandidateLimit;
+  if (CandidateLimit && TypoIndex &&
+      TypoIndex->getNumComparisons() >= CandidateLimit)
+    return nullptr;
   ++TyposCorrected;
 
   // If we're handling a missing symbol error, using modules, and the
@@ -4118,24 +4183,17 @@ std::unique_ptr<TypoCorrectionConsumer> Sema::makeTypoCorrectionConsumer(
 
   if (IsUnqualifiedLookup || SearchNamespaces) {
     // For unqualified lookup, look through all of the names that we have
-    // seen in this translation unit.
-    // FIXME: Re-add the ability to skip very unlikely potential corrections.
-    for (const auto &I : Context.Idents)
-      Consumer->FoundName(I.getKey());
-
-    // Walk through identifiers in external identifier sources.
-    // FIXME: Re-add the ability to skip very unlikely potential corrections.
-    if (IdentifierInfoLookup *External
-                            = Context.Idents.getExternalIdentifierLookup()) {
-      std::unique_ptr<IdentifierIterator> Iter(External->getIdentifiers());
-      do {
-        StringRef Name = Iter->Next();
-        if (Name.empty())
-          break;
+    // seen in this translation unit or in external identifier sources which
+    // are close enough to the typo to be a correction.
+    TypoCorrectionIndex *Index = getTypoCorrectionIndex();
+    if (!Index)
+      return nullptr;
 
-        Consumer->FoundName(Name);
-      } while (true);
-    }
+    SmallVector<StringRef, 16> Names;
+    Index->search(Typo->getName(), getMaxTypoEditDistance(Typo->getName()),
+                  Names);
+    for (unsigned I = 0, N = Names.size(); I != N; ++I)
+      Consumer->FoundName(Names[I]);
   }
 
   AddKeywordsToConsumer(*this, *Consumer, S, CCCRef, SS && SS->isNotEmpty());
@@ -5039,10 +5039,14 @@ static ExprResult CheckConvertedConstantExpression(Sema &S, Expr *From,
   Expr::EvalResult Eval;
   Eval.Diag = &Notes;
 
-  if ((T->isReferenceType()
-           ? !Result.get()->EvaluateAsLValue(Eval, S.Context)
-           : !Result.get()->EvaluateAsRValue(Eval, S.Context)) ||
-      (RequireInt && !Eval.Val.isInt())) {
+  bool Evaluated;
+  {
+    Sema::ProfileConstantEvaluationRAII Profile(S, Result.get());
+    Evaluated = T->isReferenceType()
+                    ? Result.get()->EvaluateAsLValue(Eval, S.Context)
+                    : Result.get()->EvaluateAsRValue(Eval, S.Context);
+  }
+  if (!Evaluated || (RequireInt && !Eval.Val.isInt())) {
     // The expression can't be folded, so we can't keep it at this position in
     // the AST.
     Result = ExprError();
@@ -8268,6 +8272,18 @@ Sema::AddArgumentDependentLookupCandidates(DeclarationName Name,
   // FIXME: Pass in the explicit template arguments?
   ArgumentDependentLookup(Name, Loc, Args, Fns);
 
+  AddArgumentDependentLookupCandidates(Fns, Args, ExplicitTemplateArgs,
+                                       CandidateSet, PartialOverloading);
+}
+
+/// \brief Add the function candidates \p Fns, which were found by
+/// argument-dependent lookup, to the set of overloading candidates.
+void
+Sema::AddArgumentDependentLookupCandidates(ADLResult &Fns,
+                                           ArrayRef<Expr *> Args,
+                                 TemplateArgumentListInfo *ExplicitTemplateArgs,
+                                           OverloadCandidateSet& CandidateSet,
+                                           bool PartialOverloading) {
   // Erase all of the candidates we already knew about.
   for (OverloadCandidateSet::iterator Cand = CandidateSet.begin(),
                                    CandEnd = CandidateSet.end();
@@ -10383,7 +10399,8 @@ static void AddOverloadedCallCandidate(Sema &S,
 void Sema::AddOverloadedCallCandidates(UnresolvedLookupExpr *ULE,
                                        ArrayRef<Expr *> Args,
                                        OverloadCandidateSet &CandidateSet,
-                                       bool PartialOverloading) {
+                                       bool PartialOverloading,
+                                       ADLResult *ADLFns) {
 
 #ifndef NDEBUG
   // Verify that ArgumentDependentLookup is consistent with the rules
@@ -10428,7 +10445,12 @@ void Sema::AddOverloadedCallCandidates(UnresolvedLookupExpr *ULE,
                                CandidateSet, PartialOverloading,
                                /*KnownValid*/ true);
 
-  if (ULE->requiresADL())
+  // Use the results of argument-dependent lookup if the caller has already
+  // performed it.
+  if (ADLFns)
+    AddArgumentDependentLookupCandidates(*ADLFns, Args, ExplicitTemplateArgs,
+                                         CandidateSet, PartialOverloading);
+  else if (ULE->requiresADL())
     AddArgumentDependentLookupCandidates(ULE->getName(), ULE->getExprLoc(),
                                          Args, ExplicitTemplateArgs,
                                          CandidateSet, PartialOverloading);
@@ -10668,7 +10690,8 @@ bool Sema::buildOverloadedCallSet(Scope *S, Expr *Fn,
                                   MultiExprArg Args,
                                   SourceLocation RParenLoc,
                                   OverloadCandidateSet *CandidateSet,
-                                  ExprResult *Result) {
+                                  ExprResult *Result,
+                                  ADLResult *ADLFns) {
 #ifndef NDEBUG
   if (ULE->requiresADL()) {
     // To do ADL, we must have found an unqualified name.
@@ -10695,7 +10718,8 @@ bool Sema::buildOverloadedCallSet(Scope *S, Expr *Fn,
 
   // Add the functions denoted by the callee to the set of candidate
   // functions, including those from argument-dependent lookup.
-  AddOverloadedCallCandidates(ULE, Args, *CandidateSet);
+  AddOverloadedCallCandidates(ULE, Args, *CandidateSet,
+                              /*PartialOverloading=*/false, ADLFns);
 
   // If we found nothing, try to recover.
   // BuildRecoveryCallExpr diagnoses the error itself, so we just bail
@@ -10721,6 +10745,122 @@ bool Sema::buildOverloadedCallSet(Scope *S, Expr *Fn,
   return false;
 }
 
+/// \brief Determine whether conversions to or from the type \p T are known,
+/// that is, whether they cannot change later in the translation unit.
+static bool isCompleteForOverloadCache(QualType T) {
+  // Conversions involving a class depend on its bases, constructors and
+  // conversion functions, which are only known once it is complete.
+  if (const ReferenceType *RT = T->getAs<ReferenceType>())
+    T = RT->getPointeeType();
+  else if (const PointerType *PT = T->getAs<PointerType>())
+    T = PT->getPointeeType();
+  else if (T->isMemberPointerType())
+    return false;
+  return !T->isRecordType() || !T->isIncompleteType();
+}
+
+/// \brief Determine whether the result of overload resolution for a call with
+/// the arguments \p Args depends only on the candidate functions and on the
+/// types and value kinds of the arguments, so that it can be cached.
+static bool isOverloadResolutionCacheable(Sema &S, ArrayRef<Expr *> Args) {
+  const LangOptions &LangOpts = S.getLangOpts();
+  if (!LangOpts.OverloadResolutionCache || LangOpts.CUDA || LangOpts.ObjC1)
+    return false;
+
+  for (unsigned I = 0, N = Args.size(); I != N; ++I) {
+    Expr *Arg = Args[I];
+    QualType T = Arg->getType();
+    if (Arg->isTypeDependent() || T->isPlaceholderType() ||
+        Arg->getObjectKind() != OK_Ordinary || !isCompleteForOverloadCache(T))
+      return false;
+
+    // String literals, initializer lists and null pointer constants can be
+    // converted to types that other expressions of their type cannot.
+    Expr *E = Arg->IgnoreParens();
+    if (isa<StringLiteral>(E) || isa<InitListExpr>(E))
+      return false;
+    if (T->isIntegerType() &&
+        Arg->isNullPointerConstant(S.Context,
+                                   Expr::NPC_ValueDependentIsNotNull))
+      return false;
+  }
+  return true;
+}
+
+/// \brief Compute the key under which the result of resolving a call of kind
+/// \p Kind to one of the functions \p Fns with the arguments \p Args is
+/// cached.
+static void computeOverloadCacheKey(unsigned Kind,
+                                    SmallVectorImpl<NamedDecl *> &Fns,
+                                    ArrayRef<Expr *> Args,
+                                    SmallVectorImpl<char> &Key) {
+  std::sort(Fns.begin(), Fns.end());
+  Fns.erase(std::unique(Fns.begin(), Fns.end()), Fns.end());
+
+  unsigned Sizes[3] = { Kind, static_cast<unsigned>(Fns.size()),
+                        static_cast<unsigned>(Args.size()) };
+  const char *Bytes = reinterpret_cast<const char *>(Sizes);
+  Key.append(Bytes, Bytes + sizeof(Sizes));
+  Bytes = reinterpret_cast<const char *>(Fns.data());
+  Key.append(Bytes, Bytes + Fns.size() * sizeof(NamedDecl *));
+  for (unsigned I = 0, N = Args.size(); I != N; ++I) {
+    void *Type = Args[I]->getType().getCanonicalType().getAsOpaquePtr();
+    Bytes = reinterpret_cast<const char *>(&Type);
+    Key.append(Bytes, Bytes + sizeof(Type));
+    Key.push_back(static_cast<char>(Args[I]->getValueKind()));
+  }
+}
+
+/// \brief Remember that overload resolution chose \p Best from
+/// \p CandidateSet, unless a later call with the same key could choose a
+/// different function.
+static void cacheOverloadResolution(Sema &S, StringRef Key,
+                                    OverloadCandidateSet &CandidateSet,
+                                    OverloadCandidateSet::iterator Best) {
+  if (!Best->Function || S.isSFINAEContext())
+    return;
+
+  // A candidate which is not viable because one of its parameters has an
+  // incomplete class type could become viable once the class is complete.
+  for (OverloadCandidateSet::iterator Cand = CandidateSet.begin(),
+                                   CandEnd = CandidateSet.end();
+       Cand != CandEnd; ++Cand) {
+    FunctionDecl *FD = Cand->Function;
+    if (!FD)
+      continue;
+    if (FD->hasAttr<EnableIfAttr>())
+      return;
+    for (unsigned I = 0, N = FD->getNumParams(); I != N; ++I) {
+      QualType T = FD->getParamDecl(I)->getType();
+      if (!T->isDependentType() && !isCompleteForOverloadCache(T))
+        return;
+    }
+  }
+
+  Sema::CachedOverloadResolution Result = {
+    Best->Function, Best->FoundDecl, CandidateSet.size() > 1
+  };
+  S.OverloadResolutionCache[Key] = Result;
+}
+
+/// \brief Build the call to \p FDecl, which overload resolution chose for the
+/// call to \p ULE.
+static ExprResult BuildResolvedOverloadedCall(Sema &SemaRef, Expr *Fn,
+                                              UnresolvedLookupExpr *ULE,
+                                              SourceLocation LParenLoc,
+                                              MultiExprArg Args,
+                                              SourceLocation RParenLoc,
+                                              Expr *ExecConfig,
+                                              FunctionDecl *FDecl,
+                                              DeclAccessPair FoundDecl) {
+  SemaRef.CheckUnresolvedLookupAccess(ULE, FoundDecl);
+  if (SemaRef.DiagnoseUseOfDecl(FDecl, ULE->getNameLoc()))
+    return ExprError();
+  Fn = SemaRef.FixOverloadedFunctionReference(Fn, FoundDecl, FDecl);
+  return SemaRef.BuildResolvedCallExpr(Fn, FDecl, LParenLoc, Args, RParenLoc,
+                                       ExecConfig);
+}
+
 /// FinishOverloadedCallExpr - given an OverloadCandidateSet, builds and returns
 /// the completed call expression. If overload resolution fails, emits
 /// diagnostics and returns ExprError()
@@ -10740,15 +10880,10 @@ static ExprResult FinishOverloadedCallExpr(Sema &SemaRef, Scope *S, Expr *Fn,
                                  AllowTypoCorrection);
 
   switch (OverloadResult) {
-  case OR_Success: {
-    FunctionDecl *FDecl = (*Best)->Function;
-    SemaRef.CheckUnresolvedLookupAccess(ULE, (*Best)->FoundDecl);
-    if (SemaRef.DiagnoseUseOfDecl(FDecl, ULE->getNameLoc()))
-      return ExprError();
-    Fn = SemaRef.FixOverloadedFunctionReference(Fn, (*Best)->FoundDecl, FDecl);
-    return SemaRef.BuildResolvedCallExpr(Fn, FDecl, LParenLoc, Args, RParenLoc,
-                                         ExecConfig);
-  }
+  case OR_Success:
+    return BuildResolvedOverloadedCall(SemaRef, Fn, ULE, LParenLoc, Args,
+                                       RParenLoc, ExecConfig, (*Best)->Function,
+                                       (*Best)->FoundDecl);
 
   case OR_No_Viable_Function: {
     // Try to recover by looking for viable functions which the user might
@@ -10807,17 +10942,48 @@ ExprResult Sema::BuildOverloadedCallExpr(Scope *S, Expr *Fn,
                                          SourceLocation RParenLoc,
                                          Expr *ExecConfig,
                                          bool AllowTypoCorrection) {
+  // If an earlier call had the same candidate functions and argument types,
+  // reuse the result of overload resolution for it. Argument-dependent lookup
+  // is still performed, so that functions declared since then are noticed.
+  ADLResult ADLFns;
+  SmallString<128> CacheKey;
+  bool UseCache = !ExecConfig && !ULE->hasExplicitTemplateArgs() &&
+                  isOverloadResolutionCacheable(*this, Args);
+  if (UseCache) {
+    SmallVector<NamedDecl *, 16> Fns(ULE->decls_begin(), ULE->decls_end());
+    if (ULE->requiresADL()) {
+      ArgumentDependentLookup(ULE->getName(), ULE->getExprLoc(), Args, ADLFns);
+      Fns.append(ADLFns.begin(), ADLFns.end());
+    }
+    computeOverloadCacheKey(/*Kind=*/0, Fns, Args, CacheKey);
+
+    llvm::StringMap<CachedOverloadResolution>::iterator Known
+      = OverloadResolutionCache.find(CacheKey);
+    if (Known != OverloadResolutionCache.end()) {
+      ++NumOverloadCacheHits;
+      return BuildResolvedOverloadedCall(*this, Fn, ULE, LParenLoc, Args,
+                                         RParenLoc, ExecConfig,
+                                         Known->second.Function,
+                                         Known->second.FoundDecl);
+    }
+    ++NumOverloadCacheMisses;
+  }
+
   OverloadCandidateSet CandidateSet(Fn->getExprLoc(),
                                     OverloadCandidateSet::CSK_Normal);
   ExprResult result;
 
   if (buildOverloadedCallSet(S, Fn, ULE, Args, LParenLoc, &CandidateSet,
-                             &result))
+                             &result,
+                             UseCache && ULE->requiresADL() ? &ADLFns
+                                                            : nullptr))
     return result;
 
   OverloadCandidateSet::iterator Best;
   OverloadingResult OverloadResult =
       CandidateSet.BestViableFunction(*this, Fn->getLocStart(), Best);
+  if (UseCache && OverloadResult == OR_Success)
+    cacheOverloadResolution(*this, CacheKey, CandidateSet, Best);
 
   return FinishOverloadedCallExpr(*this, S, Fn, ULE, LParenLoc, Args,
                                   RParenLoc, ExecConfig, &CandidateSet,
@@ -11017,6 +11183,91 @@ Sema::CreateOverloadedUnaryOp(SourceLocation OpLoc, unsigned OpcIn,
   return CreateBuiltinUnaryOp(OpLoc, Opc, Input);
 }
 
+/// \brief Build a call to the overloaded operator \p FnDecl, which overload
+/// resolution chose for the binary operator \p Op.
+ExprResult Sema::BuildResolvedOverloadedBinOp(SourceLocation OpLoc,
+                                              OverloadedOperatorKind Op,
+                                              FunctionDecl *FnDecl,
+                                              DeclAccessPair FoundDecl,
+                                              bool HadMultipleCandidates,
+                                              Expr *LHS, Expr *RHS) {
+  Expr *Args[2] = { LHS, RHS };
+
+  // Convert the arguments.
+  if (CXXMethodDecl *Method = dyn_cast<CXXMethodDecl>(FnDecl)) {
+    // FoundDecl's access is only meaningful for class members.
+    CheckMemberOperatorAccess(OpLoc, Args[0], Args[1], FoundDecl);
+
+    ExprResult Arg1 =
+      PerformCopyInitialization(
+        InitializedEntity::InitializeParameter(Context,
+                                               FnDecl->getParamDecl(0)),
+        SourceLocation(), Args[1]);
+    if (Arg1.isInvalid())
+      return ExprError();
+
+    ExprResult Arg0 =
+      PerformObjectArgumentInitialization(Args[0], /*Qualifier=*/nullptr,
+                                          FoundDecl, Method);
+    if (Arg0.isInvalid())
+      return ExprError();
+    Args[0] = Arg0.getAs<Expr>();
+    Args[1] = Arg1.getAs<Expr>();
+  } else {
+    // Convert the arguments.
+    ExprResult Arg0 = PerformCopyInitialization(
+      InitializedEntity::InitializeParameter(Context,
+                                             FnDecl->getParamDecl(0)),
+      SourceLocation(), Args[0]);
+    if (Arg0.isInvalid())
+      return ExprError();
+
+    ExprResult Arg1 =
+      PerformCopyInitialization(
+        InitializedEntity::InitializeParameter(Context,
+                                               FnDecl->getParamDecl(1)),
+        SourceLocation(), Args[1]);
+    if (Arg1.isInvalid())
+      return ExprError();
+    Args[0] = Arg0.getAs<Expr>();
+    Args[1] = Arg1.getAs<Expr>();
+  }
+
+  // Build the actual expression node.
+  ExprResult FnExpr = CreateFunctionRefExpr(*this, FnDecl, FoundDecl,
+                                            HadMultipleCandidates, OpLoc);
+  if (FnExpr.isInvalid())
+    return ExprError();
+
+  // Determine the result type.
+  QualType ResultTy = FnDecl->getReturnType();
+  ExprValueKind VK = Expr::getValueKindForType(ResultTy);
+  ResultTy = ResultTy.getNonLValueExprType(Context);
+
+  CXXOperatorCallExpr *TheCall =
+    new (Context) CXXOperatorCallExpr(Context, Op, FnExpr.get(),
+                                      Args, ResultTy, VK, OpLoc,
+                                      FPFeatures.fp_contract);
+
+  if (CheckCallReturnType(FnDecl->getReturnType(), OpLoc, TheCall,
+                          FnDecl))
+    return ExprError();
+
+  ArrayRef<const Expr *> ArgsArray(Args, 2);
+  // Cut off the implicit 'this'.
+  if (isa<CXXMethodDecl>(FnDecl))
+    ArgsArray = ArgsArray.slice(1);
+
+  // Check for a self move.
+  if (Op == OO_Equal)
+    DiagnoseSelfMove(Args[0], Args[1], OpLoc);
+
+  checkCall(FnDecl, ArgsArray, 0, isa<CXXMethodDecl>(FnDecl), OpLoc,
+            TheCall->getSourceRange(), VariadicDoesNotApply);
+
+  return MaybeBindToTemporary(TheCall);
+}
+
 /// \brief Create a binary operation that may resolve to an overloaded
 /// operator.
 ///
@@ -11101,6 +11352,33 @@ Sema::CreateOverloadedBinOp(SourceLocation OpLoc,
   if (Opc == BO_PtrMemD)
     return CreateBuiltinBinOp(OpLoc, Opc, Args[0], Args[1]);
 
+  // If an earlier operator had the same candidate functions and operand
+  // types, reuse the result of overload resolution for it. The member
+  // candidates are determined by the (complete) type of the left operand, so
+  // only the non-member candidates are part of the key.
+  ADLResult ADLFns;
+  SmallString<128> CacheKey;
+  bool UseCache = isOverloadResolutionCacheable(*this, Args);
+  if (UseCache) {
+    SmallVector<NamedDecl *, 16> Found(Fns.begin(), Fns.end());
+    if (Opc != BO_Assign) {
+      ArgumentDependentLookup(OpName, OpLoc, Args, ADLFns);
+      Found.append(ADLFns.begin(), ADLFns.end());
+    }
+    computeOverloadCacheKey(/*Kind=*/1 + Opc, Found, Args, CacheKey);
+
+    llvm::StringMap<CachedOverloadResolution>::iterator Known
+      = OverloadResolutionCache.find(CacheKey);
+    if (Known != OverloadResolutionCache.end()) {
+      ++NumOverloadCacheHits;
+      return BuildResolvedOverloadedBinOp(OpLoc, Op, Known->second.Function,
+                                          Known->second.FoundDecl,
+                                          Known->second.HadMultipleCandidates,
+                                          Args[0], Args[1]);
+    }
+    ++NumOverloadCacheMisses;
+  }
+
   // Build an empty overload set.
   OverloadCandidateSet CandidateSet(OpLoc, OverloadCandidateSet::CSK_Operator);
 
@@ -11113,10 +11391,16 @@ Sema::CreateOverloadedBinOp(SourceLocation OpLoc,
   // Add candidates from ADL. Per [over.match.oper]p2, this lookup is not
   // performed for an assignment operator (nor for operator[] nor operator->,
   // which don't get here).
-  if (Opc != BO_Assign)
-    AddArgumentDependentLookupCandidates(OpName, OpLoc, Args,
-                                         /*ExplicitTemplateArgs*/ nullptr,
-                                         CandidateSet);
+  if (Opc != BO_Assign) {
+    if (UseCache)
+      AddArgumentDependentLookupCandidates(ADLFns, Args,
+                                           /*ExplicitTemplateArgs*/ nullptr,
+                                           CandidateSet);
+    else
+      AddArgumentDependentLookupCandidates(OpName, OpLoc, Args,
+                                           /*ExplicitTemplateArgs*/ nullptr,
+                                           CandidateSet);
+  }
 
   // Add builtin operator candidates.
   AddBuiltinOperatorCandidates(Op, OpLoc, Args, CandidateSet);
@@ -11133,81 +11417,11 @@ Sema::CreateOverloadedBinOp(SourceLocation OpLoc,
       if (FnDecl) {
         // We matched an overloaded operator. Build a call to that
         // operator.
-
-        // Convert the arguments.
-        if (CXXMethodDecl *Method = dyn_cast<CXXMethodDecl>(FnDecl)) {
-          // Best->Access is only meaningful for class members.
-          CheckMemberOperatorAccess(OpLoc, Args[0], Args[1], Best->FoundDecl);
-
-          ExprResult Arg1 =
-            PerformCopyInitialization(
-              InitializedEntity::InitializeParameter(Context,
-                                                     FnDecl->getParamDecl(0)),
-              SourceLocation(), Args[1]);
-          if (Arg1.isInvalid())
-            return ExprError();
-
-          ExprResult Arg0 =
-            PerformObjectArgumentInitialization(Args[0], /*Qualifier=*/nullptr,
-                                                Best->FoundDecl, Method);
-          if (Arg0.isInvalid())
-            return ExprError();
-          Args[0] = Arg0.getAs<Expr>();
-          Args[1] = RHS = Arg1.getAs<Expr>();
-        } else {
-          // Convert the arguments.
-          ExprResult Arg0 = PerformCopyInitialization(
-            InitializedEntity::InitializeParameter(Context,
-                                                   FnDecl->getParamDecl(0)),
-            SourceLocation(), Args[0]);
-          if (Arg0.isInvalid())
-            return ExprError();
-
-          ExprResult Arg1 =
-            PerformCopyInitialization(
-              InitializedEntity::InitializeParameter(Context,
-                                                     FnDecl->getParamDecl(1)),
-              SourceLocation(), Args[1]);
-          if (Arg1.isInvalid())
-            return ExprError();
-          Args[0] = LHS = Arg0.getAs<Expr>();
-          Args[1] = RHS = Arg1.getAs<Expr>();
-        }
-
-        // Build the actual expression node.
-        ExprResult FnExpr = CreateFunctionRefExpr(*this, FnDecl,
-                                                  Best->FoundDecl,
-                                                  HadMultipleCandidates, OpLoc);
-        if (FnExpr.isInvalid())
-          return ExprError();
-
-        // Determine the result type.
-        QualType ResultTy = FnDecl->getReturnType();
-        ExprValueKind VK = Expr::getValueKindForType(ResultTy);
-        ResultTy = ResultTy.getNonLValueExprType(Context);
-
-        CXXOperatorCallExpr *TheCall =
-          new (Context) CXXOperatorCallExpr(Context, Op, FnExpr.get(),
-                                            Args, ResultTy, VK, OpLoc,
-                                            FPFeatures.fp_contract);
-
-        if (CheckCallReturnType(FnDecl->getReturnType(), OpLoc, TheCall,
-                                FnDecl))
-          return ExprError();
-
-        ArrayRef<const Expr *> ArgsArray(Args, 2);
-        // Cut off the implicit 'this'.
-        if (isa<CXXMethodDecl>(FnDecl))
-          ArgsArray = ArgsArray.slice(1);
-
-        // Check for a self move.
-        if (Op == OO_Equal)
-          DiagnoseSelfMove(Args[0], Args[1], OpLoc);
-
-        checkCall(FnDecl, ArgsArray, 0, isa<CXXMethodDecl>(FnDecl), OpLoc,
-                  TheCall->getSourceRange(), VariadicDoesNotApply);
-
-        return MaybeBindToTemporary(TheCall);
+        if (UseCache)
+          cacheOverloadResolution(*this, CacheKey, CandidateSet, Best);
+        return BuildResolvedOverloadedBinOp(OpLoc, Op, FnDecl, Best->FoundDecl,
+                                            HadMultipleCandidates, Args[0],
+                                            Args[1]);
       } else {
         // We matched a built-in operator. Convert the arguments, then
         // break out so that we will build the appropriate built-in
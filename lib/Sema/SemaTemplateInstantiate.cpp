@@ -23,6 +23,7 @@
 #include "clang/Sema/Lookup.h"
 #include "clang/Sema/Template.h"
 #include "clang/Sema/TemplateDeduction.h"
+#include "clang/Sema/TemplateInstantiationProfiler.h"
 
 using namespace clang;
 using namespace sema;
@@ -200,6 +201,92 @@ bool Sema::ActiveTemplateInstantiation::isInstantiationRecord() const {
   llvm_unreachable("Invalid InstantiationKind!");
 }
 
+/// \brief Retrieve the declaration under which the instantiation or
+/// evaluation of \p D is profiled: the template it was instantiated from,
+/// if any.
+static const NamedDecl *getProfiledTemplate(const Decl *D) {
+  if (const ParmVarDecl *Param = dyn_cast<ParmVarDecl>(D))
+    if (const FunctionDecl *Owner
+          = dyn_cast<FunctionDecl>(Param->getDeclContext()))
+      D = Owner;
+
+  if (const ClassTemplateSpecializationDecl *Spec
+        = dyn_cast<ClassTemplateSpecializationDecl>(D))
+    return Spec->getSpecializedTemplate();
+  if (const CXXRecordDecl *Record = dyn_cast<CXXRecordDecl>(D)) {
+    if (const CXXRecordDecl *Pattern = Record->getInstantiatedFromMemberClass())
+      return Pattern;
+  } else if (const FunctionDecl *Function = dyn_cast<FunctionDecl>(D)) {
+    if (const FunctionTemplateDecl *Primary = Function->getPrimaryTemplate())
+      return Primary;
+    if (const FunctionDecl *Pattern
+          = Function->getInstantiatedFromMemberFunction())
+      return Pattern;
+  } else if (const VarTemplateSpecializationDecl *Spec
+               = dyn_cast<VarTemplateSpecializationDecl>(D)) {
+    return Spec->getSpecializedTemplate();
+  } else if (const VarDecl *Var = dyn_cast<VarDecl>(D)) {
+    if (const VarDecl *Pattern = Var->getInstantiatedFromStaticDataMember())
+      return Pattern;
+  } else if (const EnumDecl *Enum = dyn_cast<EnumDecl>(D)) {
+    if (const EnumDecl *Pattern = Enum->getInstantiatedFromMemberEnum())
+      return Pattern;
+  }
+  return dyn_cast<NamedDecl>(D);
+}
+
+/// \brief Tell the profiler that Sema started the given instantiation.
+static void startProfiling(Sema &SemaRef,
+                           const Sema::ActiveTemplateInstantiation &Inst) {
+  typedef Sema::ActiveTemplateInstantiation ATI;
+  TemplateInstantiationProfiler::EventKind Kind;
+  switch (Inst.Kind) {
+  case ATI::TemplateInstantiation:
+    if (isa<FunctionDecl>(Inst.Entity))
+      Kind = TemplateInstantiationProfiler::EK_FunctionInstantiation;
+    else if (isa<VarDecl>(Inst.Entity))
+      Kind = TemplateInstantiationProfiler::EK_VariableInstantiation;
+    else
+      Kind = TemplateInstantiationProfiler::EK_ClassInstantiation;
+    break;
+  case ATI::DefaultTemplateArgumentInstantiation:
+  case ATI::DefaultFunctionArgumentInstantiation:
+    Kind = TemplateInstantiationProfiler::EK_DefaultArgument;
+    break;
+  case ATI::ExceptionSpecInstantiation:
+    Kind = TemplateInstantiationProfiler::EK_ExceptionSpec;
+    break;
+  case ATI::ExplicitTemplateArgumentSubstitution:
+  case ATI::DeducedTemplateArgumentSubstitution:
+  case ATI::PriorTemplateArgumentSubstitution:
+  case ATI::DefaultTemplateArgumentChecking:
+    Kind = TemplateInstantiationProfiler::EK_Substitution;
+    break;
+  }
+
+  // Specializations name themselves with their template arguments; for the
+  // other entries, print the template arguments that are being used.
+  const Decl *Entity = Inst.Template ? Inst.Template : Inst.Entity;
+  if (const ParmVarDecl *Param = dyn_cast<ParmVarDecl>(Entity))
+    Entity = Decl::castFromDeclContext(Param->getDeclContext());
+  const NamedDecl *Template = getProfiledTemplate(Entity);
+
+  std::string Name;
+  llvm::raw_string_ostream OS(Name);
+  if (const NamedDecl *ND = dyn_cast<NamedDecl>(Entity))
+    ND->getNameForDiagnostic(OS, SemaRef.getPrintingPolicy(),
+                             /*Qualified=*/true);
+  if (Inst.Kind != ATI::TemplateInstantiation && Inst.NumTemplateArgs)
+    TemplateSpecializationType::PrintTemplateArgumentList(
+        OS, Inst.TemplateArgs, Inst.NumTemplateArgs,
+        SemaRef.getPrintingPolicy());
+  OS.flush();
+
+  SemaRef.InstantiationProfiler->startEvent(
+      Kind, Name, Template ? Template->getQualifiedNameAsString() : Name,
+      SemaRef.Context.getASTAllocatedMemory());
+}
+
 void Sema::InstantiatingTemplate::Initialize(
     ActiveTemplateInstantiation::InstantiationKind Kind,
     SourceLocation PointOfInstantiation, SourceRange InstantiationRange,
@@ -208,6 +295,7 @@ void Sema::InstantiatingTemplate::Initialize(
   SavedInNonInstantiationSFINAEContext =
       SemaRef.InNonInstantiationSFINAEContext;
   Invalid = CheckInstantiationDepth(PointOfInstantiation, InstantiationRange);
+  Profiled = false;
   if (!Invalid) {
     ActiveTemplateInstantiation Inst;
     Inst.Kind = Kind;
@@ -222,6 +310,10 @@ void Sema::InstantiatingTemplate::Initialize(
     SemaRef.ActiveTemplateInstantiations.push_back(Inst);
     if (!Inst.isInstantiationRecord())
       ++SemaRef.NonInstantiationEntries;
+    if (SemaRef.InstantiationProfiler) {
+      startProfiling(SemaRef, Inst);
+      Profiled = true;
+    }
   }
 }
 
@@ -365,10 +457,58 @@ void Sema::InstantiatingTemplate::Clear() {
     }
 
     SemaRef.ActiveTemplateInstantiations.pop_back();
+    if (Profiled) {
+      SemaRef.InstantiationProfiler->finishEvent(
+          SemaRef.Context.getASTAllocatedMemory());
+      Profiled = false;
+    }
     Invalid = true;
   }
 }
 
+Sema::ProfileConstantEvaluationRAII::ProfileConstantEvaluationRAII(
+    Sema &SemaRef, const Expr *E, const VarDecl *Var)
+  : SemaRef(SemaRef), Profiled(SemaRef.InstantiationProfiler != nullptr) {
+  if (!Profiled)
+    return;
+
+  // Evaluations are profiled under the constexpr function or constructor
+  // they call.
+  const FunctionDecl *Callee = nullptr;
+  E = E->IgnoreParenImpCasts();
+  if (const CallExpr *Call = dyn_cast<CallExpr>(E))
+    Callee = Call->getDirectCallee();
+  else if (const CXXConstructExpr *Construct = dyn_cast<CXXConstructExpr>(E))
+    Callee = Construct->getConstructor();
+
+  std::string Name, Template;
+  llvm::raw_string_ostream OS(Name);
+  if (Var)
+    Var->getNameForDiagnostic(OS, SemaRef.getPrintingPolicy(),
+                              /*Qualified=*/true);
+  else if (Callee)
+    Callee->getNameForDiagnostic(OS, SemaRef.getPrintingPolicy(),
+                                 /*Qualified=*/true);
+  OS.flush();
+
+  if (Callee)
+    Template = getProfiledTemplate(Callee)->getQualifiedNameAsString();
+  else
+    Template = "<constant expression>";
+  if (Name.empty())
+    Name = Template;
+
+  SemaRef.InstantiationProfiler->startEvent(
+      TemplateInstantiationProfiler::EK_ConstantEvaluation, Name, Template,
+      SemaRef.Context.getASTAllocatedMemory());
+}
+
+Sema::ProfileConstantEvaluationRAII::~ProfileConstantEvaluationRAII() {
+  if (Profiled)
+    SemaRef.InstantiationProfiler->finishEvent(
+        SemaRef.Context.getASTAllocatedMemory());
+}
+
 bool Sema::InstantiatingTemplate::CheckInstantiationDepth(
                                         SourceLocation PointOfInstantiation,
                                            SourceRange InstantiationRange) {
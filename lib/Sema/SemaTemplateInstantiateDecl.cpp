@@ -4577,6 +4577,22 @@ NamedDecl *Sema::FindInstantiatedDecl(SourceLocation Loc, NamedDecl *D,
   return D;
 }
 
+/// \brief Determine whether the pending implicit instantiation of \p D can be
+/// performed while building a precompiled header, rather than being left to
+/// the translation units that include it.
+static bool canInstantiateInPrefix(ValueDecl *D) {
+  // Static data members and variable templates are cheap to instantiate;
+  // leave them to the including translation units.
+  FunctionDecl *Function = dyn_cast<FunctionDecl>(D);
+  if (!Function)
+    return false;
+
+  // The template may only be defined by the translation units that include
+  // the precompiled header.
+  const FunctionDecl *Pattern = Function->getTemplateInstantiationPattern();
+  return Pattern && Pattern->isDefined();
+}
+
 /// \brief Performs template instantiation for all implicit template
 /// instantiations we have seen until this point.
 void Sema::PerformPendingInstantiations(bool LocalOnly) {
@@ -4592,6 +4608,12 @@ void Sema::PerformPendingInstantiations(bool LocalOnly) {
       PendingLocalImplicitInstantiations.pop_front();
     }
 
+    if (TUKind == TU_Prefix && LangOpts.PCHInstantiateTemplates &&
+        !canInstantiateInPrefix(Inst.first)) {
+      DeferredPrefixInstantiations.push_back(Inst);
+      continue;
+    }
+
     // Instantiate function definitions
     if (FunctionDecl *Function = dyn_cast<FunctionDecl>(Inst.first)) {
       PrettyDeclStackTraceEntry CrashInfo(*this, Function, SourceLocation(),
@@ -4600,6 +4622,8 @@ void Sema::PerformPendingInstantiations(bool LocalOnly) {
                                 TSK_ExplicitInstantiationDefinition;
       InstantiateFunctionDefinition(/*FIXME:*/Inst.second, Function, true,
                                     DefinitionRequired);
+      if (TUKind == TU_Prefix && Function->isDefined())
+        ++NumPrefixInstantiations;
       continue;
     }
 
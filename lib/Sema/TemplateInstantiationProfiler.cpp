@@ -0,0 +1,182 @@
+//===--- TemplateInstantiationProfiler.cpp - Instantiation profiling ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the TemplateInstantiationProfiler class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Sema/TemplateInstantiationProfiler.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace clang;
+
+static double getCurrentWallTime() {
+  return llvm::TimeRecord::getCurrentTime().getWallTime();
+}
+
+TemplateInstantiationProfiler::TemplateInstantiationProfiler()
+  : StartTime(getCurrentWallTime()) { }
+
+void TemplateInstantiationProfiler::startEvent(EventKind Kind, StringRef Name,
+                                               StringRef Template,
+                                               uint64_t ASTMemory) {
+  std::pair<llvm::StringMap<unsigned>::iterator, bool> Known
+    = TemplateIDs.insert(std::make_pair(Template, Templates.size()));
+  if (Known.second) {
+    TemplateStats Stats = { Template.str(), 0, 0.0, 0.0, 0, 0 };
+    Templates.push_back(Stats);
+  }
+  unsigned TemplateID = Known.first->second;
+  ++Templates[TemplateID].ActiveCount;
+
+  Event E = { Kind, Name.str(), TemplateID, 0.0, -1.0, 0 };
+  ActiveEvent Active = { static_cast<unsigned>(Events.size()),
+                         getCurrentWallTime(), ASTMemory, 0.0 };
+  Events.push_back(E);
+  ActiveEvents.push_back(Active);
+}
+
+void TemplateInstantiationProfiler::finishEvent(uint64_t ASTMemory) {
+  assert(!ActiveEvents.empty() && "No event to finish");
+  ActiveEvent Active = ActiveEvents.pop_back_val();
+  double Duration = getCurrentWallTime() - Active.Start;
+
+  Event &E = Events[Active.Event];
+  E.Start = Active.Start - StartTime;
+  E.Duration = Duration;
+  E.Memory = ASTMemory >= Active.StartMemory ? ASTMemory - Active.StartMemory
+                                             : 0;
+
+  TemplateStats &Stats = Templates[E.Template];
+  ++Stats.Count;
+  Stats.SelfTime += Duration - Active.NestedTime;
+  // Recursive instantiations of a template are already part of the
+  // outermost one.
+  if (--Stats.ActiveCount == 0) {
+    Stats.Time += Duration;
+    Stats.Memory += E.Memory;
+  }
+
+  if (!ActiveEvents.empty())
+    ActiveEvents.back().NestedTime += Duration;
+}
+
+static const char *
+getEventKindName(TemplateInstantiationProfiler::EventKind K) {
+  switch (K) {
+  case TemplateInstantiationProfiler::EK_ClassInstantiation:
+    return "class";
+  case TemplateInstantiationProfiler::EK_FunctionInstantiation:
+    return "function";
+  case TemplateInstantiationProfiler::EK_VariableInstantiation:
+    return "variable";
+  case TemplateInstantiationProfiler::EK_DefaultArgument:
+    return "default argument";
+  case TemplateInstantiationProfiler::EK_ExceptionSpec:
+    return "exception specification";
+  case TemplateInstantiationProfiler::EK_Substitution:
+    return "substitution";
+  case TemplateInstantiationProfiler::EK_ConstantEvaluation:
+    return "constant evaluation";
+  }
+  llvm_unreachable("Invalid EventKind!");
+}
+
+/// \brief Write \p Str as a JSON string literal.
+static void writeJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (unsigned I = 0, N = Str.size(); I != N; ++I) {
+    unsigned char C = Str[I];
+    switch (C) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if (C < 0x20)
+        OS << llvm::format("\\u%04x", C);
+      else
+        OS << C;
+      break;
+    }
+  }
+  OS << '"';
+}
+
+void TemplateInstantiationProfiler::writeTrace(raw_ostream &OS) const {
+  OS << "{\"traceEvents\":[";
+  bool First = true;
+  for (unsigned I = 0, N = Events.size(); I != N; ++I) {
+    const Event &E = Events[I];
+    if (E.Duration < 0.0)
+      continue;
+
+    OS << (First ? "\n" : ",\n");
+    First = false;
+    OS << "{\"name\":";
+    writeJSONString(OS, E.Name);
+    OS << ",\"cat\":";
+    writeJSONString(OS, getEventKindName(E.Kind));
+    OS << ",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+       << ",\"ts\":" << llvm::format("%.3f", E.Start * 1e6)
+       << ",\"dur\":" << llvm::format("%.3f", E.Duration * 1e6)
+       << ",\"args\":{\"template\":";
+    writeJSONString(OS, Templates[E.Template].Name);
+    OS << ",\"ast_bytes\":" << E.Memory << "}}";
+  }
+  OS << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+namespace {
+/// \brief Orders templates by decreasing time.
+struct TemplateTimeGreater {
+  const std::vector<double> &Times;
+  explicit TemplateTimeGreater(const std::vector<double> &Times)
+    : Times(Times) { }
+  bool operator()(unsigned X, unsigned Y) const {
+    return Times[X] > Times[Y];
+  }
+};
+}
+
+void TemplateInstantiationProfiler::printSummary(raw_ostream &OS,
+                                                 unsigned Limit) const {
+  std::vector<double> Times;
+  std::vector<unsigned> Order;
+  double TotalTime = 0.0;
+  for (unsigned I = 0, N = Templates.size(); I != N; ++I) {
+    Times.push_back(Templates[I].Time);
+    Order.push_back(I);
+    TotalTime += Templates[I].SelfTime;
+  }
+  std::stable_sort(Order.begin(), Order.end(), TemplateTimeGreater(Times));
+  if (Limit && Order.size() > Limit)
+    Order.resize(Limit);
+
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                      Template instantiation summary\n"
+     << "===" << std::string(73, '-') << "===\n"
+     << "  Total time in profiled events: "
+     << llvm::format("%.4f", TotalTime) << " seconds ("
+     << Events.size() << " events, " << Templates.size() << " templates)\n\n"
+     << "   ---Total---   ---Self---    Count    AST bytes  Template\n";
+  for (unsigned I = 0, N = Order.size(); I != N; ++I) {
+    const TemplateStats &Stats = Templates[Order[I]];
+    OS << llvm::format("  %9.4f    %9.4f  %9u  %11llu  ", Stats.Time,
+                       Stats.SelfTime, Stats.Count,
+                       (unsigned long long)Stats.Memory)
+       << Stats.Name << '\n';
+  }
+  OS << '\n';
+}
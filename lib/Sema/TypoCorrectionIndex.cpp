@@ -0,0 +1,81 @@
+//===--- TypoCorrectionIndex.cpp - Index of names for typo correction -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the TypoCorrectionIndex class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Sema/TypoCorrectionIndex.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+void TypoCorrectionIndex::insert(StringRef Name) {
+  std::pair<llvm::StringMap<unsigned>::iterator, bool> Known
+    = NodeIDs.insert(std::make_pair(Name, (unsigned)Nodes.size()));
+  if (!Known.second)
+    return;
+
+  // Use the copy of the name owned by the map.
+  Name = Known.first->getKey();
+  unsigned ID = Nodes.size();
+  if (ID != 0) {
+    // Walk down from the root to the node which has no child at the distance
+    // between its name and the new one.
+    unsigned Parent = 0;
+    while (true) {
+      ++NumInsertComparisons;
+      unsigned Distance = Name.edit_distance(Nodes[Parent].Name, true);
+      Node &P = Nodes[Parent];
+      unsigned I = 0, N = P.Children.size();
+      while (I != N && P.Children[I].first != Distance)
+        ++I;
+      if (I == N) {
+        P.Children.push_back(std::make_pair(Distance, ID));
+        break;
+      }
+      Parent = P.Children[I].second;
+    }
+  }
+  Nodes.push_back(Node(Name));
+}
+
+void TypoCorrectionIndex::search(StringRef Typo, unsigned MaxDistance,
+                                 SmallVectorImpl<StringRef> &Results) {
+  ++NumQueries;
+  if (Nodes.empty())
+    return;
+
+  SmallVector<unsigned, 32> Worklist;
+  Worklist.push_back(0);
+  do {
+    const Node &N = Nodes[Worklist.pop_back_val()];
+    ++NumComparisons;
+    unsigned Distance = Typo.edit_distance(N.Name, true);
+    if (Distance <= MaxDistance)
+      Results.push_back(N.Name);
+
+    // By the triangle inequality, a name within MaxDistance of the typo is at
+    // a distance in [Distance - MaxDistance, Distance + MaxDistance] from
+    // this node's name.
+    unsigned Low = Distance > MaxDistance ? Distance - MaxDistance : 0;
+    unsigned High = Distance + MaxDistance;
+    for (unsigned I = 0, E = N.Children.size(); I != E; ++I)
+      if (N.Children[I].first >= Low && N.Children[I].first <= High)
+        Worklist.push_back(N.Children[I].second);
+  } while (!Worklist.empty());
+}
+
+void TypoCorrectionIndex::PrintStats() const {
+  llvm::errs() << "\n*** Typo Correction Index Stats:\n";
+  llvm::errs() << "  " << Nodes.size() << " names indexed, computing "
+               << NumInsertComparisons << " edit distances.\n";
+  llvm::errs() << "  " << NumQueries << " searches, computing "
+               << NumComparisons << " edit distances.\n";
+}
@@ -42,10 +42,12 @@
 #include "clang/Serialization/ASTDeserializationListener.h"
 #include "clang/Serialization/GlobalModuleIndex.h"
 #include "clang/Serialization/ModuleManager.h"
+#include "clang/Serialization/ModuleValidationCache.h"
 #include "clang/Serialization/SerializationDiagnostic.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -1182,6 +1184,48 @@ bool ASTReader::ReadSLocEntry(int ID) {
   
   RecordData Record;
   StringRef Blob;
+
+  // Read the blob record that follows a buffer entry, decompressing its
+  // contents if the writer compressed them or loading them from the shared
+  // buffer store if the writer moved them there.
+  auto ReadBuffer = [&](StringRef Name) -> std::unique_ptr<llvm::MemoryBuffer> {
+    unsigned Code = SLocEntryCursor.ReadCode();
+    Record.clear();
+    unsigned RecCode = SLocEntryCursor.readRecord(Code, Record, &Blob);
+
+    if (RecCode == SM_SLOC_BUFFER_BLOB_COMPRESSED) {
+      SmallString<0> Uncompressed;
+      if (!llvm::zlib::isAvailable() ||
+          llvm::zlib::uncompress(Blob, Uncompressed, Record[0]) !=
+              llvm::zlib::StatusOK) {
+        Error("could not decompress embedded file contents");
+        return nullptr;
+      }
+      ++NumSLocBlobsDecompressed;
+      return llvm::MemoryBuffer::getMemBufferCopy(Uncompressed, Name);
+    }
+
+    if (RecCode == SM_SLOC_BUFFER_BLOB_REF) {
+      llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> StoredOrErr =
+          llvm::MemoryBuffer::getFile(Blob);
+      if (!StoredOrErr || (*StoredOrErr)->getBufferSize() != Record[0]) {
+        Error(("embedded file contents missing from the shared buffer store: " +
+               Blob).str());
+        return nullptr;
+      }
+      ++NumSLocBlobsLoadedFromStore;
+      return llvm::MemoryBuffer::getMemBufferCopy((*StoredOrErr)->getBuffer(),
+                                                  Name);
+    }
+
+    if (RecCode != SM_SLOC_BUFFER_BLOB) {
+      Error("AST record has invalid code");
+      return nullptr;
+    }
+
+    return llvm::MemoryBuffer::getMemBuffer(Blob.drop_back(1), Name);
+  };
+
   switch (SLocEntryCursor.readRecord(Entry.ID, Record, &Blob)) {
   default:
     Error("incorrectly-formatted source location entry in AST file");
@@ -1202,6 +1246,15 @@ bool ASTReader::ReadSLocEntry(int ID) {
       return true;
 
     SourceLocation IncludeLoc = ReadSourceLocation(*F, Record[1]);
+    if (IncludeLoc.isInvalid() && F->Kind == MK_Preamble &&
+        SourceMgr.getMainFileID().isValid()) {
+      // A precompiled preamble can be shared by all main files that start
+      // with it, so the file it was built from stands for the main file we
+      // are parsing now.
+      if (const FileEntry *MainFile =
+              SourceMgr.getFileEntryForID(SourceMgr.getMainFileID()))
+        File = MainFile;
+    }
     if (IncludeLoc.isInvalid() && F->Kind != MK_MainFile) {
       // This is the module's main file.
       IncludeLoc = getImportLocation(F);
@@ -1229,17 +1282,9 @@ bool ASTReader::ReadSLocEntry(int ID) {
                               /*isSystemFile=*/FileCharacter != SrcMgr::C_User);
     if (OverriddenBuffer && !ContentCache->BufferOverridden &&
         ContentCache->ContentsEntry == ContentCache->OrigEntry) {
-      unsigned Code = SLocEntryCursor.ReadCode();
-      Record.clear();
-      unsigned RecCode = SLocEntryCursor.readRecord(Code, Record, &Blob);
-      
-      if (RecCode != SM_SLOC_BUFFER_BLOB) {
-        Error("AST record has invalid code");
+      std::unique_ptr<llvm::MemoryBuffer> Buffer = ReadBuffer(File->getName());
+      if (!Buffer)
         return true;
-      }
-      
-      std::unique_ptr<llvm::MemoryBuffer> Buffer
-        = llvm::MemoryBuffer::getMemBuffer(Blob.drop_back(1), File->getName());
       SourceMgr.overrideFileContents(File, std::move(Buffer));
     }
 
@@ -1256,18 +1301,9 @@ bool ASTReader::ReadSLocEntry(int ID) {
         (F->Kind == MK_ImplicitModule || F->Kind == MK_ExplicitModule)) {
       IncludeLoc = getImportLocation(F);
     }
-    unsigned Code = SLocEntryCursor.ReadCode();
-    Record.clear();
-    unsigned RecCode
-      = SLocEntryCursor.readRecord(Code, Record, &Blob);
-
-    if (RecCode != SM_SLOC_BUFFER_BLOB) {
-      Error("AST record has invalid code");
+    std::unique_ptr<llvm::MemoryBuffer> Buffer = ReadBuffer(Name);
+    if (!Buffer)
       return true;
-    }
-
-    std::unique_ptr<llvm::MemoryBuffer> Buffer =
-        llvm::MemoryBuffer::getMemBuffer(Blob.drop_back(1), Name);
     SourceMgr.createFileID(std::move(Buffer), FileCharacter, ID,
                            BaseOffset + Offset, IncludeLoc);
     break;
@@ -2293,15 +2329,24 @@ ASTReader::ReadControlBlock(ModuleFile &F,
 
       // All user input files reside at the index range [0, NumUserInputs), and
       // system input files reside at [NumUserInputs, NumInputs).
-      if (!DisableValidation) {
+      // If another compilation in this build session already validated all
+      // of this module's input files, there is nothing left to check.
+      ModuleValidationCache *VC =
+          F.Kind == MK_ImplicitModule ? getValidationCache() : nullptr;
+      if (VC && F.File &&
+          VC->isValidated(F.Signature, F.File->getSize(),
+                          F.File->getModificationTime())) {
+        ++NumModulesValidationSkipped;
+      } else if (!DisableValidation) {
         bool Complain = (ClientLoadCapabilities & ARR_OutOfDate) == 0;
 
         // If we are reading a module, we will create a verification timestamp,
         // so we verify all input files.  Otherwise, verify only user input
-        // files.
+        // files.  If we are going to record the module in the validation
+        // cache, verify all input files as well.
 
         unsigned N = NumUserInputs;
-        if (ValidateSystemInputs ||
+        if (ValidateSystemInputs || VC ||
             (HSOpts.ModulesValidateOncePerBuildSession &&
              F.InputFilesValidationTimestamp <= HSOpts.BuildSessionTimestamp &&
              F.Kind == MK_ImplicitModule))
@@ -2312,6 +2357,10 @@ ASTReader::ReadControlBlock(ModuleFile &F,
           if (!IF.getFile() || IF.isOutOfDate())
             return OutOfDate;
         }
+
+        if (VC && F.File)
+          VC->markValidated(F.Signature, F.File->getSize(),
+                            F.File->getModificationTime());
       }
 
       if (Listener)
@@ -3589,6 +3638,20 @@ bool ASTReader::isGlobalIndexUnavailable() const {
          !hasGlobalIndex() && TriedLoadingGlobalIndex;
 }
 
+ModuleValidationCache *ASTReader::getValidationCache() {
+  if (!TriedValidationCache) {
+    TriedValidationCache = true;
+    const HeaderSearch &HS = PP.getHeaderSearchInfo();
+    const HeaderSearchOptions &HSOpts = HS.getHeaderSearchOpts();
+    if (HSOpts.ModulesValidationCache && HSOpts.BuildSessionTimestamp &&
+        !HS.getModuleCachePath().empty())
+      ValidationCache.reset(new ModuleValidationCache(
+          ModuleValidationCache::getCachePath(HS.getModuleCachePath(),
+                                              HSOpts.BuildSessionTimestamp)));
+  }
+  return ValidationCache.get();
+}
+
 static void updateModuleTimestamp(ModuleFile &MF) {
   // Overwrite the timestamp file contents so that file's mtime changes.
   std::string TimestampFilename = MF.getTimestampFilename();
@@ -6788,6 +6851,15 @@ void ASTReader::PrintStats() {
     std::fprintf(stderr, "  %u/%u source location entries read (%f%%)\n",
                  NumSLocEntriesRead, TotalNumSLocEntries,
                  ((float)NumSLocEntriesRead/TotalNumSLocEntries * 100));
+  if (NumSLocBlobsDecompressed)
+    std::fprintf(stderr, "  %u compressed source buffers decompressed\n",
+                 NumSLocBlobsDecompressed);
+  if (NumModulesValidationSkipped)
+    std::fprintf(stderr, "  %u module files not revalidated in this session\n",
+                 NumModulesValidationSkipped);
+  if (NumSLocBlobsLoadedFromStore)
+    std::fprintf(stderr, "  %u source buffers loaded from the shared store\n",
+                 NumSLocBlobsLoadedFromStore);
   if (!TypesLoaded.empty())
     std::fprintf(stderr, "  %u/%u types read (%f%%)\n",
                  NumTypesLoaded, (unsigned)TypesLoaded.size(),
@@ -8546,14 +8618,17 @@ ASTReader::ASTReader(Preprocessor &PP, ASTContext &Context, StringRef isysroot,
       OwnsDeserializationListener(false), SourceMgr(PP.getSourceManager()),
       FileMgr(PP.getFileManager()), Diags(PP.getDiagnostics()),
       SemaObj(nullptr), PP(PP), Context(Context), Consumer(nullptr),
-      ModuleMgr(PP.getFileManager()), isysroot(isysroot),
+      ModuleMgr(PP.getFileManager()), TriedValidationCache(false),
+      isysroot(isysroot),
       DisableValidation(DisableValidation),
       AllowASTWithCompilerErrors(AllowASTWithCompilerErrors),
       AllowConfigurationMismatch(AllowConfigurationMismatch),
       ValidateSystemInputs(ValidateSystemInputs),
       UseGlobalIndex(UseGlobalIndex), TriedLoadingGlobalIndex(false),
       CurrSwitchCaseStmts(&SwitchCaseStmts),
-      NumSLocEntriesRead(0), TotalNumSLocEntries(0), NumStatementsRead(0),
+      NumSLocEntriesRead(0), NumSLocBlobsDecompressed(0),
+      NumSLocBlobsLoadedFromStore(0), NumModulesValidationSkipped(0),
+      TotalNumSLocEntries(0), NumStatementsRead(0),
       TotalNumStatements(0), NumMacrosRead(0), TotalNumMacros(0),
       NumIdentifierLookups(0), NumIdentifierLookupHits(0), NumSelectorsRead(0),
       NumMethodPoolEntriesRead(0), NumMethodPoolLookups(0),
@@ -46,12 +46,15 @@
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/OnDiskHashTable.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdio>
 #include <string.h>
@@ -937,6 +940,8 @@ void ASTWriter::WriteBlockInfoBlock() {
   RECORD(SM_SLOC_FILE_ENTRY);
   RECORD(SM_SLOC_BUFFER_ENTRY);
   RECORD(SM_SLOC_BUFFER_BLOB);
+  RECORD(SM_SLOC_BUFFER_BLOB_COMPRESSED);
+  RECORD(SM_SLOC_BUFFER_BLOB_REF);
   RECORD(SM_SLOC_EXPANSION_ENTRY);
 
   // Preprocessor Block.
@@ -1563,6 +1568,129 @@ static unsigned CreateSLocBufferBlobAbbrev(llvm::BitstreamWriter &Stream) {
   return Stream.EmitAbbrev(Abbrev);
 }
 
+/// \brief Create an abbreviation for the SLocEntry that refers to a
+/// buffer's compressed blob.
+static unsigned CreateSLocBufferBlobCompressedAbbrev(
+    llvm::BitstreamWriter &Stream) {
+  using namespace llvm;
+  BitCodeAbbrev *Abbrev = new BitCodeAbbrev();
+  Abbrev->Add(BitCodeAbbrevOp(SM_SLOC_BUFFER_BLOB_COMPRESSED));
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8)); // Uncompressed size
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob)); // Compressed blob
+  return Stream.EmitAbbrev(Abbrev);
+}
+
+/// \brief Create an abbreviation for the SLocEntry that refers to a
+/// buffer stored in the shared buffer store.
+static unsigned CreateSLocBufferBlobRefAbbrev(llvm::BitstreamWriter &Stream) {
+  using namespace llvm;
+  BitCodeAbbrev *Abbrev = new BitCodeAbbrev();
+  Abbrev->Add(BitCodeAbbrevOp(SM_SLOC_BUFFER_BLOB_REF));
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8)); // Size
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob)); // Stored path
+  return Stream.EmitAbbrev(Abbrev);
+}
+
+/// \brief Buffers smaller than this are never worth compressing.
+static const unsigned MinCompressedBlobSize = 1024;
+
+/// \brief Buffers smaller than this are never worth moving out of the AST
+/// file into the shared buffer store.
+static const unsigned MinStoredBlobSize = 1024;
+
+/// \brief Make sure the shared buffer store in \p StoreDir holds a file with
+/// \p Contents, named after the MD5 of those contents.
+///
+/// \returns true and sets \p StoredPath on success.
+static bool StoreSharedBuffer(StringRef StoreDir, StringRef Contents,
+                              SmallString<128> &StoredPath) {
+  llvm::MD5 Hash;
+  Hash.update(Contents);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> HashStr;
+  llvm::MD5::stringifyResult(Result, HashStr);
+
+  StoredPath = StoreDir;
+  llvm::sys::fs::make_absolute(StoredPath);
+  llvm::sys::path::append(StoredPath, HashStr.str());
+
+  // Files in the store are immutable, so an existing file is the one we want.
+  if (llvm::sys::fs::exists(StoredPath))
+    return true;
+
+  if (llvm::sys::fs::create_directories(StoreDir))
+    return false;
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // writers and readers never see a partially-written buffer.
+  SmallString<128> TmpPath;
+  int TmpFD;
+  if (llvm::sys::fs::createUniqueFile(StoredPath + "-%%%%%%%%", TmpFD,
+                                      TmpPath))
+    return false;
+
+  {
+    llvm::raw_fd_ostream Out(TmpFD, /*shouldClose=*/true);
+    Out << Contents;
+    Out.close();
+    if (Out.has_error()) {
+      Out.clear_error();
+      llvm::sys::fs::remove(TmpPath.str());
+      return false;
+    }
+  }
+
+  if (llvm::sys::fs::rename(TmpPath.str(), StoredPath.str())) {
+    llvm::sys::fs::remove(TmpPath.str());
+    // Someone else may have stored the same contents in the meantime.
+    return llvm::sys::fs::exists(StoredPath);
+  }
+  return true;
+}
+
+/// \brief Emit the blob holding the contents of \p Buffer.
+///
+/// If \p StoreDir is non-empty, the contents are moved out into the shared
+/// buffer store and only referenced from the AST file. Otherwise, they are
+/// compressed if \p Compress is set and doing so actually saves space.
+static void EmitSLocBufferBlob(llvm::BitstreamWriter &Stream,
+                               const llvm::MemoryBuffer *Buffer,
+                               unsigned BlobAbbrv,
+                               unsigned CompressedBlobAbbrv,
+                               unsigned BlobRefAbbrv,
+                               bool Compress, StringRef StoreDir) {
+  StringRef Contents(Buffer->getBufferStart(), Buffer->getBufferSize());
+  ASTWriter::RecordData Record;
+  SmallString<128> StoredPath;
+  if (!StoreDir.empty() && Contents.size() >= MinStoredBlobSize &&
+      StoreSharedBuffer(StoreDir, Contents, StoredPath)) {
+    Record.push_back(SM_SLOC_BUFFER_BLOB_REF);
+    Record.push_back(Contents.size());
+    Stream.EmitRecordWithBlob(BlobRefAbbrv, Record, StoredPath.str());
+    return;
+  }
+
+  if (Compress && Contents.size() >= MinCompressedBlobSize &&
+      llvm::zlib::isAvailable()) {
+    SmallString<0> CompressedBuffer;
+    if (llvm::zlib::compress(Contents, CompressedBuffer) ==
+            llvm::zlib::StatusOK &&
+        CompressedBuffer.size() < Contents.size()) {
+      Record.push_back(SM_SLOC_BUFFER_BLOB_COMPRESSED);
+      Record.push_back(Contents.size());
+      Stream.EmitRecordWithBlob(CompressedBlobAbbrv, Record, CompressedBuffer);
+      return;
+    }
+  }
+
+  // We add one to the size so that we capture the trailing NULL that is
+  // required by llvm::MemoryBuffer::getMemBuffer (on the reader side).
+  Record.push_back(SM_SLOC_BUFFER_BLOB);
+  Stream.EmitRecordWithBlob(BlobAbbrv, Record,
+                            StringRef(Contents.data(), Contents.size() + 1));
+}
+
 /// \brief Create an abbreviation for the SLocEntry that refers to a macro
 /// expansion.
 static unsigned CreateSLocExpansionAbbrev(llvm::BitstreamWriter &Stream) {
@@ -1782,7 +1910,14 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
   unsigned SLocFileAbbrv = CreateSLocFileAbbrev(Stream);
   unsigned SLocBufferAbbrv = CreateSLocBufferAbbrev(Stream);
   unsigned SLocBufferBlobAbbrv = CreateSLocBufferBlobAbbrev(Stream);
+  unsigned SLocBufferBlobCompressedAbbrv =
+      CreateSLocBufferBlobCompressedAbbrev(Stream);
+  unsigned SLocBufferBlobRefAbbrv = CreateSLocBufferBlobRefAbbrev(Stream);
   unsigned SLocExpansionAbbrv = CreateSLocExpansionAbbrev(Stream);
+  const HeaderSearchOptions &HSOpts =
+      PP.getHeaderSearchInfo().getHeaderSearchOpts();
+  bool CompressBlobs = HSOpts.ModulesCompressBlobs;
+  StringRef BufferStoreDir = HSOpts.ModuleBufferStorePath;
 
   // Write out the source location entry table. We skip the first
   // entry, which is always the same dummy entry.
@@ -1843,31 +1978,25 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
         Stream.EmitRecordWithAbbrev(SLocFileAbbrv, Record);
         
         if (Content->BufferOverridden) {
-          Record.clear();
-          Record.push_back(SM_SLOC_BUFFER_BLOB);
           const llvm::MemoryBuffer *Buffer
             = Content->getBuffer(PP.getDiagnostics(), PP.getSourceManager());
-          Stream.EmitRecordWithBlob(SLocBufferBlobAbbrv, Record,
-                                    StringRef(Buffer->getBufferStart(),
-                                              Buffer->getBufferSize() + 1));          
+          EmitSLocBufferBlob(Stream, Buffer, SLocBufferBlobAbbrv,
+                             SLocBufferBlobCompressedAbbrv,
+                             SLocBufferBlobRefAbbrv, CompressBlobs,
+                             BufferStoreDir);
         }
       } else {
         // The source location entry is a buffer. The blob associated
         // with this entry contains the contents of the buffer.
-
-        // We add one to the size so that we capture the trailing NULL
-        // that is required by llvm::MemoryBuffer::getMemBuffer (on
-        // the reader side).
         const llvm::MemoryBuffer *Buffer
           = Content->getBuffer(PP.getDiagnostics(), PP.getSourceManager());
         const char *Name = Buffer->getBufferIdentifier();
         Stream.EmitRecordWithBlob(SLocBufferAbbrv, Record,
                                   StringRef(Name, strlen(Name) + 1));
-        Record.clear();
-        Record.push_back(SM_SLOC_BUFFER_BLOB);
-        Stream.EmitRecordWithBlob(SLocBufferBlobAbbrv, Record,
-                                  StringRef(Buffer->getBufferStart(),
-                                                  Buffer->getBufferSize() + 1));
+        EmitSLocBufferBlob(Stream, Buffer, SLocBufferBlobAbbrv,
+                           SLocBufferBlobCompressedAbbrv,
+                           SLocBufferBlobRefAbbrv, CompressBlobs,
+                           BufferStoreDir);
 
         if (strcmp(Name, "<built-in>") == 0) {
           PreloadSLocs.push_back(SLocEntryOffsets.size());
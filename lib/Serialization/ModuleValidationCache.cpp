@@ -0,0 +1,100 @@
+//===--- ModuleValidationCache.cpp - Per-session validation cache ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ModuleValidationCache class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Serialization/ModuleValidationCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace clang;
+using namespace llvm::support;
+
+/// \brief The size of one entry in the cache file.
+static const unsigned EntrySize = 3 * sizeof(uint64_t);
+
+ModuleValidationCache::ModuleValidationCache(StringRef Path)
+  : Path(Path), Loaded(false) { }
+
+std::string
+ModuleValidationCache::getCachePath(StringRef ModuleCachePath,
+                                    uint64_t BuildSessionTimestamp) {
+  SmallString<128> Result(ModuleCachePath);
+  llvm::sys::path::append(Result, "session-" +
+                                      llvm::Twine(BuildSessionTimestamp) +
+                                      ".validated");
+  return Result.str();
+}
+
+void ModuleValidationCache::load() {
+  Loaded = true;
+
+  // Map the file rather than reading it; it is shared by every compiler
+  // invocation in the build session.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufferOrErr =
+      llvm::MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr)
+    return;
+
+  // Ignore a trailing partial entry from a concurrent writer.
+  const unsigned char *Data =
+      (const unsigned char *)(*BufferOrErr)->getBufferStart();
+  unsigned NumEntries = (*BufferOrErr)->getBufferSize() / EntrySize;
+  Entries.reserve(NumEntries);
+  for (unsigned I = 0; I != NumEntries; ++I) {
+    Entry E;
+    E.Signature = endian::readNext<uint64_t, little, unaligned>(Data);
+    E.Size = endian::readNext<uint64_t, little, unaligned>(Data);
+    E.ModTime = endian::readNext<uint64_t, little, unaligned>(Data);
+    Entries.push_back(E);
+  }
+  std::sort(Entries.begin(), Entries.end());
+}
+
+bool ModuleValidationCache::isValidated(
+    serialization::ASTFileSignature Signature, off_t Size, time_t ModTime) {
+  if (!Loaded)
+    load();
+
+  Entry Key = { Signature, uint64_t(Size), uint64_t(ModTime) };
+  return std::binary_search(Entries.begin(), Entries.end(), Key);
+}
+
+void ModuleValidationCache::markValidated(
+    serialization::ASTFileSignature Signature, off_t Size, time_t ModTime) {
+  if (isValidated(Signature, Size, ModTime))
+    return;
+
+  // Build the entry first so it reaches the file in a single append.
+  SmallString<EntrySize> Buffer;
+  {
+    llvm::raw_svector_ostream Out(Buffer);
+    endian::Writer<little> LE(Out);
+    LE.write<uint64_t>(Signature);
+    LE.write<uint64_t>(Size);
+    LE.write<uint64_t>(ModTime);
+  }
+
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_Append);
+  if (EC)
+    return;
+  OS << Buffer.str();
+
+  Entry E = { Signature, uint64_t(Size), uint64_t(ModTime) };
+  Entries.insert(std::upper_bound(Entries.begin(), Entries.end(), E), E);
+}
@@ -0,0 +1,10 @@
+struct Inner {
+  int value;
+};
+
+struct Outer {
+  struct Inner first;
+  struct Inner second;
+};
+
+struct Outer global1;
@@ -0,0 +1,17 @@
+// RUN: %clang_cc1 -emit-pch -o %t.1.ast %S/Inputs/stats1.c
+// RUN: %clang_cc1 -emit-pch -o %t.2.ast %S/Inputs/stats2.c
+// RUN: %clang_cc1 -ast-merge %t.1.ast -ast-merge %t.2.ast -fsyntax-only -print-stats %s 2>&1 | FileCheck %s
+
+// CHECK: STATISTICS FOR MERGING '{{.*}}.1.ast':
+// CHECK: load time:
+// CHECK: import time:
+// CHECK: AST memory added:
+// CHECK: *** AST Importer Statistics:
+// CHECK: {{[1-9][0-9]*}} declarations imported
+// CHECK: STATISTICS FOR MERGING '{{.*}}.2.ast':
+// CHECK: *** AST Importer Statistics:
+// CHECK: {{[1-9][0-9]*}} declaration pairs known to be equivalent
+// CHECK: {{[1-9][0-9]*}} equivalence checks answered from the cache
+
+struct Outer *use = &global1;
+struct Outer *use2 = &global2;
@@ -0,0 +1,6 @@
+static int alias_target(int x) { return x + 1; }
+int alias_of_target(int) __attribute__((alias("alias_target")));
+
+static int unused(int x) { return x - 1; }
+
+static __attribute__((used)) int used_attr(int x) { return x * 2; }
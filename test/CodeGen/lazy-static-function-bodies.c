@@ -0,0 +1,12 @@
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s -flazy-static-function-bodies | FileCheck %s
+
+// A static function which is only the target of an alias, or which has the
+// used attribute, still has its body parsed and emitted.
+#include "Inputs/lazy-static-function-bodies.h"
+
+// CHECK: @llvm.used = {{.*}} @used_attr
+// CHECK: @alias_of_target = alias {{.*}} @alias_target
+// CHECK: define internal i32 @alias_target(
+// CHECK-NOT: @unused(
+// CHECK: define internal i32 @used_attr(
+// CHECK-NOT: @unused(
@@ -33,6 +33,13 @@
 // RUN: %clang -fmodules-validate-system-headers -### %s 2>&1 | FileCheck -check-prefix=MODULES_VALIDATE_SYSTEM_HEADERS %s
 // MODULES_VALIDATE_SYSTEM_HEADERS: -fmodules-validate-system-headers
 
+// RUN: %clang -fbuild-session-timestamp=123 -fmodules-validation-cache -### %s 2>&1 | FileCheck -check-prefix=MODULES_VALIDATION_CACHE %s
+// MODULES_VALIDATION_CACHE: -fbuild-session-timestamp=123
+// MODULES_VALIDATION_CACHE: -fmodules-validation-cache
+
+// RUN: %clang -fmodules-validation-cache -### %s 2>&1 | FileCheck -check-prefix=MODULES_VALIDATION_CACHE_ERR %s
+// MODULES_VALIDATION_CACHE_ERR: option '-fmodules-validation-cache' requires '-fbuild-session-timestamp=<seconds since Epoch>' or '-fbuild-session-file=<file>'
+
 // RUN: %clang -fmodules -fmodule-map-file=foo.map -fmodule-map-file=bar.map -### %s 2>&1 | FileCheck -check-prefix=CHECK-MODULE-MAP-FILES %s
 // CHECK-MODULE-MAP-FILES: "-fmodules"
 // CHECK-MODULE-MAP-FILES: "-fmodule-map-file=foo.map"
@@ -0,0 +1,5 @@
+#define HIBERNATE_LIMIT 4
+
+struct Limit {
+  int max;
+};
@@ -0,0 +1,14 @@
+#define SCALE 3
+
+struct point { int x, y; };
+
+/* Adds up the coordinates of a point. */
+int sum(struct point p) {
+  return p.x + p.y;
+}
+
+int compute(int a) {
+  return a;
+}
+
+int twice(int a) { return compute(a) * 2; }
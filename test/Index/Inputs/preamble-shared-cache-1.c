@@ -0,0 +1,4 @@
+#include "preamble-shared-cache.h"
+#define SHARED_ORIGIN 0
+
+int first_user(struct shared_point p) { return p.x + SHARED_ORIGIN; }
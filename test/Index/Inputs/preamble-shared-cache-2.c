@@ -0,0 +1,4 @@
+#include "preamble-shared-cache.h"
+#define SHARED_ORIGIN 0
+
+int second_user(struct shared_point p) { return p.y - SHARED_ORIGIN; }
@@ -0,0 +1,2 @@
+struct shared_point { int x, y; };
+int shared_distance(struct shared_point a, struct shared_point b);
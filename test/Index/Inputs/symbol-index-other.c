@@ -0,0 +1,3 @@
+#include "symbol-index.h"
+
+int other_user(void) { return shared(2); }
@@ -0,0 +1,31 @@
+// Note: the run lines follow their respective tests, since line/column
+// matter in this test.
+int counter;
+int count_items(int);
+int Countdown;
+float compute(void);
+
+void test(void) {
+  int count_local = 0;
+  
+}
+
+// RUN: env CINDEXTEST_COMPLETION_PREFIX=cou c-index-test -code-completion-at=%s:10:3 %s | FileCheck -check-prefix=CHECK-PREFIX %s
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_COMPLETION_CACHING=1 CINDEXTEST_COMPLETION_PREFIX=cou c-index-test -code-completion-at=%s:10:3 %s | FileCheck -check-prefix=CHECK-PREFIX %s
+// CHECK-PREFIX-NOT: TypedText compute
+// CHECK-PREFIX-NOT: TypedText int
+// CHECK-PREFIX: FunctionDecl:{ResultType int}{TypedText count_items}{LeftParen (}{Placeholder int}{RightParen )}
+// CHECK-PREFIX: VarDecl:{ResultType int}{TypedText count_local}
+// CHECK-PREFIX: VarDecl:{ResultType int}{TypedText Countdown}
+// CHECK-PREFIX: VarDecl:{ResultType int}{TypedText counter}
+// CHECK-PREFIX-NOT: TypedText compute
+// CHECK-PREFIX: Completion contexts:
+
+// The best-ranked results come first: the local variable, then the globals
+// that match the case of the prefix, by name.
+// RUN: env CINDEXTEST_COMPLETION_PREFIX=cou CINDEXTEST_COMPLETION_MAX_RESULTS=2 c-index-test -code-completion-at=%s:10:3 %s | FileCheck -check-prefix=CHECK-TOP %s
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_COMPLETION_CACHING=1 CINDEXTEST_COMPLETION_PREFIX=cou CINDEXTEST_COMPLETION_MAX_RESULTS=2 c-index-test -code-completion-at=%s:10:3 %s | FileCheck -check-prefix=CHECK-TOP %s
+// CHECK-TOP: VarDecl:{ResultType int}{TypedText count_local}
+// CHECK-TOP-NEXT: FunctionDecl:{ResultType int}{TypedText count_items}
+// CHECK-TOP-NOT: TypedText counter
+// CHECK-TOP-NOT: TypedText Countdown
@@ -0,0 +1,18 @@
+struct S {
+  int x;
+};
+
+int f(struct S *s) {
+  return s->x;
+}
+
+// RUN: c-index-test -test-print-cursor-records %s | FileCheck %s
+// CHECK: [[S:[0-9]+]] StructDecl parent=-1 [cursor-records.c:1:1 - 3:2] "S" USR=c:@S@S
+// CHECK-NEXT: {{[0-9]+}} FieldDecl parent=[[S]] [cursor-records.c:2:3 - 2:8] "x" USR=c:@S@S@FI@x
+// CHECK-NEXT: [[F:[0-9]+]] FunctionDecl parent=-1 [cursor-records.c:5:1 - 7:2] "f" USR=c:@F@f
+// CHECK-NEXT: [[P:[0-9]+]] ParmDecl parent=[[F]] [cursor-records.c:5:7 - 5:18] "s" USR=c:{{.*}}
+// CHECK-NEXT: {{[0-9]+}} TypeRef parent=[[P]] [cursor-records.c:5:14 - 5:15] "struct S"{{$}}
+// CHECK-NEXT: [[C:[0-9]+]] CompoundStmt parent=[[F]] [cursor-records.c:5:20 - 7:2] ""{{$}}
+// CHECK-NEXT: [[R:[0-9]+]] ReturnStmt parent=[[C]] [cursor-records.c:6:3 - 6:14] ""{{$}}
+// CHECK-NEXT: {{[0-9]+}} MemberRefExpr parent=[[R]] [cursor-records.c:6:10 - 6:14] "x"{{$}}
+// CHECK: {{[0-9]+}} DeclRefExpr parent={{[0-9]+}} [cursor-records.c:6:10 - 6:11] "s"{{$}}
@@ -0,0 +1,39 @@
+#include "hibernate.h"
+
+struct Point {
+  int x, y;
+};
+
+int origin(struct Point *p) {
+  int unused;
+  return p->x + p->y;
+}
+
+// RUN: env CINDEXTEST_HIBERNATE=1 c-index-test -test-load-source local %s -I %S/Inputs -Wunused-variable > %t.out 2> %t.stderr.txt
+// RUN: FileCheck %s < %t.out
+// RUN: FileCheck -check-prefix CHECK-LOCAL %s < %t.out
+// RUN: FileCheck -check-prefix CHECK-DIAG %s < %t.stderr.txt
+// RUN: env CINDEXTEST_HIBERNATE=1 CINDEXTEST_EDITING=1 c-index-test -test-load-source local %s -I %S/Inputs -Wunused-variable 2> %t.stderr.txt | FileCheck %s
+// RUN: FileCheck -check-prefix CHECK-DIAG %s < %t.stderr.txt
+
+// The header is in the precompiled preamble, which is reused on waking, so
+// its preprocessed entities are not local.
+// RUN: env CINDEXTEST_HIBERNATE=1 CINDEXTEST_EDITING=1 c-index-test -test-load-source-reparse 1 local %s -I %S/Inputs -Wunused-variable > %t.out 2> %t.stderr.txt
+// RUN: FileCheck %s < %t.out
+// RUN: FileCheck -check-prefix CHECK-PREAMBLE %s < %t.out
+// RUN: FileCheck -check-prefix CHECK-DIAG %s < %t.stderr.txt
+
+// CHECK: hibernate.c:3:8: StructDecl=Point:3:8 (Definition) Extent=[3:1 - 5:2]
+// CHECK: hibernate.c:4:7: FieldDecl=x:4:7 (Definition) Extent=[4:3 - 4:8]
+// CHECK: hibernate.c:7:5: FunctionDecl=origin:7:5 (Definition) Extent=[7:1 - 10:2]
+// CHECK: hibernate.c:7:26: ParmDecl=p:7:26 (Definition) Extent=[7:12 - 7:27]
+// CHECK: hibernate.c:8:7: VarDecl=unused:8:7 (Definition) Extent=[8:3 - 8:13]
+// CHECK-DIAG: hibernate.c:8:7: warning: unused variable 'unused'
+
+// CHECK-LOCAL: hibernate.c:1:{{[0-9]+}}: inclusion directive=hibernate.h
+// CHECK-LOCAL: hibernate.h:1:9: macro definition=HIBERNATE_LIMIT Extent=[1:9 - 1:26]
+
+// CHECK-PREAMBLE-NOT: inclusion directive=hibernate.h
+// CHECK-PREAMBLE-NOT: macro definition=HIBERNATE_LIMIT
+// CHECK-PREAMBLE: hibernate.c:3:8: StructDecl=Point:3:8 (Definition)
+// CHECK-PREAMBLE-NOT: hibernate.h:{{[0-9]+}}:{{[0-9]+}}: macro definition
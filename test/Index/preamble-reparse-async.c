@@ -0,0 +1,10 @@
+// Building the preamble in the background must not change what reparses see.
+
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_ASYNC_PREAMBLE=1 c-index-test -test-load-source-reparse 5 local "-remap-file=%S/Inputs/preamble-reparse-1.c,%S/Inputs/preamble-reparse-2.c" %S/Inputs/preamble-reparse-1.c | FileCheck %s
+// CHECK: preamble-reparse-1.c:1:5: VarDecl=x:1:5 Extent=[1:1 - 1:6]
+
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_ASYNC_PREAMBLE=1 c-index-test -test-load-source-reparse 5 local %s -I %S/Inputs | FileCheck -check-prefix=CHECK-HEADER %s
+#include "preamble-shared-cache.h"
+int use(struct shared_point p) { return p.x; }
+// CHECK-HEADER: preamble-reparse-async.c:8:5: FunctionDecl=use:8:5 (Definition)
+// CHECK-HEADER: preamble-reparse-async.c:8:{{[0-9]+}}: MemberRefExpr=x:1:25
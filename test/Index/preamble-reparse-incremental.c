@@ -0,0 +1,22 @@
+// Once reparses keep changing the same function, the declarations before it
+// are precompiled along with the preamble. Cursors on both sides of the
+// change must not move.
+
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_INCREMENTAL_REPARSE=1 c-index-test -test-load-source-reparse 4 local -remap-file-0="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-1.c" -remap-file-1="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-2.c" -remap-file-2="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-3.c" -remap-file-3="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-3.c" %S/Inputs/preamble-reparse-incremental.c | FileCheck %s
+// CHECK: preamble-reparse-incremental.c:3:8: StructDecl=point:3:8 (Definition) Extent=[3:1 - 3:26]
+// CHECK: preamble-reparse-incremental.c:6:5: FunctionDecl=sum:6:5 (Definition) Extent=[6:1 - 8:2]
+// CHECK: preamble-reparse-incremental.c:7:{{[0-9]+}}: MemberRefExpr=x:3:20
+// CHECK: preamble-reparse-incremental.c:10:5: FunctionDecl=compute:10:5 (Definition) Extent=[10:1 - 12:2]
+// CHECK: preamble-reparse-incremental.c:11:{{[0-9]+}}: CallExpr=sum:6:5
+// CHECK: preamble-reparse-incremental.c:14:5: FunctionDecl=twice:14:5 (Definition)
+// CHECK: preamble-reparse-incremental.c:14:{{[0-9]+}}: CallExpr=compute:10:5
+
+// Without the option, the same edits give the same cursors.
+// RUN: env CINDEXTEST_EDITING=1 c-index-test -test-load-source-reparse 4 local -remap-file-0="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-1.c" -remap-file-1="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-2.c" -remap-file-2="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-3.c" -remap-file-3="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-3.c" %S/Inputs/preamble-reparse-incremental.c | FileCheck %s
+
+// The locations of the precompiled declarations are in the main file too.
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_INCREMENTAL_REPARSE=1 c-index-test -test-load-source-reparse-main-file 4 none -remap-file-0="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-1.c" -remap-file-1="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-2.c" -remap-file-2="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-3.c" -remap-file-3="%S/Inputs/preamble-reparse-incremental.c,%S/Inputs/preamble-reparse-incremental-3.c" %S/Inputs/preamble-reparse-incremental.c | FileCheck -check-prefix=CHECK-MAIN %s
+// CHECK-MAIN: main file 3:8: StructDecl=point:3:8 (Definition)
+// CHECK-MAIN: main file 6:5: FunctionDecl=sum:6:5 (Definition)
+// CHECK-MAIN: main file 10:5: FunctionDecl=compute:10:5 (Definition)
+// CHECK-MAIN: main file 14:5: FunctionDecl=twice:14:5 (Definition)
@@ -0,0 +1,20 @@
+// Two main files that start with the same preamble share one precompiled
+// preamble, which is persisted across processes.
+
+// RUN: rm -rf %t.cache
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_PREAMBLE_CACHE=%t.cache LIBCLANG_TIMING=1 c-index-test -test-load-source-reparse 1 local %S/Inputs/preamble-shared-cache-1.c 2> %t.1.err | FileCheck -check-prefix=FIRST %s
+// RUN: FileCheck -check-prefix=BUILD %s < %t.1.err
+// RUN: ls %t.cache | FileCheck -check-prefix=CACHE %s
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_PREAMBLE_CACHE=%t.cache LIBCLANG_TIMING=1 c-index-test -test-load-source-reparse 1 local %S/Inputs/preamble-shared-cache-2.c 2> %t.2.err | FileCheck -check-prefix=SECOND %s
+// RUN: FileCheck -check-prefix=REUSE %s < %t.2.err
+
+// FIRST: preamble-shared-cache-1.c:4:5: FunctionDecl=first_user:4:5 (Definition)
+// BUILD: Precompiling preamble
+// CACHE: .pch
+// CACHE: .preamble
+
+// SECOND: preamble-shared-cache-2.c:4:5: FunctionDecl=second_user:4:5 (Definition)
+// SECOND: preamble-shared-cache-2.c:4:{{[0-9]+}}: MemberRefExpr=y:1:30
+// REUSE-NOT: Precompiling preamble
+// REUSE: Reparsing {{.*}}preamble-shared-cache-2.c
+// REUSE-NOT: Precompiling preamble
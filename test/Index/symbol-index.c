@@ -0,0 +1,40 @@
+#include "symbol-index.h"
+
+int shared(int x) { return x; }
+
+int main_user(void) { return shared(1); }
+
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cp %s %t/main.c
+// RUN: cp %S/Inputs/symbol-index.h %S/Inputs/symbol-index-other.c %t/
+// RUN: c-index-test -symbol-index-update %t/symbols.idx %t/main.c
+// RUN: c-index-test -symbol-index-update %t/symbols.idx %t/symbol-index-other.c
+// RUN: c-index-test -symbol-index-find %t/symbols.idx c:@F@shared \
+// RUN:   | FileCheck %s -check-prefix=ALL
+// ALL:      definition: {{.*}}main.c:3:5
+// ALL-NEXT: reference: {{.*}}main.c:5:30
+// ALL-NEXT: reference: {{.*}}symbol-index-other.c:3:31
+// ALL-NEXT: declaration: {{.*}}symbol-index.h:1:5
+
+// RUN: c-index-test -symbol-index-find %t/symbols.idx c:@F@shared references \
+// RUN:   | FileCheck %s -check-prefix=REFS
+// REFS-NOT: declaration
+// REFS-NOT: definition
+// REFS:     reference: {{.*}}main.c:5:30
+// REFS:     reference: {{.*}}symbol-index-other.c:3:31
+
+// RUN: c-index-test -symbol-index-find %t/symbols.idx c:@F@main_user \
+// RUN:   | FileCheck %s -check-prefix=MAIN
+// MAIN: definition: {{.*}}main.c:5:5
+
+// Reindexing a file replaces its occurrences and leaves the others alone.
+// RUN: echo "int unrelated(void);" > %t/symbol-index-other.c
+// RUN: c-index-test -symbol-index-update %t/symbols.idx %t/symbol-index-other.c
+// RUN: c-index-test -symbol-index-find %t/symbols.idx c:@F@shared \
+// RUN:   | FileCheck %s -check-prefix=UPDATED
+// RUN: c-index-test -symbol-index-find %t/symbols.idx c:@F@other_user \
+// RUN:   | FileCheck %s -check-prefix=REMOVED
+// UPDATED:      definition: {{.*}}main.c:3:5
+// UPDATED-NEXT: reference: {{.*}}main.c:5:30
+// UPDATED-NEXT: declaration: {{.*}}symbol-index.h:1:5
+// REMOVED: no occurrences of c:@F@other_user
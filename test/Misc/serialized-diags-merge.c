@@ -0,0 +1,42 @@
+void foo() {
+  int voodoo;
+  voodoo = voodoo + 1;
+}
+
+#ifdef SECOND
+void bar() {
+  int hoodoo;
+  hoodoo = hoodoo + 1;
+}
+#endif
+
+// RUN: rm -f %t.1.dia %t.2.dia %t.merged.dia %t.list
+// RUN: %clang -Wall -fsyntax-only %s --serialize-diagnostics %t.1.dia
+// RUN: %clang -Wall -fsyntax-only -DSECOND %s --serialize-diagnostics %t.2.dia
+// RUN: diagtool merge-sdiags -stats -j 2 -o %t.merged.dia %t.1.dia %t.2.dia | FileCheck -check-prefix=STATS %s
+// RUN: c-index-test -read-diagnostics %t.merged.dia 2>&1 | FileCheck %s
+
+// STATS: 2 files, 3 diagnostics, 1 duplicates dropped, 0 files skipped
+
+// The warning both translation units share is only reported once, along
+// with its note.
+// CHECK: {{.*}}serialized-diags-merge.c:3:12: warning: variable 'voodoo' is uninitialized when used here [-Wuninitialized]
+// CHECK: +-{{.*}}serialized-diags-merge.c:2:13: note: initialize the variable 'voodoo' to silence this warning []
+// CHECK: +-FIXIT: ({{.*}}serialized-diags-merge.c:2:13 - {{.*}}serialized-diags-merge.c:2:13): " = 0"
+// CHECK-NOT: variable 'voodoo' is uninitialized
+// CHECK: {{.*}}serialized-diags-merge.c:9:12: warning: variable 'hoodoo' is uninitialized when used here [-Wuninitialized]
+// CHECK: Number of diagnostics: 2
+
+// Inputs can also be listed in a file.
+// RUN: echo %t.1.dia > %t.list
+// RUN: echo %t.2.dia >> %t.list
+// RUN: diagtool merge-sdiags -stats -file-list %t.list -o %t.merged.dia | FileCheck -check-prefix=STATS %s
+
+// Inputs which can't be read are skipped with a warning.
+// RUN: diagtool merge-sdiags -stats -j 2 -o %t.merged.dia %t.1.dia %s %t.missing.dia %t.2.dia 2> %t.err | FileCheck -check-prefix=SKIPPED %s
+// RUN: FileCheck -check-prefix=WARNING %s < %t.err
+// RUN: c-index-test -read-diagnostics %t.merged.dia 2>&1 | FileCheck %s
+
+// SKIPPED: 2 files, 3 diagnostics, 1 duplicates dropped, 2 files skipped
+// WARNING: warning: skipping serialized diagnostics file {{.*}}serialized-diags-merge.c
+// WARNING: warning: skipping serialized diagnostics file {{.*}}.missing.dia
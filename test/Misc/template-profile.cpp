@@ -0,0 +1,43 @@
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -ftemplate-profile=%t.json %s
+// RUN: FileCheck %s < %t.json
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -ftemplate-profile=%t.json \
+// RUN:   -ftime-report %s 2>&1 | FileCheck -check-prefix=SUMMARY %s
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -ftime-report %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=NOSUMMARY %s
+
+template<typename T> struct Box {
+  T Value;
+  T get() const { return Value; }
+};
+
+template<int N> struct Fact {
+  static const int Value = N * Fact<N - 1>::Value;
+};
+template<> struct Fact<0> {
+  static const int Value = 1;
+};
+
+constexpr int square(int X) { return X * X; }
+constexpr int Nine = square(3);
+
+int use() {
+  Box<int> B = { 1 };
+  return B.get() + Fact<3>::Value + Nine;
+}
+
+// CHECK: {"traceEvents":[
+// CHECK-DAG: {"name":"Box<int>","cat":"class","ph":"X",{{.*}},"args":{"template":"Box","ast_bytes":{{[0-9]+}}}}
+// CHECK-DAG: {"name":"Box<int>::get","cat":"function",{{.*}}"template":"Box::get"
+// CHECK-DAG: {"name":"Fact<3>","cat":"class",{{.*}}"template":"Fact"
+// CHECK-DAG: {"name":"Fact<1>","cat":"class",{{.*}}"template":"Fact"
+// CHECK-DAG: {"name":"Nine","cat":"constant evaluation",{{.*}}"template":"square"
+// CHECK: ],"displayTimeUnit":"ms"}
+
+// SUMMARY: Template instantiation summary
+// SUMMARY: ---Total---   ---Self---    Count    AST bytes  Template
+// SUMMARY-DAG: {{[0-9]+}}  Box{{$}}
+// SUMMARY-DAG: {{[0-9]+}}  Box::get{{$}}
+// SUMMARY-DAG: {{[0-9]+}}  Fact{{$}}
+// SUMMARY-DAG: {{[0-9]+}}  square{{$}}
+
+// NOSUMMARY-NOT: Template instantiation summary
@@ -0,0 +1,30 @@
+#include "foo.h"
+
+// RUN: rm -rf %t
+// RUN: mkdir -p %t/Inputs
+// RUN: mkdir -p %t/modules-to-compare
+
+// RUN: echo 'void meow(void);' > %t/Inputs/foo.h
+// RUN: echo 'module Foo { header "foo.h" }' > %t/Inputs/module.map
+
+// ===
+// Compile the module, recording it in the session's validation cache.
+// RUN: %clang_cc1 -fmodules -fdisable-module-hash -fmodules-cache-path=%t/modules-cache -fsyntax-only -I %t/Inputs -fbuild-session-timestamp=1390000000 -fmodules-validation-cache %s
+// RUN: ls %t/modules-cache | grep session-1390000000.validated
+// RUN: cp %t/modules-cache/Foo.pcm %t/modules-to-compare/Foo-before.pcm
+
+// ===
+// Change the sources. Even though foo.h is a user header, the module is not
+// revalidated or rebuilt within the same build session.
+// RUN: echo 'void meow2(void);' > %t/Inputs/foo.h
+// RUN: %clang_cc1 -fmodules -fdisable-module-hash -fmodules-cache-path=%t/modules-cache -fsyntax-only -I %t/Inputs -fbuild-session-timestamp=1390000000 -fmodules-validation-cache -print-stats %s 2>&1 | FileCheck %s
+// RUN: cp %t/modules-cache/Foo.pcm %t/modules-to-compare/Foo-after.pcm
+// RUN: diff %t/modules-to-compare/Foo-before.pcm %t/modules-to-compare/Foo-after.pcm
+// CHECK: 1 module files not revalidated in this session
+
+// ===
+// A new build session validates the module again and rebuilds it.
+// RUN: %clang_cc1 -fmodules -fdisable-module-hash -fmodules-cache-path=%t/modules-cache -fsyntax-only -I %t/Inputs -fbuild-session-timestamp=1390000100 -fmodules-validation-cache %s
+// RUN: ls %t/modules-cache | grep session-1390000100.validated
+// RUN: cp %t/modules-cache/Foo.pcm %t/modules-to-compare/Foo-after.pcm
+// RUN: not diff %t/modules-to-compare/Foo-before.pcm %t/modules-to-compare/Foo-after.pcm
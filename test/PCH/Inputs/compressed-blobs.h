@@ -0,0 +1,5 @@
+// Header file for PCH test compressed-blobs.c
+
+struct compressed_blob {
+  int value;
+};
@@ -0,0 +1,17 @@
+// REQUIRES: zlib
+
+// The predefines buffer is large enough to be compressed, and is always read
+// when the PCH is loaded.
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -fmodules-compress-blobs -emit-pch -o %t.compressed.pch %S/Inputs/compressed-blobs.h
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -include-pch %t.compressed.pch -fsyntax-only -print-stats %s 2>&1 | FileCheck %s
+
+// Without the option, nothing is compressed.
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -emit-pch -o %t.plain.pch %S/Inputs/compressed-blobs.h
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -include-pch %t.plain.pch -fsyntax-only -print-stats %s 2>&1 | FileCheck -check-prefix=PLAIN %s
+
+int check_header[sizeof(struct compressed_blob) == sizeof(int) ? 1 : -1];
+
+// CHECK: *** AST File Statistics:
+// CHECK: {{[1-9][0-9]*}} compressed source buffers decompressed
+// PLAIN: *** AST File Statistics:
+// PLAIN-NOT: compressed source buffers decompressed
@@ -0,0 +1,11 @@
+// Test this without pch.
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -include %S/Inputs/compressed-blobs.h -fsyntax-only -verify %s
+
+// Test with a pch whose embedded buffers are compressed.
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -fmodules-compress-blobs -emit-pch -o %t %S/Inputs/compressed-blobs.h
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -include-pch %t -fsyntax-only -verify %s
+
+// expected-no-diagnostics
+
+int check_macro[FROM_CMDLINE == 42 ? 1 : -1];
+int check_header[sizeof(struct compressed_blob) == sizeof(int) ? 1 : -1];
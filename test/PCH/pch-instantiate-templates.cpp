@@ -0,0 +1,42 @@
+// Test without pch.
+// RUN: %clang_cc1 -std=c++11 -triple %itanium_abi_triple -include %s %s -emit-llvm -o - | FileCheck %s
+
+// Test with pch, with and without performing the instantiations in the pch.
+// RUN: %clang_cc1 -std=c++11 -triple %itanium_abi_triple -x c++-header -emit-pch -o %t %s
+// RUN: %clang_cc1 -std=c++11 -triple %itanium_abi_triple -include-pch %t %s -emit-llvm -o - | FileCheck %s
+// RUN: %clang_cc1 -std=c++11 -triple %itanium_abi_triple -x c++-header -fpch-instantiate-templates -emit-pch -print-stats -o %t.inst %s 2>&1 | FileCheck -check-prefix=STATS %s
+// RUN: %clang_cc1 -std=c++11 -triple %itanium_abi_triple -include-pch %t.inst %s -emit-llvm -o - | FileCheck %s
+
+#ifndef HEADER
+#define HEADER
+
+template<typename T> T twice(T X) { return X + X; }
+
+template<typename T> struct Counter {
+  T Count;
+  void bump() { ++Count; }
+};
+
+// Only defined by the including translation unit.
+template<typename T> T later(T X);
+
+inline int header_use() {
+  Counter<int> C = { 0 };
+  C.bump();
+  return twice(21) + C.Count + later(1);
+}
+
+#else
+
+template<typename T> T later(T X) { return X - 1; }
+
+int main_use() { return header_use() + twice(1.0); }
+
+#endif
+
+// STATS: 2 implicit instantiations performed in the precompiled header, 1 left to including translation units.
+
+// CHECK-DAG: define linkonce_odr i32 @_Z5twiceIiET_S0_(
+// CHECK-DAG: define linkonce_odr void @_ZN7CounterIiE4bumpEv(
+// CHECK-DAG: define linkonce_odr i32 @_Z5laterIiET_S0_(
+// CHECK-DAG: define linkonce_odr double @_Z5twiceIdET_S0_(
@@ -0,0 +1,14 @@
+// RUN: rm -rf %t.store
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -fmodules-buffer-store-path=%t.store -emit-pch -o %t.1.pch %S/Inputs/compressed-blobs.h
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -fmodules-buffer-store-path=%t.store -emit-pch -o %t.2.pch %S/Inputs/compressed-blobs.h
+
+// Both PCH files share the one stored copy of the predefines buffer.
+// RUN: ls %t.store | count 1
+
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -include-pch %t.1.pch -fsyntax-only -verify %s
+// RUN: %clang_cc1 -DFROM_CMDLINE=42 -include-pch %t.2.pch -fsyntax-only -verify %s
+
+// expected-no-diagnostics
+
+int check_macro[FROM_CMDLINE == 42 ? 1 : -1];
+int check_header[sizeof(struct compressed_blob) == sizeof(int) ? 1 : -1];
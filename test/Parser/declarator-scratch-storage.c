@@ -0,0 +1,22 @@
+// RUN: %clang_cc1 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+// expected-no-diagnostics
+
+// The parameters of the returned function type do not fit in the declarator,
+// so each of these needs scratch storage. The storage released by one
+// declarator is reused by the next.
+int (*get_handler(int signal))(int, int);
+int (*get_filter(int kind))(int, int);
+int (*get_reducer(int kind))(int, int);
+int (*get_mapper(int kind))(int, int);
+
+// So do functions with more parameters than fit in the declarator.
+void many(int a0, int a1, int a2, int a3, int a4, int a5, int a6, int a7,
+          int a8, int a9, int a10, int a11, int a12, int a13, int a14,
+          int a15, int a16);
+void many(int a0, int a1, int a2, int a3, int a4, int a5, int a6, int a7,
+          int a8, int a9, int a10, int a11, int a12, int a13, int a14,
+          int a15, int a16);
+
+// CHECK: *** Parser Stats:
+// CHECK: 6 declarator scratch allocations, 2 of which needed new storage.
@@ -0,0 +1,58 @@
+// RUN: %clang_cc1 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -fsyntax-only -verify %s -fexperimental-deferred-function-bodies
+// RUN: %clang -fsyntax-only -Xclang -verify %s -fexperimental-deferred-function-bodies
+// RUN: not %clang_cc1 -fsyntax-only %s -fexperimental-deferred-function-bodies -print-stats 2>&1 | FileCheck %s
+
+int callee(int);
+
+int caller(int n) {
+  return callee(n) + 1;
+}
+
+int bad(void) {
+  return undeclared; // expected-error {{use of undeclared identifier 'undeclared'}}
+}
+
+int callee(int n) { return n * 2; }
+
+int knr(a) int a; { return callee(a); }
+
+int twice(void) { return 1; } // expected-note {{previous definition is here}}
+int twice(void) { return 2; } // expected-error {{redefinition of 'twice'}}
+
+// Bodies are parsed in the pragma state in effect where they were written.
+#pragma pack(push, 1)
+void packed(void) {
+  struct S { char c; int i; };
+  _Static_assert(sizeof(struct S) == 1 + sizeof(int), "");
+}
+#pragma pack(pop)
+
+void unpacked(void) {
+  struct S { char c; int i; };
+  _Static_assert(sizeof(struct S) == _Alignof(int) + sizeof(int), "");
+}
+
+void pragma_in_body(void) {
+#pragma pack(push, 1)
+  struct S { char c; int i; };
+#pragma pack(pop)
+  struct T { char c; int i; };
+  _Static_assert(sizeof(struct S) == 1 + sizeof(int), "");
+  _Static_assert(sizeof(struct T) == _Alignof(int) + sizeof(int), "");
+}
+
+// A body is parsed before a later declaration could change its meaning.
+void incomplete_in_body(void) {
+  struct Later *p = 0; // expected-note {{forward declaration of 'struct Later'}}
+  (void)p->x; // expected-error {{incomplete definition of type 'struct Later'}}
+}
+struct Later { int x; };
+
+int implicit_in_body(void) {
+  return declared_later(); // expected-warning {{implicit declaration of function 'declared_later' is invalid in C99}}
+}
+int declared_later(void);
+
+// CHECK: *** Parser Stats:
+// CHECK: {{[1-9][0-9]*}} deferred function bodies parsed in {{[0-9.]+}} seconds, the longest in {{[0-9.]+}} seconds.
@@ -0,0 +1,47 @@
+static inline int used_accessor(int x) { return x + 1; }
+
+static inline int unused_accessor(int x) {
+  return x + undeclared_in_unused;
+}
+#ifndef LAZY
+// expected-error@-3 {{use of undeclared identifier 'undeclared_in_unused'}}
+#endif
+
+// Only used by the body of a function which is parsed lazily.
+static int helper(int x) {
+  return x + undeclared_in_helper; // expected-error {{use of undeclared identifier 'undeclared_in_helper'}}
+}
+
+static inline int calls_helper(int x) { return helper(x); }
+
+__attribute__((constructor)) static void init(void) {
+  (void)undeclared_in_init; // expected-error {{use of undeclared identifier 'undeclared_in_init'}}
+}
+
+static __attribute__((used)) void kept(void) {
+  (void)undeclared_in_kept; // expected-error {{use of undeclared identifier 'undeclared_in_kept'}}
+}
+
+// Bodies written while a pragma is in effect are parsed where they are
+// written.
+#pragma pack(push, 1)
+static int packed_size(void) {
+  struct S { char c; int i; };
+  _Static_assert(sizeof(struct S) == 1 + sizeof(int), "");
+  return sizeof(struct S);
+}
+#pragma pack(pop)
+
+// Other bodies are parsed with the pragmas in their default state, whatever
+// their state at the end of the translation unit.
+static int unpacked_size(void) {
+  struct S { char c; int i; };
+  _Static_assert(sizeof(struct S) == _Alignof(int) + sizeof(int), "");
+  return sizeof(struct S);
+}
+
+// Only referenced as the target of an alias.
+static int alias_target(int x) {
+  return x + undeclared_in_alias_target; // expected-error {{use of undeclared identifier 'undeclared_in_alias_target'}}
+}
+int alias_of_target(int) __attribute__((alias("alias_target")));
@@ -0,0 +1,21 @@
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsyntax-only -verify %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsyntax-only -verify %s -flazy-static-function-bodies -DLAZY
+// RUN: %clang -target x86_64-unknown-linux-gnu -fsyntax-only -Xclang -verify %s -flazy-static-function-bodies -DLAZY
+// RUN: not %clang_cc1 -triple x86_64-unknown-linux-gnu -fsyntax-only %s -flazy-static-function-bodies -print-stats 2>&1 | FileCheck %s
+
+#include "Inputs/lazy-static-function-bodies.h"
+
+int f(int x) {
+  return used_accessor(x) + calls_helper(x) + packed_size() + unpacked_size();
+}
+
+// Static functions in the main file are parsed as usual.
+static int unused_in_main_file(void) {
+  return undeclared_in_main_file; // expected-error {{use of undeclared identifier 'undeclared_in_main_file'}}
+}
+
+// This is still in effect at the end of the translation unit.
+#pragma pack(push, 1)
+
+// CHECK: *** Parser Stats:
+// CHECK: 7 of 8 lazily parsed static function bodies were used.
@@ -0,0 +1,45 @@
+// RUN: %clang_cc1 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -fsyntax-only -verify %s -fspell-checking-candidate-limit 1 -DLIMITED
+// RUN: %clang -fsyntax-only -Xclang -verify %s -fspell-checking-candidate-limit=1 -DLIMITED
+// RUN: not %clang_cc1 -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+
+int counter;
+int maximum_length;
+#ifndef LIMITED
+// expected-note@-3 {{'counter' declared here}}
+// expected-note@-3 {{'maximum_length' declared here}}
+#endif
+int unrelated_name;
+
+// Building the index computes edit distances between the names, which count
+// against the budget for typo correction, so a tiny budget is spent before
+// the first search.
+int f(void) {
+#ifdef LIMITED
+  return countr; // expected-error-re {{use of undeclared identifier 'countr'{{$}}}}
+#else
+  return countr; // expected-error {{use of undeclared identifier 'countr'; did you mean 'counter'?}}
+#endif
+}
+
+// Identifiers created after the first correction are found, unless the
+// budget for typo correction has been spent.
+int g(void) {
+#ifdef LIMITED
+  return maximum_lenght; // expected-error-re {{use of undeclared identifier 'maximum_lenght'{{$}}}}
+#else
+  return maximum_lenght; // expected-error {{use of undeclared identifier 'maximum_lenght'; did you mean 'maximum_length'?}}
+#endif
+}
+
+#ifndef LIMITED
+int late_declared_value; // expected-note {{'late_declared_value' declared here}}
+
+int h(void) {
+  return late_declared_valu; // expected-error {{use of undeclared identifier 'late_declared_valu'; did you mean 'late_declared_value'?}}
+}
+#endif
+
+// CHECK: *** Typo Correction Index Stats:
+// CHECK: {{[1-9][0-9]*}} names indexed, computing {{[1-9][0-9]*}} edit distances.
+// CHECK: {{[1-9][0-9]*}} searches, computing {{[1-9][0-9]*}} edit distances.
@@ -1,4 +1,5 @@
 // RUN: not %clang_cc1 -std=c++11 -fsyntax-only %s -fconstexpr-backtrace-limit 0 -fconstexpr-depth 4 -fno-caret-diagnostics 2>&1 | FileCheck %s -check-prefix=TEST1
+// RUN: not %clang_cc1 -std=c++11 -fsyntax-only %s -fconstexpr-backtrace-limit 0 -fconstexpr-depth 4 -fno-caret-diagnostics -fexperimental-constexpr-interpreter 2>&1 | FileCheck %s -check-prefix=TEST1
 // TEST1: constant expression
 // TEST1-NEXT: exceeded maximum depth of 4
 // TEST1-NEXT: in call to 'recurse(2)'
@@ -21,6 +22,7 @@
 // TEST3-NEXT: in call to 'recurse(5)'
 
 // RUN: not %clang_cc1 -std=c++11 -fsyntax-only %s -fconstexpr-backtrace-limit 8 -fconstexpr-depth 8 -fno-caret-diagnostics 2>&1 | FileCheck %s -check-prefix=TEST4
+// RUN: not %clang_cc1 -std=c++11 -fsyntax-only %s -fconstexpr-backtrace-limit 8 -fconstexpr-depth 8 -fno-caret-diagnostics -fexperimental-constexpr-interpreter 2>&1 | FileCheck %s -check-prefix=TEST4
 // TEST4: constant expression
 // TEST4-NEXT: reinterpret_cast
 // TEST4-NEXT: in call to 'recurse(0)'
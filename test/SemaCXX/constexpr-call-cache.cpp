@@ -0,0 +1,43 @@
+// RUN: %clang_cc1 -std=c++1y -fsyntax-only -verify %s
+// RUN: %clang_cc1 -std=c++1y -fsyntax-only -verify %s -fconstexpr-cache-limit 0 -DNO_CACHE
+// RUN: %clang -std=c++1y -fsyntax-only -Xclang -verify %s -fconstexpr-cache-limit=0 -DNO_CACHE
+// RUN: %clang_cc1 -std=c++1y -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+
+// Without the cache, this takes exponentially many steps.
+constexpr unsigned long long fib(unsigned n) {
+  return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+static_assert(fib(20) == 6765, "");
+#ifndef NO_CACHE
+static_assert(fib(60) == 1548008755920ULL, "");
+static_assert(fib(90) == 2880067194370816120ULL, "");
+#endif
+
+struct Pair { int A, B; };
+constexpr Pair swap(Pair P) { return { P.B, P.A }; }
+static_assert(swap({ 1, 2 }).A == 2 && swap({ 2, 1 }).A == 1, "");
+
+// Calls which diagnose a problem are not memoized, and neither are calls with
+// arguments that refer to objects.
+constexpr int check(int N) { return N > 0 ? N : throw 0; } // expected-note 2{{subexpression}}
+static_assert(check(1) == 1, "");
+static_assert(check(-1) == -1, ""); // expected-error {{constant}} expected-note {{in call}}
+static_assert(check(-1) == -1, ""); // expected-error {{constant}} expected-note {{in call}}
+
+constexpr int deref(const int *P) { return *P; }
+constexpr int One = 1, Two = 2;
+static_assert(deref(&One) == 1 && deref(&Two) == 2, "");
+
+// Calls to different specializations are distinct, even when the arguments
+// have the same value.
+template<typename T> constexpr T twice(T N) { return N * 2; } // expected-note {{value 2147483648 is outside the range}}
+static_assert(twice(0x40000000LL) == 0x80000000LL, "");
+static_assert(twice(0x40000000) == 0, ""); // expected-error {{constant}} expected-note {{in call}}
+
+constexpr double half(double D) { return D / 2; }
+static_assert(half(1.0) == 0.5 && half(-1.0) == -0.5, "");
+
+// CHECK: *** Constexpr Call Cache Stats:
+// CHECK: memoized calls, using {{[0-9]+}} bytes (limit 16777216).
+// CHECK: {{[1-9][0-9]*}} hits, {{[1-9][0-9]*}} misses, 0 results dropped
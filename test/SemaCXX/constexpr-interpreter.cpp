@@ -0,0 +1,86 @@
+// RUN: %clang_cc1 -std=c++1y -fsyntax-only -verify %s
+// RUN: %clang_cc1 -std=c++1y -fsyntax-only -verify %s -fexperimental-constexpr-interpreter
+// RUN: %clang -std=c++1y -fsyntax-only -Xclang -verify %s -fexperimental-constexpr-interpreter
+// RUN: %clang_cc1 -std=c++1y -fsyntax-only %s -fexperimental-constexpr-interpreter -print-stats 2>&1 | FileCheck %s
+
+// Each of these is evaluated the same way with and without the bytecode
+// interpreter.
+
+constexpr int sum(int n) {
+  int total = 0;
+  for (int i = 1; i <= n; ++i) {
+    if (i % 3 == 0)
+      continue;
+    total += i;
+  }
+  return total;
+}
+static_assert(sum(10) == 37, "");
+
+constexpr unsigned collatz(unsigned long long n) {
+  unsigned steps = 0;
+  while (n != 1) {
+    n = n % 2 ? 3 * n + 1 : n / 2;
+    ++steps;
+  }
+  return steps;
+}
+static_assert(collatz(27) == 111, "");
+
+constexpr int gcd(int a, int b) { return b ? gcd(b, a % b) : a; }
+static_assert(gcd(1071, 462) == 21, "");
+
+constexpr int firstSquareAbove(int n) {
+  int i = 0;
+  do {
+    if (i * i > n)
+      break;
+  } while (++i);
+  return i;
+}
+static_assert(firstSquareAbove(50) == 8, "");
+
+// Integer conversions, wraparound and shifts.
+constexpr unsigned char wrap(unsigned char c) { return c + 200; }
+static_assert(wrap(100) == 44, "");
+constexpr signed char narrow(int n) { signed char c = n; c++; return c; }
+static_assert(narrow(127) == -128, "");
+constexpr long long shifts(int n) { return (1LL << n) >> 2; }
+static_assert(shifts(40) == 1LL << 38, "");
+constexpr unsigned negate(unsigned n) { return -n; }
+static_assert(negate(1) == 0xFFFFFFFFu, "");
+constexpr bool logic(int a, int b) { return (a && !b) || (a & b) == 2; }
+static_assert(logic(1, 0) && logic(2, 3) && !logic(0, 1), "");
+
+// The variable is read after the right operand of a compound assignment.
+constexpr int assignInRHS(int x) {
+  x += (x = 5); // expected-warning {{unsequenced modification and access to 'x'}}
+  return x;
+}
+static_assert(assignInRHS(1) == 10, "");
+
+// Constants, enumerators and default arguments.
+constexpr int Scale = 4;
+enum Color { Red = 1, Green = 2, Blue = 4 };
+constexpr int scale(int n, Color c = Blue) { return n * Scale + c + sizeof(n); }
+static_assert(scale(2) == 16 && scale(2, Red) == 13, "");
+
+// Evaluations that do not produce a constant are diagnosed as usual.
+constexpr int overflow(int n) { return n * 2; } // expected-note {{value 2147483648 is outside the range}}
+static_assert(overflow(1 << 30) == 0, ""); // expected-error {{constant expression}} expected-note {{in call to 'overflow(1073741824)'}}
+
+constexpr int divide(int a, int b) { return a / b; } // expected-note {{division by zero}}
+static_assert(divide(1, 0) == 0, ""); // expected-error {{constant expression}} expected-note {{in call to 'divide(1, 0)'}}
+
+constexpr int shift(int a, int b) { return a << b; } // expected-note {{shift count 40 >= width of type 'int'}}
+static_assert(shift(1, 40) == 0, ""); // expected-error {{constant expression}} expected-note {{in call to 'shift(1, 40)'}}
+
+constexpr int noReturn(int n) { if (n) return n; } // expected-warning {{control may reach end}} expected-note 2{{control reached end of constexpr function}}
+static_assert(noReturn(0) == 0, ""); // expected-error {{constant expression}} expected-note {{in call to 'noReturn(0)'}}
+
+constexpr int callsNoReturn(int n) { return noReturn(n) + 1; } // expected-note {{in call to 'noReturn(0)'}}
+static_assert(callsNoReturn(0) == 1, ""); // expected-error {{constant expression}} expected-note {{in call to 'callsNoReturn(0)'}}
+
+// CHECK: *** Constexpr Interpreter Stats:
+// CHECK: {{[1-9][0-9]*}} functions compiled to {{[0-9]+}} instructions
+// CHECK: {{[1-9][0-9]*}} calls interpreted, {{[1-9][0-9]*}} failed calls
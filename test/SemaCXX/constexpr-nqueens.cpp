@@ -1,4 +1,5 @@
 // RUN: %clang_cc1 -std=c++11 -fsyntax-only %s
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only %s -fexperimental-constexpr-interpreter
 
 typedef unsigned long uint64_t;
 
@@ -1,4 +1,5 @@
 // RUN: %clang_cc1 -verify -std=c++11 %s
+// RUN: %clang_cc1 -verify -std=c++11 %s -fexperimental-constexpr-interpreter
 // expected-no-diagnostics
 
 // A direct proof that constexpr is Turing-complete, once DR1454 is implemented.
@@ -0,0 +1,55 @@
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -verify %s -fno-overload-resolution-cache
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only %s -print-stats -fno-overload-resolution-cache 2>&1 | FileCheck %s -check-prefix=NOCACHE
+// expected-no-diagnostics
+
+namespace io {
+  struct ostream {};
+  ostream &operator<<(ostream &, bool);
+  ostream &operator<<(ostream &, char);
+  ostream &operator<<(ostream &, int);
+  ostream &operator<<(ostream &, long);
+  ostream &operator<<(ostream &, unsigned);
+  ostream &operator<<(ostream &, double);
+  ostream &operator<<(ostream &, const char *);
+  ostream &operator<<(ostream &, const void *);
+}
+
+void print(io::ostream &out, int i, double d, const char *s) {
+  out << i << d << s;
+  out << i << d << s;
+}
+
+// Declaring a new overload is noticed, even when it is only found by
+// argument-dependent lookup.
+namespace N {
+  struct A {};
+  char g(A, long);
+}
+extern N::A a;
+extern int n;
+static_assert(sizeof(g(a, n)) == sizeof(char), "");
+static_assert(sizeof(g(a, n)) == sizeof(char), "");
+namespace N {
+  int g(A, int);
+}
+static_assert(sizeof(g(a, n)) == sizeof(int), "");
+
+// A candidate whose parameter has an incomplete type becomes viable once the
+// type is complete.
+struct Later;
+int pick(Later);
+char pick(...);
+static_assert(sizeof(pick(n)) == sizeof(char), "");
+struct Later { Later(int); };
+static_assert(sizeof(pick(n)) == sizeof(int), "");
+
+// A null pointer constant has conversions which other ints do not.
+char f(int *);
+int f(...);
+static_assert(sizeof(f(0)) == sizeof(char), "");
+static_assert(sizeof(f(n)) == sizeof(int), "");
+
+// CHECK: {{[1-9][0-9]*}} overload resolutions reused, {{[1-9][0-9]*}} performed for cacheable calls, {{[1-9][0-9]*}} results cached.
+// NOCACHE: 0 overload resolutions reused, 0 performed for cacheable calls, 0 results cached.
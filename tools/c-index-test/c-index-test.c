@@ -1096,6 +1096,27 @@ enum CXChildVisitResult FilteredPrintingVisitor(CXCursor Cursor,
   return CXChildVisit_Continue;
 }
 
+/* Print the top-level cursors whose locations are in the main file. */
+static enum CXChildVisitResult MainFileCursorVisitor(CXCursor Cursor,
+                                                     CXCursor Parent,
+                                                     CXClientData ClientData) {
+  CXSourceLocation Loc = clang_getCursorLocation(Cursor);
+  unsigned line, column;
+  if (!clang_Location_isFromMainFile(Loc))
+    return CXChildVisit_Continue;
+
+  clang_getSpellingLocation(Loc, 0, &line, &column, 0);
+  printf("// %s: main file %d:%d: ", FileCheckPrefix, line, column);
+  PrintCursor(Cursor, NULL);
+  printf("\n");
+  return CXChildVisit_Continue;
+}
+
+static void PrintMainFileCursors(CXTranslationUnit TU) {
+  clang_visitChildren(clang_getTranslationUnitCursor(TU),
+                      MainFileCursorVisitor, NULL);
+}
+
 static enum CXChildVisitResult FunctionScanVisitor(CXCursor Cursor,
                                                    CXCursor Parent,
                                                    CXClientData ClientData) {
@@ -1207,6 +1228,49 @@ void PrintInclusionStack(CXTranslationUnit TU) {
   clang_getInclusions(TU, InclusionVisitor, NULL);
 }
 
+/******************************************************************************/
+/* Bulk cursor traversal testing.                                             */
+/******************************************************************************/
+
+static void PrintCursorRecords(CXTranslationUnit TU) {
+  CXCursor Root = clang_getTranslationUnitCursor(TU);
+  unsigned Options = CXCursorRecord_IncludeSpellings |
+                     CXCursorRecord_IncludeUSRs;
+  CXCursorRecord *Records;
+  char *Strings;
+  unsigned NumRecords, StringsSize, I;
+
+  /* Query the sizes of the buffers first. */
+  NumRecords = clang_visitChildrenBulk(Root, Options, NULL, 0, NULL, 0,
+                                       &StringsSize);
+  Records = (CXCursorRecord *)malloc(sizeof(CXCursorRecord) *
+                                     (NumRecords ? NumRecords : 1));
+  Strings = (char *)malloc(StringsSize);
+  clang_visitChildrenBulk(Root, Options, Records, NumRecords, Strings,
+                          StringsSize, NULL);
+
+  for (I = 0; I != NumRecords; ++I) {
+    CXCursorRecord *R = &Records[I];
+    CXString KindSpelling = clang_getCursorKindSpelling(R->kind);
+    CXString FileName = clang_getFileName(R->file);
+    const char *FileNameStr = clang_getCString(FileName);
+
+    printf("// %s: %u %s parent=%d [%s:%u:%u - %u:%u] \"%s\"", FileCheckPrefix,
+           I, clang_getCString(KindSpelling), R->parent,
+           FileNameStr ? basename(FileNameStr) : "(null)", R->start_line,
+           R->start_column, R->end_line, R->end_column,
+           Strings + R->spelling);
+    if (R->usr)
+      printf(" USR=%s", Strings + R->usr);
+    printf("\n");
+    clang_disposeString(KindSpelling);
+    clang_disposeString(FileName);
+  }
+
+  free(Records);
+  free(Strings);
+}
+
 /******************************************************************************/
 /* Linkage testing.                                                           */
 /******************************************************************************/
@@ -1537,6 +1601,19 @@ int perform_test_load_source(int argc, const char **argv,
     return 1;
   }
 
+  if (getenv("CINDEXTEST_HIBERNATE")) {
+    /* The translation unit is woken by the first query. */
+    Err = (enum CXErrorCode)clang_hibernateTranslationUnit(TU);
+    if (Err != CXError_Success) {
+      fprintf(stderr, "Unable to hibernate translation unit!\n");
+      describeLibclangFailure(Err);
+      clang_disposeTranslationUnit(TU);
+      free_remapped_files(unsaved_files, num_unsaved_files);
+      clang_disposeIndex(Idx);
+      return 1;
+    }
+  }
+
   result = perform_test_load(Idx, TU, filter, NULL, Visitor, PV,
                              CommentSchemaFile);
   free_remapped_files(unsaved_files, num_unsaved_files);
@@ -1556,12 +1633,18 @@ int perform_test_reparse_source(int argc, const char **argv, int trials,
   int result, i;
   int trial;
   int remap_after_trial = 0;
+  unsigned reparse_options;
   char *endptr = 0;
   
   Idx = clang_createIndex(/* excludeDeclsFromPCH */
                           !strcmp(filter, "local") ? 1 : 0,
                           /* displayDiagnostics=*/1);
-  
+
+  if (getenv("CINDEXTEST_PREAMBLE_CACHE"))
+    clang_CXIndex_setPreambleCacheOptions(Idx,
+                                          getenv("CINDEXTEST_PREAMBLE_CACHE"),
+                                          /*MaxSize=*/0);
+
   if (parse_remapped_files(argc, argv, 0, &unsaved_files, &num_unsaved_files)) {
     clang_disposeIndex(Idx);
     return -1;
@@ -1598,6 +1681,12 @@ int perform_test_reparse_source(int argc, const char **argv, int trials,
         strtol(getenv("CINDEXTEST_REMAP_AFTER_TRIAL"), &endptr, 10);
   }
 
+  reparse_options = clang_defaultReparseOptions(TU);
+  if (getenv("CINDEXTEST_ASYNC_PREAMBLE"))
+    reparse_options |= CXReparse_BuildPreambleInBackground;
+  if (getenv("CINDEXTEST_INCREMENTAL_REPARSE"))
+    reparse_options |= CXReparse_ReuseUnchangedDeclarations;
+
   for (trial = 0; trial < trials; ++trial) {
     free_remapped_files(unsaved_files, num_unsaved_files);
     if (parse_remapped_files_with_try(trial, argc, argv, 0,
@@ -1611,7 +1700,7 @@ int perform_test_reparse_source(int argc, const char **argv, int trials,
         TU,
         trial >= remap_after_trial ? num_unsaved_files : 0,
         trial >= remap_after_trial ? unsaved_files : 0,
-        clang_defaultReparseOptions(TU));
+        reparse_options);
     if (Err != CXError_Success) {
       fprintf(stderr, "Unable to reparse translation unit!\n");
       describeLibclangFailure(Err);
@@ -1624,6 +1713,19 @@ int perform_test_reparse_source(int argc, const char **argv, int trials,
     if (checkForErrors(TU) != 0)
       return -1;
   }
+
+  if (getenv("CINDEXTEST_HIBERNATE")) {
+    /* The translation unit is woken by the first query. */
+    Err = (enum CXErrorCode)clang_hibernateTranslationUnit(TU);
+    if (Err != CXError_Success) {
+      fprintf(stderr, "Unable to hibernate translation unit!\n");
+      describeLibclangFailure(Err);
+      clang_disposeTranslationUnit(TU);
+      free_remapped_files(unsaved_files, num_unsaved_files);
+      clang_disposeIndex(Idx);
+      return -1;
+    }
+  }
   
   result = perform_test_load(Idx, TU, filter, NULL, Visitor, PV, NULL);
 
@@ -2041,6 +2143,9 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
   CXTranslationUnit TU;
   unsigned I, Repeats = 1;
   unsigned completionOptions = clang_defaultCodeCompleteOptions();
+  const char *completionPrefix = getenv("CINDEXTEST_COMPLETION_PREFIX");
+  const char *maxResultsEnv = getenv("CINDEXTEST_COMPLETION_MAX_RESULTS");
+  unsigned maxResults = maxResultsEnv ? (unsigned)atoi(maxResultsEnv) : 0;
   
   if (getenv("CINDEXTEST_CODE_COMPLETE_PATTERNS"))
     completionOptions |= CXCodeComplete_IncludeCodePatterns;
@@ -2085,9 +2190,16 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
   }
 
   for (I = 0; I != Repeats; ++I) {
-    results = clang_codeCompleteAt(TU, filename, line, column,
-                                   unsaved_files, num_unsaved_files,
-                                   completionOptions);
+    if (completionPrefix || maxResults)
+      results = clang_codeCompleteAtWithPrefix(TU, filename, line, column,
+                                               unsaved_files,
+                                               num_unsaved_files,
+                                               completionOptions,
+                                               completionPrefix, maxResults);
+    else
+      results = clang_codeCompleteAt(TU, filename, line, column,
+                                     unsaved_files, num_unsaved_files,
+                                     completionOptions);
     if (!results) {
       fprintf(stderr, "Unable to perform code completion!\n");
       return 1;
@@ -2103,8 +2215,10 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
     CXString objCSelector;
     const char *selectorString;
     if (!timing_only) {      
-      /* Sort the code-completion results based on the typed text. */
-      clang_sortCodeCompletionResults(results->Results, results->NumResults);
+      /* Sort the code-completion results based on the typed text, unless
+         they were ranked by libclang. */
+      if (!maxResults)
+        clang_sortCodeCompletionResults(results->Results, results->NumResults);
 
       for (i = 0; i != n; ++i)
         print_completion_result(results->Results + i, stdout);
@@ -3335,6 +3449,94 @@ static int index_compile_db(int argc, const char **argv) {
   return errorCode;
 }
 
+static int symbol_index_update(int argc, const char **argv) {
+  CXIndex Idx;
+  CXSymbolIndex SymIdx;
+  int result;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: -symbol-index-update <index file> {<args>}*\n");
+    return 1;
+  }
+
+  if (!(SymIdx = clang_SymbolIndex_create(argv[0]))) {
+    fprintf(stderr, "Could not open symbol index %s\n", argv[0]);
+    return 1;
+  }
+  if (!(Idx = clang_createIndex(/* excludeDeclsFromPCH */ 1,
+                                /* displayDiagnostics=*/1))) {
+    fprintf(stderr, "Could not create Index\n");
+    clang_SymbolIndex_dispose(SymIdx);
+    return 1;
+  }
+
+  result = clang_SymbolIndex_indexSourceFile(SymIdx, Idx, 0, argv + 1,
+                                             argc - 1, 0, 0,
+                                             getDefaultParsingOptions());
+  if (result != CXError_Success)
+    describeLibclangFailure(result);
+  else if (clang_SymbolIndex_save(SymIdx) != 0) {
+    fprintf(stderr, "Could not write symbol index %s\n", argv[0]);
+    result = 1;
+  }
+
+  clang_disposeIndex(Idx);
+  clang_SymbolIndex_dispose(SymIdx);
+  return result;
+}
+
+static void printSymbolOccurrence(CXClientData client_data,
+                                  const CXSymbolOccurrence *occurrence) {
+  const char *kind = "<unknown>";
+  switch (occurrence->role) {
+  case CXSymbolRole_Declaration: kind = "declaration"; break;
+  case CXSymbolRole_Definition: kind = "definition"; break;
+  case CXSymbolRole_Reference: kind = "reference"; break;
+  }
+  printf("%s: %s:%u:%u\n", kind, occurrence->file, occurrence->line,
+         occurrence->column);
+}
+
+static int symbol_index_find(int argc, const char **argv) {
+  CXSymbolIndex SymIdx;
+  unsigned roles = 0;
+  int i;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: -symbol-index-find <index file> <USR> "
+                    "[declarations] [definitions] [references]\n");
+    return 1;
+  }
+
+  for (i = 2; i < argc; ++i) {
+    if (strcmp(argv[i], "declarations") == 0)
+      roles |= CXSymbolRole_Declaration;
+    else if (strcmp(argv[i], "definitions") == 0)
+      roles |= CXSymbolRole_Definition;
+    else if (strcmp(argv[i], "references") == 0)
+      roles |= CXSymbolRole_Reference;
+    else {
+      fprintf(stderr, "unknown symbol role '%s'\n", argv[i]);
+      return 1;
+    }
+  }
+  if (!roles)
+    roles = CXSymbolRole_Declaration | CXSymbolRole_Definition |
+            CXSymbolRole_Reference;
+
+  if (!(SymIdx = clang_SymbolIndex_create(argv[0]))) {
+    fprintf(stderr, "Could not open symbol index %s\n", argv[0]);
+    return 1;
+  }
+
+  if (clang_SymbolIndex_findOccurrences(SymIdx, argv[1], roles,
+                                        printSymbolOccurrence, 0) == 0)
+    printf("no occurrences of %s\n", argv[1]);
+
+  clang_SymbolIndex_dispose(SymIdx);
+  return 0;
+}
+
 int perform_token_annotation(int argc, const char **argv) {
   const char *input = argv[1];
   char *filename = 0;
@@ -3991,6 +4193,8 @@ static CXCursorVisitor GetVisitor(const char *s) {
     return USRVisitor;
   if (strncmp(s, "-memory-usage", 13) == 0)
     return GetVisitor(s + 13);
+  if (strncmp(s, "-main-file", 10) == 0)
+    return GetVisitor(s + 10);
   return NULL;
 }
 
@@ -4006,6 +4210,9 @@ static void print_usage(void) {
     "       c-index-test -index-file-full [-check-prefix=<FileCheck prefix>] <compiler arguments>\n"
     "       c-index-test -index-tu [-check-prefix=<FileCheck prefix>] <AST file>\n"
     "       c-index-test -index-compile-db [-check-prefix=<FileCheck prefix>] <compilation database>\n"
+    "       c-index-test -symbol-index-update <index file> <compiler arguments>\n"
+    "       c-index-test -symbol-index-find <index file> <USR> "
+          "[declarations] [definitions] [references]\n"
     "       c-index-test -test-file-scan <AST file> <source file> "
           "[FileCheck prefix]\n");
   fprintf(stderr,
@@ -4019,12 +4226,15 @@ static void print_usage(void) {
     "<symbol filter> {<args>}*\n"
     "       c-index-test -test-load-source-reparse <trials> <symbol filter> "
     "          {<args>}*\n"
+    "       c-index-test -test-load-source-reparse-main-file <trials> "
+    "<symbol filter> {<args>}*\n"
     "       c-index-test -test-load-source-usrs <symbol filter> {<args>}*\n"
     "       c-index-test -test-load-source-usrs-memory-usage "
           "<symbol filter> {<args>}*\n"
     "       c-index-test -test-annotate-tokens=<range> {<args>}*\n"
     "       c-index-test -test-inclusion-stack-source {<args>}*\n"
-    "       c-index-test -test-inclusion-stack-tu <AST file>\n");
+    "       c-index-test -test-inclusion-stack-tu <AST file>\n"
+    "       c-index-test -test-print-cursor-records {<args>}*\n");
   fprintf(stderr,
     "       c-index-test -test-print-linkage-source {<args>}*\n"
     "       c-index-test -test-print-type {<args>}*\n"
@@ -4075,6 +4285,10 @@ int cindextest_main(int argc, const char **argv) {
     return index_tu(argc - 2, argv + 2);
   if (argc > 2 && strcmp(argv[1], "-index-compile-db") == 0)
     return index_compile_db(argc - 2, argv + 2);
+  if (argc > 2 && strcmp(argv[1], "-symbol-index-update") == 0)
+    return symbol_index_update(argc - 2, argv + 2);
+  if (argc > 2 && strcmp(argv[1], "-symbol-index-find") == 0)
+    return symbol_index_find(argc - 2, argv + 2);
   else if (argc >= 4 && strncmp(argv[1], "-test-load-tu", 13) == 0) {
     CXCursorVisitor I = GetVisitor(argv[1] + 13);
     if (I)
@@ -4083,10 +4297,15 @@ int cindextest_main(int argc, const char **argv) {
   }
   else if (argc >= 5 && strncmp(argv[1], "-test-load-source-reparse", 25) == 0){
     CXCursorVisitor I = GetVisitor(argv[1] + 25);
+
+    PostVisitTU postVisit = 0;
+    if (strstr(argv[1], "-main-file"))
+      postVisit = PrintMainFileCursors;
+
     if (I) {
       int trials = atoi(argv[2]);
       return perform_test_reparse_source(argc - 4, argv + 4, trials, argv[3], I, 
-                                         NULL);
+                                         postVisit);
     }
   }
   else if (argc >= 4 && strncmp(argv[1], "-test-load-source", 17) == 0) {
@@ -4111,6 +4330,9 @@ int cindextest_main(int argc, const char **argv) {
   else if (argc > 2 && strcmp(argv[1], "-test-inclusion-stack-tu") == 0)
     return perform_test_load_tu(argv[2], "all", NULL, NULL,
                                 PrintInclusionStack);
+  else if (argc > 2 && strcmp(argv[1], "-test-print-cursor-records") == 0)
+    return perform_test_load_source(argc - 2, argv + 2, "all", NULL,
+                                    PrintCursorRecords);
   else if (argc > 2 && strcmp(argv[1], "-test-print-linkage-source") == 0)
     return perform_test_load_source(argc - 2, argv + 2, "all", PrintLinkage,
                                     NULL);
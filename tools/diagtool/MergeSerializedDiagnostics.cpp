@@ -0,0 +1,102 @@
+//===- MergeSerializedDiagnostics.cpp - diagtool tool for merging .dia ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides a diagtool tool that merges many serialized diagnostics
+// files into one, dropping diagnostics repeated across translation units.
+//
+//===----------------------------------------------------------------------===//
+
+#include "DiagTool.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Frontend/SerializedDiagnosticPrinter.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+DEF_DIAGTOOL("merge-sdiags",
+             "Merge serialized diagnostics files, dropping duplicates",
+             MergeSerializedDiagnostics)
+
+using namespace clang;
+using namespace diagtool;
+
+static void printUsage() {
+  llvm::errs() << "Usage: diagtool merge-sdiags [-j <threads>] [-stats] "
+                  "[-file-list <file>] -o <output.dia> <input.dia>...\n";
+}
+
+/// \brief Add the paths listed one per line in \p ListFile to \p Inputs.
+static bool readFileList(StringRef ListFile, std::vector<std::string> &Inputs) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufferOrErr =
+      llvm::MemoryBuffer::getFile(ListFile);
+  if (!BufferOrErr) {
+    llvm::errs() << "error: could not read '" << ListFile
+                 << "': " << BufferOrErr.getError().message() << '\n';
+    return false;
+  }
+
+  StringRef Rest = (*BufferOrErr)->getBuffer();
+  while (!Rest.empty()) {
+    std::pair<StringRef, StringRef> Split = Rest.split('\n');
+    StringRef Line = Split.first.trim();
+    if (!Line.empty())
+      Inputs.push_back(Line);
+    Rest = Split.second;
+  }
+  return true;
+}
+
+int MergeSerializedDiagnostics::run(unsigned int argc, char **argv,
+                                    llvm::raw_ostream &out) {
+  std::vector<std::string> Inputs;
+  StringRef Output;
+  unsigned NumThreads = 0;
+  bool PrintStats = false;
+
+  for (unsigned I = 0; I != argc; ++I) {
+    StringRef Arg = argv[I];
+    if (Arg == "-o" && I + 1 != argc) {
+      Output = argv[++I];
+    } else if (Arg == "-j" && I + 1 != argc) {
+      NumThreads = std::atoi(argv[++I]);
+    } else if (Arg == "-file-list" && I + 1 != argc) {
+      if (!readFileList(argv[++I], Inputs))
+        return 1;
+    } else if (Arg == "-stats") {
+      PrintStats = true;
+    } else if (Arg.startswith("-")) {
+      printUsage();
+      return 1;
+    } else {
+      Inputs.push_back(Arg);
+    }
+  }
+
+  if (Output.empty() || Inputs.empty()) {
+    printUsage();
+    return 1;
+  }
+
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts(new DiagnosticOptions());
+  serialized_diags::MergeStatistics Stats;
+  if (std::error_code EC = serialized_diags::mergeDiagnosticFiles(
+          Inputs, Output, DiagOpts.get(), NumThreads, &Stats)) {
+    llvm::errs() << "error: could not merge serialized diagnostics: "
+                 << EC.message() << '\n';
+    return 1;
+  }
+
+  if (PrintStats)
+    out << Stats.NumFiles << " files, " << Stats.NumDiagnostics
+        << " diagnostics, " << Stats.NumDuplicates << " duplicates dropped, "
+        << Stats.NumSkippedFiles << " files skipped\n";
+  return 0;
+}
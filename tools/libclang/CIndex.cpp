@@ -32,14 +32,17 @@
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
+#include "clang/Frontend/PrecompiledPreambleCache.h"
 #include "clang/Index/CommentToXML.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/Lexer.h"
 #include "clang/Lex/PreprocessingRecord.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Serialization/SerializationDiagnostic.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/IR/DataLayout.h"
@@ -50,6 +53,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/SaveAndRestore.h"
 #include "llvm/Support/Signals.h"
@@ -81,9 +85,107 @@ CXTranslationUnit cxtu::MakeCXTranslationUnit(CIndexer *CIdx, ASTUnit *AU) {
   D->Diagnostics = nullptr;
   D->OverridenCursorsPool = createOverridenCXCursorsPool();
   D->CommentToXML = nullptr;
+  D->Hibernating = false;
+  updateSourceManager(D, nullptr, &AU->getSourceManager());
   return D;
 }
 
+void cxtu::wakeTranslationUnit(CXTranslationUnit TU) {
+  cxtu::TULock Lock(TU);
+  if (!TU->Hibernating)
+    return;
+
+  TU->Hibernating = false;
+  ASTUnit *CXXUnit = TU->TheASTUnit;
+  const SourceManager *OldSM = &CXXUnit->getSourceManager();
+  if (CXXUnit->wake()) {
+    LOG_FUNC_SECTION {
+      *Log << "failed to wake " << TU;
+    }
+  }
+  updateSourceManager(TU, OldSM, &CXXUnit->getSourceManager());
+}
+
+std::thread::id cxtu::TUMutex::getOwner(std::thread::id Thread) const {
+  std::map<std::thread::id, std::thread::id>::const_iterator Delegate =
+      Delegates.find(Thread);
+  return Delegate == Delegates.end() ? Thread : Delegate->second;
+}
+
+void cxtu::TUMutex::lock() {
+  std::unique_lock<std::mutex> Guard(Mutex);
+  std::thread::id Self = getOwner(std::this_thread::get_id());
+  Released.wait(Guard, [&] { return Depth == 0 || Owner == Self; });
+  Owner = Self;
+  ++Depth;
+}
+
+void cxtu::TUMutex::unlock() {
+  {
+    std::lock_guard<std::mutex> Guard(Mutex);
+    assert(Depth && Owner == getOwner(std::this_thread::get_id()) &&
+           "Lock is not held by this thread");
+    if (--Depth)
+      return;
+  }
+  Released.notify_all();
+}
+
+cxtu::TULockDelegation::TULockDelegation(const TULock &Lock)
+    : Mutex(Lock.Mutex), Delegate(std::this_thread::get_id()), Depth(0) {
+  if (!Mutex)
+    return;
+
+  std::lock_guard<std::mutex> Guard(Mutex->Mutex);
+  Owner = Mutex->getOwner(Lock.Owner);
+  assert(Mutex->Depth && Mutex->Owner == Owner && "Lock is not held");
+  Depth = Mutex->Depth;
+  if (Delegate != Owner)
+    Mutex->Delegates[Delegate] = Owner;
+}
+
+cxtu::TULockDelegation::~TULockDelegation() {
+  if (!Mutex)
+    return;
+
+  // This runs on the owner's thread when recovering from a crash, and
+  // releases the holds the crashed thread left behind.
+  std::lock_guard<std::mutex> Guard(Mutex->Mutex);
+  Mutex->Delegates.erase(Delegate);
+  Mutex->Owner = Owner;
+  Mutex->Depth = Depth;
+}
+
+namespace {
+/// \brief The translation units that own each source manager, for the calls
+/// that are only given a source location.
+struct SourceManagerOwners {
+  llvm::sys::Mutex Mutex;
+  llvm::DenseMap<const SourceManager *, CXTranslationUnit> TUs;
+};
+}
+
+static llvm::ManagedStatic<SourceManagerOwners> SourceManagerOwnersMap;
+
+void cxtu::updateSourceManager(CXTranslationUnit TU,
+                               const SourceManager *OldSM,
+                               const SourceManager *SM) {
+  if (OldSM == SM)
+    return;
+  SourceManagerOwners &Owners = *SourceManagerOwnersMap;
+  llvm::MutexGuard Guard(Owners.Mutex);
+  if (OldSM)
+    Owners.TUs.erase(OldSM);
+  if (SM)
+    Owners.TUs[SM] = TU;
+}
+
+CXTranslationUnit cxtu::getTUForSourceManager(const SourceManager *SM) {
+  SourceManagerOwners &Owners = *SourceManagerOwnersMap;
+  llvm::MutexGuard Guard(Owners.Mutex);
+  return Owners.TUs.lookup(SM);
+}
+
 bool cxtu::isASTReadError(ASTUnit *AU) {
   for (ASTUnit::stored_diag_iterator D = AU->stored_diag_begin(),
                                      DEnd = AU->stored_diag_end();
@@ -346,7 +448,8 @@ bool CursorVisitor::visitDeclsFromFileRegion(FileID File,
       if (!TD->isFreeStanding())
         continue;
 
-    RangeComparisonResult CompRes = RangeCompare(SM, D->getSourceRange(),Range);
+    SourceRange DeclRange = Unit->mapRangeFromPreamble(D->getSourceRange());
+    RangeComparisonResult CompRes = RangeCompare(SM, DeclRange, Range);
     if (CompRes == RangeBefore)
       continue;
     if (CompRes == RangeAfter)
@@ -381,7 +484,8 @@ bool CursorVisitor::visitDeclsFromFileRegion(FileID File,
     if (CurDeclRange.isInvalid())
       break;
 
-    if (RangeCompare(SM, CurDeclRange, Range) == RangeOverlap) {
+    if (RangeCompare(SM, Unit->mapRangeFromPreamble(CurDeclRange), Range) ==
+        RangeOverlap) {
       if (Visit(MakeCXCursor(D, TU, Range), /*CheckedRegionOfInterest=*/true))
         return true; // visitation break.
     }
@@ -432,9 +536,13 @@ bool CursorVisitor::visitPreprocessedEntitiesInRegion() {
   bool OnlyLocalDecls
     = !AU->isMainFileAST() && AU->getOnlyLocalDecls(); 
   
-  if (OnlyLocalDecls)
-    return visitPreprocessedEntities(PPRec.local_begin(), PPRec.local_end(),
-                                     PPRec);
+  if (OnlyLocalDecls) {
+    // The local entities of a unit that woke from hibernation were loaded
+    // along with the rest of its AST.
+    std::pair<PreprocessingRecord::iterator, PreprocessingRecord::iterator>
+      Local = AU->getLocalPreprocessingEntities();
+    return visitPreprocessedEntities(Local.first, Local.second, PPRec);
+  }
 
   return visitPreprocessedEntities(PPRec.begin(), PPRec.end(), PPRec);
 }
@@ -2739,6 +2847,10 @@ struct RegisterFatalErrorHandler {
 
 static llvm::ManagedStatic<RegisterFatalErrorHandler> RegisterFatalErrorHandlerOnce;
 
+/// \brief The default limit on the total size of the precompiled preambles an
+/// index keeps around for sharing.
+static const uint64_t DefaultPreambleCacheSize = 512 * 1024 * 1024;
+
 extern "C" {
 CXIndex clang_createIndex(int excludeDeclarationsFromPCH,
                           int displayDiagnostics) {
@@ -2765,6 +2877,9 @@ CXIndex clang_createIndex(int excludeDeclarationsFromPCH,
     CIdxr->setCXGlobalOptFlags(CIdxr->getCXGlobalOptFlags() |
                                CXGlobalOpt_ThreadBackgroundPriorityForEditing);
 
+  CIdxr->setPreambleCache(std::make_shared<PrecompiledPreambleCache>(
+      StringRef(), DefaultPreambleCacheSize));
+
   return CIdxr;
 }
 
@@ -2784,6 +2899,18 @@ unsigned clang_CXIndex_getGlobalOptions(CXIndex CIdx) {
   return 0;
 }
 
+void clang_CXIndex_setPreambleCacheOptions(CXIndex CIdx, const char *Directory,
+                                           unsigned long long MaxSize) {
+  if (!CIdx)
+    return;
+
+  // Translation units that already share a preamble keep the old cache alive
+  // for as long as they need it.
+  static_cast<CIndexer *>(CIdx)->setPreambleCache(
+      std::make_shared<PrecompiledPreambleCache>(
+          Directory ? Directory : "", MaxSize));
+}
+
 void clang_toggleCrashRecovery(unsigned isEnabled) {
   if (isEnabled)
     llvm::CrashRecoveryContext::Enable();
@@ -2965,7 +3092,8 @@ static void clang_parseTranslationUnit_Impl(void *UserData) {
       /*RemappedFilesKeepOriginalName=*/true, PrecompilePreamble, TUKind,
       CacheCodeCompletionResults, IncludeBriefCommentsInCodeCompletion,
       /*AllowPCHWithCompilerErrors=*/true, SkipFunctionBodies,
-      /*UserFilesAreVolatile=*/true, ForSerialization, &ErrUnit));
+      /*UserFilesAreVolatile=*/true, ForSerialization, &ErrUnit,
+      CXXIdx->getPreambleCache()));
 
   if (NumErrors != Diags->getClient()->getNumErrors()) {
     // Make sure to check that 'Unit' is non-NULL.
@@ -3097,6 +3225,7 @@ int clang_saveTranslationUnit(CXTranslationUnit TU, const char *FileName,
     return CXSaveError_InvalidTU;
   }
 
+  cxtu::TULock Lock(TU);
   ASTUnit *CXXUnit = cxtu::getASTUnit(TU);
   ASTUnit::ConcurrencyCheck Check(*CXXUnit);
   if (!CXXUnit->hasSema())
@@ -3138,15 +3267,22 @@ void clang_disposeTranslationUnit(CXTranslationUnit CTUnit) {
   if (CTUnit) {
     // If the translation unit has been marked as unsafe to free, just discard
     // it.
-    ASTUnit *Unit = cxtu::getASTUnit(CTUnit);
+    // There is no need to wake a hibernating translation unit to free it.
+    ASTUnit *Unit = CTUnit->TheASTUnit;
     if (Unit && Unit->isUnsafeToFree())
       return;
 
-    delete cxtu::getASTUnit(CTUnit);
-    delete CTUnit->StringPool;
-    delete static_cast<CXDiagnosticSetImpl *>(CTUnit->Diagnostics);
-    disposeOverridenCXCursorsPool(CTUnit->OverridenCursorsPool);
-    delete CTUnit->CommentToXML;
+    {
+      // Wait for any calls still using the translation unit.
+      cxtu::TULock Lock(CTUnit);
+      if (Unit)
+        updateSourceManager(CTUnit, &Unit->getSourceManager(), nullptr);
+      delete Unit;
+      delete CTUnit->StringPool;
+      delete static_cast<CXDiagnosticSetImpl *>(CTUnit->Diagnostics);
+      disposeOverridenCXCursorsPool(CTUnit->OverridenCursorsPool);
+      delete CTUnit->CommentToXML;
+    }
     delete CTUnit;
   }
 }
@@ -3167,7 +3303,6 @@ static void clang_reparseTranslationUnit_Impl(void *UserData) {
       static_cast<ReparseTranslationUnitInfo *>(UserData);
   CXTranslationUnit TU = RTUI->TU;
   unsigned options = RTUI->options;
-  (void) options;
 
   // Check arguments.
   if (isNotUsableTU(TU)) {
@@ -3184,7 +3319,10 @@ static void clang_reparseTranslationUnit_Impl(void *UserData) {
   if (CXXIdx->isOptEnabled(CXGlobalOpt_ThreadBackgroundPriorityForEditing))
     setThreadBackgroundPriority();
 
-  ASTUnit *CXXUnit = cxtu::getASTUnit(TU);
+  // Reparsing replaces the AST of a hibernating translation unit without
+  // loading it first.
+  ASTUnit *CXXUnit = TU->TheASTUnit;
+  TU->Hibernating = false;
   ASTUnit::ConcurrencyCheck Check(*CXXUnit);
 
   std::unique_ptr<std::vector<ASTUnit::RemappedFile>> RemappedFiles(
@@ -3200,10 +3338,17 @@ static void clang_reparseTranslationUnit_Impl(void *UserData) {
     RemappedFiles->push_back(std::make_pair(UF.Filename, MB.release()));
   }
 
+  CXXUnit->setBuildPreambleInBackground(
+      options & CXReparse_BuildPreambleInBackground);
+  CXXUnit->setIncrementalReparse(
+      options & CXReparse_ReuseUnchangedDeclarations);
+
+  const SourceManager *OldSM = &CXXUnit->getSourceManager();
   if (!CXXUnit->Reparse(*RemappedFiles.get()))
     RTUI->result = CXError_Success;
   else if (isASTReadError(CXXUnit))
     RTUI->result = CXError_ASTReadError;
+  updateSourceManager(TU, OldSM, &CXXUnit->getSourceManager());
 }
 
 int clang_reparseTranslationUnit(CXTranslationUnit TU,
@@ -3217,6 +3362,9 @@ int clang_reparseTranslationUnit(CXTranslationUnit TU,
   if (num_unsaved_files && !unsaved_files)
     return CXError_InvalidArguments;
 
+  // Wait for any queries on the translation unit to finish.
+  cxtu::TULock Lock(TU);
+
   CXErrorCode result = CXError_Failure;
   ReparseTranslationUnitInfo RTUI = {
       TU, llvm::makeArrayRef(unsaved_files, num_unsaved_files), options,
@@ -3239,6 +3387,35 @@ int clang_reparseTranslationUnit(CXTranslationUnit TU,
   return result;
 }
 
+int clang_hibernateTranslationUnit(CXTranslationUnit TU) {
+  LOG_FUNC_SECTION {
+    *Log << TU;
+  }
+
+  if (isNotUsableTU(TU)) {
+    LOG_BAD_TU(TU);
+    return CXError_InvalidArguments;
+  }
+
+  // Wait for any queries on the translation unit to finish.
+  cxtu::TULock Lock(TU);
+  if (TU->Hibernating)
+    return CXError_Success;
+
+  ASTUnit *CXXUnit = TU->TheASTUnit;
+  ASTUnit::ConcurrencyCheck Check(*CXXUnit);
+  const SourceManager *OldSM = &CXXUnit->getSourceManager();
+  if (CXXUnit->hibernate())
+    return CXError_Failure;
+
+  // The diagnostics refer to the source manager that was released.
+  delete static_cast<CXDiagnosticSetImpl*>(TU->Diagnostics);
+  TU->Diagnostics = nullptr;
+
+  TU->Hibernating = true;
+  updateSourceManager(TU, OldSM, &CXXUnit->getSourceManager());
+  return CXError_Success;
+}
 
 CXString clang_getTranslationUnitSpelling(CXTranslationUnit CTUnit) {
   if (isNotUsableTU(CTUnit)) {
@@ -3246,6 +3423,7 @@ CXString clang_getTranslationUnitSpelling(CXTranslationUnit CTUnit) {
     return cxstring::createEmpty();
   }
 
+  cxtu::TULock Lock(CTUnit);
   ASTUnit *CXXUnit = cxtu::getASTUnit(CTUnit);
   return cxstring::createDup(CXXUnit->getOriginalSourceFileName());
 }
@@ -3256,6 +3434,7 @@ CXCursor clang_getTranslationUnitCursor(CXTranslationUnit TU) {
     return clang_getNullCursor();
   }
 
+  cxtu::TULock Lock(TU);
   ASTUnit *CXXUnit = cxtu::getASTUnit(TU);
   return MakeCXCursor(CXXUnit->getASTContext().getTranslationUnitDecl(), TU);
 }
@@ -3284,6 +3463,7 @@ time_t clang_getFileTime(CXFile SFile) {
 }
 
 CXFile clang_getFile(CXTranslationUnit TU, const char *file_name) {
+  cxtu::TULock Lock(TU);
   if (isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return nullptr;
@@ -3297,6 +3477,7 @@ CXFile clang_getFile(CXTranslationUnit TU, const char *file_name) {
 
 unsigned clang_isFileMultipleIncludeGuarded(CXTranslationUnit TU,
                                             CXFile file) {
+  cxtu::TULock Lock(TU);
   if (isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return 0;
@@ -3409,11 +3590,89 @@ static SourceLocation getLocationFromExpr(const Expr *E) {
   return E->getLocStart();
 }
 
+namespace {
+/// \brief Collects the records produced by clang_visitChildrenBulk().
+struct CursorRecordCollector {
+  unsigned Options;
+
+  std::vector<CXCursorRecord> Records;
+
+  /// \brief The cursors whose descendants are being visited, along with the
+  /// indices of their records.
+  SmallVector<std::pair<CXCursor, int>, 16> Parents;
+
+  /// \brief The string table, which starts with an empty string.
+  SmallVector<char, 4096> Strings;
+
+  /// \brief Maps the strings in the string table to their offsets.
+  llvm::StringMap<unsigned> StringOffsets;
+
+  explicit CursorRecordCollector(unsigned Options)
+    : Options(Options), Strings(1, '\0') { }
+
+  /// \brief Add the given string to the string table and dispose of it.
+  unsigned addString(CXString Str) {
+    const char *CStr = clang_getCString(Str);
+    StringRef S = CStr ? StringRef(CStr) : StringRef();
+    unsigned Offset = 0;
+    if (!S.empty()) {
+      unsigned &Known = StringOffsets[S];
+      if (!Known) {
+        Known = Strings.size();
+        Strings.append(S.begin(), S.end());
+        Strings.push_back('\0');
+      }
+      Offset = Known;
+    }
+    clang_disposeString(Str);
+    return Offset;
+  }
+};
+}
+
+static enum CXChildVisitResult collectCursorRecord(CXCursor C,
+                                                   CXCursor Parent,
+                                                   CXClientData client_data) {
+  CursorRecordCollector &Collector
+    = *static_cast<CursorRecordCollector *>(client_data);
+
+  // Find the record of the parent among the cursors whose descendants we are
+  // visiting; the ones after it have no more children to visit.
+  while (!Collector.Parents.empty() &&
+         !clang_equalCursors(Collector.Parents.back().first, Parent))
+    Collector.Parents.pop_back();
+
+  CXCursorRecord Record;
+  Record.kind = C.kind;
+  Record.parent =
+      Collector.Parents.empty() ? -1 : Collector.Parents.back().second;
+
+  CXSourceRange Extent = clang_getCursorExtent(C);
+  clang_getExpansionLocation(clang_getRangeStart(Extent), &Record.file,
+                             &Record.start_line, &Record.start_column,
+                             &Record.start_offset);
+  clang_getExpansionLocation(clang_getRangeEnd(Extent), nullptr,
+                             &Record.end_line, &Record.end_column,
+                             &Record.end_offset);
+
+  Record.spelling = 0;
+  if (Collector.Options & CXCursorRecord_IncludeSpellings)
+    Record.spelling = Collector.addString(clang_getCursorSpelling(C));
+  Record.usr = 0;
+  if (Collector.Options & CXCursorRecord_IncludeUSRs)
+    Record.usr = Collector.addString(clang_getCursorUSR(C));
+
+  Collector.Parents.push_back(std::make_pair(C, (int)Collector.Records.size()));
+  Collector.Records.push_back(Record);
+  return CXChildVisit_Recurse;
+}
+
 extern "C" {
 
 unsigned clang_visitChildren(CXCursor parent,
                              CXCursorVisitor visitor,
                              CXClientData client_data) {
+  cxtu::TULock Lock(getCursorTU(parent));
   CursorVisitor CursorVis(getCursorTU(parent), visitor, client_data,
                           /*VisitPreprocessorLast=*/false);
   return CursorVis.VisitChildren(parent);
@@ -3456,6 +3715,27 @@ unsigned clang_visitChildrenWithBlock(CXCursor parent,
   return clang_visitChildren(parent, visitWithBlock, block);
 }
 
+unsigned clang_visitChildrenBulk(CXCursor parent, unsigned options,
+                                 CXCursorRecord *records, unsigned num_records,
+                                 char *strings, unsigned strings_size,
+                                 unsigned *strings_size_needed) {
+  cxtu::TULock Lock(getCursorTU(parent));
+  CursorRecordCollector Collector(options);
+  CursorVisitor CursorVis(getCursorTU(parent), collectCursorRecord, &Collector,
+                          /*VisitPreprocessorLast=*/false);
+  CursorVis.VisitChildren(parent);
+
+  if (strings_size_needed)
+    *strings_size_needed = Collector.Strings.size();
+
+  if (records && Collector.Records.size() <= num_records &&
+      strings && Collector.Strings.size() <= strings_size) {
+    std::copy(Collector.Records.begin(), Collector.Records.end(), records);
+    std::copy(Collector.Strings.begin(), Collector.Strings.end(), strings);
+  }
+  return Collector.Records.size();
+}
+
 static CXString getDeclSpelling(const Decl *D) {
   if (!D)
     return cxstring::createEmpty();
@@ -3494,6 +3774,7 @@ static CXString getDeclSpelling(const Decl *D) {
 }
 
 CXString clang_getCursorSpelling(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (clang_isTranslationUnit(C.kind))
     return clang_getTranslationUnitSpelling(getCursorTU(C));
 
@@ -3644,6 +3925,7 @@ CXString clang_getCursorSpelling(CXCursor C) {
 CXSourceRange clang_Cursor_getSpellingNameRange(CXCursor C,
                                                 unsigned pieceIndex,
                                                 unsigned options) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (clang_Cursor_isNull(C))
     return clang_getNullRange();
 
@@ -3736,6 +4018,7 @@ CXSourceRange clang_Cursor_getSpellingNameRange(CXCursor C,
 }
 
 CXString clang_Cursor_getMangling(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (clang_isInvalid(C.kind) || !clang_isDeclaration(C.kind))
     return cxstring::createEmpty();
 
@@ -3767,6 +4050,7 @@ CXString clang_Cursor_getMangling(CXCursor C) {
 }
 
 CXString clang_getCursorDisplayName(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return clang_getCursorSpelling(C);
   
@@ -4324,6 +4608,7 @@ static enum CXChildVisitResult GetCursorVisitor(CXCursor cursor,
 }
 
 CXCursor clang_getCursor(CXTranslationUnit TU, CXSourceLocation Loc) {
+  cxtu::TULock Lock(TU);
   if (isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return clang_getNullCursor();
@@ -4463,7 +4748,7 @@ CXCursorKind clang_getCursorKind(CXCursor C) {
   return C.kind;
 }
 
-CXSourceLocation clang_getCursorLocation(CXCursor C) {
+static CXSourceLocation getRawCursorLocation(CXCursor C) {
   if (clang_isReference(C.kind)) {
     switch (C.kind) {
     case CXCursor_ObjCSuperClassRef: {
@@ -4599,6 +4884,20 @@ CXSourceLocation clang_getCursorLocation(CXCursor C) {
   return cxloc::translateSourceLocation(getCursorContext(C), Loc);
 }
 
+CXSourceLocation clang_getCursorLocation(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
+  CXSourceLocation Loc = getRawCursorLocation(C);
+  SourceLocation SLoc = cxloc::translateSourceLocation(Loc);
+  ASTUnit *CXXUnit = getCursorASTUnit(C);
+  if (!CXXUnit || SLoc.isInvalid())
+    return Loc;
+
+  // Map the parts of the main file that were precompiled into the preamble
+  // back to the main file, as getRawCursorExtent() does for the extent.
+  return cxloc::translateSourceLocation(CXXUnit->getASTContext(),
+                                        CXXUnit->mapLocationFromPreamble(SLoc));
+}
+
 } // end extern "C"
 
 CXCursor cxcursor::getCursor(CXTranslationUnit TU, SourceLocation SLoc) {
@@ -4615,6 +4914,7 @@ CXCursor cxcursor::getCursor(CXTranslationUnit TU, SourceLocation SLoc) {
   // the token under the cursor.
   SLoc = Lexer::GetBeginningOfToken(SLoc, CXXUnit->getSourceManager(),
                                     CXXUnit->getASTContext().getLangOpts());
+  SLoc = CXXUnit->mapLocationFromPreamble(SLoc);
   
   CXCursor Result = MakeCXCursorInvalid(CXCursor_NoDeclFound);
   if (SLoc.isValid()) {
@@ -4629,7 +4929,7 @@ CXCursor cxcursor::getCursor(CXTranslationUnit TU, SourceLocation SLoc) {
   return Result;
 }
 
-static SourceRange getRawCursorExtent(CXCursor C) {
+static SourceRange getCursorSourceRange(CXCursor C) {
   if (clang_isReference(C.kind)) {
     switch (C.kind) {
     case CXCursor_ObjCSuperClassRef:
@@ -4729,6 +5029,16 @@ static SourceRange getRawCursorExtent(CXCursor C) {
   return SourceRange();
 }
 
+/// \brief Retrieves the extent of the cursor, with the parts of the main file
+/// that were precompiled into the preamble mapped back to the main file.
+static SourceRange getRawCursorExtent(CXCursor C) {
+  SourceRange R = getCursorSourceRange(C);
+  if (R.isInvalid())
+    return R;
+  ASTUnit *CXXUnit = getCursorASTUnit(C);
+  return CXXUnit ? CXXUnit->mapRangeFromPreamble(R) : R;
+}
+
 /// \brief Retrieves the "raw" cursor extent, which is then extended to include
 /// the decl-specifier-seq for declarations.
 static SourceRange getFullCursorExtent(CXCursor C, SourceManager &SrcMgr) {
@@ -4764,7 +5074,8 @@ static SourceRange getFullCursorExtent(CXCursor C, SourceManager &SrcMgr) {
         R.setBegin(VD->getLocation());
     }
 
-    return R;    
+    ASTUnit *CXXUnit = getCursorASTUnit(C);
+    return CXXUnit ? CXXUnit->mapRangeFromPreamble(R) : R;
   }
   
   return getRawCursorExtent(C);
@@ -4773,6 +5084,7 @@ static SourceRange getFullCursorExtent(CXCursor C, SourceManager &SrcMgr) {
 extern "C" {
 
 CXSourceRange clang_getCursorExtent(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   SourceRange R = getRawCursorExtent(C);
   if (R.isInvalid())
     return clang_getNullRange();
@@ -4781,6 +5093,7 @@ CXSourceRange clang_getCursorExtent(CXCursor C) {
 }
 
 CXCursor clang_getCursorReferenced(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (clang_isInvalid(C.kind))
     return clang_getNullCursor();
 
@@ -4892,6 +5205,7 @@ CXCursor clang_getCursorReferenced(CXCursor C) {
 }
 
 CXCursor clang_getCursorDefinition(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (clang_isInvalid(C.kind))
     return clang_getNullCursor();
 
@@ -5097,6 +5411,7 @@ CXCursor clang_getCursorDefinition(CXCursor C) {
 }
 
 unsigned clang_isCursorDefinition(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return 0;
 
@@ -5104,6 +5419,7 @@ unsigned clang_isCursorDefinition(CXCursor C) {
 }
 
 CXCursor clang_getCanonicalCursor(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return C;
   
@@ -5123,10 +5439,12 @@ CXCursor clang_getCanonicalCursor(CXCursor C) {
 }
 
 int clang_Cursor_getObjCSelectorIndex(CXCursor cursor) {
+  cxtu::TULock Lock(getCursorTU(cursor));
   return cxcursor::getSelectorIdentifierIndexAndLoc(cursor).first;
 }
   
 unsigned clang_getNumOverloadedDecls(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (C.kind != CXCursor_OverloadedDeclRef)
     return 0;
   
@@ -5146,6 +5464,7 @@ unsigned clang_getNumOverloadedDecls(CXCursor C) {
 }
 
 CXCursor clang_getOverloadedDecl(CXCursor cursor, unsigned index) {
+  cxtu::TULock Lock(getCursorTU(cursor));
   if (cursor.kind != CXCursor_OverloadedDeclRef)
     return clang_getNullCursor();
 
@@ -5179,6 +5498,7 @@ void clang_getDefinitionSpellingAndExtent(CXCursor C,
                                           unsigned *startColumn,
                                           unsigned *endLine,
                                           unsigned *endColumn) {
+  cxtu::TULock Lock(getCursorTU(C));
   assert(getCursorDecl(C) && "CXCursor has null decl");
   const FunctionDecl *FD = dyn_cast<FunctionDecl>(getCursorDecl(C));
   CompoundStmt *Body = dyn_cast<CompoundStmt>(FD->getBody());
@@ -5195,6 +5515,7 @@ void clang_getDefinitionSpellingAndExtent(CXCursor C,
 
 CXSourceRange clang_getCursorReferenceNameRange(CXCursor C, unsigned NameFlags,
                                                 unsigned PieceIndex) {
+  cxtu::TULock Lock(getCursorTU(C));
   RefNamePieces Pieces;
   
   switch (C.kind) {
@@ -5270,6 +5591,7 @@ CXTokenKind clang_getTokenKind(CXToken CXTok) {
 }
 
 CXString clang_getTokenSpelling(CXTranslationUnit TU, CXToken CXTok) {
+  cxtu::TULock Lock(TU);
   switch (clang_getTokenKind(CXTok)) {
   case CXToken_Identifier:
   case CXToken_Keyword:
@@ -5312,6 +5634,7 @@ CXString clang_getTokenSpelling(CXTranslationUnit TU, CXToken CXTok) {
 }
 
 CXSourceLocation clang_getTokenLocation(CXTranslationUnit TU, CXToken CXTok) {
+  cxtu::TULock Lock(TU);
   if (isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return clang_getNullLocation();
@@ -5326,6 +5649,7 @@ CXSourceLocation clang_getTokenLocation(CXTranslationUnit TU, CXToken CXTok) {
 }
 
 CXSourceRange clang_getTokenExtent(CXTranslationUnit TU, CXToken CXTok) {
+  cxtu::TULock Lock(TU);
   if (isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return clang_getNullRange();
@@ -5413,6 +5737,7 @@ static void getTokens(ASTUnit *CXXUnit, SourceRange Range,
 
 void clang_tokenize(CXTranslationUnit TU, CXSourceRange Range,
                     CXToken **Tokens, unsigned *NumTokens) {
+  cxtu::TULock Lock(TU);
   LOG_FUNC_SECTION {
     *Log << TU << ' ' << Range;
   }
@@ -5905,6 +6230,7 @@ namespace {
     CXToken *Tokens;
     unsigned NumTokens;
     CXCursor *Cursors;
+    const cxtu::TULock *Lock;
   };
 }
 
@@ -6033,6 +6359,14 @@ static void clang_annotateTokensImpl(void *UserData) {
   const unsigned NumTokens = ((clang_annotateTokens_Data*)UserData)->NumTokens;
   CXCursor *Cursors = ((clang_annotateTokens_Data*)UserData)->Cursors;
 
+  // The caller holds the lock and waits for this thread, which may not be
+  // the caller's; act with its holds, and restore them if we crash.
+  cxtu::TULockDelegation Delegation(
+      *((clang_annotateTokens_Data*)UserData)->Lock);
+  llvm::CrashRecoveryContextCleanupRegistrar<cxtu::TULockDelegation,
+      llvm::CrashRecoveryContextDestructorCleanup<cxtu::TULockDelegation> >
+    DelegationCleanup(&Delegation);
+
   CIndexer *CXXIdx = TU->CIdx;
   if (CXXIdx->isOptEnabled(CXGlobalOpt_ThreadBackgroundPriorityForEditing))
     setThreadBackgroundPriority();
@@ -6163,13 +6497,17 @@ void clang_annotateTokens(CXTranslationUnit TU,
   for (unsigned I = 0; I != NumTokens; ++I)
     Cursors[I] = C;
 
+  // Take the lock on this thread, which may already hold it if we were
+  // called from a visitor.
+  cxtu::TULock Lock(TU);
   ASTUnit *CXXUnit = cxtu::getASTUnit(TU);
   if (!CXXUnit)
     return;
 
   ASTUnit::ConcurrencyCheck Check(*CXXUnit);
-  
-  clang_annotateTokens_Data data = { TU, CXXUnit, Tokens, NumTokens, Cursors };
+
+  clang_annotateTokens_Data data = { TU, CXXUnit, Tokens, NumTokens, Cursors,
+                                     &Lock };
   llvm::CrashRecoveryContext CRC;
   if (!RunSafely(CRC, clang_annotateTokensImpl, &data,
                  GetSafetyThreadStackSize() * 2)) {
@@ -6185,6 +6523,7 @@ void clang_annotateTokens(CXTranslationUnit TU,
 
 extern "C" {
 CXLinkageKind clang_getCursorLinkage(CXCursor cursor) {
+  cxtu::TULock Lock(getCursorTU(cursor));
   if (!clang_isDeclaration(cursor.kind))
     return CXLinkage_Invalid;
 
@@ -6280,6 +6619,7 @@ static CXAvailabilityKind getCursorAvailabilityForDecl(const Decl *D) {
 }
 
 enum CXAvailabilityKind clang_getCursorAvailability(CXCursor cursor) {
+  cxtu::TULock Lock(getCursorTU(cursor));
   if (clang_isDeclaration(cursor.kind))
     if (const Decl *D = cxcursor::getCursorDecl(cursor))
       return getCursorAvailabilityForDecl(D);
@@ -6375,6 +6715,7 @@ int clang_getCursorPlatformAvailability(CXCursor cursor,
                                         CXString *unavailable_message,
                                         CXPlatformAvailability *availability,
                                         int availability_size) {
+  cxtu::TULock Lock(getCursorTU(cursor));
   if (always_deprecated)
     *always_deprecated = 0;
   if (deprecated_message)
@@ -6405,6 +6746,7 @@ void clang_disposeCXPlatformAvailability(CXPlatformAvailability *availability) {
 }
 
 CXLanguageKind clang_getCursorLanguage(CXCursor cursor) {
+  cxtu::TULock Lock(getCursorTU(cursor));
   if (clang_isDeclaration(cursor.kind))
     return getDeclLanguage(cxcursor::getCursorDecl(cursor));
 
@@ -6431,6 +6773,7 @@ static const Decl *maybeGetTemplateCursor(const Decl *D) {
 
 
 enum CX_StorageClass clang_Cursor_getStorageClass(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   StorageClass sc = SC_None;
   const Decl *D = getCursorDecl(C);
   if (D) {
@@ -6464,6 +6807,7 @@ enum CX_StorageClass clang_Cursor_getStorageClass(CXCursor C) {
 }
 
 CXCursor clang_getCursorSemanticParent(CXCursor cursor) {
+  cxtu::TULock Lock(getCursorTU(cursor));
   if (clang_isDeclaration(cursor.kind)) {
     if (const Decl *D = getCursorDecl(cursor)) {
       const DeclContext *DC = D->getDeclContext();
@@ -6484,6 +6828,7 @@ CXCursor clang_getCursorSemanticParent(CXCursor cursor) {
 }
 
 CXCursor clang_getCursorLexicalParent(CXCursor cursor) {
+  cxtu::TULock Lock(getCursorTU(cursor));
   if (clang_isDeclaration(cursor.kind)) {
     if (const Decl *D = getCursorDecl(cursor)) {
       const DeclContext *DC = D->getLexicalDeclContext();
@@ -6501,6 +6846,7 @@ CXCursor clang_getCursorLexicalParent(CXCursor cursor) {
 }
 
 CXFile clang_getIncludedFile(CXCursor cursor) {
+  cxtu::TULock Lock(getCursorTU(cursor));
   if (cursor.kind != CXCursor_InclusionDirective)
     return nullptr;
 
@@ -6509,6 +6855,7 @@ CXFile clang_getIncludedFile(CXCursor cursor) {
 }
 
 unsigned clang_Cursor_getObjCPropertyAttributes(CXCursor C, unsigned reserved) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (C.kind != CXCursor_ObjCPropertyDecl)
     return CXObjCPropertyAttr_noattr;
 
@@ -6538,6 +6885,7 @@ unsigned clang_Cursor_getObjCPropertyAttributes(CXCursor C, unsigned reserved) {
 }
 
 unsigned clang_Cursor_getObjCDeclQualifiers(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return CXObjCDeclQualifier_None;
 
@@ -6562,6 +6910,7 @@ unsigned clang_Cursor_getObjCDeclQualifiers(CXCursor C) {
 }
 
 unsigned clang_Cursor_isObjCOptional(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return 0;
 
@@ -6575,6 +6924,7 @@ unsigned clang_Cursor_isObjCOptional(CXCursor C) {
 }
 
 unsigned clang_Cursor_isVariadic(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return 0;
 
@@ -6588,6 +6938,7 @@ unsigned clang_Cursor_isVariadic(CXCursor C) {
 }
 
 CXSourceRange clang_Cursor_getCommentRange(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return clang_getNullRange();
 
@@ -6601,6 +6952,7 @@ CXSourceRange clang_Cursor_getCommentRange(CXCursor C) {
 }
 
 CXString clang_Cursor_getRawCommentText(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return cxstring::createNull();
 
@@ -6616,6 +6968,7 @@ CXString clang_Cursor_getRawCommentText(CXCursor C) {
 }
 
 CXString clang_Cursor_getBriefCommentText(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return cxstring::createNull();
 
@@ -6635,6 +6988,7 @@ CXString clang_Cursor_getBriefCommentText(CXCursor C) {
 }
 
 CXModule clang_Cursor_getModule(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (C.kind == CXCursor_ModuleImportDecl) {
     if (const ImportDecl *ImportD =
             dyn_cast_or_null<ImportDecl>(getCursorDecl(C)))
@@ -6645,6 +6999,7 @@ CXModule clang_Cursor_getModule(CXCursor C) {
 }
 
 CXModule clang_getModuleForFile(CXTranslationUnit TU, CXFile File) {
+  cxtu::TULock Lock(TU);
   if (isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return nullptr;
@@ -6697,6 +7052,7 @@ int clang_Module_isSystem(CXModule CXMod) {
 
 unsigned clang_Module_getNumTopLevelHeaders(CXTranslationUnit TU,
                                             CXModule CXMod) {
+  cxtu::TULock Lock(TU);
   if (isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return 0;
@@ -6711,6 +7067,7 @@ unsigned clang_Module_getNumTopLevelHeaders(CXTranslationUnit TU,
 
 CXFile clang_Module_getTopLevelHeader(CXTranslationUnit TU,
                                       CXModule CXMod, unsigned Index) {
+  cxtu::TULock Lock(TU);
   if (isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return nullptr;
@@ -6735,6 +7092,7 @@ CXFile clang_Module_getTopLevelHeader(CXTranslationUnit TU,
 
 extern "C" {
 unsigned clang_CXXMethod_isPureVirtual(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return 0;
 
@@ -6745,6 +7103,7 @@ unsigned clang_CXXMethod_isPureVirtual(CXCursor C) {
 }
 
 unsigned clang_CXXMethod_isConst(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return 0;
 
@@ -6755,6 +7114,7 @@ unsigned clang_CXXMethod_isConst(CXCursor C) {
 }
 
 unsigned clang_CXXMethod_isStatic(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return 0;
   
@@ -6765,6 +7125,7 @@ unsigned clang_CXXMethod_isStatic(CXCursor C) {
 }
 
 unsigned clang_CXXMethod_isVirtual(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return 0;
   
@@ -6781,6 +7142,7 @@ unsigned clang_CXXMethod_isVirtual(CXCursor C) {
 
 extern "C" {
 CXType clang_getIBOutletCollectionType(CXCursor C) {
+  cxtu::TULock Lock(getCursorTU(C));
   if (C.kind != CXCursor_IBOutletCollectionAttr)
     return cxtype::MakeCXType(QualType(), cxcursor::getCursorTU(C));
   
@@ -6804,6 +7166,17 @@ static inline void createCXTUResourceUsageEntry(MemUsageEntries &entries,
   entries.push_back(entry);
 }
 
+/// \brief The memory used by the cached global code-completion results of
+/// \p AU.
+static unsigned long getCachedCompletionMemory(ASTUnit &AU) {
+  unsigned long Bytes = 0;
+  ArrayRef<std::shared_ptr<const ASTUnit::CachedCompletionGroup> >
+    Groups = AU.getCachedCompletionGroups();
+  for (unsigned I = 0, N = Groups.size(); I != N; ++I)
+    Bytes += Groups[I]->Allocator->getTotalMemory();
+  return Bytes;
+}
+
 extern "C" {
 
 const char *clang_getTUResourceUsageName(CXTUResourceUsageKind kind) {
@@ -6851,19 +7224,41 @@ const char *clang_getTUResourceUsageName(CXTUResourceUsageKind kind) {
     case CXTUResourceUsage_Preprocessor_HeaderSearch:
       str = "Preprocessor: header search tables";
       break;
+    case CXTUResourceUsage_HibernatedAST:
+      str = "Hibernation: saved AST file (on disk)";
+      break;
   }
   return str;
 }
 
 CXTUResourceUsage clang_getCXTUResourceUsage(CXTranslationUnit TU) {
+  cxtu::TULock Lock(TU);
   if (isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     CXTUResourceUsage usage = { (void*) nullptr, 0, nullptr };
     return usage;
   }
   
-  ASTUnit *astUnit = cxtu::getASTUnit(TU);
+  ASTUnit *astUnit = TU->TheASTUnit;
   std::unique_ptr<MemUsageEntries> entries(new MemUsageEntries());
+
+  // A hibernating translation unit only keeps its cached code completion
+  // results and its saved AST file; don't wake it to look at the memory it
+  // no longer uses.
+  if (TU->Hibernating) {
+    createCXTUResourceUsageEntry(*entries,
+                                 CXTUResourceUsage_GlobalCompletionResults,
+                                 getCachedCompletionMemory(*astUnit));
+    createCXTUResourceUsageEntry(*entries, CXTUResourceUsage_HibernatedAST,
+      (unsigned long) astUnit->getHibernationFileSize());
+
+    CXTUResourceUsage usage = { (void*) entries.get(),
+                                (unsigned) entries->size(),
+                                &(*entries)[0] };
+    entries.release();
+    return usage;
+  }
+
   ASTContext &astContext = astUnit->getASTContext();
   
   // How much memory is used by AST nodes and types?
@@ -6883,14 +7278,9 @@ CXTUResourceUsage clang_getCXTUResourceUsage(CXTranslationUnit TU) {
     (unsigned long) astContext.getSideTableAllocatedMemory());
   
   // How much memory is used for caching global code completion results?
-  unsigned long completionBytes = 0;
-  if (GlobalCodeCompletionAllocator *completionAllocator =
-      astUnit->getCachedCompletionAllocator().get()) {
-    completionBytes = completionAllocator->getTotalMemory();
-  }
   createCXTUResourceUsageEntry(*entries,
                                CXTUResourceUsage_GlobalCompletionResults,
-                               completionBytes);
+                               getCachedCompletionMemory(*astUnit));
   
   // How much memory is being used by SourceManager's content cache?
   createCXTUResourceUsageEntry(*entries,
@@ -6954,6 +7344,7 @@ void clang_disposeCXTUResourceUsage(CXTUResourceUsage usage) {
 }
 
 CXSourceRangeList *clang_getSkippedRanges(CXTranslationUnit TU, CXFile file) {
+  cxtu::TULock Lock(TU);
   CXSourceRangeList *skipped = new CXSourceRangeList;
   skipped->count = 0;
   skipped->ranges = nullptr;
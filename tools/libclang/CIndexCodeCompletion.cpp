@@ -280,9 +280,9 @@ struct AllocatedCXCodeCompleteResults : public CXCodeCompleteResults {
   /// the code-completion results.
   SmallVector<const llvm::MemoryBuffer *, 1> TemporaryBuffers;
   
-  /// \brief Allocator used to store globally cached code-completion results.
-  IntrusiveRefCntPtr<clang::GlobalCodeCompletionAllocator>
-    CachedCompletionAllocator;
+  /// \brief The groups that own the globally cached code-completion results.
+  std::vector<std::shared_ptr<const ASTUnit::CachedCompletionGroup> >
+    CachedCompletionGroups;
   
   /// \brief Allocator used to store code completion results.
   IntrusiveRefCntPtr<clang::GlobalCodeCompletionAllocator>
@@ -653,7 +653,10 @@ struct CodeCompleteAtInfo {
   unsigned complete_column;
   ArrayRef<CXUnsavedFile> unsaved_files;
   unsigned options;
+  const char *prefix;
+  unsigned max_results;
   CXCodeCompleteResults *result;
+  const cxtu::TULock *Lock;
 };
 void clang_codeCompleteAt_Impl(void *UserData) {
   CodeCompleteAtInfo *CCAI = static_cast<CodeCompleteAtInfo*>(UserData);
@@ -686,6 +689,12 @@ void clang_codeCompleteAt_Impl(void *UserData) {
   if (CXXIdx->isOptEnabled(CXGlobalOpt_ThreadBackgroundPriorityForEditing))
     setThreadBackgroundPriority();
 
+  // The caller holds the lock and waits for this thread, which may not be
+  // the caller's; act with its holds, and restore them if we crash.
+  cxtu::TULockDelegation Delegation(*CCAI->Lock);
+  llvm::CrashRecoveryContextCleanupRegistrar<cxtu::TULockDelegation,
+      llvm::CrashRecoveryContextDestructorCleanup<cxtu::TULockDelegation> >
+    DelegationCleanup(&Delegation);
   ASTUnit::ConcurrencyCheck Check(*AST);
 
   // Perform the remapping of source files.
@@ -711,6 +720,9 @@ void clang_codeCompleteAt_Impl(void *UserData) {
   CodeCompleteOptions Opts;
   Opts.IncludeBriefComments = IncludeBriefComments;
   CaptureCompletionResults Capture(Opts, *Results, &TU);
+  if (CCAI->prefix || CCAI->max_results)
+    Capture.setResultFilter(CCAI->prefix ? CCAI->prefix : "",
+                            CCAI->max_results);
 
   // Perform completion.
   AST->CodeComplete(complete_filename, complete_line, complete_column,
@@ -725,11 +737,11 @@ void clang_codeCompleteAt_Impl(void *UserData) {
 
   Results->DiagnosticsWrappers.resize(Results->Diagnostics.size());
 
-  // Keep a reference to the allocator used for cached global completions, so
+  // Keep a reference to the groups that own the cached global completions, so
   // that we can be sure that the memory used by our code completion strings
   // doesn't get freed due to subsequent reparses (while the code completion
   // results are still active).
-  Results->CachedCompletionAllocator = AST->getCachedCompletionAllocator();
+  Results->CachedCompletionGroups = AST->getCachedCompletionGroups().vec();
 
   
 
@@ -807,24 +819,22 @@ void clang_codeCompleteAt_Impl(void *UserData) {
 #endif
   CCAI->result = Results;
 }
-CXCodeCompleteResults *clang_codeCompleteAt(CXTranslationUnit TU,
-                                            const char *complete_filename,
-                                            unsigned complete_line,
-                                            unsigned complete_column,
-                                            struct CXUnsavedFile *unsaved_files,
-                                            unsigned num_unsaved_files,
-                                            unsigned options) {
-  LOG_FUNC_SECTION {
-    *Log << TU << ' '
-         << complete_filename << ':' << complete_line << ':' << complete_column;
-  }
-
+static CXCodeCompleteResults *
+codeCompleteAt(CXTranslationUnit TU, const char *complete_filename,
+               unsigned complete_line, unsigned complete_column,
+               struct CXUnsavedFile *unsaved_files,
+               unsigned num_unsaved_files, unsigned options,
+               const char *prefix, unsigned max_results) {
   if (num_unsaved_files && !unsaved_files)
     return nullptr;
 
+  // Code completion updates the translation unit's cached completion results,
+  // so it takes the lock like a reparse. Take it on this thread, which may
+  // already hold it if we were called from a visitor.
+  cxtu::TULock Lock(TU);
   CodeCompleteAtInfo CCAI = {TU, complete_filename, complete_line,
     complete_column, llvm::makeArrayRef(unsaved_files, num_unsaved_files),
-    options, nullptr};
+    options, prefix, max_results, nullptr, &Lock};
 
   if (getenv("LIBCLANG_NOTHREADS")) {
     clang_codeCompleteAt_Impl(&CCAI);
@@ -843,6 +853,42 @@ CXCodeCompleteResults *clang_codeCompleteAt(CXTranslationUnit TU,
   return CCAI.result;
 }
 
+CXCodeCompleteResults *clang_codeCompleteAt(CXTranslationUnit TU,
+                                            const char *complete_filename,
+                                            unsigned complete_line,
+                                            unsigned complete_column,
+                                            struct CXUnsavedFile *unsaved_files,
+                                            unsigned num_unsaved_files,
+                                            unsigned options) {
+  LOG_FUNC_SECTION {
+    *Log << TU << ' '
+         << complete_filename << ':' << complete_line << ':' << complete_column;
+  }
+
+  return codeCompleteAt(TU, complete_filename, complete_line, complete_column,
+                        unsaved_files, num_unsaved_files, options,
+                        /*prefix=*/nullptr, /*max_results=*/0);
+}
+
+CXCodeCompleteResults *
+clang_codeCompleteAtWithPrefix(CXTranslationUnit TU,
+                               const char *complete_filename,
+                               unsigned complete_line,
+                               unsigned complete_column,
+                               struct CXUnsavedFile *unsaved_files,
+                               unsigned num_unsaved_files, unsigned options,
+                               const char *prefix, unsigned max_results) {
+  LOG_FUNC_SECTION {
+    *Log << TU << ' '
+         << complete_filename << ':' << complete_line << ':' << complete_column
+         << " prefix: " << (prefix ? prefix : "") << " max: " << max_results;
+  }
+
+  return codeCompleteAt(TU, complete_filename, complete_line, complete_column,
+                        unsaved_files, num_unsaved_files, options, prefix,
+                        max_results);
+}
+
 unsigned clang_defaultCodeCompleteOptions(void) {
   return CXCodeComplete_IncludeMacros;
 }
@@ -210,6 +210,7 @@ CXDiagnosticSetImpl *cxdiag::lazyCreateDiags(CXTranslationUnit TU,
 extern "C" {
 
 unsigned clang_getNumDiagnostics(CXTranslationUnit Unit) {
+  cxtu::TULock Lock(Unit);
   if (cxtu::isNotUsableTU(Unit)) {
     LOG_BAD_TU(Unit);
     return 0;
@@ -220,6 +221,7 @@ unsigned clang_getNumDiagnostics(CXTranslationUnit Unit) {
 }
 
 CXDiagnostic clang_getDiagnostic(CXTranslationUnit Unit, unsigned Index) {
+  cxtu::TULock Lock(Unit);
   if (cxtu::isNotUsableTU(Unit)) {
     LOG_BAD_TU(Unit);
     return nullptr;
@@ -237,6 +239,7 @@ CXDiagnostic clang_getDiagnostic(CXTranslationUnit Unit, unsigned Index) {
 }
 
 CXDiagnosticSet clang_getDiagnosticSetFromTU(CXTranslationUnit Unit) {
+  cxtu::TULock Lock(Unit);
   if (cxtu::isNotUsableTU(Unit)) {
     LOG_BAD_TU(Unit);
     return nullptr;
@@ -411,6 +411,7 @@ extern "C" {
 
 CXResult clang_findReferencesInFile(CXCursor cursor, CXFile file,
                                     CXCursorAndRangeVisitor visitor) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(cursor));
   LogRef Log = Logger::make(LLVM_FUNCTION_NAME);
 
   if (clang_Cursor_isNull(cursor)) {
@@ -480,6 +481,7 @@ CXResult clang_findReferencesInFile(CXCursor cursor, CXFile file,
 
 CXResult clang_findIncludesInFile(CXTranslationUnit TU, CXFile file,
                              CXCursorAndRangeVisitor visitor) {
+  cxtu::TULock Lock(TU);
   if (cxtu::isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return CXResult_Invalid;
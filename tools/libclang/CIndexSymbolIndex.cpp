@@ -0,0 +1,219 @@
+//===- CIndexSymbolIndex.cpp - Persistent symbol index --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the libclang interface to the persistent, cross-TU
+// symbol index, which is filled from the results of the indexing callbacks.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CIndexer.h"
+#include "CLog.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Index/SymbolIndex.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include <cstring>
+
+using namespace clang;
+using namespace clang::index;
+
+namespace {
+
+/// \brief The state behind a CXSymbolIndex.
+struct SymbolIndexImpl {
+  /// \brief The file in which the index is stored.
+  std::string Path;
+
+  /// \brief The index as it was last read from its file, if it exists.
+  std::unique_ptr<SymbolIndex> Index;
+
+  /// \brief The updated index, created on the first update.
+  std::unique_ptr<SymbolIndexBuilder> Builder;
+
+  SymbolIndexBuilder &getBuilder() {
+    if (!Builder) {
+      Builder.reset(new SymbolIndexBuilder());
+      if (Index)
+        Builder->load(*Index);
+    }
+    return *Builder;
+  }
+};
+
+/// \brief Records the symbol occurrences reported while indexing a
+/// translation unit.
+class SymbolCollector {
+  SymbolIndexBuilder &Builder;
+
+  /// \brief The absolute path of each file seen so far, or an empty string
+  /// for the files whose occurrences are not being recorded.
+  llvm::DenseMap<CXFile, std::string> RecordedFiles;
+
+  StringRef getRecordedPath(CXFile File) {
+    llvm::DenseMap<CXFile, std::string>::iterator Known
+      = RecordedFiles.find(File);
+    if (Known != RecordedFiles.end())
+      return Known->second;
+
+    const FileEntry *FE = static_cast<const FileEntry *>(File);
+    SmallString<256> Path(FE->getName());
+    llvm::sys::fs::make_absolute(Path);
+
+    std::string &Recorded = RecordedFiles[File];
+    if (Builder.startFile(Path, FE->getSize(), FE->getModificationTime()))
+      Recorded = Path.str();
+    return Recorded;
+  }
+
+public:
+  explicit SymbolCollector(SymbolIndexBuilder &Builder) : Builder(Builder) { }
+
+  void record(CXIdxLoc Loc, const char *USR, SymbolRole Role) {
+    if (!USR || !*USR)
+      return;
+
+    CXFile File;
+    unsigned Line, Column, Offset;
+    clang_indexLoc_getFileLocation(Loc, nullptr, &File, &Line, &Column,
+                                   &Offset);
+    if (!File)
+      return;
+
+    StringRef Path = getRecordedPath(File);
+    if (!Path.empty())
+      Builder.addOccurrence(Path, USR, Role, Line, Column, Offset);
+  }
+};
+
+}
+
+static void indexDeclaration(CXClientData client_data,
+                             const CXIdxDeclInfo *info) {
+  if (!info->entityInfo)
+    return;
+  static_cast<SymbolCollector *>(client_data)->record(
+      info->loc, info->entityInfo->USR,
+      info->isDefinition ? SymbolRole_Definition : SymbolRole_Declaration);
+}
+
+static void indexEntityReference(CXClientData client_data,
+                                 const CXIdxEntityRefInfo *info) {
+  if (!info->referencedEntity)
+    return;
+  static_cast<SymbolCollector *>(client_data)->record(
+      info->loc, info->referencedEntity->USR, SymbolRole_Reference);
+}
+
+extern "C" {
+
+CXSymbolIndex clang_SymbolIndex_create(const char *index_path) {
+  if (!index_path)
+    return nullptr;
+
+  std::pair<SymbolIndex *, SymbolIndex::ErrorCode> Result =
+      SymbolIndex::readIndex(index_path);
+  if (Result.second == SymbolIndex::EC_IOError) {
+    LOG_FUNC_SECTION {
+      *Log << index_path << " is not a symbol index";
+    }
+    return nullptr;
+  }
+
+  SymbolIndexImpl *Impl = new SymbolIndexImpl();
+  Impl->Path = index_path;
+  Impl->Index.reset(Result.first);
+  return Impl;
+}
+
+void clang_SymbolIndex_dispose(CXSymbolIndex index) {
+  delete static_cast<SymbolIndexImpl *>(index);
+}
+
+int clang_SymbolIndex_indexSourceFile(CXSymbolIndex index, CXIndex CIdx,
+                                      const char *source_filename,
+                                      const char *const *command_line_args,
+                                      int num_command_line_args,
+                                      struct CXUnsavedFile *unsaved_files,
+                                      unsigned num_unsaved_files,
+                                      unsigned TU_options) {
+  if (!index || !CIdx)
+    return CXError_InvalidArguments;
+
+  SymbolIndexImpl *Impl = static_cast<SymbolIndexImpl *>(index);
+  SymbolCollector Collector(Impl->getBuilder());
+
+  IndexerCallbacks Callbacks;
+  std::memset(&Callbacks, 0, sizeof(Callbacks));
+  Callbacks.indexDeclaration = indexDeclaration;
+  Callbacks.indexEntityReference = indexEntityReference;
+
+  CXIndexAction Action = clang_IndexAction_create(CIdx);
+  int Result = clang_indexSourceFile(Action, &Collector, &Callbacks,
+                                     sizeof(Callbacks), CXIndexOpt_None,
+                                     source_filename, command_line_args,
+                                     num_command_line_args, unsaved_files,
+                                     num_unsaved_files, /*out_TU=*/nullptr,
+                                     TU_options);
+  clang_IndexAction_dispose(Action);
+  return Result;
+}
+
+void clang_SymbolIndex_removeFile(CXSymbolIndex index, const char *filename) {
+  if (!index || !filename)
+    return;
+
+  SmallString<256> Path(filename);
+  llvm::sys::fs::make_absolute(Path);
+  static_cast<SymbolIndexImpl *>(index)->getBuilder().removeFile(Path);
+}
+
+int clang_SymbolIndex_save(CXSymbolIndex index) {
+  if (!index)
+    return 1;
+
+  SymbolIndexImpl *Impl = static_cast<SymbolIndexImpl *>(index);
+  if (!Impl->Builder)
+    return 0;
+
+  if (Impl->Builder->writeIndex(Impl->Path) != SymbolIndex::EC_None)
+    return 1;
+
+  // Serve queries from the index we just wrote.
+  std::pair<SymbolIndex *, SymbolIndex::ErrorCode> Result =
+      SymbolIndex::readIndex(Impl->Path);
+  Impl->Index.reset(Result.first);
+  return 0;
+}
+
+unsigned clang_SymbolIndex_findOccurrences(CXSymbolIndex index,
+                                           const char *usr, unsigned roles,
+                                           CXSymbolOccurrenceVisitor visitor,
+                                           CXClientData client_data) {
+  if (!index || !usr || !visitor)
+    return 0;
+
+  SymbolIndexImpl *Impl = static_cast<SymbolIndexImpl *>(index);
+  if (!Impl->Index)
+    return 0;
+
+  SmallVector<SymbolOccurrence, 8> Occurrences;
+  Impl->Index->lookup(usr, roles, Occurrences);
+  for (unsigned I = 0, N = Occurrences.size(); I != N; ++I) {
+    // The file names are owned by the index and nul-terminated.
+    CXSymbolOccurrence Occurrence = {
+      Occurrences[I].File.data(), Occurrences[I].Line, Occurrences[I].Column,
+      Occurrences[I].Offset, (CXSymbolRole)Occurrences[I].Role
+    };
+    visitor(client_data, &Occurrence);
+  }
+  return Occurrences.size();
+}
+
+} // end extern "C"
@@ -39,6 +39,7 @@ bool cxcursor::getDeclCursorUSR(const Decl *D, SmallVectorImpl<char> &Buf) {
 extern "C" {
 
 CXString clang_getCursorUSR(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   const CXCursorKind &K = clang_getCursorKind(C);
 
   if (clang_isDeclaration(K)) {
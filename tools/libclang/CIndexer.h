@@ -18,6 +18,7 @@
 #include "clang-c/Index.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Path.h"
+#include <memory>
 #include <vector>
 
 namespace llvm {
@@ -31,6 +32,7 @@ namespace clang {
   class SourceLocation;
   class Token;
   class IdentifierInfo;
+  class PrecompiledPreambleCache;
 
 class CIndexer {
   bool OnlyLocalDecls;
@@ -38,6 +40,7 @@ class CIndexer {
   unsigned Options; // CXGlobalOptFlags.
 
   std::string ResourcesPath;
+  std::shared_ptr<PrecompiledPreambleCache> PreambleCache;
 
 public:
  CIndexer() : OnlyLocalDecls(false), DisplayDiagnostics(false),
@@ -63,6 +66,15 @@ public:
 
   /// \brief Get the path of the clang resource files.
   const std::string &getClangResourcesPath();
+
+  /// \brief The cache through which translation units in this index share
+  /// their precompiled preambles.
+  const std::shared_ptr<PrecompiledPreambleCache> &getPreambleCache() const {
+    return PreambleCache;
+  }
+  void setPreambleCache(std::shared_ptr<PrecompiledPreambleCache> Cache) {
+    PreambleCache = std::move(Cache);
+  }
 };
 
   /// \brief Return the current size to request for "safety".
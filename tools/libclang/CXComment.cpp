@@ -30,6 +30,7 @@ using namespace clang::cxcomment;
 extern "C" {
 
 CXComment clang_Cursor_getParsedComment(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   using namespace clang::cxcursor;
 
   if (!clang_isDeclaration(C.kind))
@@ -363,6 +364,7 @@ CXString clang_VerbatimLineComment_getText(CXComment CXC) {
 //===----------------------------------------------------------------------===//
 
 CXString clang_HTMLTagComment_getAsString(CXComment CXC) {
+  cxtu::TULock Lock(CXC.TranslationUnit);
   const HTMLTagComment *HTC = getASTNodeAs<HTMLTagComment>(CXC);
   if (!HTC)
     return cxstring::createNull();
@@ -378,6 +380,7 @@ CXString clang_HTMLTagComment_getAsString(CXComment CXC) {
 }
 
 CXString clang_FullComment_getAsHTML(CXComment CXC) {
+  cxtu::TULock Lock(CXC.TranslationUnit);
   const FullComment *FC = getASTNodeAs<FullComment>(CXC);
   if (!FC)
     return cxstring::createNull();
@@ -393,6 +396,7 @@ CXString clang_FullComment_getAsHTML(CXComment CXC) {
 }
 
 CXString clang_FullComment_getAsXML(CXComment CXC) {
+  cxtu::TULock Lock(CXC.TranslationUnit);
   const FullComment *FC = getASTNodeAs<FullComment>(CXC);
   if (!FC)
     return cxstring::createNull();
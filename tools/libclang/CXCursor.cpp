@@ -1030,6 +1030,7 @@ CXTranslationUnit clang_Cursor_getTranslationUnit(CXCursor cursor) {
 }
 
 int clang_Cursor_getNumArguments(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   if (clang_isDeclaration(C.kind)) {
     const Decl *D = cxcursor::getCursorDecl(C);
     if (const ObjCMethodDecl *MD = dyn_cast_or_null<ObjCMethodDecl>(D))
@@ -1049,6 +1050,7 @@ int clang_Cursor_getNumArguments(CXCursor C) {
 }
 
 CXCursor clang_Cursor_getArgument(CXCursor C, unsigned i) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   if (clang_isDeclaration(C.kind)) {
     const Decl *D = cxcursor::getCursorDecl(C);
     if (const ObjCMethodDecl *MD = dyn_cast_or_null<ObjCMethodDecl>(D)) {
@@ -1077,6 +1079,7 @@ CXCursor clang_Cursor_getArgument(CXCursor C, unsigned i) {
 }
 
 int clang_Cursor_getNumTemplateArguments(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   if (clang_getCursorKind(C) != CXCursor_FunctionDecl) {
     return -1;
   }
@@ -1141,6 +1144,7 @@ static int clang_Cursor_getTemplateArgument(
 
 enum CXTemplateArgumentKind clang_Cursor_getTemplateArgumentKind(CXCursor C,
                                                                  unsigned I) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   TemplateArgument TA;
   if (clang_Cursor_getTemplateArgument(C, I, &TA)) {
     return CXTemplateArgumentKind_Invalid;
@@ -1164,6 +1168,7 @@ enum CXTemplateArgumentKind clang_Cursor_getTemplateArgumentKind(CXCursor C,
 }
 
 CXType clang_Cursor_getTemplateArgumentType(CXCursor C, unsigned I) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   TemplateArgument TA;
   if (clang_Cursor_getTemplateArgument(C, I, &TA) !=
       CXGetTemplateArgumentStatus_Success) {
@@ -1178,6 +1183,7 @@ CXType clang_Cursor_getTemplateArgumentType(CXCursor C, unsigned I) {
 }
 
 long long clang_Cursor_getTemplateArgumentValue(CXCursor C, unsigned I) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   TemplateArgument TA;
   if (clang_Cursor_getTemplateArgument(C, I, &TA) !=
       CXGetTemplateArgumentStatus_Success) {
@@ -1195,6 +1201,7 @@ long long clang_Cursor_getTemplateArgumentValue(CXCursor C, unsigned I) {
 
 unsigned long long clang_Cursor_getTemplateArgumentUnsignedValue(CXCursor C,
                                                                  unsigned I) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   TemplateArgument TA;
   if (clang_Cursor_getTemplateArgument(C, I, &TA) !=
       CXGetTemplateArgumentStatus_Success) {
@@ -1277,6 +1284,7 @@ unsigned clang_CXCursorSet_insert(CXCursorSet set, CXCursor cursor) {
 }
   
 CXCompletionString clang_getCursorCompletionString(CXCursor cursor) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(cursor));
   enum CXCursorKind kind = clang_getCursorKind(cursor);
   if (clang_isDeclaration(kind)) {
     const Decl *decl = getCursorDecl(cursor);
@@ -1336,6 +1344,7 @@ extern "C" {
 void clang_getOverriddenCursors(CXCursor cursor,
                                 CXCursor **overridden,
                                 unsigned *num_overridden) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(cursor));
   if (overridden)
     *overridden = nullptr;
   if (num_overridden)
@@ -1403,6 +1412,7 @@ void clang_disposeOverriddenCursors(CXCursor *overridden) {
   CXTranslationUnit TU = getCursorTU(*overridden);
   
   assert(Vec && TU);
+  cxtu::TULock Lock(TU);
 
   OverridenCursorsPool &pool =
     *static_cast<OverridenCursorsPool*>(TU->OverridenCursorsPool);
@@ -1411,6 +1421,7 @@ void clang_disposeOverriddenCursors(CXCursor *overridden) {
 }
 
 int clang_Cursor_isDynamicCall(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   const Expr *E = nullptr;
   if (clang_isExpression(C.kind))
     E = getCursorExpr(C);
@@ -1444,6 +1455,7 @@ int clang_Cursor_isDynamicCall(CXCursor C) {
 }
 
 CXType clang_Cursor_getReceiverType(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   CXTranslationUnit TU = cxcursor::getCursorTU(C);
   const Expr *E = nullptr;
   if (clang_isExpression(C.kind))
@@ -34,6 +34,14 @@ static bool isASTUnitSourceLocation(const CXSourceLocation &L) {
   return ((uintptr_t)L.ptr_data[0] & 0x1) == 0;
 }
 
+/// \brief Find the translation unit whose lock guards \p L, if any.
+static CXTranslationUnit getLocationTU(const CXSourceLocation &L) {
+  if (!isASTUnitSourceLocation(L) || !L.ptr_data[0])
+    return nullptr;
+  return cxtu::getTUForSourceManager(
+      static_cast<const SourceManager *>(L.ptr_data[0]));
+}
+
 //===----------------------------------------------------------------------===//
 // Basic construction and comparison of CXSourceLocations and CXSourceRanges.
 //===----------------------------------------------------------------------===//
@@ -122,6 +130,7 @@ CXSourceLocation clang_getLocation(CXTranslationUnit TU,
                                    CXFile file,
                                    unsigned line,
                                    unsigned column) {
+  cxtu::TULock Lock(TU);
   if (cxtu::isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return clang_getNullLocation();
@@ -155,6 +164,7 @@ CXSourceLocation clang_getLocation(CXTranslationUnit TU,
 CXSourceLocation clang_getLocationForOffset(CXTranslationUnit TU,
                                             CXFile file,
                                             unsigned offset) {
+  cxtu::TULock Lock(TU);
   if (cxtu::isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
     return clang_getNullLocation();
@@ -209,6 +219,7 @@ static void createNullLocation(CXString *filename, unsigned *line,
 extern "C" {
 
 int clang_Location_isInSystemHeader(CXSourceLocation location) {
+  cxtu::TULock Lock(getLocationTU(location));
   const SourceLocation Loc =
     SourceLocation::getFromRawEncoding(location.int_data);
   if (Loc.isInvalid())
@@ -220,6 +231,7 @@ int clang_Location_isInSystemHeader(CXSourceLocation location) {
 }
 
 int clang_Location_isFromMainFile(CXSourceLocation location) {
+  cxtu::TULock Lock(getLocationTU(location));
   const SourceLocation Loc =
     SourceLocation::getFromRawEncoding(location.int_data);
   if (Loc.isInvalid())
@@ -235,6 +247,7 @@ void clang_getExpansionLocation(CXSourceLocation location,
                                 unsigned *line,
                                 unsigned *column,
                                 unsigned *offset) {
+  cxtu::TULock Lock(getLocationTU(location));
   
   if (!isASTUnitSourceLocation(location)) {
     CXLoadedDiagnostic::decodeLocation(location, file, line, column, offset);
@@ -276,6 +289,7 @@ void clang_getPresumedLocation(CXSourceLocation location,
                                CXString *filename,
                                unsigned *line,
                                unsigned *column) {
+  cxtu::TULock Lock(getLocationTU(location));
 
   if (!isASTUnitSourceLocation(location)) {
     // Other SourceLocation implementations do not support presumed locations
@@ -318,6 +332,7 @@ void clang_getSpellingLocation(CXSourceLocation location,
                                unsigned *line,
                                unsigned *column,
                                unsigned *offset) {
+  cxtu::TULock Lock(getLocationTU(location));
   
   if (!isASTUnitSourceLocation(location)) {
     CXLoadedDiagnostic::decodeLocation(location, file, line,
@@ -356,6 +371,7 @@ void clang_getFileLocation(CXSourceLocation location,
                            unsigned *line,
                            unsigned *column,
                            unsigned *offset) {
+  cxtu::TULock Lock(getLocationTU(location));
 
   if (!isASTUnitSourceLocation(location)) {
     CXLoadedDiagnostic::decodeLocation(location, file, line,
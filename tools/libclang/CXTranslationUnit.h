@@ -17,13 +17,53 @@
 #include "CLog.h"
 #include "CXString.h"
 #include "clang-c/Index.h"
+#include "llvm/Support/Mutex.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
 
 namespace clang {
   class ASTUnit;
   class CIndexer;
+  class SourceManager;
 namespace index {
 class CommentToXMLConverter;
 } // namespace index
+
+namespace cxtu {
+
+/// \brief A recursive lock on a translation unit, which the thread holding it
+/// can lend to a thread that runs work on its behalf; see TULockDelegation.
+class TUMutex {
+  std::mutex Mutex;
+  std::condition_variable Released;
+
+  /// \brief The thread holding the lock, if any.
+  std::thread::id Owner;
+
+  /// \brief How many times the owner holds the lock.
+  unsigned Depth;
+
+  /// \brief The threads acting for other threads, and the threads whose
+  /// holds they use.
+  std::map<std::thread::id, std::thread::id> Delegates;
+
+  TUMutex(const TUMutex &) LLVM_DELETED_FUNCTION;
+  void operator=(const TUMutex &) LLVM_DELETED_FUNCTION;
+
+  std::thread::id getOwner(std::thread::id Thread) const;
+
+  friend class TULockDelegation;
+
+public:
+  TUMutex() : Depth(0) {}
+
+  void lock();
+  void unlock();
+};
+
+} // namespace cxtu
 } // namespace clang
 
 struct CXTranslationUnitImpl {
@@ -33,6 +73,13 @@ struct CXTranslationUnitImpl {
   void *Diagnostics;
   void *OverridenCursorsPool;
   clang::index::CommentToXMLConverter *CommentToXML;
+
+  /// \brief Serializes the libclang calls that use this translation unit.
+  clang::cxtu::TUMutex Lock;
+
+  /// \brief Whether the ASTUnit is hibernating, and must be woken before its
+  /// AST is used.
+  bool Hibernating;
 };
 
 namespace clang {
@@ -40,9 +87,14 @@ namespace cxtu {
 
 CXTranslationUnitImpl *MakeCXTranslationUnit(CIndexer *CIdx, ASTUnit *AU);
 
+/// \brief Load the AST of a hibernating translation unit again.
+void wakeTranslationUnit(CXTranslationUnit TU);
+
 static inline ASTUnit *getASTUnit(CXTranslationUnit TU) {
   if (!TU)
     return nullptr;
+  if (TU->Hibernating)
+    wakeTranslationUnit(TU);
   return TU->TheASTUnit;
 }
 
@@ -54,6 +106,66 @@ static inline bool isNotUsableTU(CXTranslationUnit TU) {
   return !TU;
 }
 
+/// \brief Record that the source locations in \p SM belong to \p TU, in place
+/// of \p OldSM, so that calls given only a source location can find the
+/// translation unit to lock.
+void updateSourceManager(CXTranslationUnit TU, const SourceManager *OldSM,
+                         const SourceManager *SM);
+
+/// \brief Find the translation unit whose source manager is \p SM, if any.
+CXTranslationUnit getTUForSourceManager(const SourceManager *SM);
+
+/// \brief Holds the lock of a translation unit for the duration of a libclang
+/// call that uses it.
+///
+/// Calls that only read the translation unit still populate caches in the
+/// AST, the source manager and the AST reader lazily, so they take turns with
+/// each other as well as with reparses. The lock is recursive, so visitors
+/// and other client callbacks may call back into libclang.
+class TULock {
+  TUMutex *Mutex;
+  std::thread::id Owner;
+
+  TULock(const TULock &) LLVM_DELETED_FUNCTION;
+  void operator=(const TULock &) LLVM_DELETED_FUNCTION;
+
+  friend class TULockDelegation;
+
+public:
+  explicit TULock(CXTranslationUnit TU)
+      : Mutex(TU ? &TU->Lock : nullptr), Owner(std::this_thread::get_id()) {
+    if (Mutex)
+      Mutex->lock();
+  }
+  ~TULock() {
+    if (Mutex)
+      Mutex->unlock();
+  }
+};
+
+/// \brief Lets the current thread act with the holds of the thread that took
+/// a TULock, while that thread waits for it.
+///
+/// libclang runs some calls on a separate thread to recover from crashes and
+/// to get a larger stack. The calling thread takes the lock and blocks until
+/// that thread is done, so the libclang calls made there, including those of
+/// the client's callbacks, must use the caller's holds rather than wait for
+/// them. Destroying the delegation, which also happens if the thread crashes,
+/// restores the holds the caller had, releasing any the thread did not.
+class TULockDelegation {
+  TUMutex *Mutex;
+  std::thread::id Owner;
+  std::thread::id Delegate;
+  unsigned Depth;
+
+  TULockDelegation(const TULockDelegation &) LLVM_DELETED_FUNCTION;
+  void operator=(const TULockDelegation &) LLVM_DELETED_FUNCTION;
+
+public:
+  explicit TULockDelegation(const TULock &Lock);
+  ~TULockDelegation();
+};
+
 #define LOG_BAD_TU(TU)                                  \
     do {                                                \
       LOG_FUNC_SECTION {                                \
@@ -138,6 +138,7 @@ static inline CXTranslationUnit GetTU(CXType CT) {
 extern "C" {
 
 CXType clang_getCursorType(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   using namespace cxcursor;
   
   CXTranslationUnit TU = cxcursor::getCursorTU(C);
@@ -219,6 +220,7 @@ CXType clang_getCursorType(CXCursor C) {
 }
 
 CXString clang_getTypeSpelling(CXType CT) {
+  cxtu::TULock Lock(GetTU(CT));
   QualType T = GetQualType(CT);
   if (T.isNull())
     return cxstring::createEmpty();
@@ -234,6 +236,7 @@ CXString clang_getTypeSpelling(CXType CT) {
 }
 
 CXType clang_getTypedefDeclUnderlyingType(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   using namespace cxcursor;
   CXTranslationUnit TU = cxcursor::getCursorTU(C);
 
@@ -252,6 +255,7 @@ CXType clang_getTypedefDeclUnderlyingType(CXCursor C) {
 }
 
 CXType clang_getEnumDeclIntegerType(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   using namespace cxcursor;
   CXTranslationUnit TU = cxcursor::getCursorTU(C);
 
@@ -270,6 +274,7 @@ CXType clang_getEnumDeclIntegerType(CXCursor C) {
 }
 
 long long clang_getEnumConstantDeclValue(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   using namespace cxcursor;
 
   if (clang_isDeclaration(C.kind)) {
@@ -286,6 +291,7 @@ long long clang_getEnumConstantDeclValue(CXCursor C) {
 }
 
 unsigned long long clang_getEnumConstantDeclUnsignedValue(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   using namespace cxcursor;
 
   if (clang_isDeclaration(C.kind)) {
@@ -302,6 +308,7 @@ unsigned long long clang_getEnumConstantDeclUnsignedValue(CXCursor C) {
 }
 
 int clang_getFieldDeclBitWidth(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   using namespace cxcursor;
 
   if (clang_isDeclaration(C.kind)) {
@@ -317,6 +324,7 @@ int clang_getFieldDeclBitWidth(CXCursor C) {
 }
 
 CXType clang_getCanonicalType(CXType CT) {
+  cxtu::TULock Lock(GetTU(CT));
   if (CT.kind == CXType_Invalid)
     return CT;
 
@@ -347,6 +355,7 @@ unsigned clang_isRestrictQualifiedType(CXType CT) {
 }
 
 CXType clang_getPointeeType(CXType CT) {
+  cxtu::TULock Lock(GetTU(CT));
   QualType T = GetQualType(CT);
   const Type *TP = T.getTypePtrOrNull();
   
@@ -378,6 +387,7 @@ CXType clang_getPointeeType(CXType CT) {
 }
 
 CXCursor clang_getTypeDeclaration(CXType CT) {
+  cxtu::TULock Lock(GetTU(CT));
   if (CT.kind == CXType_Invalid)
     return cxcursor::MakeCXCursorInvalid(CXCursor_NoDeclFound);
 
@@ -494,6 +504,7 @@ unsigned clang_equalTypes(CXType A, CXType B) {
 }
 
 unsigned clang_isFunctionTypeVariadic(CXType X) {
+  cxtu::TULock Lock(GetTU(X));
   QualType T = GetQualType(X);
   if (T.isNull())
     return 0;
@@ -508,6 +519,7 @@ unsigned clang_isFunctionTypeVariadic(CXType X) {
 }
 
 CXCallingConv clang_getFunctionTypeCallingConv(CXType X) {
+  cxtu::TULock Lock(GetTU(X));
   QualType T = GetQualType(X);
   if (T.isNull())
     return CXCallingConv_Invalid;
@@ -535,6 +547,7 @@ CXCallingConv clang_getFunctionTypeCallingConv(CXType X) {
 }
 
 int clang_getNumArgTypes(CXType X) {
+  cxtu::TULock Lock(GetTU(X));
   QualType T = GetQualType(X);
   if (T.isNull())
     return -1;
@@ -551,6 +564,7 @@ int clang_getNumArgTypes(CXType X) {
 }
 
 CXType clang_getArgType(CXType X, unsigned i) {
+  cxtu::TULock Lock(GetTU(X));
   QualType T = GetQualType(X);
   if (T.isNull())
     return MakeCXType(QualType(), GetTU(X));
@@ -567,6 +581,7 @@ CXType clang_getArgType(CXType X, unsigned i) {
 }
 
 CXType clang_getResultType(CXType X) {
+  cxtu::TULock Lock(GetTU(X));
   QualType T = GetQualType(X);
   if (T.isNull())
     return MakeCXType(QualType(), GetTU(X));
@@ -578,6 +593,7 @@ CXType clang_getResultType(CXType X) {
 }
 
 CXType clang_getCursorResultType(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   if (clang_isDeclaration(C.kind)) {
     const Decl *D = cxcursor::getCursorDecl(C);
     if (const ObjCMethodDecl *MD = dyn_cast_or_null<ObjCMethodDecl>(D))
@@ -590,6 +606,7 @@ CXType clang_getCursorResultType(CXCursor C) {
 }
 
 unsigned clang_isPODType(CXType X) {
+  cxtu::TULock Lock(GetTU(X));
   QualType T = GetQualType(X);
   if (T.isNull())
     return 0;
@@ -600,6 +617,7 @@ unsigned clang_isPODType(CXType X) {
 }
 
 CXType clang_getElementType(CXType CT) {
+  cxtu::TULock Lock(GetTU(CT));
   QualType ET = QualType();
   QualType T = GetQualType(CT);
   const Type *TP = T.getTypePtrOrNull();
@@ -632,6 +650,7 @@ CXType clang_getElementType(CXType CT) {
 }
 
 long long clang_getNumElements(CXType CT) {
+  cxtu::TULock Lock(GetTU(CT));
   long long result = -1;
   QualType T = GetQualType(CT);
   const Type *TP = T.getTypePtrOrNull();
@@ -652,6 +671,7 @@ long long clang_getNumElements(CXType CT) {
 }
 
 CXType clang_getArrayElementType(CXType CT) {
+  cxtu::TULock Lock(GetTU(CT));
   QualType ET = QualType();
   QualType T = GetQualType(CT);
   const Type *TP = T.getTypePtrOrNull();
@@ -678,6 +698,7 @@ CXType clang_getArrayElementType(CXType CT) {
 }
 
 long long clang_getArraySize(CXType CT) {
+  cxtu::TULock Lock(GetTU(CT));
   long long result = -1;
   QualType T = GetQualType(CT);
   const Type *TP = T.getTypePtrOrNull();
@@ -695,6 +716,7 @@ long long clang_getArraySize(CXType CT) {
 }
 
 long long clang_Type_getAlignOf(CXType T) {
+  cxtu::TULock Lock(GetTU(T));
   if (T.kind == CXType_Invalid)
     return CXTypeLayoutError_Invalid;
   ASTContext &Ctx = cxtu::getASTUnit(GetTU(T))->getASTContext();
@@ -715,6 +737,7 @@ long long clang_Type_getAlignOf(CXType T) {
 }
 
 CXType clang_Type_getClassType(CXType CT) {
+  cxtu::TULock Lock(GetTU(CT));
   QualType ET = QualType();
   QualType T = GetQualType(CT);
   const Type *TP = T.getTypePtrOrNull();
@@ -726,6 +749,7 @@ CXType clang_Type_getClassType(CXType CT) {
 }
 
 long long clang_Type_getSizeOf(CXType T) {
+  cxtu::TULock Lock(GetTU(T));
   if (T.kind == CXType_Invalid)
     return CXTypeLayoutError_Invalid;
   ASTContext &Ctx = cxtu::getASTUnit(GetTU(T))->getASTContext();
@@ -774,6 +798,7 @@ static long long visitRecordForValidation(const RecordDecl *RD) {
 }
 
 long long clang_Type_getOffsetOf(CXType PT, const char *S) {
+  cxtu::TULock Lock(GetTU(PT));
   // check that PT is not incomplete/dependent
   CXCursor PC = clang_getTypeDeclaration(PT);
   if (clang_isInvalid(PC.kind))
@@ -818,6 +843,7 @@ long long clang_Type_getOffsetOf(CXType PT, const char *S) {
 }
 
 enum CXRefQualifierKind clang_Type_getCXXRefQualifier(CXType T) {
+  cxtu::TULock Lock(GetTU(T));
   QualType QT = GetQualType(T);
   if (QT.isNull())
     return CXRefQualifier_None;
@@ -836,6 +862,7 @@ enum CXRefQualifierKind clang_Type_getCXXRefQualifier(CXType T) {
 }
 
 unsigned clang_Cursor_isBitField(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return 0;
   const FieldDecl *FD = dyn_cast_or_null<FieldDecl>(cxcursor::getCursorDecl(C));
@@ -845,6 +872,7 @@ unsigned clang_Cursor_isBitField(CXCursor C) {
 }
 
 CXString clang_getDeclObjCTypeEncoding(CXCursor C) {
+  cxtu::TULock Lock(cxcursor::getCursorTU(C));
   if (!clang_isDeclaration(C.kind))
     return cxstring::createEmpty();
 
@@ -873,6 +901,7 @@ CXString clang_getDeclObjCTypeEncoding(CXCursor C) {
 }
 
 int clang_Type_getNumTemplateArguments(CXType CT) {
+  cxtu::TULock Lock(GetTU(CT));
   QualType T = GetQualType(CT);
   if (T.isNull())
     return -1;
@@ -887,6 +916,7 @@ int clang_Type_getNumTemplateArguments(CXType CT) {
 }
 
 CXType clang_Type_getTemplateArgumentAsType(CXType CT, unsigned i) {
+  cxtu::TULock Lock(GetTU(CT));
   QualType T = GetQualType(CT);
   if (T.isNull())
     return MakeCXType(QualType(), GetTU(CT));
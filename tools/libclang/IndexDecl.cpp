@@ -336,6 +336,8 @@ void IndexingContext::indexDeclContext(const DeclContext *DC) {
 void IndexingContext::indexTopLevelDecl(const Decl *D) {
   if (isNotFromSourceFile(D->getLocation()))
     return;
+  if (isInFileIndexedElsewhere(D->getLocation()))
+    return;
 
   if (isa<ObjCMethodDecl>(D))
     return; // Wait for the objc container.
@@ -27,11 +27,17 @@
 #include "clang/Lex/PPConditionalDirectiveRecord.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/SemaConsumer.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/MutexGuard.h"
+#include <atomic>
 #include <cstdio>
+#if LLVM_ENABLE_THREADS
+#include <thread>
+#endif
 
 using namespace clang;
 using namespace cxtu;
@@ -405,14 +411,17 @@ class IndexingFrontendAction : public ASTFrontendAction {
   SessionSkipBodyData *SKData;
   std::unique_ptr<TUSkipBodyControl> SKCtrl;
 
+  IndexedFileSet *IndexedFiles;
+
 public:
   IndexingFrontendAction(CXClientData clientData,
                          IndexerCallbacks &indexCallbacks,
                          unsigned indexOptions,
                          CXTranslationUnit cxTU,
-                         SessionSkipBodyData *skData)
+                         SessionSkipBodyData *skData,
+                         IndexedFileSet *indexedFiles)
     : IndexCtx(clientData, indexCallbacks, indexOptions, cxTU),
-      CXTU(cxTU), SKData(skData) { }
+      CXTU(cxTU), SKData(skData), IndexedFiles(indexedFiles) { }
 
   std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
                                                  StringRef InFile) override {
@@ -424,6 +433,9 @@ public:
     }
 
     IndexCtx.setASTContext(CI.getASTContext());
+    if (IndexedFiles)
+      IndexCtx.setIndexedFileSet(IndexedFiles,
+                                 CI.getInvocation().getModuleHash());
     Preprocessor &PP = CI.getPreprocessor();
     PP.addPPCallbacks(llvm::make_unique<IndexPPCallbacks>(PP, IndexCtx));
     IndexCtx.setPreprocessor(PP);
@@ -474,6 +486,7 @@ struct IndexSourceFileInfo {
   ArrayRef<CXUnsavedFile> unsaved_files;
   CXTranslationUnit *out_TU;
   unsigned TU_options;
+  IndexedFileSet *indexed_files;
   CXErrorCode &result;
 };
 
@@ -615,7 +628,8 @@ static void clang_indexSourceFile_Impl(void *UserData) {
   std::unique_ptr<IndexingFrontendAction> IndexAction;
   IndexAction.reset(new IndexingFrontendAction(client_data, CB,
                                                index_options, CXTU->getTU(),
-                        SkipBodies ? IdxSession->SkipBodyData.get() : nullptr));
+                        SkipBodies ? IdxSession->SkipBodyData.get() : nullptr,
+                                               ITUI->indexed_files));
 
   // Recover resources if we crash before exiting this method.
   llvm::CrashRecoveryContextCleanupRegistrar<IndexingFrontendAction>
@@ -686,6 +700,7 @@ struct IndexTranslationUnitInfo {
   unsigned index_options;
   CXTranslationUnit TU;
   int result;
+  const cxtu::TULock *Lock;
 };
 
 } // anonymous namespace
@@ -789,6 +804,12 @@ static void clang_indexTranslationUnit_Impl(void *UserData) {
   if (!Unit)
     return;
 
+  // The caller holds the lock and waits for this thread, where the client's
+  // callbacks run; act with its holds, and restore them if we crash.
+  cxtu::TULockDelegation Delegation(*ITUI->Lock);
+  llvm::CrashRecoveryContextCleanupRegistrar<cxtu::TULockDelegation,
+      llvm::CrashRecoveryContextDestructorCleanup<cxtu::TULockDelegation> >
+    DelegationCleanup(&Delegation);
   ASTUnit::ConcurrencyCheck Check(*Unit);
 
   if (const FileEntry *PCHFile = Unit->getPCHFile())
@@ -991,6 +1012,7 @@ int clang_indexSourceFile(CXIndexAction idxAction,
       llvm::makeArrayRef(unsaved_files, num_unsaved_files),
       out_TU,
       TU_options,
+      /*indexed_files=*/nullptr,
       result};
 
   if (getenv("LIBCLANG_NOTHREADS")) {
@@ -1030,6 +1052,106 @@ int clang_indexSourceFile(CXIndexAction idxAction,
   return result;
 }
 
+int clang_indexCompilationDatabase(CXIndexAction idxAction,
+                                   CXClientData client_data,
+                                   IndexerCallbacks *index_callbacks,
+                                   unsigned index_callbacks_size,
+                                   unsigned index_options,
+                                   CXCompilationDatabase db,
+                                   unsigned num_threads) {
+  LOG_FUNC_SECTION {
+    *Log << "threads: " << num_threads;
+  }
+
+  if (!idxAction || !db)
+    return CXError_InvalidArguments;
+
+  std::vector<tooling::CompileCommand> Commands =
+      static_cast<tooling::CompilationDatabase *>(db)->getAllCompileCommands();
+
+  // The resources path is computed on first use; do it before the threads
+  // share the index.
+  IndexSessionData *IdxSession = static_cast<IndexSessionData *>(idxAction);
+  static_cast<CIndexer *>(IdxSession->CIdx)->getClangResourcesPath();
+
+  bool NoThreads = getenv("LIBCLANG_NOTHREADS");
+  IndexedFileSet IndexedFiles;
+  std::atomic<unsigned> NextCommand(0);
+  std::atomic<int> Result(CXError_Success);
+
+  auto IndexCommands = [&]() {
+    for (unsigned I = NextCommand++; I < Commands.size(); I = NextCommand++) {
+      const tooling::CompileCommand &Command = Commands[I];
+
+      // The threads share a working directory, so let the command resolve
+      // its relative paths itself. The first argument is the compiler.
+      std::vector<const char *> Args;
+      Args.push_back("-working-directory");
+      Args.push_back(Command.Directory.c_str());
+      for (unsigned A = 1, N = Command.CommandLine.size(); A < N; ++A)
+        Args.push_back(Command.CommandLine[A].c_str());
+
+      CXErrorCode TUResult = CXError_Failure;
+      IndexSourceFileInfo ITUI = {
+          idxAction,
+          client_data,
+          index_callbacks,
+          index_callbacks_size,
+          index_options,
+          /*source_filename=*/nullptr,
+          Args.data(),
+          (int)Args.size(),
+          ArrayRef<CXUnsavedFile>(),
+          /*out_TU=*/nullptr,
+          /*TU_options=*/0,
+          &IndexedFiles,
+          TUResult};
+
+      if (NoThreads) {
+        clang_indexSourceFile_Impl(&ITUI);
+      } else {
+        llvm::CrashRecoveryContext CRC;
+        if (!RunSafely(CRC, clang_indexSourceFile_Impl, &ITUI)) {
+          fprintf(stderr, "libclang: crash detected during indexing compile "
+                          "command: {\n");
+          fprintf(stderr, "  'directory' : '%s'\n", Command.Directory.c_str());
+          fprintf(stderr, "  'command_line_args' : [");
+          for (unsigned A = 0, N = Command.CommandLine.size(); A != N; ++A) {
+            if (A)
+              fprintf(stderr, ", ");
+            fprintf(stderr, "'%s'", Command.CommandLine[A].c_str());
+          }
+          fprintf(stderr, "],\n");
+          fprintf(stderr, "}\n");
+          TUResult = CXError_Crashed;
+        }
+      }
+
+      int Expected = CXError_Success;
+      if (TUResult != CXError_Success)
+        Result.compare_exchange_strong(Expected, TUResult);
+    }
+  };
+
+#if LLVM_ENABLE_THREADS
+  if (!num_threads)
+    num_threads = std::thread::hardware_concurrency();
+  if (NoThreads)
+    num_threads = 1;
+
+  std::vector<std::thread> Threads;
+  for (unsigned I = 1; I < num_threads && I < Commands.size(); ++I)
+    Threads.push_back(std::thread(IndexCommands));
+  IndexCommands();
+  for (auto &Thread : Threads)
+    Thread.join();
+#else
+  IndexCommands();
+#endif
+
+  return Result;
+}
+
 int clang_indexTranslationUnit(CXIndexAction idxAction,
                                CXClientData client_data,
                                IndexerCallbacks *index_callbacks,
@@ -1040,9 +1162,12 @@ int clang_indexTranslationUnit(CXIndexAction idxAction,
     *Log << TU;
   }
 
+  // Take the lock on this thread, which may already hold it if we were
+  // called from a visitor.
+  cxtu::TULock Lock(TU);
   IndexTranslationUnitInfo ITUI = { idxAction, client_data, index_callbacks,
                                     index_callbacks_size, index_options, TU,
-                                    0 };
+                                    0, &Lock };
 
   if (getenv("LIBCLANG_NOTHREADS")) {
     clang_indexTranslationUnit_Impl(&ITUI);
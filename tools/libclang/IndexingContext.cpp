@@ -14,6 +14,8 @@
 #include "clang/AST/DeclCXX.h"
 #include "clang/AST/DeclTemplate.h"
 #include "clang/Frontend/ASTUnit.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace clang;
 using namespace cxindex;
@@ -202,6 +204,37 @@ void IndexingContext::setPreprocessor(Preprocessor &PP) {
   cxtu::getASTUnit(CXTU)->setPreprocessor(&PP);
 }
 
+bool IndexedFileSet::claim(StringRef Key) {
+  llvm::MutexGuard MG(Mux);
+  return Files.insert(Key).second;
+}
+
+bool IndexingContext::isInFileIndexedElsewhere(SourceLocation Loc) {
+  if (!IndexedFiles || Loc.isInvalid())
+    return false;
+
+  SourceManager &SM = Ctx->getSourceManager();
+  FileID FID = SM.getFileID(SM.getFileLoc(Loc));
+  if (FID == SM.getMainFileID())
+    return false;
+  const FileEntry *FE = SM.getFileEntryForID(FID);
+  if (!FE)
+    return false;
+
+  std::pair<llvm::DenseMap<const FileEntry *, bool>::iterator, bool> Known =
+      FilesIndexedElsewhere.insert(std::make_pair(FE, false));
+  if (!Known.second)
+    return Known.first->second;
+
+  const llvm::sys::fs::UniqueID &ID = FE->getUniqueID();
+  std::string Key;
+  llvm::raw_string_ostream OS(Key);
+  OS << ID.getDevice() << ':' << ID.getFile() << ':'
+     << FE->getModificationTime() << ':' << IndexedFilesContext;
+  Known.first->second = !IndexedFiles->claim(OS.str());
+  return Known.first->second;
+}
+
 bool IndexingContext::isFunctionLocalDecl(const Decl *D) {
   assert(D);
 
@@ -247,6 +280,8 @@ void IndexingContext::ppIncludedFile(SourceLocation hashLoc,
                                      bool isModuleImport) {
   if (!CB.ppIncludedFile)
     return;
+  if (isInFileIndexedElsewhere(hashLoc))
+    return;
 
   ScratchAlloc SA(*this);
   CXIdxIncludedFileInfo Info = { getIndexLoc(hashLoc),
@@ -15,7 +15,10 @@
 #include "clang/AST/DeclGroup.h"
 #include "clang/AST/DeclObjC.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Mutex.h"
 #include <deque>
+#include <string>
 
 namespace clang {
   class FileEntry;
@@ -46,6 +49,22 @@ public:
   T *allocate();
 };
 
+/// \brief The files that the translation units indexed together have claimed,
+/// so that each file is only indexed by one of them per configuration.
+class IndexedFileSet {
+  llvm::sys::Mutex Mux;
+  llvm::StringSet<> Files;
+
+public:
+  IndexedFileSet() : Mux(/*recursive=*/false) {}
+
+  /// \brief Claim the file identified by \p Key for the calling translation
+  /// unit.
+  ///
+  /// \returns false if another translation unit claimed it first.
+  bool claim(StringRef Key);
+};
+
 struct EntityInfo : public CXIdxEntityInfo {
   const NamedDecl *Dcl;
   IndexingContext *IndexCtx;
@@ -292,6 +311,18 @@ class IndexingContext {
   typedef std::pair<const FileEntry *, const Decl *> RefFileOccurrence;
   llvm::DenseSet<RefFileOccurrence> RefFileOccurrences;
 
+  /// \brief The files claimed by the translation units indexed along with
+  /// this one, if any.
+  IndexedFileSet *IndexedFiles;
+
+  /// \brief Identifies the options this translation unit is parsed with, as
+  /// far as they affect the meaning of the files it claims.
+  std::string IndexedFilesContext;
+
+  /// \brief Whether each file reached so far was claimed by another
+  /// translation unit.
+  llvm::DenseMap<const FileEntry *, bool> FilesIndexedElsewhere;
+
   std::deque<DeclGroupRef> TUDeclsInObjCContainer;
   
   llvm::BumpPtrAllocator StrScratch;
@@ -337,7 +368,7 @@ public:
   IndexingContext(CXClientData clientData, IndexerCallbacks &indexCallbacks,
                   unsigned indexOptions, CXTranslationUnit cxTU)
     : Ctx(nullptr), ClientData(clientData), CB(indexCallbacks),
-      IndexOptions(indexOptions), CXTU(cxTU),
+      IndexOptions(indexOptions), CXTU(cxTU), IndexedFiles(nullptr),
       StrScratch(), StrAdapterCount(0) { }
 
   ASTContext &getASTContext() const { return *Ctx; }
@@ -345,6 +376,16 @@ public:
   void setASTContext(ASTContext &ctx);
   void setPreprocessor(Preprocessor &PP);
 
+  /// \brief Only index the files that no other translation unit sharing
+  /// \p Files claimed first under the same \p Context.
+  void setIndexedFileSet(IndexedFileSet *Files, StringRef Context) {
+    IndexedFiles = Files;
+    IndexedFilesContext = Context;
+  }
+
+  /// \brief Whether \p Loc is in a file that another translation unit indexes.
+  bool isInFileIndexedElsewhere(SourceLocation Loc);
+
   bool shouldSuppressRefs() const {
     return IndexOptions & CXIndexOpt_SuppressRedundantRefs;
   }
@@ -0,0 +1,142 @@
+//===- unittests/AST/DeclContextLookupTest.cpp - DeclContext lookup tests -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Tests for name lookup into DeclContexts with many names, and a benchmark of
+// the lookup tables, which can be run with --gtest_also_run_disabled_tests.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/DeclLookups.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace clang;
+
+namespace {
+
+/// \brief Build a translation unit with an enumeration and a namespace which
+/// each declare \p N names, and redeclare the first name in the namespace.
+std::string buildLargeContexts(unsigned N) {
+  std::string Code;
+  llvm::raw_string_ostream OS(Code);
+  OS << "enum Registers {\n";
+  for (unsigned I = 0; I != N; ++I)
+    OS << "  Reg" << I << ",\n";
+  OS << "};\n";
+  OS << "namespace N {\n";
+  for (unsigned I = 0; I != N; ++I)
+    OS << "  int var" << I << ";\n";
+  OS << "}\n";
+  OS << "namespace N { extern int var0; }\n";
+  return OS.str();
+}
+
+DeclarationName getName(ASTContext &Context, const Twine &Name) {
+  return DeclarationName(&Context.Idents.get(Name.str()));
+}
+
+template <typename T>
+T *lookupOne(DeclContext *DC, DeclarationName Name) {
+  DeclContext::lookup_result R = DC->lookup(Name);
+  if (R.size() != 1)
+    return nullptr;
+  return dyn_cast<T>(R[0]);
+}
+
+TEST(DeclContextLookup, FindsNamesInLargeContexts) {
+  const unsigned N = 1000;
+  std::unique_ptr<ASTUnit> AST = tooling::buildASTFromCode(
+      buildLargeContexts(N));
+  ASSERT_TRUE(AST.get());
+  ASTContext &Context = AST->getASTContext();
+  TranslationUnitDecl *TU = Context.getTranslationUnitDecl();
+
+  EnumDecl *Enum = lookupOne<EnumDecl>(TU, getName(Context, "Registers"));
+  ASSERT_TRUE(Enum != nullptr);
+  NamespaceDecl *NS = lookupOne<NamespaceDecl>(TU, getName(Context, "N"));
+  ASSERT_TRUE(NS != nullptr);
+
+  for (unsigned I = 0; I != N; ++I) {
+    DeclarationName Reg = getName(Context, "Reg" + Twine(I));
+    EnumConstantDecl *InTU = lookupOne<EnumConstantDecl>(TU, Reg);
+    ASSERT_TRUE(InTU != nullptr);
+    EXPECT_EQ(I, InTU->getInitVal().getZExtValue());
+    EXPECT_EQ(InTU, lookupOne<EnumConstantDecl>(Enum, Reg));
+
+    VarDecl *Var = lookupOne<VarDecl>(NS, getName(Context, "var" + Twine(I)));
+    ASSERT_TRUE(Var != nullptr);
+    // The redeclaration replaces the definition in the lookup table.
+    EXPECT_EQ(I == 0 ? SC_Extern : SC_None, Var->getStorageClass());
+  }
+
+  EXPECT_TRUE(TU->lookup(getName(Context, "Reg1000")).empty());
+  EXPECT_TRUE(NS->lookup(getName(Context, "Reg0")).empty());
+
+  // The names are visited in the order in which they were declared.
+  unsigned I = 0;
+  for (DeclContext::all_lookups_iterator L = NS->lookups_begin(),
+                                         E = NS->lookups_end();
+       L != E; ++L, ++I)
+    EXPECT_EQ(("var" + Twine(I)).str(), L.getLookupName().getAsString());
+  EXPECT_EQ(N, I);
+}
+
+double getWallTime() {
+  return llvm::TimeRecord::getCurrentTime().getWallTime();
+}
+
+TEST(DeclContextLookup, DISABLED_Benchmark) {
+  const unsigned N = 40000;
+  const unsigned Rounds = 20;
+
+  double Start = getWallTime();
+  std::unique_ptr<ASTUnit> AST = tooling::buildASTFromCode(
+      buildLargeContexts(N));
+  ASSERT_TRUE(AST.get());
+  double Parsed = getWallTime();
+
+  ASTContext &Context = AST->getASTContext();
+  TranslationUnitDecl *TU = Context.getTranslationUnitDecl();
+  std::vector<DeclarationName> Regs, Vars;
+  for (unsigned I = 0; I != N; ++I) {
+    Regs.push_back(getName(Context, "Reg" + Twine(I)));
+    Vars.push_back(getName(Context, "var" + Twine(I)));
+  }
+  EnumDecl *Enum = lookupOne<EnumDecl>(TU, getName(Context, "Registers"));
+  NamespaceDecl *NS = lookupOne<NamespaceDecl>(TU, getName(Context, "N"));
+  ASSERT_TRUE(Enum && NS);
+
+  // The first lookup into the enumeration builds its table.
+  double BuildStart = getWallTime();
+  Enum->lookup(Regs[0]);
+  double Built = getWallTime();
+
+  unsigned Found = 0;
+  for (unsigned R = 0; R != Rounds; ++R)
+    for (unsigned I = 0; I != N; ++I)
+      Found += TU->lookup(Regs[I]).size() + Enum->lookup(Regs[I]).size() +
+               NS->lookup(Vars[I]).size();
+  double LookedUp = getWallTime();
+  EXPECT_EQ(3 * N * Rounds, Found);
+
+  llvm::outs() << "Parsing " << N << " enumerators and variables: "
+               << llvm::format("%.4f", Parsed - Start) << "s\n"
+               << "Building the enumeration's lookup table: "
+               << llvm::format("%.4f", Built - BuildStart) << "s\n"
+               << "Performing " << 3 * N * Rounds << " lookups: "
+               << llvm::format("%.4f", LookedUp - Built) << "s\n";
+}
+
+} // end anonymous namespace
@@ -0,0 +1,186 @@
+//===- unittests/Frontend/CompressedBlobsTest.cpp - AST file compression --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Tests for the compression of source buffers embedded in AST files, and a
+// benchmark of loading such files, which can be run with
+// --gtest_also_run_disabled_tests.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "llvm/Support/Compression.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <cstdlib>
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+/// \brief Build a header with \p N documented structures.
+std::string buildHeader(unsigned N) {
+  std::string Code;
+  raw_string_ostream OS(Code);
+  for (unsigned I = 0; I != N; ++I)
+    OS << "/// \\brief The layout of register block " << I << ".\n"
+       << "struct block" << I << " {\n"
+       << "  unsigned control;\n"
+       << "  unsigned status;\n"
+       << "  unsigned data[" << (I % 7 + 1) << "];\n"
+       << "};\n";
+  return OS.str();
+}
+
+/// \brief Write a PCH for \p HeaderCode, which is provided to the compiler as
+/// an overridden file and is therefore embedded in the PCH.
+bool writePCH(StringRef HeaderCode, StringRef OutputPath, bool Compress) {
+  CompilerInvocation *Invocation = new CompilerInvocation;
+  Invocation->getPreprocessorOpts().addRemappedFile(
+      "blocks.h", MemoryBuffer::getMemBufferCopy(HeaderCode).release());
+  Invocation->getFrontendOpts().Inputs.push_back(
+      FrontendInputFile("blocks.h", IK_C));
+  Invocation->getFrontendOpts().ProgramAction = frontend::GeneratePCH;
+  Invocation->getFrontendOpts().OutputFile = OutputPath;
+  Invocation->getHeaderSearchOpts().ModulesCompressBlobs = Compress;
+  Invocation->getTargetOpts().Triple = "i386-unknown-linux-gnu";
+  CompilerInstance Compiler;
+  Compiler.setInvocation(Invocation);
+  Compiler.createDiagnostics();
+
+  GeneratePCHAction Action;
+  return Compiler.ExecuteAction(Action);
+}
+
+/// \brief Load the AST file at \p Path and read every source buffer it
+/// embeds.
+///
+/// \returns the total size of the buffers, or 0 if the file could not be
+/// loaded.
+uint64_t loadBuffers(StringRef Path) {
+  IntrusiveRefCntPtr<DiagnosticsEngine> Diags =
+      CompilerInstance::createDiagnostics(new DiagnosticOptions());
+  std::unique_ptr<ASTUnit> AST =
+      ASTUnit::LoadFromASTFile(Path, Diags, FileSystemOptions());
+  if (!AST)
+    return 0;
+
+  SourceManager &SM = AST->getSourceManager();
+  uint64_t Size = 0;
+  for (unsigned I = 0, N = SM.loaded_sloc_entry_size(); I != N; ++I) {
+    const SrcMgr::SLocEntry &Entry = SM.getLoadedSLocEntry(I);
+    if (!Entry.isFile())
+      continue;
+    const SrcMgr::ContentCache *Content = Entry.getFile().getContentCache();
+    if (Content->BufferOverridden || !Content->OrigEntry)
+      Size += Content->getBuffer(*Diags, SM)->getBufferSize();
+  }
+  return Size;
+}
+
+double getWallTime() {
+  return TimeRecord::getCurrentTime().getWallTime();
+}
+
+class CompressedBlobsTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    // The benchmark can be pointed at the storage it should measure.
+    if (const char *BenchmarkDir = std::getenv("CLANG_AST_BENCHMARK_DIR")) {
+      Dir = BenchmarkDir;
+      OwnsDir = false;
+      return;
+    }
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("compressed-blobs", Dir));
+    OwnsDir = true;
+  }
+
+  void TearDown() override {
+    sys::fs::remove(PlainPath.str());
+    sys::fs::remove(CompressedPath.str());
+    if (OwnsDir)
+      sys::fs::remove(Dir.str());
+  }
+
+  void writeBoth(unsigned N) {
+    std::string Header = buildHeader(N);
+    PlainPath = Dir;
+    sys::path::append(PlainPath, "plain.pch");
+    CompressedPath = Dir;
+    sys::path::append(CompressedPath, "compressed.pch");
+    ASSERT_TRUE(writePCH(Header, PlainPath, /*Compress=*/false));
+    ASSERT_TRUE(writePCH(Header, CompressedPath, /*Compress=*/true));
+  }
+
+  SmallString<128> Dir;
+  SmallString<128> PlainPath;
+  SmallString<128> CompressedPath;
+  bool OwnsDir;
+};
+
+TEST_F(CompressedBlobsTest, RoundTrip) {
+  if (!zlib::isAvailable())
+    return;
+
+  writeBoth(200);
+  uint64_t PlainSize, CompressedSize;
+  ASSERT_FALSE(sys::fs::file_size(PlainPath.str(), PlainSize));
+  ASSERT_FALSE(sys::fs::file_size(CompressedPath.str(), CompressedSize));
+  EXPECT_LT(CompressedSize, PlainSize);
+
+  uint64_t PlainBuffers = loadBuffers(PlainPath);
+  EXPECT_GT(PlainBuffers, 0u);
+  EXPECT_EQ(PlainBuffers, loadBuffers(CompressedPath));
+}
+
+TEST_F(CompressedBlobsTest, DISABLED_Benchmark) {
+  const unsigned N = 20000;
+  const unsigned Rounds = 10;
+  if (!zlib::isAvailable()) {
+    outs() << "zlib is not available; nothing is compressed.\n";
+    return;
+  }
+
+  writeBoth(N);
+  const char *Names[] = { "plain", "compressed" };
+  StringRef Paths[] = { PlainPath, CompressedPath };
+  for (unsigned K = 0; K != 2; ++K) {
+    uint64_t FileSize;
+    ASSERT_FALSE(sys::fs::file_size(Paths[K], FileSize));
+
+    // The file was just written, so the first load is only cold if the
+    // storage does not cache it (for example a network file system mounted
+    // without attribute and data caching). The later loads are warm.
+    double Start = getWallTime();
+    uint64_t Buffers = loadBuffers(Paths[K]);
+    double Cold = getWallTime() - Start;
+    ASSERT_GT(Buffers, 0u);
+
+    Start = getWallTime();
+    for (unsigned R = 0; R != Rounds; ++R)
+      loadBuffers(Paths[K]);
+    double Warm = (getWallTime() - Start) / Rounds;
+
+    outs() << Names[K] << ": " << FileSize << " bytes on disk, " << Buffers
+           << " bytes of source buffers, first load "
+           << format("%.4f", Cold) << "s, later loads "
+           << format("%.4f", Warm) << "s\n";
+  }
+}
+
+} // end anonymous namespace
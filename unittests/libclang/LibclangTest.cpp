@@ -8,13 +8,22 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang-c/Index.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
+#include <atomic>
+#include <cstring>
 #include <fstream>
+#include <mutex>
 #include <set>
+#include <vector>
+#if LLVM_ENABLE_THREADS
+#include <thread>
+#endif
 #define DEBUG_TYPE "libclang-test"
 
 TEST(libclang, clang_parseTranslationUnit2_InvalidArgs) {
@@ -465,3 +474,339 @@ TEST_F(LibclangReparseTest, ReparseWithModule) {
   ASSERT_TRUE(ReparseTU(0, nullptr /* No unsaved files. */));
   EXPECT_EQ(0U, clang_getNumDiagnostics(ClangTU));
 }
+
+static std::string getCompletionText(CXTranslationUnit TU,
+                                     const std::string &SourceName,
+                                     unsigned Line, unsigned Column,
+                                     CXUnsavedFile *Unsaved,
+                                     const char *Name) {
+  std::string Result;
+  CXCodeCompleteResults *Results = clang_codeCompleteAt(
+      TU, SourceName.c_str(), Line, Column, Unsaved, 1,
+      clang_defaultCodeCompleteOptions());
+  if (!Results)
+    return Result;
+  for (unsigned I = 0; I != Results->NumResults && Result.empty(); ++I) {
+    CXCompletionString Completion = Results->Results[I].CompletionString;
+    std::string Text;
+    bool Matches = false;
+    for (unsigned C = 0, N = clang_getNumCompletionChunks(Completion); C != N;
+         ++C) {
+      CXString Chunk = clang_getCompletionChunkText(Completion, C);
+      const char *ChunkText = clang_getCString(Chunk);
+      if (clang_getCompletionChunkKind(Completion, C) ==
+              CXCompletionChunk_TypedText &&
+          ChunkText && strcmp(ChunkText, Name) == 0)
+        Matches = true;
+      if (ChunkText)
+        Text += ChunkText;
+      clang_disposeString(Chunk);
+    }
+    if (Matches)
+      Result = Text;
+  }
+  clang_disposeCodeCompleteResults(Results);
+  return Result;
+}
+
+TEST_F(LibclangReparseTest, CachedCompletionsOfUnsavedHeader) {
+  std::string HeaderName = "HeaderFile.h";
+  std::string SourceName = "SourceFile.c";
+  std::string OldHeader = "int compute(long value);\n";
+  std::string NewHeader = "int compute(char value);\n";
+  ASSERT_EQ(OldHeader.size(), NewHeader.size());
+  WriteFile(HeaderName, OldHeader);
+  WriteFile(SourceName,
+            "#include \"HeaderFile.h\"\nint main() { return 0; }\n");
+
+  // The first translation unit sees the header as an unsaved file and
+  // caches the completions it provides in the index.
+  CXUnsavedFile Unsaved;
+  Unsaved.Filename = HeaderName.c_str();
+  Unsaved.Contents = OldHeader.c_str();
+  Unsaved.Length = OldHeader.size();
+  CXTranslationUnit OldTU = clang_parseTranslationUnit(
+      Index, SourceName.c_str(), nullptr, 0, &Unsaved, 1, TUFlags);
+  ASSERT_TRUE(OldTU != nullptr);
+  ASSERT_EQ(0, clang_reparseTranslationUnit(
+                   OldTU, 1, &Unsaved, clang_defaultReparseOptions(OldTU)));
+  EXPECT_EQ("intcompute(long value)",
+            getCompletionText(OldTU, SourceName, 2, 14, &Unsaved, "compute"));
+
+  // An edit that keeps the size of the unsaved header must not reuse the
+  // completions cached for its old contents.
+  Unsaved.Contents = NewHeader.c_str();
+  ClangTU = clang_parseTranslationUnit(Index, SourceName.c_str(), nullptr, 0,
+                                       &Unsaved, 1, TUFlags);
+  ASSERT_TRUE(ClangTU != nullptr);
+  ASSERT_TRUE(ReparseTU(1, &Unsaved));
+  EXPECT_EQ("intcompute(char value)",
+            getCompletionText(ClangTU, SourceName, 2, 14, &Unsaved,
+                              "compute"));
+  clang_disposeTranslationUnit(OldTU);
+}
+
+#if LLVM_ENABLE_THREADS
+static std::string describeCursorAt(CXTranslationUnit TU, CXFile File,
+                                    unsigned Line, unsigned Column) {
+  std::string Result;
+  auto Append = [&](CXString Str) {
+    if (const char *S = clang_getCString(Str))
+      Result += S;
+    Result += '|';
+    clang_disposeString(Str);
+  };
+
+  CXCursor C = clang_getCursor(TU, clang_getLocation(TU, File, Line, Column));
+  CXCursor Referenced = clang_getCursorReferenced(C);
+  Append(clang_getCursorSpelling(C));
+  Append(clang_getTypeSpelling(clang_getCursorType(C)));
+  Append(clang_getCursorSpelling(Referenced));
+  Append(clang_getCursorUSR(Referenced));
+  unsigned DefLine = 0;
+  clang_getSpellingLocation(clang_getCursorLocation(Referenced), nullptr,
+                            &DefLine, nullptr, nullptr);
+  Result += llvm::utostr(DefLine);
+  return Result;
+}
+
+TEST_F(LibclangReparseTest, ConcurrentQueries) {
+  const unsigned NumFunctions = 64;
+  std::string Header, Source = "#include \"HeaderFile.h\"\n";
+  std::vector<std::pair<unsigned, unsigned>> Locations;
+  for (unsigned I = 0; I != NumFunctions; ++I) {
+    std::string N = llvm::utostr(I);
+    Header += "struct S" + N + " { int a" + N + "; long b" + N + "; };\n";
+    std::string Line = "long f" + N + "(struct S" + N + " *s) { return s->a" +
+                       N + " + s->b" + N + "; }";
+    Locations.push_back(std::make_pair(I + 2, Line.find("s->a") + 4));
+    Locations.push_back(std::make_pair(I + 2, Line.find("s->b") + 4));
+    Source += Line + "\n";
+  }
+  std::string HeaderName = "HeaderFile.h";
+  std::string SourceName = "SourceFile.c";
+  WriteFile(HeaderName, Header);
+  WriteFile(SourceName, Source);
+
+  ClangTU = clang_parseTranslationUnit(Index, SourceName.c_str(), nullptr, 0,
+                                       nullptr, 0, TUFlags);
+  ASSERT_TRUE(ClangTU != nullptr);
+  // Build the preamble, so that queries deserialize the structs lazily; the
+  // lock keeps them from doing so at the same time.
+  ASSERT_TRUE(ReparseTU(0, nullptr));
+  CXFile File = clang_getFile(ClangTU, SourceName.c_str());
+  ASSERT_TRUE(File != nullptr);
+
+  std::vector<std::string> Expected;
+  for (const auto &Loc : Locations)
+    Expected.push_back(
+        describeCursorAt(ClangTU, File, Loc.first, Loc.second));
+
+  // Query the translation unit from several threads, each visiting the
+  // locations in a different order. The queries take turns.
+  const unsigned NumThreads = 8;
+  std::atomic<unsigned> Mismatches(0);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T != NumThreads; ++T) {
+    Threads.push_back(std::thread([&, T] {
+      for (unsigned Round = 0; Round != 4; ++Round)
+        for (unsigned I = 0, E = Locations.size(); I != E; ++I) {
+          unsigned L = (I * (2 * T + 1) + Round) % E;
+          if (describeCursorAt(ClangTU, File, Locations[L].first,
+                               Locations[L].second) != Expected[L])
+            ++Mismatches;
+        }
+    }));
+  }
+  for (auto &Thread : Threads)
+    Thread.join();
+  EXPECT_EQ(0U, Mismatches);
+
+  // Reparse while other threads query the translation unit itself.
+  std::atomic<bool> Done(false);
+  Threads.clear();
+  for (unsigned T = 0; T != NumThreads; ++T) {
+    Threads.push_back(std::thread([&] {
+      while (!Done) {
+        if (clang_getNumDiagnostics(ClangTU) != 0)
+          ++Mismatches;
+        CXString Spelling = clang_getTranslationUnitSpelling(ClangTU);
+        clang_disposeString(Spelling);
+      }
+    }));
+  }
+  for (unsigned I = 0; I != 4; ++I)
+    EXPECT_EQ(0, clang_reparseTranslationUnit(
+                     ClangTU, 0, nullptr, clang_defaultReparseOptions(ClangTU)));
+  Done = true;
+  for (auto &Thread : Threads)
+    Thread.join();
+  EXPECT_EQ(0U, Mismatches);
+}
+#endif
+
+namespace {
+struct FunctionAnnotations {
+  CXTranslationUnit TU;
+  unsigned Tokens;
+  unsigned AnnotatedTokens;
+  unsigned Completions;
+};
+}
+
+static CXChildVisitResult annotateFunction(CXCursor C, CXCursor,
+                                           CXClientData client_data) {
+  if (clang_getCursorKind(C) != CXCursor_FunctionDecl)
+    return CXChildVisit_Continue;
+
+  FunctionAnnotations *Data = static_cast<FunctionAnnotations *>(client_data);
+  CXToken *Tokens = nullptr;
+  unsigned NumTokens = 0;
+  clang_tokenize(Data->TU, clang_getCursorExtent(C), &Tokens, &NumTokens);
+  std::vector<CXCursor> Cursors(NumTokens);
+  if (NumTokens)
+    clang_annotateTokens(Data->TU, Tokens, NumTokens, &Cursors[0]);
+  Data->Tokens += NumTokens;
+  for (const CXCursor &Annotation : Cursors)
+    if (!clang_Cursor_isNull(Annotation))
+      ++Data->AnnotatedTokens;
+  clang_disposeTokens(Data->TU, Tokens, NumTokens);
+
+  // Code completion runs on a separate thread too, and updates the cached
+  // completion results while the visitor holds the lock.
+  CXString File;
+  unsigned Line;
+  clang_getPresumedLocation(clang_getCursorLocation(C), &File, &Line, nullptr);
+  CXCodeCompleteResults *Results = clang_codeCompleteAt(
+      Data->TU, clang_getCString(File), Line, 1, nullptr, 0,
+      clang_defaultCodeCompleteOptions());
+  if (Results && Results->NumResults)
+    ++Data->Completions;
+  clang_disposeCodeCompleteResults(Results);
+  clang_disposeString(File);
+  return CXChildVisit_Continue;
+}
+
+TEST_F(LibclangReparseTest, AnnotateTokensFromVisitor) {
+  std::string SourceName = "SourceFile.c";
+  WriteFile(SourceName, "int twice(int a) { return a * 2; }\n"
+                        "int apply(int b) { return twice(b); }\n");
+  ClangTU = clang_parseTranslationUnit(Index, SourceName.c_str(), nullptr, 0,
+                                       nullptr, 0, TUFlags);
+  ASSERT_TRUE(ClangTU != nullptr);
+
+  // Annotation and completion run on a separate thread, which must not wait
+  // for the lock the visitor holds.
+  FunctionAnnotations Data = { ClangTU, 0, 0, 0 };
+  clang_visitChildren(clang_getTranslationUnitCursor(ClangTU),
+                      annotateFunction, &Data);
+  EXPECT_LT(0U, Data.Tokens);
+  EXPECT_EQ(Data.Tokens, Data.AnnotatedTokens);
+  EXPECT_EQ(2U, Data.Completions);
+}
+
+namespace {
+struct IndexedDeclarations {
+  std::mutex Lock;
+  std::multiset<std::string> Names;
+};
+}
+
+static void recordDeclaration(CXClientData client_data,
+                              const CXIdxDeclInfo *info) {
+  IndexedDeclarations *Decls = static_cast<IndexedDeclarations *>(client_data);
+  if (!info->entityInfo->name)
+    return;
+  std::lock_guard<std::mutex> Guard(Decls->Lock);
+  Decls->Names.insert(info->entityInfo->name);
+}
+
+TEST_F(LibclangReparseTest, IndexCompilationDatabase) {
+  ClangTU = nullptr;
+  const unsigned NumSources = 16;
+  std::string HeaderName = "HeaderFile.h";
+  WriteFile(HeaderName, "#ifndef H\n#define H\nint shared(int);\n#endif\n");
+
+  std::string Directory;
+  for (char C : TestDir) {
+    if (C == '\\')
+      Directory += '\\';
+    Directory += C;
+  }
+  std::string Commands = "[";
+  for (unsigned I = 0; I != NumSources; ++I) {
+    std::string N = llvm::utostr(I);
+    std::string SourceName = "SourceFile" + N + ".c";
+    WriteFile(SourceName, "#include \"HeaderFile.h\"\nint f" + N +
+                              "(int x) { return shared(x); }\n");
+    if (I)
+      Commands += ",";
+    Commands += "{ \"directory\": \"" + Directory + "\", \"command\": "
+                "\"clang -c SourceFile" + N + ".c\", \"file\": \"SourceFile" +
+                N + ".c\" }";
+  }
+  Commands += "]";
+  std::string DatabaseName = "compile_commands.json";
+  WriteFile(DatabaseName, Commands);
+
+  CXCompilationDatabase_Error Error;
+  CXCompilationDatabase DB =
+      clang_CompilationDatabase_fromDirectory(TestDir.c_str(), &Error);
+  ASSERT_EQ(CXCompilationDatabase_NoError, Error);
+
+  IndexerCallbacks Callbacks;
+  memset(&Callbacks, 0, sizeof(Callbacks));
+  Callbacks.indexDeclaration = recordDeclaration;
+  IndexedDeclarations Decls;
+  CXIndexAction Action = clang_IndexAction_create(Index);
+  EXPECT_EQ(0, clang_indexCompilationDatabase(
+                   Action, &Decls, &Callbacks, sizeof(Callbacks),
+                   CXIndexOpt_None, DB, /*num_threads=*/4));
+  clang_IndexAction_dispose(Action);
+  clang_CompilationDatabase_dispose(DB);
+
+  // The header is only indexed along with one of the source files.
+  EXPECT_EQ(1U, Decls.Names.count("shared"));
+  for (unsigned I = 0; I != NumSources; ++I)
+    EXPECT_EQ(1U, Decls.Names.count("f" + llvm::utostr(I)));
+}
+
+static void ignoreOccurrence(CXClientData, const CXSymbolOccurrence *) {}
+
+TEST_F(LibclangReparseTest, SymbolIndexUpdaters) {
+  ClangTU = nullptr;
+  std::string FirstName = "First.c";
+  std::string SecondName = "Second.c";
+  WriteFile(FirstName, "int first(void) { return 1; }\n");
+  WriteFile(SecondName, "int second(void) { return 2; }\n");
+  llvm::SmallString<256> IndexPath(TestDir);
+  llvm::sys::path::append(IndexPath, "symbols.idx");
+
+  // Both updaters open the index before either of them saves; the second
+  // save must keep the updates of the first.
+  CXSymbolIndex First = clang_SymbolIndex_create(IndexPath.c_str());
+  CXSymbolIndex Second = clang_SymbolIndex_create(IndexPath.c_str());
+  ASSERT_TRUE(First != nullptr);
+  ASSERT_TRUE(Second != nullptr);
+  EXPECT_EQ(0, clang_SymbolIndex_indexSourceFile(
+                   First, Index, FirstName.c_str(), nullptr, 0, nullptr, 0,
+                   CXTranslationUnit_None));
+  EXPECT_EQ(0, clang_SymbolIndex_indexSourceFile(
+                   Second, Index, SecondName.c_str(), nullptr, 0, nullptr, 0,
+                   CXTranslationUnit_None));
+  EXPECT_EQ(0, clang_SymbolIndex_save(First));
+  EXPECT_EQ(0, clang_SymbolIndex_save(Second));
+  clang_SymbolIndex_dispose(First);
+  clang_SymbolIndex_dispose(Second);
+
+  CXSymbolIndex Merged = clang_SymbolIndex_create(IndexPath.c_str());
+  ASSERT_TRUE(Merged != nullptr);
+  unsigned Roles = CXSymbolRole_Declaration | CXSymbolRole_Definition |
+                   CXSymbolRole_Reference;
+  EXPECT_EQ(1U, clang_SymbolIndex_findOccurrences(Merged, "c:@F@first", Roles,
+                                                  ignoreOccurrence, nullptr));
+  EXPECT_EQ(1U, clang_SymbolIndex_findOccurrences(Merged, "c:@F@second", Roles,
+                                                  ignoreOccurrence, nullptr));
+  clang_SymbolIndex_dispose(Merged);
+  llvm::sys::fs::remove(IndexPath.str());
+}